@@ -21,6 +21,8 @@
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
+ 16-oct-2026  QC      DMA pool keeps buffers in use over PRU restart
+ 16-oct-2026  QC      pool for zero-copy DMA buffers
  12-nov-2018  JH      entered beta phase
  */
 
@@ -31,6 +33,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <assert.h>
+#include <iterator>
 
 #include "logger.hpp"
 #include "mailbox.h"
@@ -39,6 +42,9 @@
 
 #include "application.hpp"
 
+// alignment of zero-copy DMA buffers in DDR, bytes
+#define DDRMEM_DMA_POOL_ALIGN	64
+
 /* another singleton */
 ddrmem_c *ddrmem;
 
@@ -46,6 +52,10 @@ ddrmem_c::ddrmem_c()
 {
 	log_label = "DDRMEM";
 	pmi_address_overlay = 0 ;
+	dma_pool_offset = 0;
+	dma_pool_size = 0;
+	dma_pool_base = NULL;
+	pthread_mutex_init(&dma_pool_mutex, NULL);
 }
 
 // check allocated memory and print info
@@ -66,6 +76,138 @@ void ddrmem_c::info()
 	INFO("  %d bytes of " QUNIBONE_NAME" memory allocated", sizeof(qunibus_memory_t));
 }
 
+/* Zero-copy DMA buffer pool
+ DDR memory allocated by uio_pruss behind ddrmem_t is free for device DMA buffers.
+ PRU reads/writes them directly with mailbox.dma.ddr_offset, instead of having
+ qunibusadapter copy the chunks through the small mailbox.dma.words[].
+ If "extram_pool_sz" leaves no memory behind ddrmem_t, or the pool is exhausted,
+ dma_buffer_alloc() returns heap memory and DMA works with mailbox staging as before.
+ Each PRU access to DDR is slow (upto 400ns), ARM access is uncached.
+ Called on every PRU start, as the DDR may be mapped at a different address.
+ Buffers still held from the previous PRU session stay reserved, so they are
+ not handed out twice. If the DDR was remapped they are invalid: their
+ later dma_buffer_free() is ignored.
+ */
+void ddrmem_c::dma_pool_init()
+{
+	pthread_mutex_lock(&dma_pool_mutex);
+	dma_pool_free_blocks.clear();
+	dma_pool_offset = (sizeof(ddrmem_t) + DDRMEM_DMA_POOL_ALIGN - 1)
+			& ~(DDRMEM_DMA_POOL_ALIGN - 1);
+	if (len > dma_pool_offset)
+		dma_pool_size = (len - dma_pool_offset) & ~(DDRMEM_DMA_POOL_ALIGN - 1);
+	else
+		dma_pool_size = 0;
+	std::map<uint32_t, uint32_t>::iterator it;
+	if (!dma_pool_used_blocks.empty()) {
+		std::map<uint32_t, uint32_t>::reverse_iterator last = dma_pool_used_blocks.rbegin();
+		bool remapped = (dma_pool_base != (void *) base_virtual)
+				|| last->first + last->second > dma_pool_offset + dma_pool_size;
+		if (remapped) {
+			ERROR("%u zero-copy DMA buffers of previous PRU session lost, DDR memory remapped",
+					(unsigned) dma_pool_used_blocks.size());
+			for (it = dma_pool_used_blocks.begin(); it != dma_pool_used_blocks.end(); ++it)
+				dma_pool_stale_buffers.insert((uint16_t *) ((uint8_t *) dma_pool_base + it->first));
+			dma_pool_used_blocks.clear();
+		} else
+			WARNING("%u zero-copy DMA buffers still in use over PRU restart, kept reserved",
+					(unsigned) dma_pool_used_blocks.size());
+	}
+	dma_pool_base = (void *) base_virtual;
+	// free blocks: pool minus buffers in use
+	uint32_t free_start = dma_pool_offset;
+	for (it = dma_pool_used_blocks.begin(); it != dma_pool_used_blocks.end(); ++it) {
+		if (it->first > free_start)
+			dma_pool_free_blocks[free_start] = it->first - free_start;
+		free_start = it->first + it->second;
+	}
+	if (dma_pool_size && dma_pool_offset + dma_pool_size > free_start)
+		dma_pool_free_blocks[free_start] = dma_pool_offset + dma_pool_size - free_start;
+	pthread_mutex_unlock(&dma_pool_mutex);
+	if (dma_pool_size)
+		INFO("  %u bytes of DDR memory for zero-copy DMA buffers", dma_pool_size);
+	else
+		INFO("  No DDR memory left for zero-copy DMA buffers, DMA data is copied via PRU mailbox");
+}
+
+// buffer for device DMA, first fit from pool. Falls back to heap if pool exhausted.
+// Free with dma_buffer_free().
+uint16_t *ddrmem_c::dma_buffer_alloc(uint32_t wordcount)
+{
+	uint32_t size = (2 * wordcount + DDRMEM_DMA_POOL_ALIGN - 1) & ~(DDRMEM_DMA_POOL_ALIGN - 1);
+	uint16_t *result = NULL;
+	pthread_mutex_lock(&dma_pool_mutex);
+	std::map<uint32_t, uint32_t>::iterator it;
+	for (it = dma_pool_free_blocks.begin(); it != dma_pool_free_blocks.end(); ++it)
+		if (it->second >= size) {
+			uint32_t offset = it->first;
+			uint32_t rest = it->second - size;
+			dma_pool_free_blocks.erase(it);
+			if (rest)
+				dma_pool_free_blocks[offset + size] = rest;
+			dma_pool_used_blocks[offset] = size;
+			result = (uint16_t *) ((uint8_t *) base_virtual + offset);
+			break;
+		}
+	pthread_mutex_unlock(&dma_pool_mutex);
+	if (result == NULL)
+		result = new uint16_t[wordcount];
+	return result;
+}
+
+// return buffer to pool and merge with free neighbours, or to heap.
+void ddrmem_c::dma_buffer_free(uint16_t *buffer)
+{
+	if (buffer == NULL)
+		return;
+	pthread_mutex_lock(&dma_pool_mutex);
+	bool stale = dma_pool_stale_buffers.erase(buffer) > 0;
+	pthread_mutex_unlock(&dma_pool_mutex);
+	if (stale)
+		return; // from before a DDR remap, nothing to give back
+	uint32_t offset = dma_buffer_offset(buffer, 1);
+	if (offset == 0) {
+		delete[] buffer; // heap fallback
+		return;
+	}
+	pthread_mutex_lock(&dma_pool_mutex);
+	std::map<uint32_t, uint32_t>::iterator it = dma_pool_used_blocks.find(offset);
+	if (it == dma_pool_used_blocks.end()) {
+		pthread_mutex_unlock(&dma_pool_mutex);
+		ERROR("dma_buffer_free(): %p not allocated", buffer);
+		return;
+	}
+	uint32_t size = it->second;
+	dma_pool_used_blocks.erase(it);
+	std::map<uint32_t, uint32_t>::iterator next = dma_pool_free_blocks.lower_bound(offset);
+	if (next != dma_pool_free_blocks.end() && offset + size == next->first) {
+		size += next->second;
+		next = dma_pool_free_blocks.erase(next);
+	}
+	if (next != dma_pool_free_blocks.begin()) {
+		std::map<uint32_t, uint32_t>::iterator prev = std::prev(next);
+		if (prev->first + prev->second == offset) {
+			prev->second += size;
+			pthread_mutex_unlock(&dma_pool_mutex);
+			return;
+		}
+	}
+	dma_pool_free_blocks[offset] = size;
+	pthread_mutex_unlock(&dma_pool_mutex);
+}
+
+// Offset of a buffer relative to DDR base, as needed for PRU DMA.
+// 0: buffer not completely inside the pool, DMA must be staged through mailbox.
+uint32_t ddrmem_c::dma_buffer_offset(const uint16_t *buffer, uint32_t wordcount)
+{
+	if (dma_pool_size == 0)
+		return 0;
+	uintptr_t offset = (uintptr_t) buffer - (uintptr_t) base_virtual;
+	if (offset < dma_pool_offset || offset + 2 * wordcount > dma_pool_offset + dma_pool_size)
+		return 0;
+	return offset;
+}
+
 // read/write ddr memory locally
 // result: true =OK, else illegal address ("timeout")
 bool ddrmem_c::deposit(uint32_t addr, uint16_t w) 
@@ -191,7 +333,7 @@ void ddrmem_c::fill_pattern(void)
 void ddrmem_c::fill_pattern_pru(void) 
 {
 	// ddrmem_base_physical and _len already set
-	assert((uint32_t )mailbox->ddrmem_base_physical == base_physical);
+	assert((uint32_t)(uintptr_t)mailbox->ddrmem_base_physical == base_physical);
 	mailbox_execute(ARM2PRU_DDR_FILL_PATTERN);
 }
 
@@ -21,6 +21,7 @@
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
+ 15-oct-2026  QC      VIRTUAL_PRU: GPIO registers in host memory
  21-may-2019  JH      added UNIBUS signals
  12-nov-2018  JH      entered beta phase
  */
@@ -67,9 +68,13 @@ gpios_c::gpios_c() {
     cmdline_leds = 0 ; // is set before init()
     leds_for_debug = false ;
 
+#ifdef VIRTUAL_PRU
+    memory_filedescriptor = 0 ; // no /dev/mem on host
+#else
     memory_filedescriptor = open((char*) "/dev/mem", O_RDWR);
     if (!memory_filedescriptor)
         FATAL("Can not open /dev/mem");
+#endif
 
 }
 
@@ -87,9 +92,15 @@ void gpios_c::bank_map_registers(unsigned bank_idx, unsigned unmapped_start_addr
     bank->registerrange_addr_unmapped = unmapped_start_addr; // info only
     INFO("GPIO%d registers at %X - %X (size = %X)", bank_idx, unmapped_start_addr,
          unmapped_start_addr + GPIO_SIZE - 1, GPIO_SIZE);
+#ifdef VIRTUAL_PRU
+    // dummy registers: outputs go nowhere, inputs read 0
+    bank->registerrange_start_addr = (uint8_t *) calloc(1, GPIO_SIZE);
+    if (bank->registerrange_start_addr == NULL)
+#else
     bank->registerrange_start_addr = (uint8_t *) mmap(0, GPIO_SIZE, PROT_READ | PROT_WRITE,
                                      MAP_SHARED, memory_filedescriptor, unmapped_start_addr);
     if (bank->registerrange_start_addr == MAP_FAILED)
+#endif
         FATAL("Unable to map GPIO%d", bank_idx);
 
     bank->oe_addr = (uint32_t *) (bank->registerrange_start_addr + GPIO_OE_ADDROFFSET);
@@ -134,6 +145,10 @@ void gpios_c::export_pin(gpio_config_t *pin)
     FILE *f;
     struct stat statbuff;
 
+#ifdef VIRTUAL_PRU
+    UNUSED(pin) ;
+    return ; // no sysfs GPIOs on host
+#endif
     sprintf(fname, "/sys/class/gpio/export");
     f = fopen(fname, "w");
     if (!f)
@@ -239,6 +254,10 @@ void gpios_c::init()
 void gpios_c::set_frequency(unsigned frequency)
 {
     // timer5 is programmed to toggle the output on each timer reload
+#ifdef VIRTUAL_PRU
+    UNUSED(frequency) ;
+    return ; // no timer5 on host
+#endif
 
     // map registers
     // on error: enable clock module for timer5
@@ -21,6 +21,7 @@
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
+ 16-oct-2026  QC      clear micro-action table
  12-nov-2018  JH      entered beta phase
  */
 
@@ -72,6 +73,11 @@ void iopageregisters_init()
   	// clear the iopage addr map: no register assigned
 	memset((void *) pru_iopage_registers->register_handles, 0,
 			sizeof(pru_iopage_registers->register_handles));
+	// no PRU micro-actions
+	memset((void *) pru_iopage_registers->register_action_handles, 0,
+			sizeof(pru_iopage_registers->register_action_handles));
+	memset((void *) pru_iopage_registers->register_actions, 0,
+			sizeof(pru_iopage_registers->register_actions));
 }
 
 void iopageregisters_print_tables(void) 
@@ -0,0 +1,193 @@
+/* latency.cpp: log2 latency histograms of the PRU->ARM->PRU path
+
+ Copyright (c) 2026, QUniBone contributors
+ https://github.com/j-hoppe/QUniBone
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ THE CONTRIBUTORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+ 16-oct-2026  QC      created
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <algorithm>
+
+#include "logger.hpp"
+#include "latency.hpp"
+
+latency_recorder_c *latency_recorder; // singleton
+
+void latency_histogram_c::clear(void)
+{
+	for (unsigned i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++)
+		bucket[i] = 0;
+	count = 0;
+	sum_ns = 0;
+	max_ns = 0;
+}
+
+// called by worker() and device threads in parallel: no lock, only atomic counters
+void latency_histogram_c::record(uint64_t ns)
+{
+	unsigned idx = 0;
+	if (ns > 1)
+		idx = 63 - __builtin_clzll(ns); // log2
+	if (idx >= LATENCY_HISTOGRAM_BUCKETS)
+		idx = LATENCY_HISTOGRAM_BUCKETS - 1;
+	bucket[idx].fetch_add(1, std::memory_order_relaxed);
+	count.fetch_add(1, std::memory_order_relaxed);
+	sum_ns.fetch_add(ns, std::memory_order_relaxed);
+	uint64_t old_max = max_ns.load(std::memory_order_relaxed);
+	while (ns > old_max && !max_ns.compare_exchange_weak(old_max, ns, std::memory_order_relaxed))
+		;
+}
+
+// upper bound of the bucket in which "percent" of all samples are reached,
+// but not above the maximum seen
+uint64_t latency_histogram_c::percentile_ns(unsigned percent)
+{
+	uint64_t total = count;
+	uint64_t max = max_ns;
+	if (total == 0)
+		return 0;
+	uint64_t limit = (total * percent + 99) / 100;
+	uint64_t sum = 0;
+	for (unsigned i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+		sum += bucket[i];
+		if (sum >= limit)
+			return std::min((uint64_t) (2ULL << i) - 1, max);
+	}
+	return max;
+}
+
+latency_recorder_c::latency_recorder_c()
+{
+	log_label = "LAT";
+	enabled = false;
+	pthread_mutex_init(&mutex, NULL);
+}
+
+latency_recorder_c::~latency_recorder_c()
+{
+	for (unsigned i = 0; i < stats.size(); i++)
+		delete stats[i];
+	pthread_mutex_destroy(&mutex);
+}
+
+const char *latency_recorder_c::stage_name(enum latency_stage_enum stage)
+{
+	switch (stage) {
+	case latency_register_dispatch:
+		return "reg_dispatch";
+	case latency_register_callback:
+		return "reg_callback";
+	case latency_register_ack:
+		return "reg_ack";
+	case latency_dma_queue:
+		return "dma_queue";
+	case latency_dma_transfer:
+		return "dma_transfer";
+	case latency_dma_signal:
+		return "dma_signal";
+	case latency_intr_grant:
+		return "intr_grant";
+	default:
+		return "???";
+	}
+}
+
+// find histograms of a device, create on first use
+latency_stats_c *latency_recorder_c::get_stats(std::string device_name)
+{
+	latency_stats_c *result = NULL;
+	pthread_mutex_lock(&mutex);
+	for (unsigned i = 0; !result && i < stats.size(); i++)
+		if (stats[i]->name == device_name)
+			result = stats[i];
+	if (!result) {
+		result = new latency_stats_c(device_name);
+		stats.push_back(result);
+	}
+	pthread_mutex_unlock(&mutex);
+	return result;
+}
+
+void latency_recorder_c::clear(void)
+{
+	pthread_mutex_lock(&mutex);
+	for (unsigned i = 0; i < stats.size(); i++)
+		for (unsigned j = 0; j < latency_stage_count; j++)
+			stats[i]->stage[j].clear();
+	pthread_mutex_unlock(&mutex);
+}
+
+// one line per device and stage, empty histograms suppressed
+void latency_recorder_c::print(void)
+{
+	bool empty = true;
+	pthread_mutex_lock(&mutex);
+	printf("%-12s %-13s %10s %10s %10s %10s %10s\n", "Device", "Stage", "Count", "Avg[us]",
+			"50%[us]", "99%[us]", "Max[us]");
+	for (unsigned i = 0; i < stats.size(); i++)
+		for (unsigned j = 0; j < latency_stage_count; j++) {
+			latency_histogram_c *h = &stats[i]->stage[j];
+			uint64_t count = h->count;
+			if (count == 0)
+				continue;
+			empty = false;
+			printf("%-12s %-13s %10llu %10.1f %10.1f %10.1f %10.1f\n",
+					stats[i]->name.c_str(), stage_name((enum latency_stage_enum) j),
+					(unsigned long long) count, (double) h->sum_ns / count / 1000.0,
+					h->percentile_ns(50) / 1000.0, h->percentile_ns(99) / 1000.0,
+					h->max_ns / 1000.0);
+		}
+	pthread_mutex_unlock(&mutex);
+	if (empty)
+		printf("No latencies recorded%s.\n", enabled ? "" : ", recording is disabled");
+}
+
+// CSV: one line per device and stage, columns are log2 buckets
+// result: false on file error
+bool latency_recorder_c::save_csv(const char *filename)
+{
+	FILE *f = fopen(filename, "w");
+	if (f == NULL) {
+		ERROR("Can not open %s for write", filename);
+		return false;
+	}
+	fprintf(f, "device,stage,count,sum_ns,max_ns");
+	for (unsigned b = 0; b < LATENCY_HISTOGRAM_BUCKETS; b++)
+		fprintf(f, ",lt_%llu_ns", 2ULL << b);
+	fprintf(f, "\n");
+	pthread_mutex_lock(&mutex);
+	for (unsigned i = 0; i < stats.size(); i++)
+		for (unsigned j = 0; j < latency_stage_count; j++) {
+			latency_histogram_c *h = &stats[i]->stage[j];
+			fprintf(f, "%s,%s,%llu,%llu,%llu", stats[i]->name.c_str(),
+					stage_name((enum latency_stage_enum) j), (unsigned long long) h->count,
+					(unsigned long long) h->sum_ns, (unsigned long long) h->max_ns);
+			for (unsigned b = 0; b < LATENCY_HISTOGRAM_BUCKETS; b++)
+				fprintf(f, ",%llu", (unsigned long long) h->bucket[b]);
+			fprintf(f, "\n");
+		}
+	pthread_mutex_unlock(&mutex);
+	fclose(f);
+	return true;
+}
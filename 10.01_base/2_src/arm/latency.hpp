@@ -0,0 +1,131 @@
+/* latency.hpp: log2 latency histograms of the PRU->ARM->PRU path
+
+ Copyright (c) 2026, QUniBone contributors
+ https://github.com/j-hoppe/QUniBone
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ THE CONTRIBUTORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+ 16-oct-2026  QC      reg_ack measured by PRU
+ 16-oct-2026  QC      samples without start timestamp ignored
+ 16-oct-2026  QC      created
+
+ Probes in qunibusadapter_c measure each stage of
+ - device register events: PRU event -> worker() wakeup -> on_after_register_access()
+	-> EVENT_ACK, and PRU event -> SSYN/RPLY released
+ - device DMA: DMA() schedule -> start on PRU -> PRU complete -> DMA() returns
+ - device INTR: INTR() schedule -> vector transferred
+ PRU and ARM have no common clock, so the PRU event is timestamped
+ when the worker() wakes up. Only the total SSYN/RPLY stretch is measured
+ by PRU1 in its cycle counter, and recorded with the next blocking event.
+ Each device has a set of histograms, found by name. They survive
+ device deletion, so they can be shown after leaving the device menu.
+ Recording is off by default, the clock costs time on each bus event.
+ */
+#ifndef _LATENCY_HPP_
+#define _LATENCY_HPP_
+
+#include <stdint.h>
+#include <pthread.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "logsource.hpp"
+
+// bucket n counts latencies in [2^n, 2^(n+1)) nanoseconds
+// bucket 0 also has 0 ns, last bucket has all >= 2^31 ns (2 sec)
+#define LATENCY_HISTOGRAM_BUCKETS	32
+
+// PRU cycle counter runs at 200 MHz
+#define LATENCY_PRU_CYCLE_NS	5
+
+// the measured path segments
+enum latency_stage_enum {
+	latency_register_dispatch = 0, // worker wakeup -> on_after_register_access() entry
+	latency_register_callback, // on_after_register_access() entry -> exit
+	latency_register_ack, // PRU event -> SSYN/RPLY released, counted by PRU
+	latency_dma_queue, // DMA() -> first chunk started on PRU
+	latency_dma_transfer, // first chunk start -> last chunk complete
+	latency_dma_signal, // last chunk complete -> blocking DMA() returns
+	latency_intr_grant, // INTR() -> vector transferred
+	latency_stage_count
+};
+
+class latency_histogram_c {
+public:
+	std::atomic<uint64_t> bucket[LATENCY_HISTOGRAM_BUCKETS];
+	std::atomic<uint64_t> count;
+	std::atomic<uint64_t> sum_ns;
+	std::atomic<uint64_t> max_ns;
+
+	latency_histogram_c() {
+		clear();
+	}
+	void clear(void);
+	void record(uint64_t ns);
+	uint64_t percentile_ns(unsigned percent);
+};
+
+// all histograms of one device
+class latency_stats_c {
+public:
+	std::string name; // device name
+	latency_histogram_c stage[latency_stage_count];
+
+	latency_stats_c(std::string _name) {
+		name = _name;
+	}
+	// start_ns == 0: start not taken (recorder was off), no sample
+	void record(enum latency_stage_enum _stage, uint64_t start_ns, uint64_t end_ns) {
+		if (start_ns == 0)
+			return;
+		if (end_ns > start_ns)
+			stage[_stage].record(end_ns - start_ns);
+		else
+			stage[_stage].record(0);
+	}
+	// duration measured by PRU
+	void record_ns(enum latency_stage_enum _stage, uint64_t ns) {
+		stage[_stage].record(ns);
+	}
+};
+
+class latency_recorder_c: public logsource_c {
+private:
+	pthread_mutex_t mutex; // for stats list
+	std::vector<latency_stats_c *> stats;
+
+public:
+	// probes check this before taking timestamps
+	volatile bool enabled;
+
+	latency_recorder_c();
+	~latency_recorder_c();
+
+	static const char *stage_name(enum latency_stage_enum stage);
+
+	latency_stats_c *get_stats(std::string device_name);
+	void clear(void);
+	void print(void);
+	bool save_csv(const char *filename);
+};
+
+extern latency_recorder_c *latency_recorder; // singleton
+
+#endif
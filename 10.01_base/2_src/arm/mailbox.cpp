@@ -28,7 +28,6 @@
 
 #include <stdio.h>
 #include <string.h>
-#include "prussdrv.h"
 
 #include "pru.hpp"
 #include "logger.hpp"
@@ -59,7 +58,7 @@ int mailbox_connect(void)
 	memset((void*) mailbox, 0, sizeof(mailbox_t));
 
 	// tell PRU location of shared DDR RAM
-	mailbox->ddrmem_base_physical = (ddrmem_t *) ddrmem->base_physical;
+	mailbox->ddrmem_base_physical = (ddrmem_t *) (uintptr_t) ddrmem->base_physical;
 
 	return 0;
 }
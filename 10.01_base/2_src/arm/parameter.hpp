@@ -188,6 +188,11 @@ public:
 	// called after param value changed. 
 	// result: false = "new_value" not excepted, error printed.
 	virtual bool on_param_changed(parameter_c *param) = 0;
+
+	// called before parameters are displayed,
+	// to update "readonly" values maintained elsewhere
+	virtual void on_params_render(void) {
+	}
 };
 
 #endif
@@ -21,13 +21,22 @@
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
+ 16-oct-2026  QC      latency timestamps
+ 16-oct-2026  QC      completion wait with futex
+ 16-oct-2026  QC      zero-copy DMA: DDR offset of buffer
+ 15-oct-2026  QC      scatter/gather DMA segments
  jul-2019     JH      start: multiple parallel arbitration levels	 
  */
 
 #include <assert.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 #include <algorithm>
 
 #include "logger.hpp"
+#include "ddrmem.h"
 #include "qunibusdevice.hpp"
 #include "priorityrequest.hpp"
 
@@ -35,11 +44,10 @@ priority_request_c::priority_request_c(qunibusdevice_c *_device)
 {
 	log_label = "REQ";
 	device = _device;
-	complete = false;
+	complete = PRIORITY_REQUEST_PENDING;
 	executing_on_PRU = false;
+	latency_schedule_ns = latency_start_ns = latency_complete_ns = 0;
 	priority_slot = 0xff; // uninitialized, asserts() if used
-	complete_mutex = PTHREAD_MUTEX_INITIALIZER;
-	complete_cond = PTHREAD_COND_INITIALIZER; // PRU signal notifies request on completeness
 }
 
 priority_request_c::~priority_request_c() 
@@ -47,6 +55,31 @@ priority_request_c::~priority_request_c()
 	// not used, but need some virtual func for dynamic_cast()
 }
 
+// mark request complete, wake up thread in complete_wait().
+// No syscall if nobody is waiting (emulated CPU polls).
+void priority_request_c::complete_signal(void)
+{
+	if (__atomic_exchange_n(&complete, PRIORITY_REQUEST_COMPLETE, __ATOMIC_SEQ_CST)
+			== PRIORITY_REQUEST_WAITING)
+		syscall(SYS_futex, &complete, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+// block until complete_signal()
+void priority_request_c::complete_wait(void)
+{
+	int c = complete;
+	while (c != PRIORITY_REQUEST_COMPLETE) {
+		// announce sleeper, so complete_signal() issues a wake up
+		if (c == PRIORITY_REQUEST_PENDING
+				&& !__atomic_compare_exchange_n(&complete, &c, PRIORITY_REQUEST_WAITING, false,
+						__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+			continue; // changed meanwhile, c reloaded
+		// returns immediately if no longer WAITING
+		syscall(SYS_futex, &complete, FUTEX_WAIT_PRIVATE, PRIORITY_REQUEST_WAITING, NULL, NULL, 0);
+		c = complete;
+	}
+}
+
 void priority_request_c::set_priority_slot(uint8_t _priority_slot) 
 {
 	assert(_priority_slot > 0); // 0 reserved
@@ -68,6 +101,8 @@ dma_request_c::dma_request_c(qunibusdevice_c *_device) :
 {
 	level_index = PRIORITY_LEVEL_INDEX_NPR;
 	success = false;
+	segment_index = 0;
+	buffer_ddr_offset = 0;
 	is_cpu_access = false ;// over written for emulated CPU
 	// register request for device
 	if (_device) {
@@ -85,6 +120,24 @@ dma_request_c::~dma_request_c()
 	}
 }
 
+// make segments[index] the current transfer, chunking restarts at its begin.
+// result: false, if no more segments
+bool dma_request_c::segment_load(unsigned index)
+{
+	if (index >= segments.size())
+		return false;
+	dma_segment_t *segment = &segments[index];
+	segment_index = index;
+	qunibus_control = segment->qunibus_control;
+	qunibus_start_addr = segment->qunibus_addr;
+	chunk_qunibus_start_addr = segment->qunibus_addr;
+	buffer = segment->buffer;
+	wordcount = segment->wordcount;
+	// CPU accesses single words on stack, not worth the lookup
+	buffer_ddr_offset = is_cpu_access ? 0 : ddrmem->dma_buffer_offset(buffer, wordcount);
+	return true;
+}
+
 // create invalid requests, is setup by qunibusadapter
 intr_request_c::intr_request_c(qunibusdevice_c *_device) :
 		priority_request_c(_device) 
@@ -21,6 +21,11 @@
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
+ 16-oct-2026  QC      latency timestamps
+ 16-oct-2026  QC      completion wait with futex
+ 16-oct-2026  QC      zero-copy DMA: DDR offset of buffer
+ 15-oct-2026  QC      double buffered DMA chunks
+ 15-oct-2026  QC      scatter/gather DMA segments
  jul-2019     JH      start: multiple parallel arbitration levels	 
  */
 
@@ -40,12 +45,15 @@
  In each level, a refernece array[slot] holds open requests.
  For fast determination of lowest active slot, a bitarray
  marks active slots.
+ Both are atomic: devices insert requests lock-free,
+ see qunibusadapter_c::request_schedule().
  */
 #ifndef _PRIORITYREQUEST_HPP_
 #define _PRIORITYREQUEST_HPP_
 
 #include <stdint.h>
 #include <pthread.h>
+#include <vector>
 
 #include "logsource.hpp"
 
@@ -59,6 +67,11 @@
 
 #define PRIORITY_SLOT_COUNT	32	// backplane slot numbers 0..31 may be used
 
+// values of priority_request_c::complete
+#define PRIORITY_REQUEST_PENDING	0
+#define PRIORITY_REQUEST_COMPLETE	1
+#define PRIORITY_REQUEST_WAITING	2 // pending, a thread sleeps in complete_wait()
+
 class qunibusdevice_c;
 
 // (almost) abstract base class for dma and intr requests
@@ -78,11 +91,19 @@ private:
 public:
 	// better make state variables volatile, accessed by qunibusadapter::worker
 	volatile bool executing_on_PRU; // true between schedule to PRU and compelte signal
-	volatile bool complete;
 
 	// PRU -> signal -> worker() -> request -> device. INTR/DMA
-	pthread_mutex_t complete_mutex;
-	pthread_cond_t complete_cond; // PRU signal notifies request on completeness
+	// one of PRIORITY_REQUEST_*, also used as futex. Changed with __atomic builtins
+	volatile int complete;
+	// timestamps for latency histograms, valid only if latency_recorder->enabled
+	uint64_t latency_schedule_ns; // INTR()/DMA() called
+	uint64_t latency_start_ns; // started on PRU, 0 = not yet
+	uint64_t latency_complete_ns; // completed by PRU
+	bool is_complete(void) {
+		return complete == PRIORITY_REQUEST_COMPLETE;
+	}
+	void complete_signal(void);
+	void complete_wait(void);
 
 	priority_request_c(qunibusdevice_c *device);
 	virtual ~priority_request_c(); // not used, but need dynamic_cast
@@ -93,18 +114,35 @@ public:
 	}
 };
 
+// one part of a scatter/gather DMA: contiguous address range with own direction
+typedef struct {
+	uint8_t qunibus_control; // DATI,DATO
+	uint32_t qunibus_addr;
+	uint16_t* buffer;
+	uint32_t wordcount;
+} dma_segment_t;
+
 class dma_request_c: public priority_request_c {
 	friend class qunibusadapter_c;
 public:
 	dma_request_c(qunibusdevice_c *device);
 
 	~dma_request_c();
-	// const for all chunks
+
+	// Scatter/gather: all segments are executed in order as one request,
+	// the device is signaled once after the last segment or on first error.
+	std::vector<dma_segment_t> segments;
+	unsigned segment_index; // current segment. On timeout: the failed segment
+
+	// const for all chunks of the current segment
 	uint8_t qunibus_control; // DATI,DATO
 	uint32_t qunibus_start_addr;
 	uint32_t qunibus_end_addr;
 	uint16_t* buffer;
 	uint32_t wordcount;
+	// zero-copy: offset of buffer in DDR, see ddrmem_c::dma_buffer_alloc().
+	// 0 = buffer not in DDR pool, data is staged through mailbox.dma.words[]
+	uint32_t buffer_ddr_offset;
 
 	bool is_cpu_access; // true if DMA is CPU memory access
 
@@ -112,6 +150,10 @@ public:
 	uint32_t chunk_max_words; // max is PRU capacity PRU_MAX_DMA_WORDCOUNT (512)
 	uint32_t chunk_qunibus_start_addr; // current chunk
 	uint32_t chunk_words; // size of current chunks
+	uint8_t chunk_buffer_index; // mailbox.dma.words[] of current chunk
+	// Double buffering: chunk following the current one, already queued
+	// on the PRU in the other buffer. 0 = none.
+	uint32_t chunk_queued_words;
 
 	volatile bool success; // DMA can fail with bus timeout
 
@@ -120,11 +162,21 @@ public:
 		return buffer + (chunk_qunibus_start_addr - qunibus_start_addr) / 2;
 	}
 
+	// zero-copy: PRU data address of chunk starting at chunk_start_addr.
+	// 0 = chunk staged through mailbox
+	uint32_t chunk_ddr_offset(uint32_t chunk_start_addr) {
+		if (buffer_ddr_offset == 0)
+			return 0;
+		return buffer_ddr_offset + (chunk_start_addr - qunibus_start_addr);
+	}
+
 	// words already transfered in previous chunks
 	uint32_t wordcount_completed_chunks(void) {
 		return (chunk_qunibus_start_addr - qunibus_start_addr) / 2;
 	}
 
+	bool segment_load(unsigned index);
+
 };
 
 struct qunibusdevice_register_struct;
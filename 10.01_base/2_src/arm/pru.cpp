@@ -21,6 +21,8 @@
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
+ 16-oct-2026  QC      init zero-copy DMA buffer pool
+ 15-oct-2026  QC      VIRTUAL_PRU: no code arrays, PRU1 emulated by pru_virtual
  12-nov-2018  JH      entered beta phase
 
  Management interface to PRU0 & 1:
@@ -49,8 +51,10 @@
 
 #include "utils.hpp"
 #include "logger.hpp"
+#ifndef VIRTUAL_PRU
 #include "prussdrv.h"
 #include "pruss_intc_mapping.h"
+#endif
 #include "mailbox.h"
 #include "ddrmem.h"
 #include "iopageregister.h"
@@ -73,6 +77,7 @@
  ...
  0x00};
  */
+#ifndef VIRTUAL_PRU
 //  under c++ linker error with const attribute ?!
 #define const
 #include "pru0_code_all_array.c"
@@ -83,6 +88,7 @@
 #include "pru1_code_qbus_array.c"
 #endif
 #undef const
+#endif
 
 // Singleton
 pru_c *pru;
@@ -118,6 +124,13 @@ struct prucode_entry {
 };
 
 // local static dictionary of program code variants
+#ifdef VIRTUAL_PRU
+// no code arrays: pru_virtual executes PRU1 functions for all variants
+struct prucode_entry prucode[] = {
+		{ pru_c::PRUCODE_TEST, NULL, 0, PRU0_ENTRY_ADDR, NULL, 0, PRU1_ENTRY_ADDR }, //
+		{ pru_c::PRUCODE_EMULATION, NULL, 0, PRU0_ENTRY_ADDR, NULL, 0, PRU1_ENTRY_ADDR }, //
+		{ pru_c::PRUCODE_EOD, NULL, 0, 0, NULL, 0, 0 } };
+#else
 struct prucode_entry prucode[] = {
 // self test functions
 		{ pru_c::PRUCODE_TEST, //
@@ -135,6 +148,7 @@ struct prucode_entry prucode[] = {
 	}, //
 	   // end marker
 	{ pru_c::PRUCODE_EOD, NULL, 0, 0, NULL, 0, 0 } };
+#endif
 
 int pru_c::start(enum prucode_enum _prucode_id) 
 {
@@ -175,6 +189,7 @@ int pru_c::start(enum prucode_enum _prucode_id)
 
 	ddrmem->base_physical = prussdrv_get_phys_addr((void *) (ddrmem->base_virtual));
 	ddrmem->info(); // may abort program
+	ddrmem->dma_pool_init();
 
 	// get address of mail box struct in PRU
 	mailbox_connect();
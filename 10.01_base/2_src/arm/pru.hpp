@@ -31,6 +31,7 @@
  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+ 15-oct-2026  QC      VIRTUAL_PRU: prussdrv replaced by pru_virtual
  18-apr-2019  JH      added PRU code dictionary
  12-nov-2018  JH      entered beta phase
  */
@@ -39,7 +40,11 @@
 #define _PRU_HPP_
 
 #include <stdint.h>
+#ifdef VIRTUAL_PRU
+#include "pru_virtual.hpp"
+#else
 #include "prussdrv.h"
+#endif
 
 #include "logsource.hpp"
 
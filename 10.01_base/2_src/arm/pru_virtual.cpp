@@ -0,0 +1,818 @@
+/* pru_virtual.cpp: Software emulation of PRU1 for host builds without PRU
+
+ Copyright (c) 2026, QUniBone contributors
+ https://github.com/j-hoppe/QUniBone
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ THE CONTRIBUTORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+ 16-oct-2026  QC      deviceregister.ack_cycles
+ 16-oct-2026  QC      PRU micro-actions, posted DATI events
+ 15-oct-2026  QC      created
+
+ "Virtual PRU": the PRU1 main loop of pru1_main_unibus.c/pru1_main_qbus.c,
+ executed by a host thread.
+ - ARM2PRU opcodes are accepted and ACKed like on the PRU.
+ - Arbitration: the virtual PRU acts as the bus arbitrator. NPR is granted
+   immediately, BR4..7 are granted to a (not existing) physical CPU
+   or to the emulated CPU via ifs_priority_level.
+ - DMA and INTR are executed in one step, not as bus state machines.
+   DATI/DATO go to emulated memory or the iopage register table,
+   other addresses end with DMA_STATE_TIMEOUTSTOP.
+ - PRU->ARM events are signaled through the same mailbox_events_t counters,
+   PRU2ARM_INTERRUPT is a condition variable.
+ */
+#ifdef VIRTUAL_PRU
+
+#define _PRU_VIRTUAL_CPP_
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <sched.h>
+#include <time.h>
+#include <errno.h>
+
+#include "utils.hpp"
+#include "logger.hpp"
+#include "mailbox.h"
+#include "ddrmem.h"
+#include "iopageregister.h"
+
+#include "pru_virtual.hpp"
+
+// DDR behind ddrmem_t for zero-copy DMA buffers, like a big "extram_pool_sz"
+#define VIRTUAL_PRU_DMA_POOL_SIZE	0x100000
+
+// idle loops before the worker starts to sleep between polls
+#define VIRTUAL_PRU_IDLE_SPIN_COUNT	1000
+#define VIRTUAL_PRU_IDLE_SLEEP_NS	20000
+
+// bus latch with INIT and power signals, see INITIALIZATIONSIGNAL_*
+#if defined(UNIBUS)
+#define VIRTUAL_PRU_INITIALIZATIONSIGNAL_LATCH	7
+#define VIRTUAL_PRU_POWERSIGNALS	(INITIALIZATIONSIGNAL_DCLO | INITIALIZATIONSIGNAL_ACLO)
+#elif defined(QBUS)
+#define VIRTUAL_PRU_INITIALIZATIONSIGNAL_LATCH	5
+#define VIRTUAL_PRU_POWERSIGNALS	(INITIALIZATIONSIGNAL_DCOK | INITIALIZATIONSIGNAL_POK)
+#endif
+
+// sizes of the PRU RAMs
+#define VIRTUAL_PRU_DATARAM_SIZE	0x2000	// 8K PRU0 RAM, holds pru_iopage_registers_t
+#define VIRTUAL_PRU_SHARED_DATARAM_SIZE	0x3000	// 12K shared RAM, holds mailbox_t
+
+virtual_pru_c *virtual_pru; // Singleton
+
+static void *virtual_pru_worker_pthread_wrapper(void *context)
+{
+	virtual_pru_c *vpru = (virtual_pru_c *) context;
+	vpru->worker();
+	return NULL;
+}
+
+virtual_pru_c::virtual_pru_c()
+{
+	log_label = "VPRU";
+	worker_terminate = false;
+	worker_running = false;
+	pthread_mutex_init(&pru2arm_mutex, NULL);
+	pthread_cond_init(&pru2arm_cond, NULL);
+	pru2arm_pending = false;
+	pru2arm_count = 0;
+	pru0_dataram = NULL;
+	pru_shared_dataram = NULL;
+	ddrmem_base = NULL;
+	ddrmem_size = 0;
+}
+
+virtual_pru_c::~virtual_pru_c()
+{
+	stop();
+	free(pru0_dataram);
+	free(pru_shared_dataram);
+	free((void *) ddrmem_base);
+}
+
+// allocate "PRU RAM" and "shared DDR" once.
+// Like the uio_pruss mapping, memory remains valid after stop()
+void virtual_pru_c::memory_alloc()
+{
+	if (pru0_dataram == NULL) {
+		assert(sizeof(pru_iopage_registers_t) <= VIRTUAL_PRU_DATARAM_SIZE);
+		pru0_dataram = calloc(1, VIRTUAL_PRU_DATARAM_SIZE);
+	}
+	if (pru_shared_dataram == NULL) {
+		assert(sizeof(mailbox_t) <= VIRTUAL_PRU_SHARED_DATARAM_SIZE);
+		pru_shared_dataram = calloc(1, VIRTUAL_PRU_SHARED_DATARAM_SIZE);
+	}
+	if (ddrmem_base == NULL) {
+		ddrmem_size = sizeof(ddrmem_t) + VIRTUAL_PRU_DMA_POOL_SIZE;
+		ddrmem_base = (volatile ddrmem_t *) calloc(1, ddrmem_size);
+	}
+	if (!pru0_dataram || !pru_shared_dataram || !ddrmem_base)
+		FATAL("Can not allocate memory for virtual PRU");
+}
+
+// reset PRU1 state and start main loop
+void virtual_pru_c::start()
+{
+	assert(!worker_running);
+	emulate_cpu = false;
+	address_overlay = 0;
+	memset(latches, 0, sizeof(latches));
+	device_request_mask = 0;
+	cpu_request = false;
+	arbitration_noop = false;
+	init_asserted_seen = false;
+	deviceregister_stretch_active = false;
+
+	worker_terminate = false;
+	if (pthread_create(&worker_pthread, NULL, &virtual_pru_worker_pthread_wrapper, this))
+		FATAL("Can not create virtual PRU thread");
+	worker_running = true;
+
+	// The PRU is independent hardware: ARM threads with realtime priority
+	// spin in mailbox_execute() and would starve a SCHED_OTHER PRU thread
+	// on a single core host.
+	struct sched_param params;
+	params.sched_priority = sched_get_priority_max(SCHED_FIFO);
+	if (pthread_setschedparam(worker_pthread, SCHED_FIFO, &params))
+		WARNING("Virtual PRU: can not set realtime priority, ARM workers may starve PRU");
+	INFO("Virtual PRU started");
+}
+
+void virtual_pru_c::stop()
+{
+	if (!worker_running)
+		return;
+	worker_terminate = true;
+	pthread_join(worker_pthread, NULL);
+	worker_running = false;
+}
+
+// PRU2ARM_INTERRUPT: wake up qunibusadapter worker
+void virtual_pru_c::pru2arm_interrupt()
+{
+	// events and data written before interrupt
+	__sync_synchronize();
+	pthread_mutex_lock(&pru2arm_mutex);
+	pru2arm_pending = true;
+	pthread_cond_signal(&pru2arm_cond);
+	pthread_mutex_unlock(&pru2arm_mutex);
+}
+
+// like prussdrv_pru_wait_event_timeout():
+// 0 = timeout, else event count
+int virtual_pru_c::wait_event_timeout(unsigned time_us)
+{
+	struct timespec abstime;
+	int result = 0;
+
+	clock_gettime(CLOCK_REALTIME, &abstime);
+	abstime.tv_sec += time_us / 1000000;
+	abstime.tv_nsec += (long) (time_us % 1000000) * 1000;
+	if (abstime.tv_nsec >= 1000000000L) {
+		abstime.tv_sec++;
+		abstime.tv_nsec -= 1000000000L;
+	}
+	pthread_mutex_lock(&pru2arm_mutex);
+	while (!pru2arm_pending)
+		if (pthread_cond_timedwait(&pru2arm_cond, &pru2arm_mutex, &abstime) == ETIMEDOUT)
+			break;
+	if (pru2arm_pending) {
+		// interrupt raised while ARM is processing is seen on next wait
+		pru2arm_pending = false;
+		result = ++pru2arm_count;
+		if (result <= 0) // rollaround: 0 would mean "timeout"
+			result = pru2arm_count = 1;
+	}
+	pthread_mutex_unlock(&pru2arm_mutex);
+	return result;
+}
+
+// append to event ring, as EVENTRING_PUSH
+void virtual_pru_c::eventring_push(uint8_t type)
+{
+	uint8_t head = mailbox->eventring.head;
+	EVENTRING_ENTRY(*mailbox, head).type = type;
+	__sync_synchronize(); // entry valid before head
+	mailbox->eventring.head = head + 1;
+	__sync_synchronize(); // head written before tail read
+	if (mailbox->eventring.tail == head)
+		pru2arm_interrupt(); // ARM idle: wake up
+}
+
+// as DO_EVENT_DEVICEREGISTER_DATO/_DATI: posted into ring, or blocking event
+void virtual_pru_c::do_event_deviceregister(volatile pru_iopage_register_t *reg,
+		uint8_t unibus_control, uint32_t addr, uint16_t data)
+{
+	uint8_t posted_flag =
+			(unibus_control == QUNIBUS_CYCLE_DATI) ?
+					IOPAGEREGISTER_EVENT_FLAG_DATI_POSTED : IOPAGEREGISTER_EVENT_FLAG_DATO_POSTED;
+	if ((reg->event_flags & posted_flag)
+			&& EVENTRING_FILL(*mailbox) < (EVENTRING_SIZE - EVENTRING_RESERVED)) {
+		volatile mailbox_eventring_entry_t *entry = &EVENTRING_ENTRY(*mailbox,
+				mailbox->eventring.head);
+		entry->unibus_control = unibus_control;
+		entry->register_handle = reg->event_register_handle;
+		entry->addr = addr;
+		entry->data = data;
+		eventring_push(EVENTRING_TYPE_DEVICEREGISTER);
+	} else {
+		mailbox->events.deviceregister.unibus_control = unibus_control;
+		mailbox->events.deviceregister.register_handle = reg->event_register_handle;
+		mailbox->events.deviceregister.addr = addr;
+		mailbox->events.deviceregister.data = data;
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		deviceregister_signal_ns = (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+		deviceregister_stretch_active = true;
+		EVENT_SIGNAL(*mailbox, deviceregister);
+		pru2arm_interrupt();
+	}
+}
+
+/*** emulated memory and iopage registers, as in pru1_iopageregisters.c ***/
+
+// as DO_REGISTER_ACTION_DATI
+void virtual_pru_c::do_register_action_dati(uint8_t reghandle, volatile pru_iopage_register_t *reg)
+{
+	volatile pru_iopage_register_action_t *action =
+			&pru_iopage_registers->register_actions[pru_iopage_registers->register_action_handles[reghandle]];
+	if (action->flags & IOPAGEREGISTER_ACTION_DATI)
+		reg->value &= ~action->dati_clear_bits;
+}
+
+// as DO_REGISTER_ACTION_DATO
+void virtual_pru_c::do_register_action_dato(uint8_t reghandle, uint16_t reg_val)
+{
+	volatile pru_iopage_register_action_t *action =
+			&pru_iopage_registers->register_actions[pru_iopage_registers->register_action_handles[reghandle]];
+	if (action->flags & IOPAGEREGISTER_ACTION_DATO) {
+		volatile pru_iopage_register_t *target =
+				&pru_iopage_registers->registers[action->dato_register_handle];
+		uint16_t target_val = (action->flags & IOPAGEREGISTER_ACTION_DATO_COPY) ? reg_val : target->value;
+		target->value = (target_val & ~action->dato_clear_bits) | action->dato_set_bits;
+	}
+}
+
+// result 1 = successful, 0 = not implemented: bus timeout
+uint8_t virtual_pru_c::emulated_addr_read(uint32_t addr, uint16_t *val)
+{
+	volatile pru_iopage_registers_t *regs = pru_iopage_registers;
+	if (addr < regs->memory_limit_addr && addr >= regs->memory_start_addr) {
+		*val = ddrmem_base->memory.words[addr / 2];
+		return 1;
+	}
+#if defined(UNIBUS)
+	if (addr < regs->iopage_start_addr)
+		return 0;
+#elif defined(QBUS)
+	if (!(addr & QUNIBUS_IOPAGE_ADDR_BITMASK))
+		return 0;
+#endif
+	uint8_t reghandle = IOPAGE_REGISTER_ENTRY(*regs, addr);
+	if (reghandle == 0)
+		return 0; // register not implemented
+	if (reghandle == IOPAGE_REGISTER_HANDLE_ROM) {
+		// ROM is backed by DDR memory at the iopage address
+		*val = ddrmem_base->memory.words[(regs->iopage_start_addr + (addr & 017777)) / 2];
+		return 1;
+	}
+	volatile pru_iopage_register_t *reg = &(regs->registers[reghandle]);
+	*val = reg->value;
+	if (reg->event_flags & IOPAGEREGISTER_EVENT_FLAG_ACTION)
+		do_register_action_dati(reghandle, reg);
+	if (reg->event_flags & IOPAGEREGISTER_EVENT_FLAG_DATI)
+		do_event_deviceregister(reg, QUNIBUS_CYCLE_DATI, addr, *val);
+	return 1;
+}
+
+uint8_t virtual_pru_c::emulated_addr_write_w(uint32_t addr, uint16_t w)
+{
+	volatile pru_iopage_registers_t *regs = pru_iopage_registers;
+	if (addr < regs->memory_limit_addr && addr >= regs->memory_start_addr) {
+		ddrmem_base->memory.words[addr / 2] = w;
+		return 1;
+	}
+#if defined(UNIBUS)
+	if (addr < regs->iopage_start_addr)
+		return 0;
+#elif defined(QBUS)
+	if (!(addr & QUNIBUS_IOPAGE_ADDR_BITMASK))
+		return 0;
+#endif
+	uint8_t reghandle = IOPAGE_REGISTER_ENTRY(*regs, addr);
+	if (reghandle == 0 || reghandle == IOPAGE_REGISTER_HANDLE_ROM)
+		return 0; // not implemented, ROM does not respond to DATO
+	volatile pru_iopage_register_t *reg = &(regs->registers[reghandle]);
+	uint16_t reg_val = (reg->value & ~reg->writable_bits) | (w & reg->writable_bits);
+	reg->value = reg_val;
+	if (reg->event_flags & IOPAGEREGISTER_EVENT_FLAG_ACTION)
+		do_register_action_dato(reghandle, reg_val);
+	if (reg->event_flags & IOPAGEREGISTER_EVENT_FLAG_DATO)
+		do_event_deviceregister(reg, QUNIBUS_CYCLE_DATO, addr, reg_val);
+	return 1;
+}
+
+uint8_t virtual_pru_c::emulated_addr_write_b(uint32_t addr, uint8_t b)
+{
+	volatile pru_iopage_registers_t *regs = pru_iopage_registers;
+	if (addr < regs->memory_limit_addr && addr >= regs->memory_start_addr) {
+		ddrmem_base->memory.bytes[addr] = b;
+		return 1;
+	}
+#if defined(UNIBUS)
+	if (addr < regs->iopage_start_addr)
+		return 0;
+#elif defined(QBUS)
+	if (!(addr & QUNIBUS_IOPAGE_ADDR_BITMASK))
+		return 0;
+#endif
+	uint8_t reghandle = IOPAGE_REGISTER_ENTRY(*regs, addr);
+	if (reghandle == 0 || reghandle == IOPAGE_REGISTER_HANDLE_ROM)
+		return 0; // not implemented, ROM does not respond to DATOB
+	volatile pru_iopage_register_t *reg = &(regs->registers[reghandle]);
+	uint16_t reg_val;
+	if (addr & 1) // odd address = write upper byte
+		reg_val = (reg->value & 0x00ff) // don't touch lower byte
+				| (reg->value & ~reg->writable_bits & 0xff00) // protected upper byte bits
+				| (((uint16_t) b << 8) & reg->writable_bits); // changed upper byte bits
+	else
+		// even address: write lower byte
+		reg_val = (reg->value & 0xff00) // don't touch upper byte
+				| (reg->value & ~reg->writable_bits & 0x00ff) // protected lower byte bits
+				| (b & reg->writable_bits); // changed lower byte bits
+	reg->value = reg_val;
+	if (reg->event_flags & IOPAGEREGISTER_EVENT_FLAG_ACTION)
+		do_register_action_dato(reghandle, reg_val);
+	if (reg->event_flags & IOPAGEREGISTER_EVENT_FLAG_DATO)
+		do_event_deviceregister(reg, QUNIBUS_CYCLE_DATOB, addr, reg_val);
+	return 1;
+}
+
+// INIT: reset all registers to their "reset_value"
+void virtual_pru_c::iopageregisters_reset_values()
+{
+	unsigned i;
+	for (i = 0; i < MAX_IOPAGE_REGISTER_COUNT; i++)
+		pru_iopage_registers->registers[i].value = pru_iopage_registers->registers[i].reset_value;
+}
+
+/*** bus master operations ***/
+
+// execute the DMA setup in mailbox.dma, as pru1_statemachine_dma.c
+void virtual_pru_c::do_dma()
+{
+	volatile mailbox_dma_t *dma = &mailbox->dma;
+	uint8_t buscycle = dma->buscycle;
+	unsigned wordsleft = dma->wordcount;
+	volatile uint16_t *dataptr = dma->words[dma->buffer_index];
+	if (dma->ddr_offset) // zero-copy: device buffer in DDR
+		dataptr = (volatile uint16_t *) ((volatile uint8_t *) ddrmem_base + dma->ddr_offset);
+	uint8_t final_dma_state = DMA_STATE_READY;
+
+	dma->cur_addr = dma->startaddr;
+	dma->cur_status = DMA_STATE_RUNNING;
+
+	while (wordsleft > 0) {
+		uint32_t addr = dma->cur_addr;
+		bool internal;
+#if defined(UNIBUS)
+		addr |= address_overlay; // M9312 boot vector
+#endif
+		if (buscycle == QUNIBUS_CYCLE_DATOB) {
+			uint16_t data = *dataptr;
+			// A00=1: upper byte, A00=0: lower byte
+			internal = emulated_addr_write_b(addr, (addr & 1) ? (data >> 8) : (data & 0xff));
+		} else if (QUNIBUS_CYCLE_IS_DATO(buscycle))
+			internal = emulated_addr_write_w(addr, *dataptr);
+		else {
+			uint16_t data;
+			internal = emulated_addr_read(addr, &data);
+			if (internal)
+				*dataptr = data;
+		}
+		if (!internal) {
+			// no physical bus: nobody else answers
+			final_dma_state = DMA_STATE_TIMEOUTSTOP;
+			break;
+		}
+		dataptr++;
+		wordsleft--;
+		if (wordsleft == 0)
+			break; // cur_addr remains at last address accessed
+		if (latches[VIRTUAL_PRU_INITIALIZATIONSIGNAL_LATCH] & INITIALIZATIONSIGNAL_INIT) {
+			final_dma_state = DMA_STATE_INITSTOP;
+			break;
+		}
+		dma->cur_addr += 2; // signal progress to ARM
+	}
+	__sync_synchronize(); // data valid before status
+	dma->cur_status = final_dma_state; // signal to ARM
+
+	if (dma->cpu_access) {
+		// for cpu access: ARM CPU thread ends looping now
+		EVENT_SIGNAL(*mailbox, dma);
+		if (dma->cpu_wakeup)
+			pru2arm_interrupt(); // ARM CPU thread sleeps: worker completes
+	} else {
+		// for device DMA: qunibusadapter worker() drains event ring
+		// result in ring entry, as EVENTRING_DMA_RESULT()
+		uint8_t idx = mailbox->eventring.head;
+		EVENTRING_ENTRY(*mailbox, idx).dma_buffer_index = dma->buffer_index;
+		EVENTRING_ENTRY(*mailbox, idx).dma_status = final_dma_state;
+		EVENTRING_ENTRY(*mailbox, idx).data = dma->wordcount;
+		EVENTRING_ENTRY(*mailbox, idx).addr = dma->cur_addr;
+		// activate queued chunk before ARM sees the result
+		if (dma->next_valid) {
+			if (final_dma_state == DMA_STATE_READY)
+				dma_next_activate(); // chunk queued by ARM2PRU_DMA_NEXT
+			else
+				dma->next_valid = 0; // error aborts queued chunk
+		}
+		eventring_push(EVENTRING_TYPE_DMA);
+	}
+}
+
+// as DMA_NEXT_ACTIVATE(): queued chunk in other buffer becomes current,
+// request arbitration
+void virtual_pru_c::dma_next_activate()
+{
+	volatile mailbox_dma_t *dma = &mailbox->dma;
+	dma->buffer_index ^= 1;
+	dma->buscycle = dma->next_buscycle;
+	dma->wordcount = dma->next_wordcount;
+	dma->startaddr = dma->next_startaddr;
+	dma->ddr_offset = dma->next_ddr_offset;
+	dma->next_valid = 0;
+	dma->cur_status = DMA_STATE_ARBITRATING;
+	device_request_mask |= PRIORITY_ARBITRATION_BIT_NP;
+}
+
+// INTR vector GRANTed for level, as pru1_statemachine_intr_master.c
+// and pru1_statemachine_intr_slave.c
+void virtual_pru_c::do_intr_master(uint8_t level_index)
+{
+	if (emulate_cpu) {
+		// vector received by emulated CPU:
+		// block more GRANTs until PSW fetched
+		mailbox->arbitrator.ifs_priority_level = CPU_PRIORITY_LEVEL_FETCHING;
+		mailbox->events.intr_slave.vector = mailbox->intr.vector[level_index];
+		EVENT_SIGNAL(*mailbox, intr_slave);
+		pru2arm_interrupt();
+	}
+	// else no physical CPU: vector is lost on the bus.
+	// complete INTR cycle. Ring space reserved for each level.
+	EVENTRING_ENTRY(*mailbox, mailbox->eventring.head).level_index = level_index;
+	eventring_push(EVENTRING_TYPE_INTR_MASTER);
+}
+
+// emulated bus arbitrator and devices in one,
+// as sm_arb_worker_cpu() and sm_device_arb_worker()
+// result: true = bus cycle executed
+bool virtual_pru_c::arbitration_worker()
+{
+	bool result = false;
+	uint8_t intr_request_mask = device_request_mask & PRIORITY_ARBITRATION_INTR_MASK;
+	bool do_intr_arbitration = true;
+	uint8_t granted_level = 0; // 4..7 if INTR GRANTed
+
+	if (emulate_cpu) // ARM allowed INTR arbitration?
+		do_intr_arbitration = mailbox->arbitrator.ifs_intr_arbitration_pending;
+	else if (arbitration_noop)
+		do_intr_arbitration = false; // no INTRs without arbitrator
+
+	if (do_intr_arbitration && intr_request_mask && EVENT_IS_ACKED(*mailbox, intr_slave)) {
+		// highest BR level: BR4 = 0x01 -> 4, BR5 = 0x02 -> 5, etc.
+		uint8_t requested_intr_level = (31 - __builtin_clz(intr_request_mask)) + 4;
+		if (!emulate_cpu)
+			granted_level = requested_intr_level; // missing physical CPU runs at level 0
+		else if (requested_intr_level > mailbox->arbitrator.ifs_priority_level
+				&& mailbox->arbitrator.ifs_priority_level != CPU_PRIORITY_LEVEL_FETCHING)
+			granted_level = requested_intr_level;
+	}
+
+	if (device_request_mask & PRIORITY_ARBITRATION_BIT_NP) {
+		// device NPR has highest priority
+		device_request_mask &= ~PRIORITY_ARBITRATION_BIT_NP;
+		do_dma();
+		result = true;
+	} else if (granted_level) {
+		uint8_t level_index = granted_level - 4;
+		device_request_mask &= ~BIT(level_index);
+		do_intr_master(level_index);
+		result = true;
+	} else if (cpu_request) {
+		// no device requests active: emulated CPU owns the bus
+		cpu_request = false;
+		do_dma();
+		result = true;
+	}
+
+	// do not produce GRANTs until next ARM call of ARM2PRU_ARB_GRANT_INTR_REQUESTS
+	if (emulate_cpu)
+		mailbox->arbitrator.ifs_intr_arbitration_pending = false;
+	return result;
+}
+
+// detect change of INIT and power signals and send event,
+// as do_event_initializationsignals() and sm_initialization_func()
+void virtual_pru_c::do_event_initializationsignals()
+{
+	uint8_t bussignals_cur = latches[VIRTUAL_PRU_INITIALIZATIONSIGNAL_LATCH]
+			& INITIALIZATIONSIGNAL_ANY;
+
+	if (bussignals_cur & INITIALIZATIONSIGNAL_INIT) {
+		device_request_mask = 0; // INIT clears all PRIORITY request signals
+	}
+
+	// Power event
+	uint8_t powersignals_prev = mailbox->events.power_signals_cur; // as ARM knows
+	if ((powersignals_prev ^ bussignals_cur) & VIRTUAL_PRU_POWERSIGNALS) {
+		mailbox->events.power_signals_prev = powersignals_prev;
+		mailbox->events.power_signals_cur = bussignals_cur & VIRTUAL_PRU_POWERSIGNALS;
+		EVENT_SIGNAL(*mailbox, power);
+		pru2arm_interrupt();
+	}
+
+#if defined(UNIBUS)
+	// UNIBUS: event on both edges of INIT
+	uint8_t initsignal_prev = mailbox->events.init_signal_cur; // as ARM knows
+	if ((initsignal_prev ^ bussignals_cur) & INITIALIZATIONSIGNAL_INIT) {
+		if (!initsignal_prev)
+			iopageregisters_reset_values(); // INIT raised
+		mailbox->events.init_signal_cur = bussignals_cur & INITIALIZATIONSIGNAL_INIT;
+		EVENT_SIGNAL(*mailbox, init);
+		pru2arm_interrupt();
+	}
+#elif defined(QBUS)
+	// QBUS: event only on raising edge of INIT
+	if (!init_asserted_seen) {
+		if (bussignals_cur & INITIALIZATIONSIGNAL_INIT) {
+			mailbox->events.init_signal_cur = 1;
+			iopageregisters_reset_values();
+			EVENT_SIGNAL(*mailbox, init);
+			pru2arm_interrupt();
+			init_asserted_seen = true;
+		}
+	} else if (EVENT_IS_ACKED(*mailbox, init) && !(bussignals_cur & INITIALIZATIONSIGNAL_INIT))
+		init_asserted_seen = false; // wait for trailing edge of INIT
+#endif
+}
+
+// process ARM commands, as switch() in pru1_main_*.c
+// result: true = opcode executed
+bool virtual_pru_c::arm2pru_worker()
+{
+	uint32_t arm2pru_req_cached = mailbox->arm2pru_req;
+	if (arm2pru_req_cached == ARM2PRU_NONE)
+		return false;
+	__sync_synchronize(); // mailbox data valid after arm2pru_req
+
+	switch (arm2pru_req_cached) {
+	case ARM2PRU_NOP: // needed to probe PRU run state
+		break;
+	case ARM2PRU_HALT:
+		worker_terminate = true;
+		break;
+	case ARM2PRU_MAILBOXTEST1:
+		mailbox->mailbox_test.val = mailbox->mailbox_test.addr;
+		break;
+	case ARM2PRU_BUSLATCH_INIT: // all signals deasserted
+		memset(latches, 0, sizeof(latches));
+		break;
+	case ARM2PRU_BUSLATCH_SET: {
+		uint8_t reg_sel = mailbox->buslatch.addr & 7;
+		latches[reg_sel] = (latches[reg_sel] & ~mailbox->buslatch.bitmask)
+				| (mailbox->buslatch.val & mailbox->buslatch.bitmask);
+		mailbox->buslatch.val = latches[reg_sel];
+		break;
+	}
+	case ARM2PRU_BUSLATCH_GET:
+		mailbox->buslatch.val = latches[mailbox->buslatch.addr & 7];
+		break;
+	case ARM2PRU_BUSLATCH_EXERCISER: {
+		// latches are perfect registers
+		unsigned i;
+		for (i = 0; i < 8; i++) {
+			uint8_t reg_sel = mailbox->buslatch_exerciser.addr[i] & 7;
+			latches[reg_sel] = mailbox->buslatch_exerciser.writeval[i];
+			mailbox->buslatch_exerciser.readval[i] = latches[reg_sel];
+		}
+		break;
+	}
+	case ARM2PRU_BUSLATCH_TEST: // nothing to test
+		break;
+	case ARM2PRU_INITALIZATIONSIGNAL_SET: {
+		// signal id is its bit mask in the latch
+		uint8_t mask = mailbox->initializationsignal.id & INITIALIZATIONSIGNAL_ANY;
+		uint8_t *latch = &latches[VIRTUAL_PRU_INITIALIZATIONSIGNAL_LATCH];
+		*latch = (*latch & ~mask) | (mailbox->initializationsignal.val ? mask : 0);
+		break;
+	}
+	case ARM2PRU_ADDRESS_OVERLAY:
+		address_overlay = mailbox->address_overlay;
+		break;
+	case ARM2PRU_ARB_MODE_NONE:
+		arbitration_noop = true;
+		break;
+	case ARM2PRU_ARB_MODE_CLIENT:
+		arbitration_noop = false;
+		break;
+	case ARM2PRU_DMA:
+		// different arbitration for device and CPU memory access.
+		if (mailbox->dma.cpu_access)
+			cpu_request = true;
+		else {
+			mailbox->dma.next_valid = 0;
+			mailbox->dma.cur_status = DMA_STATE_ARBITRATING;
+			device_request_mask |= PRIORITY_ARBITRATION_BIT_NP;
+		}
+		break;
+	case ARM2PRU_DMA_NEXT:
+		// queue device DMA chunk, or start now if current one already complete
+		if (mailbox->dma.cur_status == DMA_STATE_ARBITRATING
+				|| mailbox->dma.cur_status == DMA_STATE_RUNNING)
+			mailbox->dma.next_valid = 1;
+		else if (mailbox->dma.cur_status == DMA_STATE_READY)
+			dma_next_activate();
+		break;
+	case ARM2PRU_INTR:
+		device_request_mask |= mailbox->intr.priority_arbitration_bit;
+		// Atomically change state in a device's associated interrupt register.
+		if (mailbox->intr.iopage_register_handle)
+			pru_iopage_registers->registers[mailbox->intr.iopage_register_handle].value =
+					mailbox->intr.iopage_register_value;
+		break;
+	case ARM2PRU_INTR_CANCEL:
+		device_request_mask &= ~mailbox->intr.priority_arbitration_bit;
+		break;
+	case ARM2PRU_ARB_GRANT_INTR_REQUESTS:
+		if (emulate_cpu)
+			mailbox->arbitrator.ifs_intr_arbitration_pending = true;
+		break;
+	case ARM2PRU_CPU_ENABLE:
+		emulate_cpu = mailbox->param;
+		break;
+	case ARM2PRU_CPU_BUS_ACCESS: // no physical CPU to inhibit
+		break;
+	case ARM2PRU_DDR_FILL_PATTERN: {
+		unsigned n;
+		for (n = 0; n < QUNIBUS_MAX_WORDCOUNT; n++)
+			ddrmem_base->memory.words[n] = n;
+		break;
+	}
+	case ARM2PRU_DDR_SLAVE_MEMORY:
+		// no bus master to serve: wait until ARM aborts by writing arm2pru_req
+		return false;
+	default:
+		WARNING("Virtual PRU: opcode %u not implemented", arm2pru_req_cached);
+	}
+	__sync_synchronize(); // results valid before ACK
+	mailbox->arm2pru_req = ARM2PRU_NONE; // ACK: done
+	return true;
+}
+
+// PRU1 main loop
+void virtual_pru_c::worker()
+{
+	unsigned idle_count = 0;
+	while (!worker_terminate) {
+		bool busy = false;
+		// signal INIT or PWR FAIL to ARM
+		// before arbitration, so BR/NPR requests are canceled on INIT
+		do_event_initializationsignals();
+
+		// Delay INTR or DMA while ARM processes a deviceregister event.
+		if (EVENT_IS_ACKED(*mailbox, deviceregister)) {
+			if (deviceregister_stretch_active) {
+				// as DEVICEREGISTER_STRETCH_END(), in 5 ns PRU cycles
+				struct timespec now;
+				clock_gettime(CLOCK_MONOTONIC, &now);
+				uint64_t ns = (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+				mailbox->events.deviceregister.ack_cycles = (ns - deviceregister_signal_ns) / 5;
+				deviceregister_stretch_active = false;
+			}
+			busy |= arbitration_worker();
+		}
+
+		busy |= arm2pru_worker();
+		if (busy)
+			idle_count = 0;
+		else if (++idle_count < VIRTUAL_PRU_IDLE_SPIN_COUNT)
+			sched_yield(); // PRU spins, but must share CPU cores with ARM threads
+		else {
+			// long idle: sleep, so realtime priority does not block the host
+			struct timespec ts = { 0, VIRTUAL_PRU_IDLE_SLEEP_NS };
+			nanosleep(&ts, NULL);
+		}
+	}
+}
+
+/*** prussdrv API ***/
+
+int prussdrv_init(void)
+{
+	if (virtual_pru == NULL)
+		virtual_pru = new virtual_pru_c();
+	virtual_pru->memory_alloc();
+	return 0;
+}
+
+int prussdrv_open(unsigned int host_interrupt)
+{
+	UNUSED(host_interrupt);
+	return 0;
+}
+
+int prussdrv_pruintc_init(const tpruss_intc_initdata *prussintc_init_data)
+{
+	UNUSED(prussintc_init_data);
+	return 0;
+}
+
+int prussdrv_map_prumem(unsigned int pru_ram_id, void **address)
+{
+	switch (pru_ram_id) {
+	case PRUSS0_PRU0_DATARAM:
+		*address = virtual_pru->pru0_dataram;
+		return 0;
+	case PRUSS0_SHARED_DATARAM:
+		*address = virtual_pru->pru_shared_dataram;
+		return 0;
+	default:
+		return -1;
+	}
+}
+
+int prussdrv_map_extmem(void **address)
+{
+	*address = (void *) virtual_pru->ddrmem_base;
+	return 0;
+}
+
+unsigned int prussdrv_extmem_size(void)
+{
+	return virtual_pru->ddrmem_size;
+}
+
+// PRU never dereferences this address, just for display
+unsigned int prussdrv_get_phys_addr(const void *address)
+{
+	return (unsigned int) (uintptr_t) address;
+}
+
+// no code to load: PRU0 does nothing, PRU1 starts the emulation
+int prussdrv_exec_code_at(int prunum, const unsigned int *code, int codelen, unsigned int addr)
+{
+	UNUSED(code);
+	UNUSED(codelen);
+	UNUSED(addr);
+	if (prunum == 1)
+		virtual_pru->start();
+	return 0;
+}
+
+int prussdrv_pru_wait_event_timeout(unsigned int host_interrupt, unsigned int time_us)
+{
+	UNUSED(host_interrupt);
+	return virtual_pru->wait_event_timeout(time_us);
+}
+
+// PRU2ARM_INTERRUPT is cleared by wait_event_timeout()
+int prussdrv_pru_clear_event(unsigned int host_interrupt, unsigned int sysevent)
+{
+	UNUSED(host_interrupt);
+	UNUSED(sysevent);
+	return 0;
+}
+
+int prussdrv_pru_disable(unsigned int prunum)
+{
+	if (prunum == 1 && virtual_pru)
+		virtual_pru->stop();
+	return 0;
+}
+
+int prussdrv_exit(void)
+{
+	return 0;
+}
+
+#endif // VIRTUAL_PRU
@@ -0,0 +1,136 @@
+/* pru_virtual.hpp: Software emulation of PRU1 for host builds without PRU
+
+ Copyright (c) 2026, QUniBone contributors
+ https://github.com/j-hoppe/QUniBone
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ THE CONTRIBUTORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+ 15-oct-2026  QC      created
+
+ Compiled with -DVIRTUAL_PRU instead of prussdrv.h.
+ Provides the subset of the prussdrv API used by pru_c, mailbox, iopageregisters
+ and qunibusadapter. PRU shared RAM and DDR memory are plain host memory,
+ PRU1 is a thread executing the ARM2PRU opcodes against the mailbox_t
+ and the pru_iopage_registers_t table.
+ There is no physical QBUS/UNIBUS: all bus cycles end on emulated memory and
+ registers, all other addresses produce a bus timeout.
+ */
+#ifndef _PRU_VIRTUAL_HPP_
+#define _PRU_VIRTUAL_HPP_
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "logsource.hpp"
+#include "ddrmem.h"
+#include "iopageregister.h"
+
+// RAM IDs for prussdrv_map_prumem(), as in prussdrv.h
+#define PRUSS0_PRU0_DATARAM	0
+#define PRUSS0_PRU1_DATARAM	1
+#define PRUSS0_SHARED_DATARAM	4
+
+// host interrupt and system event, as in pruss_intc_mapping.h
+#define PRU_EVTOUT_0	0
+#define PRU0_ARM_INTERRUPT	19
+
+// interrupt controller setup is meaningless without PRUSS
+typedef struct {
+	int dummy;
+} tpruss_intc_initdata;
+#define PRUSS_INTC_INITDATA	{ 0 }
+
+class virtual_pru_c: public logsource_c {
+private:
+	pthread_t worker_pthread;
+	volatile bool worker_terminate;
+	bool worker_running;
+
+	// PRU2ARM_INTERRUPT
+	pthread_mutex_t pru2arm_mutex;
+	pthread_cond_t pru2arm_cond;
+	bool pru2arm_pending;
+	unsigned pru2arm_count; // returned by wait_event_timeout()
+
+	// state of PRU1, as in pru1_main_*.c
+	bool emulate_cpu;
+	uint32_t address_overlay;
+	uint8_t latches[8]; // bus latch registers as seen by ARM
+	uint8_t device_request_mask; // PRIORITY_ARBITRATION_BIT_* of emulated devices
+	bool cpu_request; // DMA with cpu_access pending
+	bool arbitration_noop; // ARM2PRU_ARB_MODE_NONE
+	bool init_asserted_seen; // QBUS: INIT raised, event not yet completed
+	// blocking deviceregister event: SSYN stretch into ack_cycles on ACK
+	bool deviceregister_stretch_active;
+	uint64_t deviceregister_signal_ns;
+
+	void pru2arm_interrupt(void);
+	void eventring_push(uint8_t type);
+	void do_event_deviceregister(volatile pru_iopage_register_t *reg,
+			uint8_t unibus_control, uint32_t addr, uint16_t data);
+	void do_register_action_dati(uint8_t reghandle, volatile pru_iopage_register_t *reg);
+	void do_register_action_dato(uint8_t reghandle, uint16_t reg_val);
+
+	uint8_t emulated_addr_read(uint32_t addr, uint16_t *val);
+	uint8_t emulated_addr_write_w(uint32_t addr, uint16_t w);
+	uint8_t emulated_addr_write_b(uint32_t addr, uint8_t b);
+	void iopageregisters_reset_values(void);
+
+	void do_dma(void);
+	void dma_next_activate(void);
+	void do_intr_master(uint8_t level_index);
+	bool arbitration_worker(void);
+	void do_event_initializationsignals(void);
+	bool arm2pru_worker(void);
+
+public:
+	// memory which is "PRU RAM" and "shared DDR" on the BeagleBone
+	void *pru0_dataram;
+	void *pru_shared_dataram;
+	volatile ddrmem_t *ddrmem_base;
+	unsigned ddrmem_size;
+
+	virtual_pru_c();
+	~virtual_pru_c();
+
+	void memory_alloc(void);
+	void start(void);
+	void stop(void);
+	void worker(void);
+
+	int wait_event_timeout(unsigned time_us);
+};
+
+extern virtual_pru_c *virtual_pru; // singleton
+
+// prussdrv API subset, implemented by virtual_pru
+int prussdrv_init(void);
+int prussdrv_open(unsigned int host_interrupt);
+int prussdrv_pruintc_init(const tpruss_intc_initdata *prussintc_init_data);
+int prussdrv_map_prumem(unsigned int pru_ram_id, void **address);
+int prussdrv_map_extmem(void **address);
+unsigned int prussdrv_extmem_size(void);
+unsigned int prussdrv_get_phys_addr(const void *address);
+int prussdrv_exec_code_at(int prunum, const unsigned int *code, int codelen, unsigned int addr);
+int prussdrv_pru_wait_event_timeout(unsigned int host_interrupt, unsigned int time_us);
+int prussdrv_pru_clear_event(unsigned int host_interrupt, unsigned int sysevent);
+int prussdrv_pru_disable(unsigned int prunum);
+int prussdrv_exit(void);
+
+#endif
@@ -21,6 +21,8 @@
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
+ 16-oct-2026	QC      compiled to lookup tables, data match, count, post trigger, text program
+ 16-oct-2026	QC      is_armed()
  13-feb-2021	JH      created
 
 
@@ -37,6 +39,10 @@
 #define _QUNIBUS_TRACER_HPP_
 
 
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <vector>
 #include <string>
 
@@ -46,26 +52,49 @@
 #define TRIGGER_DATOB (1 << QUNIBUS_CYCLE_DATOB)
 #define TRIGGER_DATANY (TRIGGER_DATI | TRIGGER_DATO | TRIGGER_DATOB)
 
+// Conditions are compiled into lookup tables, so probe() costs the same
+// for any program:
+// - per 8KB page: mask of conditions covering the whole page,
+//   and a table with a mask per word. Bit n = condition n.
+// - per cycle type: mask of conditions accepting it.
+// Only if the current condition is a candidate, exact address, data
+// and repeat count are checked.
+#define TRIGGER_MAX_CONDITIONS	32	// bits of a mask
+#define TRIGGER_PAGE_SHIFT	13
+#define TRIGGER_PAGE_MASK	((1 << TRIGGER_PAGE_SHIFT) - 1)
+#define TRIGGER_PAGE_WORDS	(1 << (TRIGGER_PAGE_SHIFT - 1))
+#define TRIGGER_PAGE_COUNT	((1 << 22) >> TRIGGER_PAGE_SHIFT) // 22 bit QBUS
+
 class trigger_condition_c {
 public:
     // cycles: OR set of TRIGGER_DAT*
     trigger_condition_c(unsigned _address, unsigned _cycle_mask) {
         address_from = this->address_to = _address ;
         cycle_mask = _cycle_mask ;
+        data_value = data_mask = 0 ;
+        count = 1 ;
     }
-    trigger_condition_c(unsigned _address_from, unsigned _address_to, unsigned _cycle_mask) {
+    trigger_condition_c(unsigned _address_from, unsigned _address_to, unsigned _cycle_mask,
+                        unsigned _data_value = 0, unsigned _data_mask = 0, unsigned _count = 1) {
         address_from = _address_from ;
         address_to = _address_to ;
         cycle_mask = _cycle_mask ;
+        data_value = _data_value ;
+        data_mask = _data_mask ;
+        count = _count ? _count : 1 ;
     }
 
     unsigned	address_from ;
     unsigned	address_to ;
     unsigned	cycle_mask ; // multiple of "1 << " QUNIBUS_CYCLE_DATI,DATO,DATOB
-    bool matches(uint32_t _address, unsigned _cycle) {
+    unsigned	data_value ; // compared with data bits in data_mask
+    unsigned	data_mask ; // 0 = any data
+    unsigned	count ; // matches needed to advance to next condition
+    bool matches(uint32_t _address, unsigned _cycle, uint16_t _data) {
         return (_address >= address_from)
                && (_address <= address_to)
-               && (cycle_mask & (1 << _cycle)) ;
+               && (cycle_mask & (1 << _cycle))
+               && ((_data & data_mask) == (data_value & data_mask)) ;
     }
     char *to_string() {
         static char buff[255] ; // how C-ish !
@@ -79,54 +108,238 @@ public:
             strcat(buff, "DATO ") ;
         if (cycle_mask & TRIGGER_DATOB)
             strcat(buff, "DATOB ") ;
+        if (data_mask)
+            sprintf(buff + strlen(buff), "data %06o mask %06o ", data_value, data_mask) ;
+        if (count > 1)
+            sprintf(buff + strlen(buff), "%u times ", count) ;
         return buff ;
     }
 } ;
 
 //is an ordered list of conditions
 class trigger_c: std::vector<trigger_condition_c> {
+private:
+    typedef struct {
+        uint32_t all ; // conditions on every word of page
+        uint32_t *words ; // conditions per word, or zero_words
+    } page_t ;
+    page_t	pages[TRIGGER_PAGE_COUNT] ;
+    uint32_t	zero_words[TRIGGER_PAGE_WORDS] ; // shared by pages without single word conditions
+    uint32_t	cycle_conditions[4] ; // index QUNIBUS_CYCLE_*
+
+    uint32_t	level_bit ; // 1 << level, 0 if all conditions met
+    unsigned	level_hits ; // matches of current condition
+    unsigned	post_cycles_left ; // counting down after last condition
+
+    void pages_free() {
+        for (unsigned i = 0 ; i < TRIGGER_PAGE_COUNT ; i++) {
+            if (pages[i].words != zero_words)
+                free(pages[i].words) ;
+            pages[i].all = 0 ;
+            pages[i].words = zero_words ;
+        }
+    }
+
+    // set bit of condition n in all tables
+    void compile_condition(unsigned n) {
+        trigger_condition_c *c = &at(n) ;
+        uint32_t bit = 1U << n ;
+        for (unsigned cycle = 0 ; cycle < 4 ; cycle++)
+            if (c->cycle_mask & (1 << cycle))
+                cycle_conditions[cycle] |= bit ;
+        // words touched by range, inclusive
+        uint32_t word_from = c->address_from >> 1 ;
+        uint32_t word_to = c->address_to >> 1 ;
+        if (word_to >= TRIGGER_PAGE_COUNT * TRIGGER_PAGE_WORDS)
+            word_to = TRIGGER_PAGE_COUNT * TRIGGER_PAGE_WORDS - 1 ;
+        for (uint32_t w = word_from ; w <= word_to ; ) {
+            page_t *page = &pages[w / TRIGGER_PAGE_WORDS] ;
+            uint32_t page_first = w & ~(TRIGGER_PAGE_WORDS - 1) ;
+            uint32_t page_last = page_first + TRIGGER_PAGE_WORDS - 1 ;
+            if (w == page_first && word_to >= page_last)
+                page->all |= bit ;
+            else {
+                if (page->words == zero_words)
+                    page->words = (uint32_t *)calloc(TRIGGER_PAGE_WORDS, sizeof(uint32_t)) ;
+                for (uint32_t i = w ; i <= word_to && i <= page_last ; i++)
+                    page->words[i - page_first] |= bit ;
+            }
+            w = page_last + 1 ;
+        }
+    }
+
 public:
     trigger_c() {
+        memset(zero_words, 0, sizeof(zero_words)) ;
+        for (unsigned i = 0 ; i < TRIGGER_PAGE_COUNT ; i++)
+            pages[i].words = zero_words ;
+        post_trigger_cycles = 0 ;
+        generation = 0 ;
         conditions_clear() ;
     }
+    ~trigger_c() {
+        pages_free() ;
+    }
 
     /* defining */
+    unsigned	post_trigger_cycles ; // bus cycles probed after last condition, then triggered
+
+    // changes, when set of probed pages changes. See page_probed()
+    unsigned	generation ;
+
     void conditions_clear() {
         clear() ;
+        pages_free() ;
+        memset(cycle_conditions, 0, sizeof(cycle_conditions)) ;
         reset() ;
     }
 
     // define a multi-level conditions
-    void condition_add(trigger_condition_c tc) {
+    // result: false, if too many
+    bool condition_add(trigger_condition_c tc) {
+        if (size() >= TRIGGER_MAX_CONDITIONS)
+            return false ;
         push_back(tc) ;
+        compile_condition(size() - 1) ;
+        reset() ;
+        return true ;
+    }
+
+    // Replace conditions by text program, all numbers octal except count:
+    //   <addr>[-<addr>][:<cycles>][=<data>[/<mask>]][*<count>],...
+    // cycles: any of "i", "o", "b" for DATI, DATO, DATOB. Default all.
+    // Example: "777170:o,3576:i*3" = write to RXCS, then 3 reads of 3576.
+    // Result: false and error text on syntax error, conditions unchanged.
+    bool parse(std::string program, std::string *error) {
+        std::vector<trigger_condition_c> conditions ;
+        const char *s = program.c_str() ;
+        while (*s) {
+            char *end ;
+            unsigned from = strtoul(s, &end, 8) ;
+            if (end == s)
+                goto syntax_error ;
+            s = end ;
+            unsigned to = from ;
+            if (*s == '-') {
+                to = strtoul(++s, &end, 8) ;
+                if (end == s || to < from)
+                    goto syntax_error ;
+                s = end ;
+            }
+            unsigned cycle_mask = TRIGGER_DATANY ;
+            if (*s == ':') {
+                cycle_mask = 0 ;
+                for (s++ ; *s == 'i' || *s == 'o' || *s == 'b' ; s++)
+                    cycle_mask |= (*s == 'i') ? TRIGGER_DATI : (*s == 'o') ? TRIGGER_DATO : TRIGGER_DATOB ;
+                if (cycle_mask == 0)
+                    goto syntax_error ;
+            }
+            unsigned data_value = 0, data_mask = 0 ;
+            if (*s == '=') {
+                data_value = strtoul(++s, &end, 8) ;
+                if (end == s)
+                    goto syntax_error ;
+                s = end ;
+                data_mask = 0177777 ;
+                if (*s == '/') {
+                    data_mask = strtoul(++s, &end, 8) ;
+                    if (end == s)
+                        goto syntax_error ;
+                    s = end ;
+                }
+            }
+            unsigned count = 1 ;
+            if (*s == '*') {
+                count = strtoul(++s, &end, 10) ;
+                if (end == s || count == 0)
+                    goto syntax_error ;
+                s = end ;
+            }
+            conditions.push_back(trigger_condition_c(from, to, cycle_mask, data_value, data_mask, count)) ;
+            if (*s == ',')
+                s++ ;
+            else if (*s)
+                goto syntax_error ;
+        }
+        if (conditions.size() > TRIGGER_MAX_CONDITIONS) {
+            *error = "Trigger: max " + std::to_string(TRIGGER_MAX_CONDITIONS) + " conditions" ;
+            return false ;
+        }
+        conditions_clear() ;
+        for (unsigned i = 0 ; i < conditions.size() ; i++)
+            condition_add(conditions[i]) ;
+        return true ;
+syntax_error:
+        *error = "Trigger syntax error at \"" + std::string(s) + "\"" ;
+        return false ;
     }
 
     /* to monitor bus activity */
     unsigned	level ; // # of conditions met so far
 
     // insert into CPU code to monitor bus traffic
-    void probe(uint32_t address, uint8_t cycle) {
-        if (has_triggered() || size() == 0 )
+    void probe(uint32_t address, uint8_t cycle, uint16_t data) {
+        if (level_bit == 0) {
+            // not armed, or post trigger window
+            if (post_cycles_left && --post_cycles_left == 0)
+                generation++ ; // triggered, stop probing
+            return ;
+        }
+        page_t *page = &pages[(address >> TRIGGER_PAGE_SHIFT) & (TRIGGER_PAGE_COUNT - 1)] ;
+        uint32_t candidates = (page->all | page->words[(address & TRIGGER_PAGE_MASK) >> 1])
+                              & cycle_conditions[cycle & 3] ;
+        if (!(candidates & level_bit))
             return ;
-        if (at(level).matches(address,cycle))
-            level++ ;
+        trigger_condition_c *c = &(*this)[level] ;
+        if (!c->matches(address, cycle, data) || ++level_hits < c->count)
+            return ;
+        level_hits = 0 ;
+        level++ ;
+        if (level < size())
+            level_bit <<= 1 ;
+        else {
+            level_bit = 0 ;
+            post_cycles_left = post_trigger_cycles ;
+            generation++ ; // all pages probed in post window, or triggered
+        }
     }
 
     /* checking */
     // start probing again
     void reset() {
         level = 0 ;
+        level_hits = 0 ;
+        level_bit = size() > 0 ? 1 : 0 ;
+        post_cycles_left = 0 ;
+        generation++ ;
     }
 
     // check wether all conditions met.
     bool has_triggered(void) {
-        return (size() > 0 && level >= size()) ;
+        return (size() > 0 && level >= size() && post_cycles_left == 0) ;
+    }
+
+    // probe() must be called on bus cycles?
+    bool is_armed(void) {
+        return (size() > 0 && !has_triggered()) ;
     }
 
+    // must probe() be called on bus cycles to the 8KB page containing addr?
+    // Only pages with conditions, all pages in post trigger window.
+    bool page_probed(uint32_t addr) {
+        if (!is_armed())
+            return false ;
+        if (level_bit == 0)
+            return true ;
+        page_t *page = &pages[(addr >> TRIGGER_PAGE_SHIFT) & (TRIGGER_PAGE_COUNT - 1)] ;
+        return page->all || page->words != zero_words ;
+    }
 
     void print(FILE *stream) {
         for(unsigned  i=0 ; i < size() ; i++)
-            fprintf(stream, "%d) %s\n", i, at(i).to_string()) ;
+            fprintf(stream, "%d) %s%s\n", i, at(i).to_string(), i < level ? "(met)" : "") ;
+        if (post_trigger_cycles)
+            fprintf(stream, "then %u bus cycles\n", post_trigger_cycles) ;
     }
 
 } ;
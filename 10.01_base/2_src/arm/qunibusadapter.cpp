@@ -21,6 +21,20 @@
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
+ 16-oct-2026  QC      reg_ack latency: SSYN stretch measured by PRU
+ 16-oct-2026  QC      event ring entries read after barrier on head
+ 16-oct-2026  QC      latency timestamps cleared after use
+ 16-oct-2026  QC      CPU spin loop relaxes/yields the core
+ 16-oct-2026  QC      "posted" register events only with micro-actions
+ 16-oct-2026  QC      latency histograms
+ 16-oct-2026  QC      PRU micro-actions for register side effects
+ 16-oct-2026  QC      CPU bus cycle bursts
+ 16-oct-2026  QC      adaptive spin/sleep for CPU bus cycles
+ 16-oct-2026  QC      lock-free request scheduling
+ 16-oct-2026  QC      zero-copy DMA for device buffers in DDR
+ 15-oct-2026  QC      double buffered DMA chunks
+ 15-oct-2026  QC      scatter/gather DMA
+ 15-oct-2026  QC      non-blocking events via mailbox event ring
  aug-2020	JH		adapted to QBUS
  jul-2019     JH      rewrite: multiple parallel arbitration levels
  12-nov-2018  JH      entered beta phase
@@ -51,6 +65,8 @@
 #include <ios>
 #include <string.h>
 #include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
 #include <assert.h>
 #include <queue>
 
@@ -62,12 +78,28 @@
 #include "logger.hpp"
 #include "mailbox.h"
 #include "gpios.hpp"
-#include "prussdrv.h"
+#include "pru.hpp"
+#ifndef VIRTUAL_PRU
 #include "pruss_intc_mapping.h"
+#endif
 #include "iopageregister.h"
 #include "priorityrequest.hpp"
 #include "qunibusadapter.hpp"
 #include "unibuscpu.hpp"
+#include "timeout.hpp"
+#include "latency.hpp"
+
+// hint for the core in a busy-wait loop: reduce power, give way to sibling threads
+static inline void cpu_relax(void)
+{
+#if defined(__arm__) || defined(__aarch64__)
+    __asm__ __volatile__("yield" ::: "memory");
+#elif defined(__i386__) || defined(__x86_64__)
+    __asm__ __volatile__("pause" ::: "memory");
+#else
+    __sync_synchronize();
+#endif
+}
 
 qunibusadapter_c *qunibusadapter; // another Singleton
 // is registered in device_c.list<devices> ... order of static constructor calls ???
@@ -99,11 +131,21 @@ qunibusadapter_c::qunibusadapter_c() :     device_c()
     line_DCLO = false;
     line_ACLO = false;
 
-    requests_mutex = PTHREAD_MUTEX_INITIALIZER;
+    dispatch_mutex = PTHREAD_MUTEX_INITIALIZER;
+    dispatch_pending = false;
+    device_dma_write_count = 0;
 
     requests_init();
 
     registered_cpu = NULL;
+    cpu_spin_avg = 0;
+    worker_wakeup_ns = 0;
+    latency_ack_register_handle = 0;
+    cpu_spin_limit = QUNIBUSADAPTER_CPU_SPIN_MIN;
+    cpu_spin_yield = (sysconf(_SC_NPROCESSORS_ONLN) <= 1);
+    cpu_cycles_spun.value = 0;
+    cpu_cycles_parked.value = 0;
+    cpu_spin_iterations.value = 0;
 
 	memset(register_by_handle, 0, sizeof(register_by_handle)) ;
 }
@@ -123,7 +165,9 @@ void qunibusadapter_c::on_power_changed(signal_edge_enum aclo_edge, signal_edge_
 
 void qunibusadapter_c::on_init_changed(void) 
 {
-    requests_init();
+    pthread_mutex_lock(&dispatch_mutex);
+    requests_cancel_scheduled();
+    dispatch_unlock();
     // clear all pending BR and NPR lines on PRU
     mailbox->intr.priority_arbitration_bit = PRIORITY_ARBITRATION_BIT_MASK;
     mailbox_execute(ARM2PRU_INTR_CANCEL);
@@ -161,6 +205,7 @@ bool qunibusadapter_c::register_device(qunibusdevice_c& device)
     }
     devices[device_handle] = &device;
     device.handle = device_handle; // tell the device its slots
+    device.latency_stats = latency_recorder->get_stats(device.name.value);
 
     // lookup register_handles[]
     memset(register_handle_used, 0, sizeof(register_handle_used)); // all 0
@@ -238,6 +283,7 @@ bool qunibusadapter_c::register_device(qunibusdevice_c& device)
             if (device_reg->active_on_dato)
                 pru_iopage_reg->event_flags |= IOPAGEREGISTER_EVENT_FLAG_DATO;
         }
+        pru_iopage_registers->register_action_handles[register_handle] = 0;
         // write register handle into IO page address map
         uint32_t addr = device.base_addr.value + 2 * i; // devices have always sequential address register range!
         IOPAGE_REGISTER_ENTRY(*pru_iopage_registers,addr)= register_handle;
@@ -246,6 +292,55 @@ bool qunibusadapter_c::register_device(qunibusdevice_c& device)
 
         register_handle++;
     }
+
+    // PRU micro-actions: allocate entries in register_actions[]
+    for (i = 0; i < device.register_count; i++) {
+        qunibusdevice_register_t *device_reg = &(device.registers[i]);
+        volatile pru_iopage_register_t *pru_iopage_reg = device_reg->pru_iopage_register;
+        bool action_dati = (device_reg->action_dati_clear_bits != 0);
+        bool action_dato = (device_reg->action_dato_target != NULL);
+        if (!action_dati && !action_dato)
+            continue;
+        if ((action_dati && !device_reg->active_on_dati) || (action_dato && !device_reg->active_on_dato))
+            FATAL("register_device() Register configuration error for device %s, register idx %u:\n"
+                  "micro-actions only on DATI/DATO active registers.", device.name.value.c_str(), i);
+        if (action_dato && device_reg->action_dato_target->device != &device)
+            FATAL("register_device() Register configuration error for device %s, register idx %u:\n"
+                  "micro-action target must be register of same device.", device.name.value.c_str(), i);
+        // search unused entry, 0 = "no action"
+        unsigned action_handle;
+        for (action_handle = 1; action_handle < MAX_IOPAGE_REGISTER_ACTION_COUNT; action_handle++)
+            if (pru_iopage_registers->register_actions[action_handle].flags == 0)
+                break;
+        if (action_handle >= MAX_IOPAGE_REGISTER_ACTION_COUNT) {
+            ERROR("register_device() can not register device %s, all %d register micro-actions in use.",
+                  device.name.value.c_str(), MAX_IOPAGE_REGISTER_ACTION_COUNT - 1);
+            return false;
+        }
+        volatile pru_iopage_register_action_t *action = &pru_iopage_registers->register_actions[action_handle];
+        uint8_t action_flags = 0;
+        action->dati_clear_bits = device_reg->action_dati_clear_bits;
+        if (action_dati)
+            action_flags |= IOPAGEREGISTER_ACTION_DATI;
+        action->dato_register_handle = 0;
+        action->dato_clear_bits = device_reg->action_dato_clear_bits;
+        action->dato_set_bits = device_reg->action_dato_set_bits;
+        if (action_dato) {
+            action->dato_register_handle = device_reg->action_dato_target->register_handle;
+            action_flags |= IOPAGEREGISTER_ACTION_DATO;
+            if (device_reg->action_dato_copy)
+                action_flags |= IOPAGEREGISTER_ACTION_DATO_COPY;
+        }
+        action->flags = action_flags; // marks entry as used
+        pru_iopage_registers->register_action_handles[device_reg->register_handle] = action_handle;
+        // side effects done by PRU: ARM needs not to stall the bus cycle
+        pru_iopage_reg->event_flags |= IOPAGEREGISTER_EVENT_FLAG_ACTION;
+        if (action_dati)
+            pru_iopage_reg->event_flags |= IOPAGEREGISTER_EVENT_FLAG_DATI_POSTED;
+        if (action_dato)
+            pru_iopage_reg->event_flags |= IOPAGEREGISTER_EVENT_FLAG_DATO_POSTED;
+    }
+
     // if its a CPU, switch PRU to "with_CPU"
     unibuscpu_c *cpu = dynamic_cast<unibuscpu_c*>(&device);
     if (cpu) {
@@ -285,6 +380,12 @@ void qunibusadapter_c::unregister_device(qunibusdevice_c& device)
 	    qunibusdevice_register_t *device_reg = &(device.registers[i]);
         IOPAGE_REGISTER_ENTRY(*pru_iopage_registers,device_reg->addr) = 0;
 		register_by_handle[device_reg->register_handle] = NULL  ;
+        // free micro-action entry
+        uint8_t action_handle = pru_iopage_registers->register_action_handles[device_reg->register_handle];
+        if (action_handle) {
+            pru_iopage_registers->register_actions[action_handle].flags = 0;
+            pru_iopage_registers->register_action_handles[device_reg->register_handle] = 0;
+        }
 
         // register descriptor remain unchanged, also device->members
     }
@@ -358,35 +459,69 @@ void qunibusadapter_c::requests_init(void)
     }
 }
 
-// put a request into the level/slot table
+// put a request into the level/slot table, lock-free.
 // do not yet activate!
-void qunibusadapter_c::request_schedule(priority_request_c& request) 
+// First the slot is claimed with compare-and-swap, then published in
+// slot_request_mask for the dispatcher.
+// Request must be setup completely before.
+// Result: false, if an INTR of the device is already scheduled in the slot.
+bool qunibusadapter_c::request_schedule(priority_request_c& request) 
 {
-    // Must run under  pthread_mutex_lock(&requests_mutex);
     priority_request_level_c *prl = &request_levels[request.level_index];
+    priority_request_c *slotrequest = NULL;
     // DEBUG_FAST("request_schedule") ;
 
-    // a device may reraise on of its own interrupts, but not an DMA on same slot
-    if (dynamic_cast<dma_request_c *>(&request)) {
-        if (prl->slot_request[request.priority_slot] != NULL)
+    if (!prl->slot_request[request.priority_slot].compare_exchange_strong(slotrequest,
+            &request)) {
+        // a device may reraise on of its own interrupts, but not an DMA on same slot
+        if (dynamic_cast<dma_request_c *>(&request))
             FATAL("Concurrent DMA requested for slot %d.", (unsigned )request.priority_slot);
-    } else if (dynamic_cast<intr_request_c *>(&request)) {
-        if (prl->slot_request[request.priority_slot] != NULL) {
-            qunibusdevice_c *slotdevice = prl->slot_request[request.priority_slot]->device;
-            if (slotdevice != request.device)
-                FATAL(
-                    "Devices %s and %s share both slot %u for INTR request with priority index %u",
-                    slotdevice ? slotdevice->name.value.c_str() : "NULL",
-                    request.device->name.value.c_str(), (unsigned )request.priority_slot,
-                    (unsigned )request.level_index);
-            // DEBUG("request_schedule(): update request %p into level %u, slot %u",&request, request.level_index, request.slot);
-        } else {
-            //	DEBUG("request_schedule(): insert request %p into level %u, slot %u",&request, request.level_index, request.slot);
-        }
+        qunibusdevice_c *slotdevice = slotrequest->device;
+        if (slotdevice != request.device)
+            FATAL(
+                "Devices %s and %s share both slot %u for INTR request with priority index %u",
+                slotdevice ? slotdevice->name.value.c_str() : "NULL",
+                request.device->name.value.c_str(), (unsigned )request.priority_slot,
+                (unsigned )request.level_index);
+        // DEBUG("request_schedule(): request %p already in level %u, slot %u",&request, request.level_index, request.slot);
+        return false;
     }
+    //	DEBUG("request_schedule(): insert request %p into level %u, slot %u",&request, request.level_index, request.slot);
+    prl->slot_request_mask |= (1 << request.priority_slot);  // set slot bit: now visible
+    return true;
+}
 
-    prl->slot_request[request.priority_slot] = &request; // mark slot with request
-    prl->slot_request_mask |= (1 << request.priority_slot);  // set slot bit
+// Activate and execute the highest prioritized request on all idle levels.
+// Does not block: if another thread owns dispatch_mutex,
+// that one dispatches in dispatch_unlock().
+void qunibusadapter_c::requests_dispatch(void) 
+{
+    dispatch_pending = true;
+    if (pthread_mutex_trylock(&dispatch_mutex) != 0)
+        return; // owner sees dispatch_pending after release
+    dispatch_unlock();
+}
+
+// Release dispatch_mutex. Before, start requests scheduled while locked.
+void qunibusadapter_c::dispatch_unlock(void) 
+{
+    // Must run under  pthread_mutex_lock(&dispatch_mutex);
+    for (;;) {
+        if (dispatch_pending.exchange(false)) {
+            for (unsigned level_index = 0; level_index < PRIORITY_LEVEL_COUNT; level_index++) {
+                priority_request_level_c *prl = &request_levels[level_index];
+                if (!prl->active && prl->slot_request_mask
+                        && request_activate_lowest_slot(level_index))
+                    request_execute_active_on_PRU(level_index);
+            }
+        }
+        pthread_mutex_unlock(&dispatch_mutex);
+        // A thread which failed to lock has set dispatch_pending before.
+        // seq_cst: either it is seen here, or that thread's trylock succeeds.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!dispatch_pending || pthread_mutex_trylock(&dispatch_mutex) != 0)
+            return;
+    }
 }
 
 // Cancel all pending device_DMA and IRQ requests of every level.
@@ -396,24 +531,21 @@ void qunibusadapter_c::requests_cancel_scheduled(void)
 {
     priority_request_c *req;
 
-    // Must run under pthread_mutex_lock(&requests_mutex);
+    // Must run under pthread_mutex_lock(&dispatch_mutex);
     for (unsigned level_index = 0; level_index < PRIORITY_LEVEL_COUNT; level_index++) {
         priority_request_level_c *prl = &request_levels[level_index];
-        prl->slot_request_mask = 0; // clear alls slot from request
         prl->active = NULL;
+        // all published requests. Requests inserted meanwhile remain scheduled.
+        uint32_t mask = prl->slot_request_mask.exchange(0);
 
         for (unsigned slot = 0; slot < PRIORITY_SLOT_COUNT; slot++)
-            if ((req = prl->slot_request[slot])) {
+            if ((mask & (1 << slot)) && (req = prl->slot_request[slot].exchange(NULL))) {
                 dma_request_c *dmareq;
                 req->executing_on_PRU = false;
                 if ((dmareq = dynamic_cast<dma_request_c *>(req)))
                     dmareq->success = false; // device gets an DMA error, but will not understand
-                prl->slot_request[slot] = NULL;
                 // signal to blocking DMA() or INTR()
-                pthread_mutex_lock(&req->complete_mutex);
-                req->complete = true;
-                pthread_cond_signal(&req->complete_cond);
-                pthread_mutex_unlock(&req->complete_mutex);
+                req->complete_signal();
             }
     }
 }
@@ -421,7 +553,7 @@ void qunibusadapter_c::requests_cancel_scheduled(void)
 /*
  // is a request of given level active on the PRU?
  bool qunibusadapter_c::request_is_active(unsigned level_index) {
- // Must run under  pthread_mutex_lock(&requests_mutex);
+ // Must run under  pthread_mutex_lock(&dispatch_mutex);
  priority_request_level_c *prl = &request_levels[level_index];
  return (prl->active != NULL);
  }
@@ -455,7 +587,7 @@ priority_request_c *qunibusadapter_c::request_activate_lowest_slot(unsigned leve
     // 	DEBUG("request_activate_lowest_slot(): ->active = dma_request %p, level %u, slot %u",prl->active, prl->active->level_index, prl->active->slot);
     // else
     // 	DEBUG("request_activate_lowest_slot(): ->active = NULL");
-    assert((prl->slot_request_mask == 0) == (prl->active == NULL));
+    // no check of slot_request_mask against active: devices insert concurrently
 
     return rq;
 }
@@ -463,6 +595,7 @@ priority_request_c *qunibusadapter_c::request_activate_lowest_slot(unsigned leve
 // is any request of higher or same level executed? Is the next request executed delayed?
 bool qunibusadapter_c::request_is_blocking_active(uint8_t level_index) 
 {
+    // Must run under  pthread_mutex_lock(&dispatch_mutex);
     while (level_index < PRIORITY_LEVEL_COUNT) {
         priority_request_level_c *prl = &request_levels[level_index];
         if (prl->active)
@@ -474,17 +607,31 @@ bool qunibusadapter_c::request_is_blocking_active(uint8_t level_index)
     return false;
 }
 
+// DMA start address as expected by PRU
+static uint32_t dma_pru_addr(uint32_t qunibus_addr)
+{
+    if (qunibus_addr >= qunibus->iopage_start_addr) {
+#if defined(UNIBUS)
+        // UniBone PRU doesn't handle IOpage addresses marked with IOpage bit 22
+        return qunibus_addr ;
+#elif defined(QBUS)
+        return qunibus_addr | QUNIBUS_IOPAGE_ADDR_BITMASK ;
+#endif
+    } else
+        return qunibus_addr ;
+}
+
 // helper: push the active request to the PRU for execution
 // VB: the next request to schedule already calculated and saved in priority_request_level_c.active
 void qunibusadapter_c::request_execute_active_on_PRU(unsigned level_index) 
 {
     priority_request_level_c *prl = &request_levels[level_index];
     assert(prl->active);
-    // Must run under  pthread_mutex_lock(&requests_mutex);
+    // Must run under  pthread_mutex_lock(&dispatch_mutex);
     // DEBUG_FAST("request_execute_active_on_PRU(level_idx=%u)", level_index);
     if (level_index == PRIORITY_LEVEL_INDEX_NPR) {
 
-        dma_request_c *dmareq = dynamic_cast<dma_request_c *>(prl->active);
+        dma_request_c *dmareq = dynamic_cast<dma_request_c *>(prl->active.load());
         assert(dmareq);
 
         // We do the device_DMA transfer in chunks so we can handle arbitrary buffer sizes.
@@ -496,22 +643,18 @@ void qunibusadapter_c::request_execute_active_on_PRU(unsigned level_index)
         dmareq->chunk_words = std::min(dmareq->chunk_max_words, wordcount_remaining);
 
         assert(dmareq->chunk_words); // if complete, the dmareq should not be active anymore
-        if (dmareq->chunk_qunibus_start_addr >= qunibus->iopage_start_addr) {
-#if defined(UNIBUS)
-            // UniBone PRU doesn't handle IOpage addresses marked with IOpage bit 22
-            mailbox->dma.startaddr = dmareq->chunk_qunibus_start_addr ;
-#elif defined(QBUS)
-            mailbox->dma.startaddr = dmareq->chunk_qunibus_start_addr | QUNIBUS_IOPAGE_ADDR_BITMASK ;
-#endif
-        } else
-            mailbox->dma.startaddr = dmareq->chunk_qunibus_start_addr ;
+        dmareq->chunk_buffer_index = 0;
+        dmareq->chunk_queued_words = 0;
+        mailbox->dma.startaddr = dma_pru_addr(dmareq->chunk_qunibus_start_addr) ;
         mailbox->dma.buscycle = dmareq->qunibus_control;
         mailbox->dma.wordcount = dmareq->chunk_words;
         mailbox->dma.cpu_access = dmareq->is_cpu_access;
+        mailbox->dma.buffer_index = dmareq->chunk_buffer_index;
+        mailbox->dma.ddr_offset = dmareq->chunk_ddr_offset(dmareq->chunk_qunibus_start_addr);
 
-        // Copy outgoing data into mailbox device_DMA buffer
-        if (QUNIBUS_CYCLE_IS_DATO(dmareq->qunibus_control)) {
-            memcpy((void*) mailbox->dma.words, dmareq->chunk_buffer_start(),
+        // Copy outgoing data into mailbox device_DMA buffer, if not zero-copy
+        if (!mailbox->dma.ddr_offset && QUNIBUS_CYCLE_IS_DATO(dmareq->qunibus_control)) {
+            memcpy((void*) mailbox->dma.words[dmareq->chunk_buffer_index], dmareq->chunk_buffer_start(),
                    2 * dmareq->chunk_words);
         }
 
@@ -523,12 +666,22 @@ void qunibusadapter_c::request_execute_active_on_PRU(unsigned level_index)
             "request_execute_active_on_PRU() DMA: dev %s, ->active = dma_request %p, start = %s, control=%u, wordcount=%u, data=%06o ...",
             dmareq->device ? dmareq->device->name.value.c_str() : "none", dmareq,
             qunibus->addr2text(mailbox->dma.startaddr), (unsigned) mailbox->dma.buscycle,
-            (unsigned) mailbox->dma.wordcount, (unsigned) mailbox->dma.words[0]);
+            (unsigned) mailbox->dma.wordcount, (unsigned) mailbox->dma.words[0][0]);
         mailbox->dma.cur_status = 0; // device DMA, not by CPU
         mailbox_execute(ARM2PRU_DMA);
+        if (latency_recorder->enabled && !dmareq->is_cpu_access && !dmareq->latency_start_ns) {
+            dmareq->latency_start_ns = timeout_c::abstime_ns();
+            if (dmareq->device)
+                dmareq->device->latency_stats->record(latency_dma_queue,
+                                                      dmareq->latency_schedule_ns, dmareq->latency_start_ns);
+            dmareq->latency_schedule_ns = 0; // consumed
+        }
         // scheduling is fast, on complete there's a signal.
         dmareq->executing_on_PRU = true;
 
+        // prepare the following chunk while PRU transfers this one
+        request_queue_next_dma_chunk(dmareq);
+
         /* if DMA is done in multiple chunks,
          then after PRU is complete, we don not call "active_complete() to remove the request.
          Instead we leave it active, with transferred data clipped from buffer start.
@@ -541,7 +694,7 @@ void qunibusadapter_c::request_execute_active_on_PRU(unsigned level_index)
 
     } else {
         // Not DMA? must be INTR
-        intr_request_c *intrreq = dynamic_cast<intr_request_c *>(prl->active);
+        intr_request_c *intrreq = dynamic_cast<intr_request_c *>(prl->active.load());
         assert(intrreq);
 
         // Handle interrupt request to PRU. Setup mailbox:
@@ -576,40 +729,68 @@ void qunibusadapter_c::request_execute_active_on_PRU(unsigned level_index)
      */
 }
 
+// Double buffering: queue the chunk after the current one in the other mailbox
+// buffer. PRU starts it on completion of the current chunk, without waiting
+// for the ARM. Meanwhile worker() drains/refills the buffer of the completed chunk.
+// Only inside the current segment, and not if a request with higher slot priority
+// is waiting: that gets the bus after the current chunk.
+void qunibusadapter_c::request_queue_next_dma_chunk(dma_request_c *dmareq)
+{
+    // Must run under  pthread_mutex_lock(&dispatch_mutex);
+    priority_request_level_c *prl = &request_levels[PRIORITY_LEVEL_INDEX_NPR];
+    if (dmareq->is_cpu_access || dmareq->chunk_queued_words)
+        return;
+    uint32_t next_start_addr = dmareq->chunk_qunibus_start_addr + 2 * dmareq->chunk_words;
+    unsigned wordcount_remaining = dmareq->wordcount
+                                   - (next_start_addr - dmareq->qunibus_start_addr) / 2;
+    if (wordcount_remaining == 0)
+        return;
+    if (prl->slot_request_mask & ((1 << dmareq->priority_slot) - 1))
+        return; // lower slot number = higher priority
+
+    dmareq->chunk_queued_words = std::min(dmareq->chunk_max_words, wordcount_remaining);
+    uint8_t buffer_index = dmareq->chunk_buffer_index ^ 1;
+    mailbox->dma.next_startaddr = dma_pru_addr(next_start_addr);
+    mailbox->dma.next_buscycle = dmareq->qunibus_control;
+    mailbox->dma.next_wordcount = dmareq->chunk_queued_words;
+    mailbox->dma.next_ddr_offset = dmareq->chunk_ddr_offset(next_start_addr);
+    if (!mailbox->dma.next_ddr_offset && QUNIBUS_CYCLE_IS_DATO(dmareq->qunibus_control)) {
+        memcpy((void*) mailbox->dma.words[buffer_index],
+               dmareq->buffer + (next_start_addr - dmareq->qunibus_start_addr) / 2,
+               2 * dmareq->chunk_queued_words);
+    }
+    mailbox_execute(ARM2PRU_DMA_NEXT);
+}
+
 // remove request pointer currently handled by PRU from tables
 // also called on INTR_CANCEL
 void qunibusadapter_c::request_active_complete(unsigned level_index, bool signal_complete) 
 {
-    // Must run under  pthread_mutex_lock(&requests_mutex);
+    // Must run under  pthread_mutex_lock(&dispatch_mutex);
 
     priority_request_level_c *prl = &request_levels[level_index];
-    if (!prl->active) // PRU completed after INIT cleared the tables
+    priority_request_c *tmprq = prl->active;
+    if (!tmprq) // PRU completed after INIT cleared the tables
         return;
     // DEBUG_FAST("request_active_complete") ;
 
-    unsigned slot = prl->active->priority_slot;
+    unsigned slot = tmprq->priority_slot;
     //if (prl->slot_request[slot] != prl->active)
     //	mailbox_execute(ARM2PRU_HALT) ; // LA: trigger on timeout REG_WRITE
     // active not in table, if table cleared by  INIT	requests_cancel_scheduled()
-    assert(prl->slot_request[slot] == prl->active); // must still be in table
+    assert(prl->slot_request[slot] == tmprq); // must still be in table
 
     // mark as complete
-    prl->active->executing_on_PRU = false;
-//	prl->active->complete = true;
-    // remove table entries
-    prl->slot_request[slot] = NULL; // clear slot from request
+    tmprq->executing_on_PRU = false;
+    // remove table entries. Mask bit first: slot may be claimed again
+    // by the device as soon as it is NULL.
     prl->slot_request_mask &= ~(1 << slot); // mask out slot bit
+    prl->slot_request[slot] = NULL; // clear slot from request
 
-    priority_request_c *tmprq = prl->active;
     prl->active = NULL;
 
-    if (signal_complete) {
-        // signal to DMA() or INTR()
-        pthread_mutex_lock(&tmprq->complete_mutex);
-        tmprq->complete = true;
-        pthread_cond_signal(&tmprq->complete_cond);
-        pthread_mutex_unlock(&tmprq->complete_mutex);
-    }
+    if (signal_complete)
+        tmprq->complete_signal(); // to DMA() or INTR()
 
 }
 
@@ -623,27 +804,44 @@ void qunibusadapter_c::request_active_complete(unsigned level_index, bool signal
 
 void qunibusadapter_c::DMA(dma_request_c& dma_request, bool blocking, uint8_t qunibus_cycle,
                            uint32_t unibus_addr, uint16_t *buffer, uint32_t wordcount) 
+{
+    dma_segment_t segment = { qunibus_cycle, unibus_addr, buffer, wordcount } ;
+    DMA(dma_request, blocking, &segment, 1);
+}
+
+// Scatter/gather DMA: execute a list of segments, each with own direction,
+// address and buffer, as one request.
+// Segments are transferred in list order, a bus timeout aborts the chain.
+// The device is signaled only once, after the last segment.
+// On error dma_request.segment_index is the failed segment,
+// dma_request.qunibus_end_addr the failed address.
+// Segment list is copied, buffers must be valid until complete.
+void qunibusadapter_c::DMA(dma_request_c& dma_request, bool blocking,
+                           const dma_segment_t *segments, unsigned segment_count)
 {
     assert(dma_request.priority_slot < PRIORITY_SLOT_COUNT);
     assert(dma_request.level_index == PRIORITY_LEVEL_INDEX_NPR);
 
     // setup device request
-    assert(wordcount > 0);
-    assert((unibus_addr + 2*wordcount) <= qunibus->addr_space_byte_count);
+    assert(segment_count > 0);
+    for (unsigned i = 0; i < segment_count; i++) {
+        assert(segments[i].wordcount > 0);
+        assert((segments[i].qunibus_addr + 2*segments[i].wordcount) <= qunibus->addr_space_byte_count);
+    }
     // lowest priority reserved for CPU
     assert(!dma_request.is_cpu_access || dma_request.priority_slot == 31);
+    assert(!dma_request.is_cpu_access || segment_count == 1);
 
 #if defined(UNIBUS)
     if (!dma_request.is_cpu_access && qunibus->is_address_overlay_active())
-        ERROR("UNIBUS ADDR lines overlayed (for M9312 boot) @ %s. Only CPU 24/26 access intended!", qunibus->addr2text(unibus_addr)) ;
+        ERROR("UNIBUS ADDR lines overlayed (for M9312 boot) @ %s. Only CPU 24/26 access intended!", qunibus->addr2text(segments[0].qunibus_addr)) ;
 #endif
 
     // ignore calls if INIT condition
     if (line_INIT) {
-        dma_request.complete = true;
+        dma_request.complete_signal();
         return;
     }
-    pthread_mutex_lock(&requests_mutex); // lock schedule table operations
 
     // In contrast to re-raised INTR, overlapping DMA requests from same board
     // must not be ignored (different DATA situation) and are an device implementation error.
@@ -652,80 +850,118 @@ void qunibusadapter_c::DMA(dma_request_c& dma_request, bool blocking, uint8_t qu
     assert(prl->slot_request[dma_request.priority_slot] == NULL); // not scheduled or prev completed
 
     // 	dma_request.level-index, priority_slot in constructor
-    dma_request.complete = false;
+    dma_request.complete = PRIORITY_REQUEST_PENDING;
     dma_request.success = false;
     dma_request.executing_on_PRU = false;
-    dma_request.qunibus_control = qunibus_cycle;
-    dma_request.qunibus_start_addr = unibus_addr;
-    dma_request.chunk_qunibus_start_addr = unibus_addr;
+    // no allocation if capacity already there
+    dma_request.segments.assign(segments, segments + segment_count);
+    dma_request.segment_load(0);
     dma_request.qunibus_end_addr = 0; // last transfered addr, or error position
-    dma_request.buffer = buffer;
-    dma_request.wordcount = wordcount;
     dma_request.chunk_max_words = PRU_MAX_DMA_WORDCOUNT; // PRU limit, maybe less
-    _DEBUG("DMA() req: dev %s, %s @ %s, wordcount %d",
+    // CPU cycles not recorded, see cpu_cycles_* statistics
+    // timestamps are 0 when not taken, so a stale value is never used
+    dma_request.latency_start_ns = dma_request.latency_complete_ns = 0;
+    if (latency_recorder->enabled && !dma_request.is_cpu_access)
+        dma_request.latency_schedule_ns = timeout_c::abstime_ns();
+    else
+        dma_request.latency_schedule_ns = 0;
+    _DEBUG("DMA() req: dev %s, %s @ %s, wordcount %d, segments %u",
            dma_request.device ? dma_request.device->name.value.c_str() : "none",
-           qunibus_c::control2text(qunibus_cycle), qunibus->addr2text(unibus_addr), wordcount);
+           qunibus_c::control2text(dma_request.qunibus_control),
+           qunibus->addr2text(dma_request.qunibus_start_addr), dma_request.wordcount, segment_count);
 
-    // put into schedule tables
-
-    request_schedule(dma_request); // assertion, if twice for same slot
-    if (!prl->active) {
-//	if (!request_is_active(dma_request.level_index)) {
-        // no device_DMA current performed: start immediately
-        // else triggered by PRU signals
-        request_activate_lowest_slot(dma_request.level_index);
-        request_execute_active_on_PRU(dma_request.level_index);
-    }
-    pthread_mutex_unlock(&requests_mutex);
+    // put into schedule tables, lock-free
+    request_schedule(dma_request); // FATAL, if twice for same slot
+    // no device_DMA current performed: start immediately
+    // else triggered by PRU signals
+    requests_dispatch();
 
     // DEBUG_FAST("device DMA start: %s @ %06o, len=%d", qunibus->control2text(qunibus_cycle), unibus_addr, wordcount);
 
     if (dma_request.is_cpu_access) {
         // NO wait for PRU signal, instead busy waiting. CPU thread blocked.
         // Reason: SPEED. CPU does high frequency single word accesses.
-        bool completed = false;
+        // Polling is lock-free, dispatch_mutex only taken when PRU is done.
+        // But if the PRU is busy with device DMA, spinning steals the ARM from
+        // the threads serving the PRU: sleep after cpu_spin_limit polls.
 // ARM_DEBUG_PIN1(1); // CPU20 performace
-        do {
+        unsigned spin_count = 0;
+        bool parked = false;
+        while (!dma_request.is_complete()) {
             // CPU thread is now spinning
             // wait until CPU access scheduled and processed on PRU
             // in parallel, other device threads call DMA()
-            pthread_mutex_lock(&requests_mutex);
-            dma_request_c *activereq = dynamic_cast<dma_request_c *>(prl->active);
-//if (activereq == &dma_request)
-//	printf("a\n") ;
-//if (DMA_STATE_IS_COMPLETE(mailbox->dma.cur_status))
-//	printf("b\n") ;
-            if ((activereq == &dma_request) && !EVENT_IS_ACKED(*mailbox, dma)) {
-                assert(activereq->is_cpu_access);
-                // transfer DATI data to buffer, set success flag, schedule next request
-                worker_device_dma_chunk_complete_event(); // do not signal, uses complete_mutex
-                EVENT_ACK(*mailbox, dma);
-                completed = true;
-            } else if (activereq == NULL)
-                // request aborted by worker_power_event()
-                completed = true;
-            pthread_mutex_unlock(&requests_mutex); //&dma_request.complete_mutex);
-        } while (!completed);
+            // complete also set if request aborted by worker_power_event()
+            if (prl->active == &dma_request && !EVENT_IS_ACKED(*mailbox, dma))
+                cpu_dma_complete_event();
+            else if (spin_count < cpu_spin_limit) {
+                spin_count++;
+                // single core: the PRU servicing threads run only if we give up the core
+                if (cpu_spin_yield)
+                    sched_yield();
+                else
+                    cpu_relax();
+            }
+            else {
+                // PRU raises PRU2ARM_INTERRUPT on completion, worker completes
+                mailbox->dma.cpu_wakeup = 1;
+                __sync_synchronize(); // PRU may have completed before flag was visible
+                if (prl->active == &dma_request && !EVENT_IS_ACKED(*mailbox, dma))
+                    cpu_dma_complete_event();
+                else
+                    dma_request.complete_wait();
+                mailbox->dma.cpu_wakeup = 0;
+                parked = true;
+            }
+        }
 //ARM_DEBUG_PIN1(0); // CPU20 performace
+        // statistics, adapt spin limit like glibc adaptive mutex
+        cpu_spin_iterations.value += spin_count;
+        if (parked)
+            cpu_cycles_parked.value++;
+        else
+            cpu_cycles_spun.value++;
+        cpu_spin_avg += ((int)spin_count - (int)cpu_spin_avg) / 8;
+        cpu_spin_limit = 2 * cpu_spin_avg + QUNIBUSADAPTER_CPU_SPIN_MIN;
+        if (cpu_spin_limit > QUNIBUSADAPTER_CPU_SPIN_MAX)
+            cpu_spin_limit = QUNIBUSADAPTER_CPU_SPIN_MAX;
 
     } else if (blocking) {
-        pthread_mutex_lock(&dma_request.complete_mutex);
         // DMA() is blocking: Wait for request to finish.
-        //	pthread_mutex_lock(&dma_request.mutex);
-        while (!dma_request.complete) {
-            int res = pthread_cond_wait(&dma_request.complete_cond,
-                                        &dma_request.complete_mutex);
-            assert(!res);
-        }
-        pthread_mutex_unlock(&dma_request.complete_mutex);
+        dma_request.complete_wait();
+        if (latency_recorder->enabled && dma_request.latency_complete_ns && dma_request.device)
+            dma_request.device->latency_stats->record(latency_dma_signal,
+                    dma_request.latency_complete_ns, timeout_c::abstime_ns());
+        dma_request.latency_complete_ns = 0; // consumed
     }
 }
 
+// CPU access ended on PRU: transfer DATI data to buffer, set success flag,
+// schedule next request.
+// Called by spinning CPU thread, or by worker() if CPU thread sleeps.
+void qunibusadapter_c::cpu_dma_complete_event(void)
+{
+    priority_request_level_c *prl = &request_levels[PRIORITY_LEVEL_INDEX_NPR];
+    pthread_mutex_lock(&dispatch_mutex);
+    dma_request_c *dmareq = dynamic_cast<dma_request_c *>(prl->active.load());
+    // recheck: CPU thread and worker() may both see the event
+    if (dmareq && dmareq->is_cpu_access && !EVENT_IS_ACKED(*mailbox, dma)) {
+        worker_device_dma_chunk_complete_event(mailbox->dma.cur_status,
+                                               mailbox->dma.cur_addr, mailbox->dma.buffer_index);
+        EVENT_ACK(*mailbox, dma);
+    }
+    dispatch_unlock();
+}
+
 // do DATO/DATI as master CPU.
-// result: success, else BUS TIMEOUT
+// wordcount > 1: burst of DATI or DATO cycles to consecutive addresses,
+// executed by the PRU as one chunk.
+// result: success, else BUS TIMEOUT at qunibus_end_addr
 void qunibusadapter_c::cpu_DATA_transfer(dma_request_c& cpu_data_transfer_request,
-        uint8_t unibus_control, uint32_t qunibus_cycle, uint16_t *buffer) 
+        uint8_t unibus_control, uint32_t qunibus_cycle, uint16_t *buffer, unsigned wordcount) 
 {
+    assert(wordcount > 0 && wordcount <= PRU_MAX_DMA_WORDCOUNT); // one chunk
+    assert(wordcount == 1 || unibus_control != QUNIBUS_CYCLE_DATOB);
     // no NPR/NPG/SACK arbitration
     // no PRU->ARM signal on complete
     cpu_data_transfer_request.is_cpu_access = true;
@@ -735,7 +971,7 @@ void qunibusadapter_c::cpu_DATA_transfer(dma_request_c& cpu_data_transfer_reques
     // Also less then INTR, thats implementend in PRU statemachine_arbitration_master()
     cpu_data_transfer_request.priority_slot = 31;
     // "blocking" flag not used
-    DMA(cpu_data_transfer_request, true, unibus_control, qunibus_cycle, buffer, 1);
+    DMA(cpu_data_transfer_request, true, unibus_control, qunibus_cycle, buffer, wordcount);
 }
 
 // A device raises an interrupt and simultaneously changes a value in
@@ -755,12 +991,11 @@ void qunibusadapter_c::INTR(intr_request_c& intr_request,
 
     // ignore calls if INIT condition
     if (line_INIT) {
-        intr_request.complete = true;
+        intr_request.complete_signal();
         return;
     }
 
     priority_request_level_c *prl = &request_levels[intr_request.level_index];
-    pthread_mutex_lock(&requests_mutex); // lock schedule table operations
 //if (intr_request.device->log_level == LL_DEBUG)
     DEBUG_FAST("INTR() req: dev %s, slot/level/vector= %d/%d/%03o",
           intr_request.device->name.value.c_str(), (unsigned ) intr_request.priority_slot,
@@ -768,24 +1003,60 @@ void qunibusadapter_c::INTR(intr_request_c& intr_request,
     // Is an INTR with same slot and level already executed on PRU
     // or waiting in the schedule table?
     // If yes: do not re-raise, will be completed at some time later.
-    if (prl->slot_request[intr_request.priority_slot] != NULL) {
-        intr_request_c *scheduled_intr_req =
-            dynamic_cast<intr_request_c *>(prl->slot_request[intr_request.priority_slot]);
-        assert(scheduled_intr_req);
+    // A request object must not be raised by multiple threads in parallel.
+    // Locked: the "blocking active" test must not race with the worker
+    // completing and activating requests of this level.
+    pthread_mutex_lock(&dispatch_mutex);
+    bool scheduled = false;
+    if (prl->slot_request[intr_request.priority_slot] == NULL) {
+        intr_request.complete = PRIORITY_REQUEST_PENDING;
+        intr_request.executing_on_PRU = false;
+        if (latency_recorder->enabled)
+            intr_request.latency_schedule_ns = timeout_c::abstime_ns();
+        else
+            intr_request.latency_schedule_ns = 0;
+
+        if (interrupt_register)
+            assert(intr_request.device == interrupt_register->device);
+
+        // The associated device interrupt register (if any) should be updated
+        // atomically with raising the INTR signal line by PRU.
+        if (interrupt_register && request_is_blocking_active(intr_request.level_index)) {
+            DEBUG_FAST("INTR() delayed, IR now");
+            //	one or more another requests are handled by PRU: INTR signal delayed by Arbitrator,
+            // write intr register asynchronically here.
+            intr_request.device->set_register_dati_value(interrupt_register,
+                    interrupt_register_value, __func__);
+            intr_request.interrupt_register = NULL; // don't do a 2nd  time
+        } else { // forward to PRU
+            DEBUG_FAST("INTR() IR forward to PRU");
+            // 	intr_request.level_index, priority_slot, vector in constructor
+            intr_request.interrupt_register = interrupt_register;
+            intr_request.interrupt_register_value = interrupt_register_value;
+        }
+
+        // put into schedule tables
+        scheduled = request_schedule(intr_request);
+    }
+
+    if (!scheduled) {
+        priority_request_c *scheduled_req = prl->slot_request[intr_request.priority_slot];
+        intr_request_c *scheduled_intr_req = dynamic_cast<intr_request_c *>(scheduled_req);
+        // NULL: completed meanwhile
+        assert(!scheduled_req || scheduled_intr_req);
         // A device may re-raised a pending INTR again
         // (quite normal situation when other ISRs block, CPU overload)
         // A re-raise will be ignored.
         // ! Another device MAY NOT reraise an INTR with same slot/level
         // ! (else complete signals may be routed to wrong device)
-        assert(scheduled_intr_req->device == intr_request.device);
-        assert(scheduled_intr_req->vector == intr_request.vector);
+        assert(!scheduled_intr_req || scheduled_intr_req->device == intr_request.device);
+        assert(!scheduled_intr_req || scheduled_intr_req->vector == intr_request.vector);
         // if different vector, it may not be ignored -> change in program flow
 
         // If device uses multiple INTRs with different vectors (DL11 rcv+xmt),
         // it must use different pseudo-slots.
 
         // scheduled and request_active_complete() not called
-        pthread_mutex_unlock(&requests_mutex);
         if (interrupt_register) {
             DEBUG_FAST("INTR() delayed with IR");
             // if device re-raises a blocked INTR, CSR must complete immediately
@@ -794,53 +1065,15 @@ void qunibusadapter_c::INTR(intr_request_c& intr_request,
         } else {
             DEBUG_FAST("INTR() delayed without IR");
         }
-
+        pthread_mutex_unlock(&dispatch_mutex);
         return; // do not schedule a 2nd time
     }
 
-    intr_request.complete = false;
-    intr_request.executing_on_PRU = false;
-
-    if (interrupt_register)
-        assert(intr_request.device == interrupt_register->device);
-
-    // The associated device interrupt register (if any) should be updated
-    // atomically with raising the INTR signal line by PRU.
-    if (interrupt_register && request_is_blocking_active(intr_request.level_index)) {
-        DEBUG_FAST("INTR() delayed, IR now");
-        //	one or more another requests are handled by PRU: INTR signal delayed by Arbitrator,
-        // write intr register asynchronically here.
-        intr_request.device->set_register_dati_value(interrupt_register,
-                interrupt_register_value, __func__);
-        intr_request.interrupt_register = NULL; // don't do a 2nd  time
-    } else { // forward to PRU
-        DEBUG_FAST("INTR() IR forward to PRU");
-        // 	intr_request.level_index, priority_slot, vector in constructor
-        intr_request.interrupt_register = interrupt_register;
-        intr_request.interrupt_register_value = interrupt_register_value;
-    }
-
-    // put into schedule tables
-    request_schedule(intr_request); // assertion, if twice for same slot
-
-    if (!prl->active) {
-        // INTR of this level can be raised immediately
-        // If other level active, let PRU atomically set the interrupt register value.
-        request_activate_lowest_slot(intr_request.level_index);
-        request_execute_active_on_PRU(intr_request.level_index);
-        // else activation triggered by PRU signal in worker()
-    }
-
-    pthread_mutex_unlock(&requests_mutex);  // work on schedule table finished
-
-    /*
-     // If INTR() is blocking: Wait for request to finish.
-     pthread_mutex_lock(&intr_request.mutex);
-     while (!intr_request.complete) {
-     pthread_cond_wait(&intr_request.complete_cond, &intr_request.mutex);
-     }
-     pthread_mutex_unlock(&intr_request.mutex);
-     */
+    // INTR of this level can be raised immediately, if level idle
+    // If other level active, let PRU atomically set the interrupt register value.
+    // else activation triggered by PRU signal in worker()
+    dispatch_pending = true;
+    dispatch_unlock();
 }
 
 /* A device may cancel an INTR request, if not yet GRANTed by Arbitrator.
@@ -856,7 +1089,7 @@ void qunibusadapter_c::cancel_INTR(intr_request_c& intr_request)
     if (prl->slot_request[intr_request.priority_slot] == NULL)
         return; // not scheduled or active
 
-    pthread_mutex_lock(&requests_mutex); // lock schedule table operations
+    pthread_mutex_lock(&dispatch_mutex); // no activation in parallel
     if (&intr_request == prl->active) {
         // already on PRU
         assert(level_index <= PRIORITY_LEVEL_INDEX_BR7);
@@ -869,20 +1102,14 @@ void qunibusadapter_c::cancel_INTR(intr_request_c& intr_request)
         request_activate_lowest_slot(level_index);
         if (prl->active)
             request_execute_active_on_PRU(level_index);
-    } else {
+    } else if (prl->slot_request[intr_request.priority_slot] == &intr_request) {
         // not active on PRU: just remove from schedule table
-        prl->slot_request[intr_request.priority_slot] = NULL; // clear slot from request
         prl->slot_request_mask &= ~(1 << intr_request.priority_slot); // mask out slot bit
+        prl->slot_request[intr_request.priority_slot] = NULL; // clear slot from request
+        intr_request.complete_signal();
     }
-    // both empty, or both filled
-    assert((prl->slot_request_mask == 0) == (prl->active == NULL));
-
-    pthread_mutex_lock(&intr_request.complete_mutex);
-    pthread_cond_signal(&intr_request.complete_cond);
-    pthread_mutex_unlock(&intr_request.complete_mutex);
-
-    pthread_mutex_unlock(&requests_mutex); // lock schedule table operations
 
+    dispatch_unlock();
 }
 
 // set state of INIT
@@ -899,12 +1126,10 @@ void qunibusadapter_c::worker_init_event()
             device->on_init_changed();
         }
 
-    // Clear bus request queues,
-    pthread_mutex_lock(&requests_mutex);
+    // Clear bus request queues, also requests on PRU
+    pthread_mutex_lock(&dispatch_mutex);
     requests_cancel_scheduled();
-    // reset all scheduled tables, also requests on PRU
-    requests_init();
-    pthread_mutex_unlock(&requests_mutex);
+    dispatch_unlock();
 }
 
 void qunibusadapter_c::worker_power_event(signal_edge_enum aclo_edge, signal_edge_enum dclo_edge) 
@@ -926,30 +1151,26 @@ void qunibusadapter_c::worker_power_event(signal_edge_enum aclo_edge, signal_edg
 
     // in true power fail, terminate pending DMA/CPU transfer
     if (dclo_edge == SIGNAL_EDGE_RAISING) {
-        // Clear bus request queues,
-        pthread_mutex_lock(&requests_mutex);
+        // Clear bus request queues, also requests on PRU
+        pthread_mutex_lock(&dispatch_mutex);
         requests_cancel_scheduled();
-        // reset all scheduled tables, also requests on PRU
-        requests_init();
-        pthread_mutex_unlock(&requests_mutex);
+        dispatch_unlock();
     }
 }
 
 // process DATI/DATO access to active device registers
-
-void qunibusadapter_c::worker_deviceregister_event() 
+// event data from mailbox.events.deviceregister (blocking)
+// or from an event ring entry (posted DATI/DATO)
+void qunibusadapter_c::worker_deviceregister_event(uint8_t register_handle, uint8_t unibus_control,
+        uint32_t evt_addr, uint16_t evt_data) 
 {
 	// signaled the 8bit registerhandle, locate device & register
-    uint8_t register_handle = mailbox->events.deviceregister.register_handle ;
     assert(register_handle > 0 && register_handle != IOPAGE_REGISTER_HANDLE_ROM); 
     qunibusdevice_register_t *device_reg = register_by_handle[register_handle];
 	assert(device_reg) ;
     qunibusdevice_c *device = device_reg->device ;
-    uint32_t evt_addr = mailbox->events.deviceregister.addr;
     // normally evt_data == device_reg->pru_iopage_register->value
     // but shared value gets desorted if INIT in same event clears the registers before DATO
-    uint16_t evt_data = mailbox->events.deviceregister.data;
-    uint8_t unibus_control = mailbox->events.deviceregister.unibus_control;
 
     // QBUS: for IOpage only addr bits <12:0> transferred,
     // "IOPage" signal BS7 encoded in QUNIBUS_IOPAGE_ADDR_BITMASK
@@ -970,15 +1191,31 @@ void qunibusadapter_c::worker_deviceregister_event()
     if (device_reg->active_on_dati && !QUNIBUS_CYCLE_IS_DATO(unibus_control)) {
         // register is read with DATI, this changes the logic state
         evt_addr &= ~1; // make even
+        // PRU micro-action already cleared bits in shared value
+        device_reg->active_dati_flipflops &= ~device_reg->action_dati_clear_bits;
         unibus_control = QUNIBUS_CYCLE_DATI;
         // read access: dati-flipflops do not change
 
         // signal: changed by QBUS/UNIBUS
         device->log_register_event("DATI", device_reg);
 
-        device->on_after_register_access(device_reg, unibus_control, DATO_WORD);
+        if (latency_recorder->enabled) {
+            uint64_t entry_ns = timeout_c::abstime_ns();
+            device->latency_stats->record(latency_register_dispatch, worker_wakeup_ns, entry_ns);
+            device->on_after_register_access(device_reg, unibus_control, DATO_WORD);
+            device->latency_stats->record(latency_register_callback, entry_ns, timeout_c::abstime_ns());
+        } else
+            device->on_after_register_access(device_reg, unibus_control, DATO_WORD);
     } else if (device_reg->active_on_dato && QUNIBUS_CYCLE_IS_DATO(unibus_control)) {
         DATO_ACCESS dato_type = DATO_WORD;
+        // PRU micro-action already changed shared value of target register
+        qunibusdevice_register_t *action_target = device_reg->action_dato_target;
+        if (action_target) {
+            uint16_t target_val =
+                device_reg->action_dato_copy ? evt_data : action_target->active_dati_flipflops;
+            action_target->active_dati_flipflops = (target_val & ~device_reg->action_dato_clear_bits)
+                                                   | device_reg->action_dato_set_bits;
+        }
         //		uint16_t reg_value_written = device_reg->pru_iopage_register->value;
         //	restore value accessible by DATI
         device_reg->pru_iopage_register->value = device_reg->active_dati_flipflops;
@@ -1013,7 +1250,13 @@ void qunibusadapter_c::worker_deviceregister_event()
             device->log_register_event("DATOB", device_reg);
             break;
         }
-        device->on_after_register_access(device_reg, unibus_control, dato_type);
+        if (latency_recorder->enabled) {
+            uint64_t entry_ns = timeout_c::abstime_ns();
+            device->latency_stats->record(latency_register_dispatch, worker_wakeup_ns, entry_ns);
+            device->on_after_register_access(device_reg, unibus_control, dato_type);
+            device->latency_stats->record(latency_register_callback, entry_ns, timeout_c::abstime_ns());
+        } else
+            device->on_after_register_access(device_reg, unibus_control, dato_type);
         /*
          DEBUG_FAST(LL_DEBUG, LC_UNIBUS, "dev.reg=%d.%d, %s, addr %06o, data %06o->%06o",
          device_handle, evt_idx,
@@ -1026,50 +1269,78 @@ void qunibusadapter_c::worker_deviceregister_event()
 // called by PRU signal when DMA transmission complete
 // Called for device DMA() chunk,
 // or cpu_DATA_transfer()
-void qunibusadapter_c::worker_device_dma_chunk_complete_event() 
+// Result of chunk from event ring entry, mailbox.dma may already
+// execute the next chunk.
+// buffer_index: mailbox.dma.words[] of completed chunk
+void qunibusadapter_c::worker_device_dma_chunk_complete_event(uint8_t dma_status,
+        uint32_t end_addr, uint8_t buffer_index) 
 {
     priority_request_level_c *prl = &request_levels[PRIORITY_LEVEL_INDEX_NPR];
     bool more_chunks;
-    // Must run under pthread_mutex_lock(&requests_mutex) ;
+    // Must run under pthread_mutex_lock(&dispatch_mutex) ;
 
-    dma_request_c *dmareq = dynamic_cast<dma_request_c *>(prl->active);
+    dma_request_c *dmareq = dynamic_cast<dma_request_c *>(prl->active.load());
 
     assert(dmareq != NULL);
-    // fix PRU data struct: remove IOPAGE bit from mailbox struct, was set im mailbox_execute()
-    mailbox->dma.startaddr &= ~QUNIBUS_IOPAGE_ADDR_BITMASK ;
-    mailbox->dma.cur_addr &= ~QUNIBUS_IOPAGE_ADDR_BITMASK ;
-    dmareq->qunibus_end_addr = mailbox->dma.cur_addr; // track end of transmission, eror position
+    assert(buffer_index == dmareq->chunk_buffer_index);
+    // remove IOPAGE bit, was set for PRU
+    end_addr &= ~QUNIBUS_IOPAGE_ADDR_BITMASK ;
+    dmareq->qunibus_end_addr = end_addr; // track end of transmission, eror position
     unsigned wordcount_transferred = dmareq->wordcount_completed_chunks()
-                                     + mailbox->dma.wordcount;
+                                     + dmareq->chunk_words;
     assert(wordcount_transferred <= dmareq->wordcount);
-    assert(!dmareq->is_cpu_access || dmareq->wordcount == 1); // CPU accesses only single words
-    if (QUNIBUS_CYCLE_IS_DATI(mailbox->dma.buscycle)) {
-        // guard against buffer overrun
-        // PRU read chunk data from QBUS/UNIBUS into mailbox
-        // copy result cur_DMA_wordcount from mailbox->DMA buffer to cur_DMA_buffer
-        memcpy(dmareq->chunk_buffer_start(), (void *) mailbox->dma.words,
-               2 * mailbox->dma.wordcount);
+    bool segment_complete = (wordcount_transferred == dmareq->wordcount);
+    // CPU accesses single words or bursts in one chunk
+    assert(!dmareq->is_cpu_access || dmareq->wordcount <= PRU_MAX_DMA_WORDCOUNT);
+    if (!dmareq->is_cpu_access && QUNIBUS_CYCLE_IS_DATO(dmareq->qunibus_control))
+        device_dma_write_count++; // memory changed behind the CPU
+    if (QUNIBUS_CYCLE_IS_DATI(dmareq->qunibus_control)) {
+        if (dmareq->buffer_ddr_offset) {
+            // zero-copy: PRU has written into device buffer directly
+        } else {
+            // not zero-copy: PRU read chunk data from QBUS/UNIBUS into mailbox,
+            // copy mailbox DMA buffer into device buffer
+            memcpy(dmareq->chunk_buffer_start(), (void *) mailbox->dma.words[buffer_index],
+                   2 * dmareq->chunk_words);
+        }
     }
-    if (mailbox->dma.cur_status != DMA_STATE_READY) {
-        // failure: abort remaining chunks
+    if (dma_status != DMA_STATE_READY) {
+        // failure: abort remaining chunks. PRU discarded queued chunk.
         dmareq->success = false;
+        dmareq->chunk_queued_words = 0;
         more_chunks = false;
-    } else if (wordcount_transferred == dmareq->wordcount) {
-        // last chunk completed
+    } else if (dmareq->chunk_queued_words) {
+        // double buffering: following chunk already started by PRU in other buffer.
+        // Buffer of completed chunk now free for the one after.
+        _DEBUG(
+            "DMA chunk complete: dev %s, %s @ %s..%s, wordcount %d, next chunk queued",
+            dmareq->device ? dmareq->device->name.value.c_str() : "none",
+            qunibus->control2text(dmareq->qunibus_control),
+            qunibus->addr2text(dmareq->chunk_qunibus_start_addr),
+            qunibus->addr2text(end_addr), dmareq->chunk_words);
+        dmareq->chunk_qunibus_start_addr = end_addr + 2;
+        dmareq->chunk_words = dmareq->chunk_queued_words;
+        dmareq->chunk_buffer_index ^= 1;
+        dmareq->chunk_queued_words = 0;
+        request_queue_next_dma_chunk(dmareq);
+        more_chunks = true;
+    } else if (segment_complete && !dmareq->segment_load(dmareq->segment_index + 1)) {
+        // last chunk of last segment completed
         dmareq->success = true;
         more_chunks = false;
     } else {
-        // more data to transfer: next chunk.
-        assert(!dmareq->is_cpu_access); // CPU accesses only single words
-        dmareq->chunk_qunibus_start_addr = mailbox->dma.cur_addr + 2;
+        // more data to transfer: next chunk, or first chunk of next segment
+        assert(!dmareq->is_cpu_access); // CPU accesses only single chunks
+        if (!segment_complete)
+            dmareq->chunk_qunibus_start_addr = end_addr + 2;
         // dmarequest remains prl->active and ->busy
 
         _DEBUG(
-            "DMA chunk complete: dev %s, %s @ %s..%s, wordcount %d, data=%06o, %06o, ... %s",
-            prl->active->device ? prl->active->device->name.value.c_str() : "none",
-            qunibus->control2text(mailbox->dma.buscycle), qunibus->addr2text(mailbox->dma.startaddr),
-            qunibus->addr2text(mailbox->dma.cur_addr), mailbox->dma.wordcount, mailbox->dma.words[0],
-            mailbox->dma.words[1], dmareq->success ? "OK" : "TIMEOUT");
+            "DMA chunk complete: dev %s, %s @ %s, wordcount %d, data=%06o, %06o, ... %s",
+            dmareq->device ? dmareq->device->name.value.c_str() : "none",
+            qunibus->control2text(dmareq->qunibus_control), qunibus->addr2text(end_addr),
+            dmareq->chunk_words, mailbox->dma.words[buffer_index][0],
+            mailbox->dma.words[buffer_index][1], dmareq->success ? "OK" : "TIMEOUT");
 
         // re-activate this request, or choose another with higher slot priority,
         // inserted in parallel (interrupt this DMA)
@@ -1087,9 +1358,16 @@ void qunibusadapter_c::worker_device_dma_chunk_complete_event()
                qunibus->addr2text(dmareq->qunibus_end_addr), dmareq->wordcount, dmareq->buffer[0],
                dmareq->buffer[1], dmareq->success ? "OK" : "TIMEOUT");
 
+        if (latency_recorder->enabled && !dmareq->is_cpu_access && dmareq->latency_start_ns) {
+            dmareq->latency_complete_ns = timeout_c::abstime_ns();
+            if (dmareq->device)
+                dmareq->device->latency_stats->record(latency_dma_transfer,
+                                                      dmareq->latency_start_ns, dmareq->latency_complete_ns);
+            dmareq->latency_start_ns = 0; // consumed
+        }
         // clear from schedule table of this level
-        // CPu memory accesses are not signaled, but polled in DMA()
-        request_active_complete(PRIORITY_LEVEL_INDEX_NPR, /*signal*/!dmareq->is_cpu_access);
+        // CPU memory accesses are polled in DMA(), signal without futex wake up
+        request_active_complete(PRIORITY_LEVEL_INDEX_NPR, true);
 
         // check and execute DMA on other priority_slot
         if (request_activate_lowest_slot(PRIORITY_LEVEL_INDEX_NPR))
@@ -1103,13 +1381,19 @@ void qunibusadapter_c::worker_device_dma_chunk_complete_event()
 // priority_level_index:  0..3 = BR4..BR7
 void qunibusadapter_c::worker_intr_complete_event(uint8_t level_index) 
 {
-    // Must run under pthread_mutex_lock(&requests_mutex) ;
+    // Must run under pthread_mutex_lock(&dispatch_mutex) ;
     priority_request_level_c *prl = &request_levels[level_index];
 
     // if 1st opcode of an ISR is a "clear of INTR" condition,
     // cancel_INTR() may be called in worker_deviceregister_event()
     // then the request is already removed from schedule table.
     //assert(prl->active);
+    priority_request_c *intrreq = prl->active;
+    if (latency_recorder->enabled && intrreq && intrreq->latency_schedule_ns && intrreq->device)
+        intrreq->device->latency_stats->record(latency_intr_grant,
+                                               intrreq->latency_schedule_ns, timeout_c::abstime_ns());
+    if (intrreq)
+        intrreq->latency_schedule_ns = 0; // consumed
 
     // clear from schedule table of this level
     request_active_complete(level_index, true);
@@ -1125,6 +1409,48 @@ void qunibusadapter_c::worker_intr_complete_event(uint8_t level_index)
     // else INTRs for all slots of this level completed
 }
 
+// process all entries in the event ring, in the order raised by PRU.
+// PRU may append entries while draining, these are processed too.
+void qunibusadapter_c::worker_eventring_drain() 
+{
+    uint8_t tail = mailbox->eventring.tail ;
+    uint8_t head = mailbox->eventring.head ;
+    while (tail != head) {
+        // read entry only after head: PRU fills it before incrementing head,
+        // but the ARM core may load the entry ahead of head.
+        __sync_synchronize() ;
+        // entry valid, PRU does not touch it until tail is incremented
+        volatile mailbox_eventring_entry_t *entry = &EVENTRING_ENTRY(*mailbox, tail) ;
+        switch (entry->type) {
+        case EVENTRING_TYPE_DMA:
+            pthread_mutex_lock(&dispatch_mutex);
+            worker_device_dma_chunk_complete_event(entry->dma_status, entry->addr,
+                                                   entry->dma_buffer_index);
+            dispatch_unlock();
+            break ;
+        case EVENTRING_TYPE_INTR_MASTER:
+            // Device INTR was transmitted. INTRs are granted unpredictable by Arbitrator
+            pthread_mutex_lock(&dispatch_mutex);
+            worker_intr_complete_event(entry->level_index);
+            dispatch_unlock();
+            break ;
+        case EVENTRING_TYPE_DEVICEREGISTER:
+            // posted DATI/DATO, PRU has already completed the bus cycle
+            worker_deviceregister_event(entry->register_handle, entry->unibus_control,
+                                        entry->addr, entry->data);
+            break ;
+        default:
+            ERROR("worker_eventring_drain(): illegal event type %u", (unsigned)entry->type) ;
+        }
+        tail++ ;
+        mailbox->eventring.tail = tail ; // PRU may reuse entry now
+        // write tail before reading head: PRU raises PRU2ARM_INTERRUPT
+        // only if it sees all entries processed
+        __sync_synchronize() ;
+        head = mailbox->eventring.head ;
+    }
+}
+
 // runs in background, catches and distributes PRU events
 void qunibusadapter_c::worker(unsigned instance) 
 {
@@ -1160,15 +1486,23 @@ void qunibusadapter_c::worker(unsigned instance)
          the event has taken place, as an unsigned int. There is no out-of-
          band value to indicate error (and it can wrap around to 0 if you
          run the program just a whole lot of times). */
+        worker_wakeup_ns = 0; // samples of the previous wakeup consumed
         res = prussdrv_pru_wait_event_timeout(PRU_EVTOUT_0, 100000/*us*/);
 //res = prussdrv_pru_wait_event(PRU_EVTOUT_0);
         // PRU may have raised more than one event before signal is accepted.
         // single combination of only INIT+DATI/O possible
         prussdrv_pru_clear_event(PRU_EVTOUT_0, PRU0_ARM_INTERRUPT);
+        if (latency_recorder->enabled)
+            worker_wakeup_ns = timeout_c::abstime_ns();
         // uses select() internally: 0 = timeout, -1 = error, else event count received
         any_event = true;
+        // CPU bus cycle complete, CPU thread sleeps in DMA()
+        // also checked on timeout, if PRU2ARM_INTERRUPT was missed
+        if (mailbox && mailbox->dma.cpu_wakeup && !EVENT_IS_ACKED(*mailbox, dma))
+            cpu_dma_complete_event();
         // at startup sequence, mailbox may be not yet valid
-        while (mailbox && res > 0 && any_event) { // res is const
+        // event ring: PRU signals only the first of a batch, so also check on timeout.
+        while (mailbox && (res > 0 || !EVENTRING_IS_EMPTY(*mailbox)) && any_event) { // res is const
             any_event = false;
             // Process multiple events sent by PRU.
             //
@@ -1258,41 +1592,37 @@ void qunibusadapter_c::worker(unsigned instance)
 			// we receive event INIT and execute device initalization.
 			// PDP11 CPU state is out of sync with device state in that time, but CPU sees device
 			// only via SSYN/RPLY halted deviceregister accesses. So make sure pending INIT are processed before register access
-            if (!EVENT_IS_ACKED(*mailbox, deviceregister) && EVENT_IS_ACKED(*mailbox, init)) {
-                any_event = true;
-
-                // DATI/DATO
-                // DEBUG_FAST("EVENT_DEVICEREGISTER:  control=%d, addr=%06o", (int)mailbox->events.unibus_control, mailbox->events.addr);
-                worker_deviceregister_event();
-                // ARM2PRU opcodes raised by device logic are processed in midst of bus cycle
-                EVENT_ACK(*mailbox, deviceregister); // PRU continues bus cycle with SSYN now
-            }
-
-            if (!EVENT_IS_ACKED(*mailbox, dma) && !mailbox->dma.cpu_access) {
-                // not called for CPU DATI/DATO
+            if (EVENT_IS_ACKED(*mailbox, init)) {
+                // sample blocking event before ring: posted register events raised before
+                // are then all visible in the ring, and processed first.
+                bool deviceregister_event = !EVENT_IS_ACKED(*mailbox, deviceregister) ;
 
-                any_event = true;
-                pthread_mutex_lock(&requests_mutex);
-                worker_device_dma_chunk_complete_event();
-
-                pthread_mutex_unlock(&requests_mutex);
-                // PRU may have set again event_dma again, if this is called before EVENT signal??
-                // call this only on signal, not on timeout!
-
-                // this may clear reraised PRU event flag!
-                EVENT_ACK(*mailbox, dma); // PRU may re-raise and change mailbox now
-            }
+                // DMA complete, INTR complete, posted DATI/DATO
+                if (!EVENTRING_IS_EMPTY(*mailbox)) {
+                    any_event = true;
+                    worker_eventring_drain() ;
+                }
 
-            // 4 events for each BG4,5,6,7
-            for (unsigned level_index = 0; level_index < 4; level_index++) {
-                if (!EVENT_IS_ACKED(*mailbox, intr_master[level_index])) {
-                    // Device INTR was transmitted. INTRs are granted unpredictable by Arbitrator
+                if (deviceregister_event) {
                     any_event = true;
-                    // INTR of which level? the .active rquest of the"
-                    pthread_mutex_lock(&requests_mutex);
-                    worker_intr_complete_event(level_index);
-                    pthread_mutex_unlock(&requests_mutex);
-                    EVENT_ACK(*mailbox, intr_master[level_index]); // PRU may re-raise and change mailbox now
+
+                    // DATI/DATO
+                    // DEBUG_FAST("EVENT_DEVICEREGISTER:  control=%d, addr=%06o", (int)mailbox->events.unibus_control, mailbox->events.addr);
+                    uint8_t register_handle = mailbox->events.deviceregister.register_handle;
+                    // SSYN stretch of the previous blocking event, set by PRU before this signal
+                    if (latency_ack_register_handle && register_by_handle[latency_ack_register_handle])
+                        register_by_handle[latency_ack_register_handle]->device->latency_stats->record_ns(
+                            latency_register_ack,
+                            (uint64_t)mailbox->events.deviceregister.ack_cycles * LATENCY_PRU_CYCLE_NS);
+                    latency_ack_register_handle = 0;
+                    worker_deviceregister_event(register_handle,
+                                                mailbox->events.deviceregister.unibus_control,
+                                                mailbox->events.deviceregister.addr,
+                                                mailbox->events.deviceregister.data);
+                    // ARM2PRU opcodes raised by device logic are processed in midst of bus cycle
+                    EVENT_ACK(*mailbox, deviceregister); // PRU continues bus cycle with SSYN now
+                    if (latency_recorder->enabled)
+                        latency_ack_register_handle = register_handle;
                 }
             }
 
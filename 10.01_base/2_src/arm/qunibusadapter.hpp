@@ -21,6 +21,14 @@
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
+ 16-oct-2026  QC      CPU spin loop yields on single core
+ 16-oct-2026  QC      latency histograms
+ 16-oct-2026  QC      CPU bus cycle bursts
+ 16-oct-2026  QC      adaptive spin/sleep for CPU bus cycles
+ 16-oct-2026  QC      lock-free request scheduling
+ 15-oct-2026  QC      double buffered DMA chunks
+ 15-oct-2026  QC      scatter/gather DMA
+ 15-oct-2026  QC      non-blocking events via mailbox event ring
  aug-2020	JH		adapted to QBUS
  jul-2019     JH      rewrite: multiple parallel arbitration levels	 
  12-nov-2018  JH      entered beta phase
@@ -29,6 +37,8 @@
 #ifndef _QUNIBUSADAPTER_HPP_
 #define _QUNIBUSADAPTER_HPP_
 
+#include <atomic>
+
 #include "iopageregister.h"
 #include "priorityrequest.hpp"
 #include "qunibusadapter.hpp"
@@ -39,19 +49,26 @@
 class priority_request_level_c {
 public:
 	// remember for each backplane slot wether the device has requested
-	// INTR or DMA at this level
-	priority_request_c* slot_request[PRIORITY_SLOT_COUNT + 1];
+	// INTR or DMA at this level.
+	// A request claims its slot with compare-and-swap, then publishes it in slot_request_mask
+	std::atomic<priority_request_c*> slot_request[PRIORITY_SLOT_COUNT + 1];
 	// Optimization to find the high priorized slot in use very fast.
 	// bit array: bit set -> slot<bitnr> has open request.
-	uint32_t slot_request_mask;
+	std::atomic<uint32_t> slot_request_mask;
 
-	priority_request_c* active; // request currently handled by PRU, not in table anymore
+	// request currently handled by PRU, still in table.
+	// Changed only under qunibusadapter_c::dispatch_mutex
+	std::atomic<priority_request_c*> active;
 
 	void clear();
 };
 
 class unibuscpu_c ;
 
+// CPU bus cycles: spin on PRU completion, then sleep.
+// Spin limit adapts to the average spin count of completed cycles.
+#define QUNIBUSADAPTER_CPU_SPIN_MIN	100
+#define QUNIBUSADAPTER_CPU_SPIN_MAX	20000
 
 // is a device_c. need a thread (but no params)
 class qunibusadapter_c: public device_c {
@@ -63,24 +80,52 @@ private:
 	// access of master CPU to memory not handled via priority arbitration
 //	dma_request_c 	*cpu_data_transfer_request ; // needs no link to CPU
 
-	pthread_mutex_t requests_mutex;
+	// Schedule tables are lock-free. Only one thread may activate requests
+	// and talk to the PRU: the owner of dispatch_mutex.
+	// Others set dispatch_pending, owner dispatches for them before release.
+	pthread_mutex_t dispatch_mutex;
+	std::atomic<bool> dispatch_pending;
+	void dispatch_unlock(void);
 
 	unibuscpu_c	*registered_cpu ; // only one unibuscpu_c may be registered
 
+	// adaptive spinning of CPU thread, access only by CPU thread
+	unsigned cpu_spin_avg; // moving average of spin iterations
+	unsigned cpu_spin_limit; // sleep after this many iterations
+	bool cpu_spin_yield; // single core: sched_yield() while spinning
+	void cpu_dma_complete_event(void);
+
+	// latency_recorder: time when worker() was woken up by PRU
+	uint64_t worker_wakeup_ns;
+	// register of last blocking event, PRU reports its SSYN stretch with the next.
+	// 0 = none
+	uint8_t latency_ack_register_handle;
+
 	// Helper map: find register via 8bit handle
 	qunibusdevice_register_t *register_by_handle[MAX_IOPAGE_REGISTER_COUNT];
 	
 
 	void worker_init_event(void);
 	void worker_power_event(signal_edge_enum aclo_edge, signal_edge_enum dclo_edge);
-	void worker_deviceregister_event(void);
-	void worker_device_dma_chunk_complete_event(void);
+	void worker_deviceregister_event(uint8_t register_handle, uint8_t unibus_control,
+			uint32_t evt_addr, uint16_t evt_data);
+	void worker_device_dma_chunk_complete_event(uint8_t dma_status, uint32_t end_addr,
+			uint8_t buffer_index);
 	void worker_intr_complete_event(uint8_t level_index);
+	void worker_eventring_drain(void);
 	void worker(unsigned instance) override; // background worker function
 
 public:
 	qunibusadapter_c();
 
+	// statistics of CPU bus cycles
+	parameter_unsigned64_c cpu_cycles_spun = parameter_unsigned64_c(this, "cpu_cycles_spun", "cspun",/*readonly*/
+			true, "", "%u", "CPU bus cycles completed while spinning", 63, 10);
+	parameter_unsigned64_c cpu_cycles_parked = parameter_unsigned64_c(this, "cpu_cycles_parked", "cpark",/*readonly*/
+			true, "", "%u", "CPU bus cycles completed while sleeping", 63, 10);
+	parameter_unsigned64_c cpu_spin_iterations = parameter_unsigned64_c(this, "cpu_spin_iterations", "cspin",/*readonly*/
+			true, "", "%u", "Polls of PRU completion by CPU thread", 63, 10);
+
 	bool on_param_changed(parameter_c *param) override;  // must implement
 
 	// list of registered devices.
@@ -105,21 +150,29 @@ public:
 	// Helper for request processing
 	void requests_init(void);
 
-	void request_schedule(priority_request_c& request);
+	bool request_schedule(priority_request_c& request);
+	void requests_dispatch(void);
 	void requests_cancel_scheduled(void);
 	priority_request_c *request_activate_lowest_slot(unsigned level_index);
 //	bool request_is_active(		unsigned level_index);
 	bool request_is_blocking_active(uint8_t level_index);
 	void request_active_complete(unsigned level_index, bool signal_complete);
 	void request_execute_active_on_PRU(unsigned level_index);
+	void request_queue_next_dma_chunk(dma_request_c *dmareq);
 
 	void DMA(dma_request_c& dma_request, bool blocking, uint8_t qunibus_cycle,
 			uint32_t unibus_addr, uint16_t *buffer, uint32_t wordcount);
+	void DMA(dma_request_c& dma_request, bool blocking, const dma_segment_t *segments,
+			unsigned segment_count);
 	void INTR(intr_request_c& intr_request, qunibusdevice_register_t *interrupt_register,
 			uint16_t interrupt_register_value);
 	void cancel_INTR(intr_request_c& intr_request);
 
-	void cpu_DATA_transfer(dma_request_c& dma_request, uint8_t qunibus_cycle, uint32_t unibus_addr, uint16_t *buffer);
+	void cpu_DATA_transfer(dma_request_c& dma_request, uint8_t qunibus_cycle, uint32_t unibus_addr, uint16_t *buffer,
+			unsigned wordcount = 1);
+	// incremented on every device DMA chunk written to memory.
+	// CPU prefetch buffers are invalid if changed.
+	std::atomic<uint32_t> device_dma_write_count;
 
 	void print_pru_iopage_register_map(void);
 
@@ -21,6 +21,8 @@
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
+ 16-oct-2026  QC      latency histograms
+ 15-oct-2026  QC      "posted_on_dato" registers
  aug-2020	JH		adapted to QBUS
  6-feb-2020	JH		added symbol table
  12-nov-2018  JH      entered beta phase
@@ -34,6 +36,7 @@
  */
 //#include <string>
 #include <vector>
+#include <string.h>
 #include <assert.h>
 #include "logger.hpp"
 #include "qunibus.h"
@@ -43,7 +46,9 @@
 qunibusdevice_c::qunibusdevice_c() :		device_c() 
 {
 	handle = 0;
+	latency_stats = NULL;
 	register_count = 0;
+	memset(registers, 0, sizeof(registers)) ; // all flags false
 	// device is not yet enabled, QBUS/UNIBUS properties can be set
 	base_addr.readonly = false;
     // Kristen McIntyre: reinitialize the base address's bitwidth now that we are initialized
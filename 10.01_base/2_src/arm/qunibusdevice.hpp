@@ -21,6 +21,10 @@
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
+ 16-oct-2026  QC      "posted_on_dato" removed, posted events only with micro-actions
+ 16-oct-2026  QC      latency histograms
+ 16-oct-2026  QC      PRU micro-actions
+ 15-oct-2026  QC      "posted_on_dato" registers
  12-nov-2018  JH      entered beta phase
  */
 
@@ -34,6 +38,7 @@
 
 #include "iopageregister.h"
 #include "priorityrequest.hpp"
+#include "latency.hpp"
 
 // forwards
 class qunibusdevice_c;
@@ -74,6 +79,19 @@ typedef struct qunibusdevice_register_struct {
 	//   UNIBUS access to the register
 	bool active_on_dati; // call on_after_register_access() on DATI
 	bool active_on_dato; // call on_after_register_access() on DATO
+	// PRU "micro-actions": simple side effects executed by PRU within the bus cycle.
+	//   DATI: clear "action_dati_clear_bits" in this register after read.
+	//   DATO/DATOB: in "action_dato_target" (NULL = none, may be this register)
+	//	 clear "action_dato_clear_bits", then set "action_dato_set_bits".
+	//	 "action_dato_copy": target is first loaded with the value written.
+	//   Target must be a register of the same device.
+	//   ARM sees the result in active_dati_flipflops, events of registers
+	//   with micro-actions are "posted": bus cycle does not wait for ARM.
+	uint16_t action_dati_clear_bits;
+	struct qunibusdevice_register_struct *action_dato_target;
+	uint16_t action_dato_clear_bits;
+	uint16_t action_dato_set_bits;
+	bool action_dato_copy;
 	uint16_t reset_value;
 	uint16_t writable_bits;
 
@@ -101,6 +119,9 @@ private:
 public:
 	uint8_t handle; // assigned by "qunibus.adapter.register
 
+	// histograms of bus event latencies, assigned by qunibusadapter.register_device
+	latency_stats_c *latency_stats;
+
 	// !!! slot, vector, level READONLY. If user should change,
 	// !! add logic to update dma_request_c and intr_request_c
 
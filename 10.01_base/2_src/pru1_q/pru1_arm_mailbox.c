@@ -35,3 +35,6 @@
 
 volatile far mailbox_t mailbox;
 
+uint32_t deviceregister_signal_cycles;
+uint8_t deviceregister_stretch_active;
+
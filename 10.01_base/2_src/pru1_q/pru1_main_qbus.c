@@ -21,6 +21,7 @@
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
+ 15-oct-2026  QC      ARM2PRU_DMA_NEXT: double buffered device DMA
  28-mar-2019  JH      split off from "all-function" main
  12-nov-2018  JH      entered beta phase
 
@@ -228,11 +229,25 @@ void main(void) {
 //PRU_DEBUG_PIN0_PULSE(50) ; // CPU20 performace
 				} else {
 					// Emulated device: raise request for emulated or physical Arbitrator.
+					mailbox.dma.next_valid = 0;
+					mailbox.dma.cur_status = DMA_STATE_ARBITRATING;
 					sm_arb.device_request_mask |= PRIORITY_ARBITRATION_BIT_NP;
 				}
 				// request not put on bus for CPU memory access
 				mailbox.arm2pru_req = ARM2PRU_NONE; // ACK: done
 				break;
+			case ARM2PRU_DMA_NEXT:
+				// queue device DMA chunk in other buffer, started at end of current one.
+				// If current chunk already complete: start now.
+				if (mailbox.dma.cur_status == DMA_STATE_ARBITRATING
+						|| mailbox.dma.cur_status == DMA_STATE_RUNNING)
+					mailbox.dma.next_valid = 1;
+				else if (mailbox.dma.cur_status == DMA_STATE_READY) {
+					DMA_NEXT_ACTIVATE();
+					sm_arb.device_request_mask |= PRIORITY_ARBITRATION_BIT_NP;
+				} // else current chunk failed: ARM aborts the request
+				mailbox.arm2pru_req = ARM2PRU_NONE; // ACK: done
+				break;
 			case ARM2PRU_INTR:
 				// request INTR, arbitrator must've been selected with ARM2PRU_ARB_MODE_*
 				// start one INTR cycle. May be raised in midst of slave cycle
@@ -21,6 +21,7 @@
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
+ 15-oct-2026  QC      INTR complete signaled via event ring
  12-nov-2018  JH      entered beta phase
 
  Statemachine for execution of the Priority Arbitration protocol
@@ -313,14 +314,11 @@ uint8_t sm_arb_worker_device(uint8_t granted_requests_mask) {
         // if (buslatches_getbyte(4) & BIT(1))
         //	return 0 ; // wait for DIN to negate, "RPLY negate" repeats then
 
-        // signal to ARM which INTR was completed
-        // change mailbox only after ARM has ack'ed mailbox.events.event_intr
-        // mailbox.events.intr_master.level_index = sm_intr_master.level_index;
-        EVENT_SIGNAL(mailbox,intr_master[sm_arb.intr_level_index]);
-        // ARM is clearing this, before requesting new interrupt of same level
-        // so no concurrent ARP+PRU access
-        PRU2ARM_INTERRUPT
-        ;
+        // signal to ARM which INTR was completed.
+        // ARM requests a new interrupt of same level only after this event,
+        // so ring space is reserved.
+        EVENTRING_ENTRY(mailbox,mailbox.eventring.head).level_index = sm_arb.intr_level_index;
+        EVENTRING_PUSH(EVENTRING_TYPE_INTR_MASTER);
 
         sm_arb.state = state_arbitration_grant_check ; // restart
 
@@ -207,6 +207,7 @@ enum states_data_slave_enum  sm_data_slave_func(enum states_data_slave_enum  /**
 //                state = state_data_slave_din_single_complete; // wait for ARM to process device register access
             } else {
                 buslatches_setbits(4, BIT(3)+BIT(6), 0); // RPLY=0, ARM-elongated cycle finished.  REF=0, cleanup
+                DEVICEREGISTER_STRETCH_END() ;
                 // "The Bus slave continues to gate TDATA onto the Bus for 0 ns
                 // minimum and 100 ns maximum after negating TRPLY"
                 buslatches_setbyte(3, BIT(1));	// "clr DAL", remove data from DAL lines
@@ -232,6 +233,7 @@ enum states_data_slave_enum  sm_data_slave_func(enum states_data_slave_enum  /**
 //                state = state_data_slave_dout_single_complete; // wait for ARM to process device register access
             } else {
                 buslatches_setbits(4, BIT(3)+BIT(6), 0); // RPLY=0, ARM-elongated cycle finished.  REF=0, cleanup
+                DEVICEREGISTER_STRETCH_END() ;
                 state = state_data_slave_dout_block_complete;
             }
         }
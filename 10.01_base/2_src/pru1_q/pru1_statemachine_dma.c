@@ -21,6 +21,9 @@
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
+ 16-oct-2026	QC	zero-copy: data from/to DDR buffer at mailbox.dma.ddr_offset
+ 15-oct-2026	QC	double buffered device DMA: start queued chunk
+ 15-oct-2026	QC	device DMA complete signaled via event ring
  01-aug-2020	JH		start QBUS
  29-jun-2019	JH		rework: state returns ptr to next state func
  12-nov-2018	JH      entered beta phase
@@ -88,7 +91,10 @@ statemachine_state_func sm_dma_start() {
     // buslatches_setbits(1, BIT(6), BIT(6));
 
     mailbox.dma.cur_addr = mailbox.dma.startaddr;
-    sm_dma.dataptr = (uint16_t *) mailbox.dma.words; // point to start of data buffer
+    if (mailbox.dma.ddr_offset) // zero-copy: device buffer in DDR
+        sm_dma.dataptr = (uint16_t *) ((uint8_t *) mailbox.ddrmem_base_physical + mailbox.dma.ddr_offset);
+    else
+        sm_dma.dataptr = (uint16_t *) mailbox.dma.words[mailbox.dma.buffer_index]; // point to start of data buffer
     sm_dma.words_left = mailbox.dma.wordcount;
     mailbox.dma.cur_status = DMA_STATE_RUNNING;
 
@@ -473,17 +479,26 @@ static statemachine_state_func sm_dma_state_99() {
     // device or cpu cycle ended
     // no concurrent ARM+PRU access
 
-    // for cpu access: ARM CPU thread ends looping now
-    // test for DMA_STATE_IS_COMPLETE(cur_status)
-    EVENT_SIGNAL(mailbox, dma);
-
-    // for device DMA: qunibusadapter worker() waits for signal
-    if (!mailbox.dma.cpu_access) {
-        // signal to ARM
-        // ARM is clearing this, before requesting new DMA.
-        // no concurrent ARM+PRU access
-        PRU2ARM_INTERRUPT
-        ;
+    if (mailbox.dma.cpu_access) {
+        // for cpu access: ARM CPU thread ends looping now
+        // test for DMA_STATE_IS_COMPLETE(cur_status)
+        EVENT_SIGNAL(mailbox, dma);
+        if (mailbox.dma.cpu_wakeup)
+            // ARM CPU thread stopped spinning and sleeps: worker completes
+            PRU2ARM_INTERRUPT;
+    } else {
+        // for device DMA: qunibusadapter worker() drains event ring
+        // result in ring entry, ARM drains buffer while next chunk runs
+        EVENTRING_DMA_RESULT(final_dma_state);
+        if (mailbox.dma.next_valid) {
+            if (final_dma_state == DMA_STATE_READY) {
+                // chunk queued by ARM2PRU_DMA_NEXT: arbitrate again, no ARM roundtrip
+                DMA_NEXT_ACTIVATE();
+                sm_arb.device_request_mask |= PRIORITY_ARBITRATION_BIT_NP;
+            } else
+                mailbox.dma.next_valid = 0; // error aborts queued chunk
+        }
+        EVENTRING_PUSH(EVENTRING_TYPE_DMA);
     }
 //		PRU_DEBUG_PIN0_PULSE(50) ;  // CPU20 performace
 
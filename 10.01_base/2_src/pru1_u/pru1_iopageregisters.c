@@ -21,6 +21,8 @@
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
+ 16-oct-2026  QC      PRU micro-actions, "posted" DATI events
+ 15-oct-2026  QC      "posted" DATO events
  12-nov-2018  JH      entered beta phase
  */
 
@@ -69,8 +71,10 @@ uint8_t emulated_addr_read(uint32_t addr, uint16_t *val) {
 			// indexing this records takes 4,6 us, if record size != 8
 			pru_iopage_register_t *reg = (pru_iopage_register_t *) &(pru_iopage_registers.registers[reghandle]); // alias
 			*val = reg->value;
+			if (reg->event_flags & IOPAGEREGISTER_EVENT_FLAG_ACTION)
+				DO_REGISTER_ACTION_DATI(reghandle, reg);
 			if (reg->event_flags & IOPAGEREGISTER_EVENT_FLAG_DATI)
-				DO_EVENT_DEVICEREGISTER(reg, QUNIBUS_CYCLE_DATI, addr, *val);
+				DO_EVENT_DEVICEREGISTER_DATI(reg, addr, *val);
 			// ARM is clearing this, while SSYN asserted, so no concurrent next bus cycle.
 			// no concurrent ARP+PRU access
 
@@ -104,8 +108,10 @@ uint8_t emulated_addr_write_w(uint32_t addr, uint16_t w) {
 			pru_iopage_register_t *reg = (pru_iopage_register_t *) &(pru_iopage_registers.registers[reghandle]); // alias
 			uint16_t reg_val = (reg->value & ~reg->writable_bits) | (w & reg->writable_bits);
 			reg->value = reg_val;
+			if (reg->event_flags & IOPAGEREGISTER_EVENT_FLAG_ACTION)
+				DO_REGISTER_ACTION_DATO(reghandle, reg_val);
 			if (reg->event_flags & IOPAGEREGISTER_EVENT_FLAG_DATO)
-				DO_EVENT_DEVICEREGISTER(reg, QUNIBUS_CYCLE_DATO, addr, reg_val);
+				DO_EVENT_DEVICEREGISTER_DATO(reg, QUNIBUS_CYCLE_DATO, addr, reg_val);
 			return 1;
 		}
 	} else
@@ -138,8 +144,10 @@ uint8_t emulated_addr_write_b(uint32_t addr, uint8_t b) {
 				| (reg->value & ~reg->writable_bits & 0x00ff) // protected upper byte bits
 						| (b & reg->writable_bits); // changed lower byte bits
 			reg->value = reg_val;
+			if (reg->event_flags & IOPAGEREGISTER_EVENT_FLAG_ACTION)
+				DO_REGISTER_ACTION_DATO(reghandle, reg_val);
 			if (reg->event_flags & IOPAGEREGISTER_EVENT_FLAG_DATO)
-				DO_EVENT_DEVICEREGISTER(reg, QUNIBUS_CYCLE_DATOB, addr, reg_val);
+				DO_EVENT_DEVICEREGISTER_DATO(reg, QUNIBUS_CYCLE_DATOB, addr, reg_val);
 			return 1;
 		}
 	} else
@@ -178,6 +178,7 @@ static statemachine_state_func sm_data_slave_state_10() {
 
 	// clear SSYN = latch[4], bit 5
 	buslatches_setbits(4, BIT(5), 0);
+	DEVICEREGISTER_STRETCH_END() ;
 
 	return NULL; // ready 
 }
@@ -202,6 +203,7 @@ static statemachine_state_func sm_data_slave_state_20() {
 	buslatches_setbyte(6, 0);
 	// clear SSYN = latch[4], bit 5
 	buslatches_setbits(4, BIT(5), 0);
+	DEVICEREGISTER_STRETCH_END() ;
 	return NULL; // ready 
 }
 
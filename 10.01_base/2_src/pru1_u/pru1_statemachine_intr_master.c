@@ -21,6 +21,7 @@
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
+ 15-oct-2026	QC	INTR complete signaled via event ring
  29-jun-2019	JH		rework: state returns ptr to next state func
  12-nov-2018  JH      entered beta phase
 
@@ -82,11 +83,10 @@ static statemachine_state_func sm_intr_master_state_2() {
 		return (statemachine_state_func) &sm_intr_master_state_2; // wait
 	// received SSYN
 
-	// Complete and signal this INTR transaction only after ARM has processed the previous event.
+	// Complete and signal this INTR transaction without waiting for ARM:
 	// INTR may come faster than ARM Linux can process,
 	// especially if Arbitrator grants INTRs of multiple levels almost simultaneaously in parallel.
-	if (! EVENT_IS_ACKED(mailbox,intr_master[sm_intr_master.level_index]))
-		return (statemachine_state_func) &sm_intr_master_state_2; // wait
+	// ARM processes the event ring in order.
 
 	// remove vector
 	buslatches_setbyte(5, 0); // DATA[0..7] = latch[5]
@@ -100,14 +100,12 @@ static statemachine_state_func sm_intr_master_state_2() {
 	// device cycle ended: now CPU may become UNIBUS master again
 	// SACK already removed
 
-	// signal to ARM which INTR was completed
-	// change mailbox only after ARM has ack'ed mailbox.events.event_intr
-	// mailbox.events.intr_master.level_index = sm_intr_master.level_index;
-	EVENT_SIGNAL(mailbox,intr_master[sm_intr_master.level_index]);
-	// ARM is clearing this, before requesting new interrupt of same level
-	// so no concurrent ARP+PRU access
-	PRU2ARM_INTERRUPT
-	;
+	// signal to ARM which INTR was completed.
+	// ARM requests a new interrupt of same level only after this event,
+	// so the ring can not overflow: one of the EVENTRING_RESERVED entries
+	// is always free for each level.
+	EVENTRING_ENTRY(mailbox,mailbox.eventring.head).level_index = sm_intr_master.level_index;
+	EVENTRING_PUSH(EVENTRING_TYPE_INTR_MASTER);
 	
 
 	return NULL; // ready
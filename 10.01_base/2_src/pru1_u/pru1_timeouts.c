@@ -44,6 +44,7 @@
 #include <string.h>
 
 #include "pru1_utils.h"
+#include "mailbox.h" // deviceregister_signal_cycles
 #include "pru1_timeouts.h"	// own
 
 // count running timers.
@@ -66,6 +67,8 @@ void timeout_set(uint32_t *target_cycles_var, uint32_t delta_cycles) {
 	if (timeouts_active == 0) {
 		// first timeout: clear and restart counter
 		PRU1_CTRL.CTRL_bit.CTR_EN = 0;
+		// running SSYN stretch measurement continues on the new count
+		deviceregister_signal_cycles -= PRU1_CTRL.CYCLE;
 		PRU1_CTRL.CYCLE = 0;
 	}
 
@@ -115,4 +118,6 @@ bool timeout_reached(uint32_t *target_cycles_var) {
 void timeout_init(void) {
 	timeouts_active = 0;
 	memset(timeout_target_cycles, 0, sizeof(uint32_t) * TIMEOUT_COUNT);
+	// counter runs also without timeouts, for SSYN stretch measurement
+	PRU1_CTRL.CTRL_bit.CTR_EN = 1;
 }
@@ -31,6 +31,9 @@ typedef struct {
 #ifdef ARM
 // included by ARM code
 
+#include <map>
+#include <set>
+#include <pthread.h>
 #include "logsource.hpp"
 
 class ddrmem_c: public logsource_c {
@@ -67,7 +70,22 @@ public:
 		
 	bool iopage_deposit(uint32_t addr, uint16_t w) ;
 	bool iopage_exam(uint32_t addr, uint16_t *w) ;
-	
+
+	// Zero-copy DMA: device buffers in the DDR memory behind ddrmem_t.
+	// PRU transfers from/to these directly, no staging through mailbox.dma.words[].
+	uint32_t dma_pool_offset; // start of pool, relative to base_virtual
+	uint32_t dma_pool_size; // 0: no DDR left behind ddrmem_t
+	void dma_pool_init(void);
+	uint16_t *dma_buffer_alloc(uint32_t wordcount);
+	void dma_buffer_free(uint16_t *buffer);
+	uint32_t dma_buffer_offset(const uint16_t *buffer, uint32_t wordcount);
+
+private:
+	pthread_mutex_t dma_pool_mutex;
+	std::map<uint32_t, uint32_t> dma_pool_free_blocks; // offset -> size, in bytes
+	std::map<uint32_t, uint32_t> dma_pool_used_blocks; // offset -> size
+	void *dma_pool_base; // base_virtual the used blocks refer to
+	std::set<uint16_t *> dma_pool_stale_buffers; // held over a PRU restart with DDR remap
 };
 
 #ifndef _DDRMEM_C_
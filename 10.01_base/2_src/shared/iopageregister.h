@@ -22,6 +22,8 @@
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
+ 16-oct-2026  QC      PRU micro-actions for simple register side effects
+ 15-oct-2026  QC      "posted" DATO events via mailbox event ring
  12-nov-2018  JH      entered Beta phase
 
  Implementation of QBUS/UNIBUS devices:
@@ -79,6 +81,21 @@
  route event to controller
  change controller state, write new values into register set.
  perhaps do DMA and INTR
+
+ "Posted" DATI/DATO:
+ If the PRU did all synchronous side effects of an access by micro-action (see below),
+ it does not wait for ARM: the event is appended to the mailbox event ring,
+ SSYN is negated immediately.
+ ARM processes the access later, in order with other ring events.
+ If the ring is full, the PRU falls back to the blocking "AFTER-DATO" event.
+
+ PRU "micro-actions":
+ Many active registers need only simple side effects: clear-on-read status bits,
+ set or clear bits in a status register after DATO to a buffer register
+ (DL11 XBUF -> XCSR READY clear), copy the value written into another register.
+ These are described in a small table "register_actions[]" and executed by the PRU
+ itself within the bus cycle. The DATI/DATO event to the ARM is then "posted":
+ the bus cycle completes in PRU time, ARM device logic runs later.
  */
 
 #ifndef _DEVICES_H_
@@ -125,6 +142,17 @@
 // Bitmask: Create event for iopageregister DATI/DATO access ?
 #define IOPAGEREGISTER_EVENT_FLAG_DATI	0x01
 #define IOPAGEREGISTER_EVENT_FLAG_DATO	0x02
+#define IOPAGEREGISTER_EVENT_FLAG_DATO_POSTED	0x04	// DATO event via event ring, no bus stall
+#define IOPAGEREGISTER_EVENT_FLAG_DATI_POSTED	0x08	// DATI event via event ring, no bus stall
+#define IOPAGEREGISTER_EVENT_FLAG_ACTION	0x10	// PRU executes register_actions[] entry
+
+// # of PRU micro-action entries. Handle 0 = no action
+#define MAX_IOPAGE_REGISTER_ACTION_COUNT	32
+
+// Bitmask: which micro-actions of an entry are valid
+#define IOPAGEREGISTER_ACTION_DATI	0x01	// DATI: clear "dati_clear_bits" in register
+#define IOPAGEREGISTER_ACTION_DATO	0x02	// DATO/DATOB: clear+set bits in target register
+#define IOPAGEREGISTER_ACTION_DATO_COPY	0x04	// DATO/DATOB: target register := value written, then clear+set
 
 // register descriptor used by PRU for direct high-speed QBUS/UNIBUS DATI/DATO access
 typedef struct {
@@ -154,6 +182,15 @@ typedef struct {
 	// uint8_t dummy[2]; // fill up to 2+2+1+1+2 = 8 byte record size
 } pru_iopage_register_t;
 
+// PRU micro-action: side effects of a register access executed by PRU
+typedef struct {
+	uint16_t dati_clear_bits; // DATI: bits cleared in register after read
+	uint16_t dato_clear_bits; // DATO: bits cleared in target register
+	uint16_t dato_set_bits; // DATO: bits set in target register
+	uint8_t dato_register_handle; // target register of DATO action, may be the register itself
+	uint8_t flags; // Bit-OR of IOPAGEREGISTER_ACTION_*
+} pru_iopage_register_action_t;
+
 typedef struct {
 	/* The whole memory range is segmented into 
 	 * a single contniuous range of emulated memory (maybe 0)
@@ -176,8 +213,14 @@ typedef struct {
  	pru_iopage_register_t registers[MAX_IOPAGE_REGISTER_COUNT];
 	// sizeof(pru_iopage_register_t) == "power of 2", index calculation!
 
+	// micro-action entry for each register, indexed by register handle.
+	// 0 = none, used only if IOPAGEREGISTER_EVENT_FLAG_ACTION set
+	uint8_t register_action_handles[MAX_IOPAGE_REGISTER_COUNT];
+	uint8_t _dummy; // keep 32 bit borders
+	pru_iopage_register_action_t register_actions[MAX_IOPAGE_REGISTER_ACTION_COUNT];
+
 } pru_iopage_registers_t;
-// must fit in 8K PRU0 RAM
+// must fit in 8K PRU0 RAM, before PRU-PRU mailbox at end
 
 #ifdef ARM
 #pragma pack(pop)
@@ -209,6 +252,24 @@ uint8_t emulated_addr_write_b(uint32_t addr, uint8_t w);
 void iopageregisters_reset_values(void) ;
 void iopageregisters_init(void);
 
+// PRU micro-actions, register "value" already put on bus or written
+#define DO_REGISTER_ACTION_DATI(_reghandle,_reg) do {	\
+		pru_iopage_register_action_t *_action = &pru_iopage_registers.register_actions[	\
+				pru_iopage_registers.register_action_handles[_reghandle]] ;	\
+		if (_action->flags & IOPAGEREGISTER_ACTION_DATI)	\
+			(_reg)->value &= ~_action->dati_clear_bits ;	\
+	} while(0)
+
+#define DO_REGISTER_ACTION_DATO(_reghandle,_reg_val) do {	\
+		pru_iopage_register_action_t *_action = &pru_iopage_registers.register_actions[	\
+				pru_iopage_registers.register_action_handles[_reghandle]] ;	\
+		if (_action->flags & IOPAGEREGISTER_ACTION_DATO) {	\
+			pru_iopage_register_t *_target = &pru_iopage_registers.registers[_action->dato_register_handle] ;	\
+			uint16_t _target_val = (_action->flags & IOPAGEREGISTER_ACTION_DATO_COPY) ? (_reg_val) : _target->value ; \
+			_target->value = (_target_val & ~_action->dato_clear_bits) | _action->dato_set_bits ;	\
+		}	\
+	} while(0)
+
 #endif
 
 #endif // _IOPAGEREGISTER_H_
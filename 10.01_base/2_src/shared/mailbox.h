@@ -21,6 +21,12 @@
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
+ 16-oct-2026  QC      deviceregister.ack_cycles: SSYN/RPLY stretch measured by PRU
+ 16-oct-2026  QC      posted DATI events for registers with PRU micro-actions
+ 16-oct-2026  QC      dma.cpu_wakeup: PRU2ARM_INTERRUPT for sleeping CPU thread
+ 16-oct-2026  QC      zero-copy DMA from/to DDR buffers
+ 15-oct-2026  QC      double buffered device DMA chunks, ARM2PRU_DMA_NEXT
+ 15-oct-2026  QC      event ring for non-blocking DMA/INTR/DATO events
  12-nov-2018  JH      entered beta phase
  */
 
@@ -52,6 +58,7 @@
 #define ARM2PRU_DDR_SLAVE_MEMORY	18	// use DDR as QBUS/UNIBUS slave memory
 #define ARM2PRU_ARB_GRANT_INTR_REQUESTS	19 // emulated CPU answers device requests
 #define ARM2PRU_CPU_BUS_ACCESS 20 // prohibit any activity of CPU on QBUS
+#define ARM2PRU_DMA_NEXT	21	// queue device DMA chunk behind the running one
 
 
 
@@ -95,7 +102,8 @@
 #define CPU_PRIORITY_LEVEL_FETCHING	0xff
 
 // data for a requested DMA operation
-#define	PRU_MAX_DMA_WORDCOUNT	(8*512)
+#define	PRU_MAX_DMA_WORDCOUNT	(4*512)	// per buffer
+#define	PRU_DMA_BUFFER_COUNT	2	// ping-pong: ARM fills/drains one while PRU transfers other
 
 #include "ddrmem.h"
 
@@ -161,12 +169,28 @@ typedef struct {
 	uint16_t wordcount; // # of remaining words transmit/receive, static
 	// ---dword---
 	uint8_t	cpu_access ; // 0 for device DMA, 1 for emulated CPU
-	uint8_t	dummy[3] ;
+	uint8_t	buffer_index ; // words[buffer_index][] used by current transfer
+	uint8_t	next_valid ; // 1: a chunk is queued with ARM2PRU_DMA_NEXT
+	uint8_t	next_buscycle ;
 	// ---dword---
 	uint32_t cur_addr; // current address in transfer, if timeout: offending address.
 	// if complete: last address accessed.
 	uint32_t startaddr; // address of 1st word to transfer
-	uint16_t words[PRU_MAX_DMA_WORDCOUNT]; // buffer for rcv/xmt data
+	// Device DMA chunk queued with ARM2PRU_DMA_NEXT, uses the other buffer.
+	// PRU starts it after the current chunk ended with DMA_STATE_READY,
+	// without waiting for the ARM. Result of each chunk is in the event ring.
+	uint32_t next_startaddr;
+	uint16_t next_wordcount;
+	// CPU access: 1 = ARM CPU thread parked, PRU2ARM_INTERRUPT wakes worker on completion
+	uint8_t cpu_wakeup ;
+	uint8_t _dummy1 ;
+	// ---dword---
+	// Zero-copy: data in DDR buffer at ddrmem_base_physical + ddr_offset,
+	// instead of words[buffer_index]. 0 = use words[].
+	uint32_t ddr_offset ;
+	uint32_t next_ddr_offset ; // of chunk queued with ARM2PRU_DMA_NEXT
+	// ---dword---
+	uint16_t words[PRU_DMA_BUFFER_COUNT][PRU_MAX_DMA_WORDCOUNT]; // buffers for rcv/xmt data
 } mailbox_dma_t;
 
 // data for all 4 pending INTR requests
@@ -220,6 +244,10 @@ typedef struct {
 	// ---dword---
 	// QUNIBUS address accessed
 	uint32_t addr; // accessed address: odd/even important for DATOB
+	// ---dword---
+	// PRU cycles (5 ns) SSYN/RPLY of the previous blocking event was held:
+	// from signal until PRU saw the ACK. Valid when the next event is signaled.
+	uint32_t ack_cycles;
 } mailbox_event_deviceregister_t;
 
 // DMA transfer complete
@@ -234,18 +262,6 @@ typedef struct {
 	uint8_t _dummy2[2];
 } mailbox_event_dma_t;
 
-// INTR raised by device
-typedef struct {
-	/* Event priority arbitration INTR transfer complete
-	 After ARM2PRU_INTR, one of BR4/5/6/7 NP was requested,
-	 granted, and the deviceregister.data transfer was handled as bus master.
-	 */
-	uint8_t signaled; // PRU->ARM, one of BR/IRQ4,5,6,7 vector on QBUS/UNIBUS
-	uint8_t acked; // ARM->PRU
-	//uint8_t level_index; // 0..3 -> BR4..BR7
-	uint8_t _dummy[2];
-} mailbox_event_intr_master_t;
-
 // INTR received by CPU
 typedef struct {
 	uint8_t signaled; // PRU->ARM, one of BR4/IRQ,5,6,7 vector on QBUS/UNIBUS
@@ -271,11 +287,9 @@ typedef struct {
 	// different events can be raised asynchronically and concurrent,
 	// but a single event type is sequentially signaled by PRU and acked by ARM.
 	mailbox_event_deviceregister_t deviceregister;
+	// DMA of emulated CPU complete. Device DMA is signaled via event ring.
 	mailbox_event_dma_t dma;
 
-	// one event for each BG4,5,6,7
-	mailbox_event_intr_master_t intr_master[4];
-
 	mailbox_event_intr_slave_t intr_slave;
 
 	/*** INIT or Power cycle seen on QBUS/UNIBUS ***/
@@ -291,6 +305,51 @@ typedef struct {
 	uint8_t _dummy9[1]; // make record multiple of dword !!!
 } mailbox_events_t;
 
+/* Event ring for events which need not stall the PRU until ARM has processed them:
+ - device DMA chunk complete
+ - INTR vector transfer complete (BG4,5,6,7)
+ - DATI/DATO to a device register with PRU micro-action (IOPAGEREGISTER_EVENT_FLAG_*_POSTED)
+ Single producer (PRU) / single consumer (ARM):
+ PRU fills entry[head], then increments "head".
+ ARM processes entry[tail], then increments "tail".
+ Both are rollaround counters, fill level is "head - tail".
+ PRU2ARM_INTERRUPT is only raised if the ring was empty before the push,
+ ARM drains all entries on one wakeup.
+ Device DMA is limited to 1 active and 1 queued chunk, INTR to 1 per level, so
+ EVENTRING_RESERVED entries are always free for these.
+ Posted register events use only the remaining space, else the blocking deviceregister event.
+ */
+#define EVENTRING_SIZE	32	// power of 2, < 256
+#define EVENTRING_RESERVED	6	// 2 DMA + 4 INTR levels
+
+#define EVENTRING_TYPE_DMA	1	// device DMA chunk complete, result in entry
+#define EVENTRING_TYPE_INTR_MASTER	2	// INTR of .level_index transmitted
+#define EVENTRING_TYPE_DEVICEREGISTER	3	// posted DATO/DATOB, or DATI
+
+#define EVENTRING_FILL(mailbox) ((uint8_t)((mailbox).eventring.head - (mailbox).eventring.tail))
+#define EVENTRING_IS_EMPTY(mailbox) ((mailbox).eventring.head == (mailbox).eventring.tail)
+#define EVENTRING_ENTRY(mailbox,idx) ((mailbox).eventring.entries[(idx) & (EVENTRING_SIZE-1)])
+
+typedef struct {
+	uint8_t type; // EVENTRING_TYPE_*
+	uint8_t level_index; // INTR_MASTER: 0..3 -> BR4..BR7
+	uint8_t unibus_control; // DEVICEREGISTER: DATO, DATOB, DATI
+	uint8_t register_handle; // DEVICEREGISTER
+	// ---dword---
+	uint16_t data; // DEVICEREGISTER: value written. DMA: wordcount of chunk
+	uint8_t dma_buffer_index; // DMA: mailbox.dma.words[] of chunk
+	uint8_t dma_status; // DMA: final DMA_STATE_*
+	// ---dword---
+	uint32_t addr; // DEVICEREGISTER: odd/even important for DATOB. DMA: last/error addr
+} mailbox_eventring_entry_t;
+
+typedef struct {
+	uint8_t head; // PRU->ARM
+	uint8_t tail; // ARM->PRU
+	uint8_t _dummy[2];
+	mailbox_eventring_entry_t entries[EVENTRING_SIZE];
+} mailbox_eventring_t;
+
 typedef struct {
 
 	// generic request/response flags
@@ -304,6 +363,8 @@ typedef struct {
 	// set by PRU, read by ARM on event
 	mailbox_events_t events;
 
+	mailbox_eventring_t eventring;
+
 	mailbox_intr_t intr;
 
 	mailbox_dma_t dma;
@@ -346,6 +407,17 @@ bool mailbox_execute(uint8_t request);
 #ifndef _MAILBOX_C_
 extern volatile far mailbox_t mailbox;
 #endif
+// PRU1 cycle counter when the blocking deviceregister event was signaled
+extern uint32_t deviceregister_signal_cycles;
+extern uint8_t deviceregister_stretch_active; // 1: ack_cycles not yet set
+
+// SSYN/RPLY released after ARM ACK: stretch of bus cycle into mailbox
+#define DEVICEREGISTER_STRETCH_END() do { \
+			if (deviceregister_stretch_active) {						\
+				mailbox.events.deviceregister.ack_cycles = PRU1_CTRL.CYCLE - deviceregister_signal_cycles ; \
+				deviceregister_stretch_active = 0 ;					\
+			}															\
+		} while(0)
 
 // code to send an register access event
 // pru_iopage_register_t *reg
@@ -355,12 +427,79 @@ extern volatile far mailbox_t mailbox;
 			mailbox.events.deviceregister.register_handle = _reg->event_register_handle ;\
 			mailbox.events.deviceregister.addr = _addr ;									 \
 			mailbox.events.deviceregister.data = _data ;									\
+			deviceregister_signal_cycles = PRU1_CTRL.CYCLE ;						\
+			deviceregister_stretch_active = 1 ;						\
 			EVENT_SIGNAL(mailbox,deviceregister) ;						\
 			/* data for ARM valid now*/ 									\
 			PRU2ARM_INTERRUPT ; 											\
 			/* leave SSYN asserted until mailbox.event.signal ACKEd to 0 */ \
 		} while(0)
 
+// append an entry to the event ring. Fields beside "type" set by caller before.
+// ARM is woken only if it had processed all previous entries.
+// "head" must be written before "tail" is read, see mailbox_eventring_t
+#define EVENTRING_PUSH(_type) do { \
+			uint8_t _head = mailbox.eventring.head ;					\
+			EVENTRING_ENTRY(mailbox,_head).type = _type ;				\
+			mailbox.eventring.head = _head + 1 ; /* data for ARM valid now */	\
+			if (mailbox.eventring.tail == _head)						\
+				PRU2ARM_INTERRUPT ; /* ARM idle: wake up */				\
+		} while(0)
+
+// device DMA chunk ended: result into next event ring entry, as mailbox.dma
+// may be reused by the queued chunk. Entry published with EVENTRING_PUSH().
+#define EVENTRING_DMA_RESULT(_final_dma_state) do { \
+			uint8_t _idx = mailbox.eventring.head ;					\
+			EVENTRING_ENTRY(mailbox,_idx).dma_buffer_index = mailbox.dma.buffer_index ; \
+			EVENTRING_ENTRY(mailbox,_idx).dma_status = _final_dma_state ;	\
+			EVENTRING_ENTRY(mailbox,_idx).data = mailbox.dma.wordcount ;	\
+			EVENTRING_ENTRY(mailbox,_idx).addr = mailbox.dma.cur_addr ;	\
+		} while(0)
+
+// make the queued chunk the current one, in the other buffer.
+// Caller must request NPR arbitration for it.
+// Must be done before the previous chunk is signaled to ARM, ARM then
+// writes the next_* fields again.
+#define DMA_NEXT_ACTIVATE() do { \
+			mailbox.dma.buffer_index ^= 1 ;						\
+			mailbox.dma.buscycle = mailbox.dma.next_buscycle ;		\
+			mailbox.dma.wordcount = mailbox.dma.next_wordcount ;	\
+			mailbox.dma.startaddr = mailbox.dma.next_startaddr ;	\
+			mailbox.dma.ddr_offset = mailbox.dma.next_ddr_offset ;	\
+			mailbox.dma.next_valid = 0 ;							\
+			mailbox.dma.cur_status = DMA_STATE_ARBITRATING ;		\
+		} while(0)
+
+// DATO to a register with event: post into ring if allowed and space,
+// else signal and leave SSYN asserted until ARM has processed
+#define DO_EVENT_DEVICEREGISTER_DATO(_reg,_unibus_control,_addr,_data)	do { \
+			if ((_reg->event_flags & IOPAGEREGISTER_EVENT_FLAG_DATO_POSTED)		\
+				&& EVENTRING_FILL(mailbox) < (EVENTRING_SIZE - EVENTRING_RESERVED)) { \
+				uint8_t _idx = mailbox.eventring.head ;					\
+				EVENTRING_ENTRY(mailbox,_idx).unibus_control = _unibus_control ;	\
+				EVENTRING_ENTRY(mailbox,_idx).register_handle = _reg->event_register_handle ; \
+				EVENTRING_ENTRY(mailbox,_idx).addr = _addr ;				\
+				EVENTRING_ENTRY(mailbox,_idx).data = _data ;				\
+				EVENTRING_PUSH(EVENTRING_TYPE_DEVICEREGISTER) ;			\
+			} else															\
+				DO_EVENT_DEVICEREGISTER(_reg,_unibus_control,_addr,_data) ;	\
+		} while(0)
+
+// DATI on active register: posted into event ring if register side effects
+// are done by PRU micro-action, else blocking
+#define DO_EVENT_DEVICEREGISTER_DATI(_reg,_addr,_data)	do { \
+			if ((_reg->event_flags & IOPAGEREGISTER_EVENT_FLAG_DATI_POSTED)		\
+				&& EVENTRING_FILL(mailbox) < (EVENTRING_SIZE - EVENTRING_RESERVED)) { \
+				uint8_t _idx = mailbox.eventring.head ;					\
+				EVENTRING_ENTRY(mailbox,_idx).unibus_control = QUNIBUS_CYCLE_DATI ;	\
+				EVENTRING_ENTRY(mailbox,_idx).register_handle = _reg->event_register_handle ; \
+				EVENTRING_ENTRY(mailbox,_idx).addr = _addr ;				\
+				EVENTRING_ENTRY(mailbox,_idx).data = _data ;				\
+				EVENTRING_PUSH(EVENTRING_TYPE_DEVICEREGISTER) ;			\
+			} else															\
+				DO_EVENT_DEVICEREGISTER(_reg,QUNIBUS_CYCLE_DATI,_addr,_data) ;	\
+		} while(0)
+
 
 #endif
 
@@ -20,6 +20,12 @@
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
+ 16-oct-2026  QC      trigger program as parameter, compiled trigger
+ 16-oct-2026  QC      binary cycle trace, stream mode
+ 16-oct-2026  QC      basic block cache
+ 16-oct-2026  QC      page table for CPU memory access
+ 16-oct-2026  QC      table driven opcode decode, lock free INTR, ips benchmark
+ 16-oct-2026  QC      CPU bus cycle bursts, instruction prefetch
  16-oct-2020  JH     merged VBIT changes by github jks-prv
  23-nov-2018  JH      created
 
@@ -107,13 +113,24 @@ void unibone_grant_interrupts(void)
 #define UNIBUS_ACCESS_NS	1000
 // "real world" time for bus access. emulated timeout is stepped by this on every cycle.
 
-int unibone_dato(unsigned addr, unsigned data) 
+// trigger probe on a full bus cycle.
+// Ends a basic block on trigger, to HALT after this opcode.
+static void unibone_trigger_probe(unsigned addr, uint8_t cycle, uint16_t data)
+{
+    unibone_cpu->trigger.probe(addr, cycle, data) ;
+    if (unibone_cpu->trigger.has_triggered())
+        unibone_cpu->ka11.block_abort = 1;
+}
+
+// full bus cycle: trigger, emulated time, PMI or UNIBUS, trace
+static int unibone_dato_cycle(unsigned addr, unsigned data) 
 {
     bool success ;
 
-    unibone_cpu->trigger.probe(addr, QUNIBUS_CYCLE_DATO) ; // register access for trigger system
+    unibone_trigger_probe(addr, QUNIBUS_CYCLE_DATO, data) ; // register access for trigger system
 
     uint16_t wordbuffer = (uint16_t) data;
+    unibone_cpu->prefetch_invalidate(addr);
     the_flexi_timeout_controller->emu_step_ns(UNIBUS_ACCESS_NS);
     if (unibone_cpu->direct_memory.value && addr < qunibus->iopage_start_addr) {
         // Direct access Non-IOPage memory.
@@ -130,15 +147,16 @@ int unibone_dato(unsigned addr, unsigned data)
 
     // trace bus access
     if (unibone_cpu->cycle_trace_buffer.active)
-        unibone_cpu->cycle_trace_buffer.add(qunibus_cycle_trace_entry_c(unibone_cpu->cycle_trace_entry_id++, addr >= qunibus->iopage_start_addr, addr, QUNIBUS_CYCLE_DATO, data, !success)) ;
+        unibone_cpu->cycle_trace_buffer.add(addr >= qunibus->iopage_start_addr, addr, QUNIBUS_CYCLE_DATO, data, !success) ;
 
     return success;
 }
 
-int unibone_datob(unsigned addr, unsigned data) 
+static int unibone_datob_cycle(unsigned addr, unsigned data) 
 {
     bool success ;
-    unibone_cpu->trigger.probe(addr, QUNIBUS_CYCLE_DATO) ; // register access for trigger system
+    unibone_trigger_probe(addr, QUNIBUS_CYCLE_DATOB, data) ; // register access for trigger system
+    unibone_cpu->prefetch_invalidate(addr & ~1);
     the_flexi_timeout_controller->emu_step_ns(UNIBUS_ACCESS_NS);
     if (unibone_cpu->direct_memory.value && addr < qunibus->iopage_start_addr) {
         // read-modify-write
@@ -166,23 +184,28 @@ int unibone_datob(unsigned addr, unsigned data)
 
     // trace bus access
     if (unibone_cpu->cycle_trace_buffer.active)
-        unibone_cpu->cycle_trace_buffer.add(qunibus_cycle_trace_entry_c(unibone_cpu->cycle_trace_entry_id++, addr >= qunibus->iopage_start_addr, addr, QUNIBUS_CYCLE_DATOB, data, !success)) ;
+        unibone_cpu->cycle_trace_buffer.add(addr >= qunibus->iopage_start_addr, addr, QUNIBUS_CYCLE_DATOB, data, !success) ;
 
     return success;
 }
 
-int unibone_dati(unsigned addr, unsigned *data) 
- {
+static int unibone_dati_cycle(unsigned addr, unsigned *data) 
+{
     bool success ;
     uint16_t w;
-    unibone_cpu->trigger.probe(addr, QUNIBUS_CYCLE_DATI) ; // register access for trigger system
+    unsigned cpu_addr = addr; // before boot address overlay
 
     the_flexi_timeout_controller->emu_step_ns(UNIBUS_ACCESS_NS);
     if (unibone_cpu->direct_memory.value && addr < qunibus->iopage_start_addr) {
         // boot address redirection by M9312? addrs 24/26 now in M9312 IOpage
         addr |= ddrmem->pmi_address_overlay;
     }
-    if (unibone_cpu->direct_memory.value
+    if (unibone_cpu->prefetch_hit(addr)) {
+        // read ahead by instruction prefetch burst
+        w = unibone_cpu->prefetch_buffer[(addr - unibone_cpu->prefetch_addr) / 2];
+        *data = w;
+        success = true;
+    } else if (unibone_cpu->direct_memory.value
             && (addr < qunibus->iopage_start_addr || qunibusadapter->is_rom(addr))) {
         // Direct access Non-IOPage memory, or to emulated ROM
         ddrmem->pmi_exam(addr, &w);
@@ -198,13 +221,231 @@ int unibone_dati(unsigned addr, unsigned *data)
         //printf("DATI; ba=%o, data=%o, success=%u\n", addr, *data, (int)success) ;
     }
 
+    unibone_trigger_probe(cpu_addr, QUNIBUS_CYCLE_DATI, *data) ; // trigger may compare data read
+
     // trace bus access
     if (unibone_cpu->cycle_trace_buffer.active)
-        unibone_cpu->cycle_trace_buffer.add(qunibus_cycle_trace_entry_c(unibone_cpu->cycle_trace_entry_id++, addr >= qunibus->iopage_start_addr, addr, QUNIBUS_CYCLE_DATI, *data, !success)) ;
+        unibone_cpu->cycle_trace_buffer.add(addr >= qunibus->iopage_start_addr, addr, QUNIBUS_CYCLE_DATI, *data, !success) ;
 
     return success;
 }
 
+// memory page, "pmi": no trigger, no trace, no IO page, no boot address overlay
+static int unibone_dato_memory(unsigned addr, unsigned data) 
+{
+    the_flexi_timeout_controller->emu_step_ns(UNIBUS_ACCESS_NS);
+    if (unibone_cpu->code_line_cached(addr))
+        unibone_cpu->block_cache_flush(); // self modifying code
+    unibone_cpu->page_table[addr >> CPU_PAGE_SHIFT].words[(addr & CPU_PAGE_MASK) / 2] = data;
+    return 1;
+}
+
+static int unibone_datob_memory(unsigned addr, unsigned data) 
+{
+    the_flexi_timeout_controller->emu_step_ns(UNIBUS_ACCESS_NS);
+    if (unibone_cpu->code_line_cached(addr))
+        unibone_cpu->block_cache_flush();
+    uint8_t *bytes = (uint8_t *)unibone_cpu->page_table[addr >> CPU_PAGE_SHIFT].words;
+    // odd addr: bits <8:15>. little endian, like read-modify-write in unibone_datob_cycle()
+    bytes[addr & CPU_PAGE_MASK] = (addr & 1) ? (data >> 8) : data;
+    return 1;
+}
+
+static int unibone_dati_memory(unsigned addr, unsigned *data) 
+{
+    the_flexi_timeout_controller->emu_step_ns(UNIBUS_ACCESS_NS);
+    *data = unibone_cpu->page_table[addr >> CPU_PAGE_SHIFT].words[(addr & CPU_PAGE_MASK) / 2];
+    return 1;
+}
+
+// dispatch over page table
+int unibone_dato(unsigned addr, unsigned data) 
+{
+    return unibone_cpu->page_table[addr >> CPU_PAGE_SHIFT].dato(addr, data);
+}
+
+int unibone_datob(unsigned addr, unsigned data) 
+{
+    return unibone_cpu->page_table[addr >> CPU_PAGE_SHIFT].datob(addr, data);
+}
+
+int unibone_dati(unsigned addr, unsigned *data) 
+{
+    return unibone_cpu->page_table[addr >> CPU_PAGE_SHIFT].dati(addr, data);
+}
+
+#if CPU_PAGE_SHIFT != TRIGGER_PAGE_SHIFT
+#error "trigger_c::page_probed() needs CPU page size"
+#endif
+
+// Memory pages access DDR RAM directly only, if nothing else is to be done
+// on a bus cycle. Else all pages execute the full cycle.
+// An armed trigger needs full cycles only on pages holding its addresses.
+// Called before each opcode fetch, table changes only on state change.
+void cpu_c::page_table_update(void)
+{
+    bool direct = direct_memory.value
+                  && !cycle_trace_buffer.active
+                  && !ddrmem->pmi_address_overlay ;
+    if (direct == page_table_direct && trigger.generation == page_table_trigger_generation)
+        return;
+    for (unsigned i = 0; i < CPU_PAGE_COUNT; i++) {
+        cpu_page_t *page = &page_table[i];
+        uint32_t addr = i << CPU_PAGE_SHIFT;
+        if (direct && addr + CPU_PAGE_MASK < qunibus->iopage_start_addr
+                && !trigger.page_probed(addr)) {
+            page->dati = unibone_dati_memory;
+            page->dato = unibone_dato_memory;
+            page->datob = unibone_datob_memory;
+            page->words = (uint16_t *)&ddrmem->base_virtual->memory.words[addr / 2];
+        } else {
+            page->dati = unibone_dati_cycle;
+            page->dato = unibone_dato_cycle;
+            page->datob = unibone_datob_cycle;
+            page->words = NULL;
+        }
+    }
+    prefetch_wordcount = 0;
+    page_table_direct = direct;
+    page_table_trigger_generation = trigger.generation;
+    block_cache_flush(); // memory may have been changed meanwhile, blocks only from direct pages
+}
+
+// opcode fetch served by block cache: only time of bus cycle.
+// Result: 0 = device DMA since cache flush, predecoded opcode may be outdated
+int unibone_istream_cached(void)
+{
+    if (unibone_cpu->block_dma_write_count != qunibusadapter->device_dma_write_count)
+        return 0;
+    the_flexi_timeout_controller->emu_step_ns(UNIBUS_ACCESS_NS);
+    return 1;
+}
+
+// invalidate all blocks, end the executing one
+void cpu_c::block_cache_flush(void)
+{
+    block_flush_count++;
+    block_dma_write_count = qunibusadapter->device_dma_write_count;
+    memset(code_lines, 0, sizeof(code_lines));
+    ka11.block_abort = 1;
+}
+
+// block starting at PC, predecode if not cached.
+// Block ends before a page without direct memory access,
+// after an opcode changing PC, PSW priority or CPU state.
+// NULL: PC not in memory page
+cpu_block_t *cpu_c::block_lookup(uint16_t addr)
+{
+    if (addr & 1)
+        return NULL; // fetch runs into bus error
+    if (block_dma_write_count != qunibusadapter->device_dma_write_count)
+        block_cache_flush(); // devices may have loaded new code
+    cpu_block_t *block = &block_cache[(addr >> 1) & (CPU_BLOCK_CACHE_SIZE - 1)];
+    if (block->flush_count == block_flush_count && block->pc[0] == addr)
+        return block;
+
+    unsigned n = 0;
+    while (n < CPU_BLOCK_MAX_OPCODES) {
+        uint16_t *words = page_table[addr >> CPU_PAGE_SHIFT].words;
+        if (words == NULL)
+            break;
+        uint16_t ir = words[(addr & CPU_PAGE_MASK) / 2];
+        block->pc[n] = addr;
+        block->ir[n] = ir;
+        n++;
+        code_lines[addr >> (CPU_CODE_LINE_SHIFT + 5)] |= 1U << ((addr >> CPU_CODE_LINE_SHIFT) & 31);
+        unsigned len = ka11_oplength(ir);
+        if (len == 0)
+            break;
+        addr += 2 * len;
+    }
+    if (n == 0)
+        return NULL;
+    block->count = n;
+    block->flush_count = block_flush_count;
+    return block;
+}
+
+// CPU bus cycle bursts.
+// Consecutive bus cycles known in advance are executed by the PRU as one
+// multi word DMA with CPU flag set: one mailbox round trip instead of many.
+// - trap/interrupt vector fetch, RTI pop
+// - instruction prefetch ahead of PC, see "prefetch" parameter
+// Only for memory below the IO page: register access may have side effects.
+// Bus cycles are accounted (trigger, trace, emulated time) when used by the CPU.
+
+// can the range be done as burst over the bus?
+static bool unibone_burst_possible(unsigned addr, unsigned wordcount)
+{
+    if (addr & 1)
+        return false;
+    if (wordcount < 2 || wordcount > PRU_MAX_DMA_WORDCOUNT)
+        return false;
+    if (addr + 2 * wordcount > qunibus->iopage_start_addr)
+        return false;
+    if (unibone_cpu->direct_memory.value)
+        return false; // PMI: memory not accessed over bus
+#if defined(UNIBUS)
+    if (qunibus->is_address_overlay_active())
+        return false; // M9312 boot vector redirection
+#endif
+    return true;
+}
+
+// trigger, time and trace for one bus cycle of a burst
+static void unibone_burst_cycle_account(unsigned addr, uint8_t cycle, uint16_t data)
+{
+    unibone_trigger_probe(addr, cycle, data) ;
+    the_flexi_timeout_controller->emu_step_ns(UNIBUS_ACCESS_NS);
+    if (unibone_cpu->cycle_trace_buffer.active)
+        unibone_cpu->cycle_trace_buffer.add(false, addr, cycle, data, false) ;
+}
+
+// wordcount DATI cycles from addr on
+// Result: 1 = OK, 0 = not possible or bus timeout:
+// then caller must do single cycles.
+int unibone_dati_burst(unsigned addr, unsigned wordcount, uint16_t *buffer)
+{
+    if (!unibone_burst_possible(addr, wordcount))
+        return 0;
+    if (unibone_cpu->prefetch_hit(addr) && unibone_cpu->prefetch_hit(addr + 2 * wordcount - 2))
+        memcpy(buffer, &unibone_cpu->prefetch_buffer[(addr - unibone_cpu->prefetch_addr) / 2], 2 * wordcount);
+    else {
+        qunibusadapter->cpu_DATA_transfer(unibone_cpu->data_transfer_request,
+                                          QUNIBUS_CYCLE_DATI, addr, buffer, wordcount);
+        if (!unibone_cpu->data_transfer_request.success)
+            return 0;
+    }
+    for (unsigned i = 0; i < wordcount; i++)
+        unibone_burst_cycle_account(addr + 2 * i, QUNIBUS_CYCLE_DATI, buffer[i]);
+    return 1;
+}
+
+// called before opcode fetch from addr:
+// if not in prefetch window, read the next "prefetch" words as one burst.
+// The following unibone_dati() calls are served from the window.
+void unibone_prefetch(unsigned addr)
+{
+    unsigned wordcount = unibone_cpu->prefetch_words.value;
+    if (wordcount < 2 || unibone_cpu->prefetch_hit(addr))
+        return;
+    // window ends before IO page
+    if (addr < qunibus->iopage_start_addr && addr + 2 * wordcount > qunibus->iopage_start_addr)
+        wordcount = (qunibus->iopage_start_addr - addr) / 2;
+    if (!unibone_burst_possible(addr, wordcount))
+        return;
+    unibone_cpu->prefetch_wordcount = 0; // invalid while loading
+    // device DMA completing after here invalidates
+    uint32_t dma_write_count = qunibusadapter->device_dma_write_count;
+    qunibusadapter->cpu_DATA_transfer(unibone_cpu->data_transfer_request,
+                                      QUNIBUS_CYCLE_DATI, addr, unibone_cpu->prefetch_buffer, wordcount);
+    if (!unibone_cpu->data_transfer_request.success)
+        return; // bus timeout inside window: single cycles
+    unibone_cpu->prefetch_addr = addr;
+    unibone_cpu->prefetch_wordcount = wordcount;
+    unibone_cpu->prefetch_dma_write_count = dma_write_count;
+}
+
 // CPU has changed the arbitration level, just forward
 // if this is called as result of INTR fector PC and PSW fetch,
 // mailbox->arbitrator.cpu_priority_level was CPU_PRIORITY_LEVEL_FETCHING
@@ -255,6 +496,16 @@ cpu_c::cpu_c() :
     continue_switch.value = false;
     direct_memory.value = false;
     emulation_speed.value = 0.1 ; // non-PMI speed,  see on_param_changed() also
+    prefetch_words.value = 0;
+    prefetch_wordcount = 0;
+
+    // all pages full bus cycles
+    page_table_direct = true;
+    page_table_update();
+    memset(block_cache, 0, sizeof(block_cache));
+    memset(code_lines, 0, sizeof(code_lines));
+    block_flush_count = 1;
+    block_dma_write_count = 0;
 
 
     // current CPU does not publish registers to the bus
@@ -265,6 +516,7 @@ cpu_c::cpu_c() :
     memset(&bus, 0, sizeof(bus));
     memset(&ka11, 0, sizeof(ka11));
     ka11.bus = &bus;
+    ka11_init(&ka11); // opcode decode table
 
     // link to global instance ptr
     assert(unibone_cpu == NULL);// only one possible
@@ -306,17 +558,51 @@ bool cpu_c::on_param_changed(parameter_c *param)
         // speed feedback, as measured
         // see cpu_c() also
         emulation_speed.value = direct_memory.new_value ? 0.5 : 0.1 ;
+    } else if (param == &prefetch_words) {
+        if (prefetch_words.new_value > CPU_PREFETCH_MAX_WORDS) {
+            ERROR("prefetch max %d words", CPU_PREFETCH_MAX_WORDS);
+            return false;
+        }
+        prefetch_wordcount = 0;
     } else if (param == &cycle_tracefilepath) {
 	    cycle_trace_buffer.active = ! cycle_tracefilepath.new_value.empty() ;
+    } else if (param == &trigger_program || param == &trigger_post_cycles) {
+        // worker probes the tables while running
+        if (runmode.value) {
+            ERROR("Trigger can only be changed while CPU is halted");
+            return false;
+        }
+        if (param == &trigger_program) {
+            std::string error;
+            if (!trigger.parse(trigger_program.new_value, &error)) {
+                ERROR("%s", error.c_str());
+                return false;
+            }
+        } else
+            trigger.post_trigger_cycles = trigger_post_cycles.new_value;
     }
     return qunibusdevice_c::on_param_changed(param); // more actions (for enable)
 }
 
+// is word addr in instruction prefetch window, and window still valid?
+bool cpu_c::prefetch_hit(uint32_t addr)
+{
+    return prefetch_wordcount && (addr - prefetch_addr) < 2 * prefetch_wordcount
+           && prefetch_dma_write_count == qunibusadapter->device_dma_write_count;
+}
+
+// CPU writes word addr: invalidate window, if inside
+void cpu_c::prefetch_invalidate(uint32_t addr)
+{
+    if ((addr - prefetch_addr) < 2 * prefetch_wordcount)
+        prefetch_wordcount = 0;
+}
+
 // start CPU logic on PRU and switch arbitration mode
 void cpu_c::start() 
 {
+    trigger.reset() ; // conditions from "trigger" param, probe from first
 // stop on an ZRXB test before error output starts, to watch CPU trace
-    trigger.conditions_clear() ;
     /* Earlier use cases left as example: *
     trigger.condition_add(trigger_condition_c(0777170, TRIGGER_DATO)) ; // ZRXF, start test by write into RXCS
     trigger.condition_add(trigger_condition_c(0003576, TRIGGER_DATI)) ; // ZRXA, SEEKER
@@ -339,6 +625,10 @@ void cpu_c::start()
 #endif
 
     runmode.value = true;
+    prefetch_wordcount = 0; // memory may have been changed while HALTed
+    block_cache_flush();
+    if (cycle_trace_buffer.active && cycle_tracestream.value)
+        cycle_trace_buffer.stream_open(cycle_tracefilepath.value) ; // file per run
     mailbox->param = 1;
     mailbox_execute(ARM2PRU_CPU_ENABLE);
     qunibus->set_arbitrator_active(true);
@@ -387,7 +677,9 @@ void cpu_c::stop(const char * info, int show_options)
 		ka11_printstate(&ka11) ;
 		ka11_tracestate(&ka11) ; // DEBUG_FAST log
 	}
-	if ((show_options & show_cycletrace) && !cycle_tracefilepath.value.empty()) {
+	if (cycle_trace_buffer.is_streaming())
+		cycle_trace_buffer.stream_close() ; // always complete the file
+	else if ((show_options & show_cycletrace) && !cycle_tracefilepath.value.empty()) {
 		cycle_trace_buffer.dump(cycle_tracefilepath.value) ;
 	}
 	
@@ -414,6 +706,12 @@ void cpu_c::worker(unsigned instance)
 
     timeout.wait_us(1);
 
+    // benchmark: opcodes per second
+    timeout_c ips_timeout;
+    uint64_t ips_cycle_count = 0;
+    unsigned ips_loop_count = 0;
+    ips_timeout.start_ms(1000);
+
     while (!workers_terminate) {
         // speed control is difficult, force to use more ARM cycles
 //			if (runmode.value != (ka11.state != 0))
@@ -447,8 +745,17 @@ void cpu_c::worker(unsigned instance)
         start_switch.value = false; // momentary action
 
         int prev_ka11_state = ka11.state;
+        page_table_update(); // pmi, trigger or trace changed?
         // ARM_DEBUG_PIN(0,1) ; // measure pmi gain
-        ka11_condstep(&ka11);
+        // straight line code as one block: panel and trigger checks once per block
+        unsigned opcode_count = 1;
+        cpu_block_t *block = NULL;
+        if (page_table_direct && !breakpoint.value && ka11.state == KA11_STATE_RUNNING)
+            block = block_lookup(ka11.r[7]);
+        if (block)
+            opcode_count = ka11_blockstep(&ka11, block->ir, block->pc, block->count);
+        else
+            ka11_condstep(&ka11);
         // ARM_DEBUG_PIN(0,0) ;
         if (ka11.state != KA11_STATE_HALTED && trigger.has_triggered()) {
             stop("Halted by trigger conditions:", show_pc+show_trigger+show_state+show_cycletrace);
@@ -460,13 +767,23 @@ void cpu_c::worker(unsigned instance)
         }
         // running CPU: produce emulated time for all devices
         if (ka11.state == KA11_STATE_RUNNING) {
-            cycle_count.value++;
+            cycle_count.value += opcode_count;
         } else if (ka11.state == KA11_STATE_WAITING)
             // we should us "world" time here, but want to avoid permanent time-source switching
             // so just assume this here is called every 500ns (estimated average worker loop time)
             the_flexi_timeout_controller->emu_step_ns(500);
         // if KA11_STATE_HALTED: world time is used, see start() / stop()
 
+        // time only every 1024 loops, clock_gettime() is not for free
+        if ((++ips_loop_count & 0x3ff) == 0 && ips_timeout.reached()) {
+            if (cycle_count.value < ips_cycle_count)
+                ips_cycle_count = 0; // restarted
+            instructions_per_second.value = (cycle_count.value - ips_cycle_count) * 1000000000ULL
+                                            / ips_timeout.elapsed_ns();
+            ips_cycle_count = cycle_count.value;
+            ips_timeout.start_ms(1000);
+        }
+
         // serialize asynchronous power events
         // ACLO inactive & no HALT: reboot
         // ACLO inactive & HALT: boot on CONT
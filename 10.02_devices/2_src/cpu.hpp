@@ -21,6 +21,11 @@
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
+ 16-oct-2026  QC      trigger program as parameter, compiled trigger
+ 16-oct-2026  QC      binary cycle trace, stream mode
+ 16-oct-2026  QC      basic block cache
+ 16-oct-2026  QC      page table for CPU memory access
+ 16-oct-2026  QC      CPU bus cycle bursts, instruction prefetch
  23-nov-2018  JH      created
  */
 #ifndef _CPU_HPP_
@@ -28,86 +33,50 @@
 
 #include "utils.hpp"
 #include "timeout.hpp"
+#include "qunibus.h"
 //#include "qunibusadapter.hpp"
 //#include "qunibusdevice.hpp"
 #include "unibuscpu.hpp"
 #include "qunibus_tracer.hpp"
-#include "ringbuffer.hpp"
+#include "cpu_cycletrace.hpp"
 #include "cpu20/11.h"
 #include "cpu20/ka11.h"
 
-// on etraces QUNIBUS access
-class qunibus_cycle_trace_entry_c {
-public:
-    uint64_t	id ;
-    uint64_t	timestamp_ns ;
-    bool iopage ;
-    unsigned address ;
-    uint8_t	cycle ; // DTAI
-    uint16_t	data ;
-    bool nxm ; // timeout, not existing memory
-    qunibus_cycle_trace_entry_c() { }
-    qunibus_cycle_trace_entry_c(uint64_t _id, bool _iopage, unsigned _address, uint8_t _cycle, uint16_t _data, bool _nxm) {
-        id = _id ;
-        this->timestamp_ns = timeout_c::abstime_ns() ;
-        iopage = _iopage ;
-        address = _address ;
-        cycle = _cycle ;
-        data = _data ;
-        nxm = _nxm ;
-    }
-} ;
-
-#include <fstream>
-#include <sys/time.h>
-
-#define qunibus_cycle_trace_buffer_size 16384
-//#define qunibus_cycle_trace_buffer_size 4096
-class qunibus_cycle_trace_buffer_c: public jnk0le::Ringbuffer<qunibus_cycle_trace_entry_c, qunibus_cycle_trace_buffer_size, false, 8> {
-public:
-    bool active = false ;
-    // my insert() erases oldest entry
-    void add(qunibus_cycle_trace_entry_c qcte) {
-        if (isFull()) remove(100) ; // remove a large chunk, to speed up.
-        assert( insert(qcte)) ;
-    }
-
-    // readout non-destructive. to clear, use "clearConsumer()"
-    void dump(std::ostream *stream) 
-    {
-        qunibus_cycle_trace_entry_c *cte ;
-        char buffer[256] ;
-        timeval now ;
-        gettimeofday(&now, NULL);
-        strftime(buffer, 26, "%F %T", localtime(&now.tv_sec));
-        *stream << "// Sampled QUNIBUS cycles, saved at " << buffer << "\n";
-        *stream << "id, timestamp, iopage, address, cycle, data, nxm\n" ;
-        for (unsigned i=0 ; i < readAvailable() ; i++) {
-            cte = at(i) ;
-//        while (remove(cte)) {
-            sprintf(buffer, "%llu, %llu, %d, %06o, %s, %06o, %d",
-                    cte->id, cte->timestamp_ns, cte->iopage, cte->address, qunibus_c::control2text(cte->cycle), cte->data, cte->nxm) ;
-            *stream << buffer << "\n";
-        }
-    }
-
-
-    void dump(std::string filepath) 
-    {
-        std::ofstream file_stream;
-        file_stream.open(filepath, std::ofstream::out | std::ofstream::trunc);
-        if (!file_stream.is_open()) {
-            std::cout << "Can not open log file \"" << filepath << "\"! Aborting!\n";
-            exit(2);
-        }
-        size_t fill = readAvailable() ;
-        dump(&file_stream);
-
-        file_stream.close();
-        std::cout << "Dumped " << fill << " messages to file \"" << filepath << "\".\n";
-    }
-} ;
-
+// max size of instruction prefetch window
+#define CPU_PREFETCH_MAX_WORDS	64
+
+// CPU bus cycles are dispatched over a table of 8KB pages.
+// With "pmi", memory pages access DDR RAM directly,
+// the IO page, pages with trigger addresses and all pages while
+// cycle trace is active execute the full bus cycle.
+#define CPU_PAGE_SHIFT	13
+#define CPU_PAGE_MASK	((1 << CPU_PAGE_SHIFT) - 1)
+#define CPU_PAGE_COUNT	((2 * QUNIBUS_MAX_WORDCOUNT) >> CPU_PAGE_SHIFT)
+
+typedef struct {
+    int (*dati)(unsigned addr, unsigned *data) ;
+    int (*dato)(unsigned addr, unsigned data) ;
+    int (*datob)(unsigned addr, unsigned data) ;
+    uint16_t *words ; // page in DDR RAM, if direct memory access
+} cpu_page_t ;
+
+// Basic block cache: straight line opcodes predecoded from DDR RAM,
+// executed as one step of the worker loop.
+// Only with direct memory page access, no breakpoint.
+// CPU writes into 64 byte lines holding cached opcodes and device DMA
+// flush the cache. Device DMA is checked before each opcode, so a block
+// ends when DMA completes while it runs. Not if physical devices DMA into code!
+#define CPU_BLOCK_MAX_OPCODES	32
+#define CPU_BLOCK_CACHE_SIZE	1024	// direct mapped by start address
+#define CPU_CODE_LINE_SHIFT	6
+#define CPU_CODE_LINE_WORDS	((0x10000 >> CPU_CODE_LINE_SHIFT) / 32) // bitmap of 16 bit PC space
+
+typedef struct {
+    uint32_t flush_count ; // valid if == cpu_c::block_flush_count
+    unsigned count ;
+    uint16_t pc[CPU_BLOCK_MAX_OPCODES] ; // address of each opcode
+    uint16_t ir[CPU_BLOCK_MAX_OPCODES] ;
+} cpu_block_t ;
 
 class cpu_c: public unibuscpu_c {
 private:
@@ -149,6 +118,9 @@ public:
     parameter_bool_c swab_vbit = parameter_bool_c(this, "swab_vbit", "swab",/*readonly*/
                                  false, "SWAB instruction does not(=0) or does(=1) modify psw v-bit (=0 is standard 11/20 behavior)");
 
+    parameter_unsigned_c prefetch_words = parameter_unsigned_c(this, "prefetch", "pf",/*readonly*/
+                                          false, "", "%d", "Words read ahead of PC as one bus burst. 0 = off. Not if physical devices DMA into code!", 16, 10);
+
     parameter_unsigned_c pc = parameter_unsigned_c(this, "PC", "pc",/*readonly*/
                               false, "", "%06o", "program counter helper register.", 16, 8);
 
@@ -158,12 +130,52 @@ public:
     parameter_unsigned64_c cycle_count = parameter_unsigned64_c(this, "cycle_count", "cc",/*readonly*/
                                          true, "", "%u", "CPU opcodes executed since last HALT", 63, 10);
 
+    parameter_unsigned_c instructions_per_second = parameter_unsigned_c(this, "instructions_per_second", "ips",/*readonly*/
+            true, "", "%u", "Benchmark: CPU opcodes executed per second, measured every second", 32, 10);
+
     parameter_unsigned_c breakpoint = parameter_unsigned_c(this, "breakpoint", "bp",/*readonly*/
                                       false, "", "%06o", "Stop when CPU fetches opcode from octal address. 0 = disable", 16, 8);
 
     parameter_string_c cycle_tracefilepath = parameter_string_c(this, "cycle_tracefilepath", "ctf",/*readonly*/false,
-            "If set, CPU cycle trace is active and dumped to file on HALT.") ;
-
+            "If set, CPU cycle trace is active and dumped to binary file on HALT.") ;
+
+    parameter_bool_c cycle_tracestream = parameter_bool_c(this, "cycle_tracestream", "cts",/*readonly*/
+                                         false, "Cycle trace: 0 = save last cycles on HALT, 1 = stream all cycles into file while running. "
+                                         "ARMv7 timestamps from PMU cycle counter, if kernel enabled user access, "
+                                         "else clock_gettime(): about 1 us per bus cycle.") ;
+
+    parameter_string_c trigger_program = parameter_string_c(this, "trigger", "trg",/*readonly*/false,
+            "HALT after sequence of bus cycles: <addr>[-<addr>][:iob][=<data>[/<mask>]][*<count>],... octal") ;
+
+    parameter_unsigned_c trigger_post_cycles = parameter_unsigned_c(this, "trigger_post", "trgp",/*readonly*/
+            false, "", "%u", "Trigger: bus cycles executed after last condition before HALT", 32, 10);
+
+
+    // instruction prefetch window, filled by bus burst on opcode fetch.
+    // Invalid after DATO by CPU or device DMA into it.
+    uint16_t prefetch_buffer[CPU_PREFETCH_MAX_WORDS];
+    uint32_t prefetch_addr; // bus address of prefetch_buffer[0]
+    unsigned prefetch_wordcount; // 0 = invalid
+    uint32_t prefetch_dma_write_count; // qunibusadapter->device_dma_write_count at fill
+    bool prefetch_hit(uint32_t addr) ;
+    void prefetch_invalidate(uint32_t addr) ;
+
+    // bus cycle handlers per 8KB page
+    cpu_page_t page_table[CPU_PAGE_COUNT] ;
+    bool page_table_direct ; // memory pages access DDR RAM
+    unsigned page_table_trigger_generation ; // trigger.generation at update
+    void page_table_update(void) ;
+
+    cpu_block_t block_cache[CPU_BLOCK_CACHE_SIZE] ;
+    uint32_t block_flush_count ;
+    uint32_t block_dma_write_count ; // qunibusadapter->device_dma_write_count at flush
+    uint32_t code_lines[CPU_CODE_LINE_WORDS] ; // bitmap: line holds cached opcode
+    cpu_block_t *block_lookup(uint16_t addr) ;
+    void block_cache_flush(void) ;
+    bool code_line_cached(uint32_t addr) {
+        return addr < 0x10000
+               && (code_lines[addr >> (CPU_CODE_LINE_SHIFT + 5)] & (1U << ((addr >> CPU_CODE_LINE_SHIFT) & 31))) ;
+    }
 
     struct Bus bus; // UNIBUS interface of CPU
     struct KA11 ka11; // Angelos CPU state
@@ -185,9 +197,7 @@ public:
     tracer_c	tracer ;
 
     // ring buffer for bus DATI/DATO accesses
-    // need to set cachelinesize, 0 causes error. 8?
-    uint64_t cycle_trace_entry_id = 0 ; // enumerate samples
-    qunibus_cycle_trace_buffer_c cycle_trace_buffer;
+    cycletrace_buffer_c cycle_trace_buffer;
 
 
 };
@@ -60,6 +60,11 @@ struct Bus
 	Busdev *devs;
 	uint32 addr;
 	word data;
+	/* svc() polls the Busdevs only if set. Set by ka11_init(), ka11_reset()
+	   and when the CPU takes a BR grant. Busdevs do not set it: a device
+	   raising BR from its own svc() (kl11, kw11 poll host time) must set it
+	   itself, else it is not polled. No Busdevs are linked in UniBone. */
+	volatile int svc_request;
 };
 int dati_bus(Bus *bus);
 int dato_bus(Bus *bus);
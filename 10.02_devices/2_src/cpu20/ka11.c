@@ -4,9 +4,12 @@
 #include "gpios.hpp" // ARM_DEBUG_PIN*
 
 void unibone_grant_interrupts(void) ;
+int unibone_istream_cached(void) ;
 int unibone_dato(unsigned addr, unsigned data);
 int unibone_datob(unsigned addr, unsigned data);
 int unibone_dati(unsigned addr, unsigned *data);
+int unibone_dati_burst(unsigned addr, unsigned wordcount, uint16_t *buffer);
+void unibone_prefetch(unsigned addr);
 void unibone_prioritylevelchange(uint8_t level);
 void unibone_bus_init() ;
 
@@ -121,8 +124,8 @@ ka11_reset(KA11 *cpu)
 	Busdev *bd;
 
 	cpu->traps = 0;
-	cpu->external_intr = 0;
-	cpu->mutex = PTHREAD_MUTEX_INITIALIZER ;
+	__atomic_store_n(&cpu->external_intr, 0, __ATOMIC_RELAXED);
+	cpu->bus->svc_request = 1;
 
 	for(bd = cpu->bus->devs; bd; bd = bd->next)
 		bd->reset(bd->dev);
@@ -186,6 +189,7 @@ trace("%s [%06o] <= %06o\n", b? "DATOB":"DATO", cpu->ba, cpu->bus->data);
 			   I think this is correct. */
 			cpu->psw = cpu->bus->data;
 			levelchange(cpu->psw);
+			cpu->block_abort = 1;	// grant again with new level
 			goto ok;
 		case 0377:
 		    goto be;
@@ -209,6 +213,58 @@ be:
 	return 1;
 }
 
+/* opcode fetch: bus may read ahead the following words */
+static int
+dati_istream(KA11 *cpu)
+{
+	unibone_prefetch(ubxt(cpu->ba));
+	return dati(cpu, 0);
+}
+
+/* Vector and stack DATI cycles of traps and RTI as bus bursts.
+   Result 0: done. 1: burst not possible or bus error, CPU state unchanged,
+   caller executes the single cycles.
+   Trap pushes are no burst: the KA11 writes PSW before PC, at descending
+   addresses, but bursts are ascending. */
+
+/* fetch new PC and PSW from vector with one 2 word DATI */
+static int
+vector_burst(KA11 *cpu, word vec)
+{
+	word w[2];
+	if(!unibone_dati_burst(ubxt(vec), 2, w))
+		return 1;
+	if (unibone_trace_addr(vec)){
+		trace("DATI [%06o] => %06o\n", vec, w[0]);
+		trace("DATI [%06o] => %06o\n", (word)(vec+2), w[1]);
+	}
+	cpu->r[7] = w[0];
+	cpu->psw = w[1];
+	cpu->ba = vec+2;
+	cpu->be = 0;
+	return 0;
+}
+
+/* RTI: pop PC and PSW with one 2 word DATI */
+static int
+pop_burst(KA11 *cpu)
+{
+	word w[2];
+	word sp = cpu->r[6];
+	if(!unibone_dati_burst(ubxt(sp), 2, w))
+		return 1;
+	if (unibone_trace_addr(sp)){
+		trace("DATI [%06o] => %06o\n", sp, w[0]);
+		trace("DATI [%06o] => %06o\n", (word)(sp+2), w[1]);
+	}
+	cpu->r[7] = w[0];
+	cpu->psw = w[1];
+	cpu->r[6] = sp + 4;
+	cpu->ba = sp + 2;
+	cpu->be = 0;
+	return 0;
+}
+
 static void
 svc(KA11 *cpu, Bus *bus)
 {
@@ -316,6 +372,115 @@ setnz(KA11 *cpu, word w)
 	if(w == 0) cpu->psw |= PSW_Z;
 }
 
+/* Instruction classes, decoded once per opcode into optab[].
+   Binary ops have an extra class for "both operands are registers". */
+enum {
+	OP_RI = 0,
+	OP_MOV, OP_MOV_RR, OP_CMP, OP_CMP_RR, OP_BIT, OP_BIT_RR,
+	OP_BIC, OP_BIC_RR, OP_BIS, OP_BIS_RR, OP_ADD, OP_ADD_RR, OP_SUB, OP_SUB_RR,
+	OP_CLR, OP_COM, OP_INC, OP_DEC, OP_NEG, OP_ADC, OP_SBC, OP_TST,
+	OP_ROR, OP_ROL, OP_ASR, OP_ASL,
+	OP_JSR, OP_EMT, OP_TRAP,
+	OP_BR, OP_BNE, OP_BEQ, OP_BGE, OP_BLT, OP_BGT, OP_BLE,
+	OP_BPL, OP_BMI, OP_BHI, OP_BLOS, OP_BVC, OP_BVS, OP_BCC, OP_BCS,
+	OP_JMP, OP_RTS, OP_CCC, OP_SEC, OP_SWAB,
+	OP_HALT, OP_WAIT, OP_RTI, OP_BPT, OP_IOT, OP_RESET
+};
+
+static byte optab[0200000];
+
+/* same order of mask tests as the original switch cascade */
+static byte
+decode(word ir)
+{
+	int rr = (ir & 07070) == 0;	// source and destination mode 0
+
+	switch(ir & 0170000){
+	case 0110000: case 0010000:	return rr ? OP_MOV_RR : OP_MOV;
+	case 0120000: case 0020000:	return rr ? OP_CMP_RR : OP_CMP;
+	case 0130000: case 0030000:	return rr ? OP_BIT_RR : OP_BIT;
+	case 0140000: case 0040000:	return rr ? OP_BIC_RR : OP_BIC;
+	case 0150000: case 0050000:	return rr ? OP_BIS_RR : OP_BIS;
+	case 0060000:			return rr ? OP_ADD_RR : OP_ADD;
+	case 0160000:			return rr ? OP_SUB_RR : OP_SUB;
+	case 0170000: case 0070000:	return OP_RI;
+	}
+
+	switch(ir & 0007700){
+	case 0005000:	return OP_CLR;
+	case 0005100:	return OP_COM;
+	case 0005200:	return OP_INC;
+	case 0005300:	return OP_DEC;
+	case 0005400:	return OP_NEG;
+	case 0005500:	return OP_ADC;
+	case 0005600:	return OP_SBC;
+	case 0005700:	return OP_TST;
+	case 0006000:	return OP_ROR;
+	case 0006100:	return OP_ROL;
+	case 0006200:	return OP_ASR;
+	case 0006300:	return OP_ASL;
+	case 0006400: case 0006500: case 0006600: case 0006700:
+		return OP_RI;
+	}
+
+	switch(ir & 0107400){
+	case 0004000: case 0004400:	return OP_JSR;
+	case 0104000:	return OP_EMT;
+	case 0104400:	return OP_TRAP;
+	}
+
+	if((ir & 074000) == 0 && (ir & 0103400) != 0)
+		switch(ir & 0103400){
+		case 0000400:	return OP_BR;
+		case 0001000:	return OP_BNE;
+		case 0001400:	return OP_BEQ;
+		case 0002000:	return OP_BGE;
+		case 0002400:	return OP_BLT;
+		case 0003000:	return OP_BGT;
+		case 0003400:	return OP_BLE;
+		case 0100000:	return OP_BPL;
+		case 0100400:	return OP_BMI;
+		case 0101000:	return OP_BHI;
+		case 0101400:	return OP_BLOS;
+		case 0102000:	return OP_BVC;
+		case 0102400:	return OP_BVS;
+		case 0103000:	return OP_BCC;
+		case 0103400:	return OP_BCS;
+		}
+
+	switch(ir & 0777300){
+	case 0100:	return OP_JMP;
+	case 0200:
+		switch(ir&070){
+		case 000:	return OP_RTS;
+		case 040: case 050:	return OP_CCC;
+		case 060: case 070:	return OP_SEC;
+		}
+		return OP_RI;
+	case 0300:	return OP_SWAB;
+	}
+
+	switch(ir){
+	case 0:	return OP_HALT;
+	case 1:	return OP_WAIT;
+	case 2:	return OP_RTI;
+	case 3:	return OP_BPT;
+	case 4:	return OP_IOT;
+	case 5:	return OP_RESET;
+	}
+	return OP_RI;
+}
+
+// once, before first step()
+void
+ka11_init(KA11 *cpu)
+{
+	uint32 ir;
+	for(ir = 0; ir < 0200000; ir++)
+		optab[ir] = decode(ir);
+	cpu->bus->svc_request = 1;
+}
+
 void
 step(KA11 *cpu)
 {
@@ -346,7 +511,10 @@ step(KA11 *cpu)
 #define RD_U	if(dm != 0) if(readop(cpu, 011, dst, by)) goto be;\
 		if(dm == 0) fetchop(cpu, 011, dst, by);\
 		SR = DR
+#define RD_RR	SR = cpu->r[sf]; DR = cpu->r[df];\
+		if(by) SR = sxt(SR), DR = sxt(DR)
 #define WR	if(writedest(cpu, b, by)) goto be
+#define WR_R	if(by) SETMASK(cpu->r[df], b, 0377); else cpu->r[df] = b
 #define NZ	setnz(cpu, b)
 #define SVC	goto service
 #define TRAP(v)	TV = v; goto trap
@@ -375,23 +543,26 @@ step(KA11 *cpu)
 
 	inhov = 0;
 
-	{
-		// external interrupt from parallel threads?
-		pthread_mutex_lock(&cpu->mutex) ;
-		bool external_intr = cpu->external_intr ;
-		word external_intrvec = cpu->external_intrvec ;
-		cpu->external_intr = 0 ;
-		pthread_mutex_unlock(&cpu->mutex) ;
+	// external interrupt from parallel threads?
+	// Cheap load first, atomic exchange only if one is pending.
+	if (__atomic_load_n(&cpu->external_intr, __ATOMIC_RELAXED)) {
+		uint32 external_intr = __atomic_exchange_n(&cpu->external_intr, 0, __ATOMIC_ACQUIRE) ;
 		if (external_intr){
 			//ARM_DEBUG_PIN1(0);	// INTR processed
 			cpu->state = KA11_STATE_RUNNING ;
-			TRAP(external_intrvec);
+			TRAP(external_intr & 0xffff);
 		}	
 	}
 
 
 	oldpsw = PSW;
-	INA(PC, cpu->ir);
+	BA = PC;
+	if(cpu->block_ir)
+		cpu->ir = *cpu->block_ir;	// fetch cycle accounted by ka11_blockstep()
+	else{
+		if(dati_istream(cpu)) goto be;
+		cpu->ir = cpu->bus->data;
+	}
 	PC += 2;	/* don't increment on bus error! */
 	by = !!(cpu->ir&B15);
 	br = sxt(cpu->ir)<<1;
@@ -404,170 +575,177 @@ step(KA11 *cpu)
 	if(by)	mask = M8, sign = B7;
 	else	mask = M16, sign = B15;
 
+	switch(optab[cpu->ir]){
+	case OP_RI:	goto ri;
+
 	/* Binary */
-	switch(cpu->ir & 0170000){
-	case 0110000: case 0010000:	TRB(MOV);
+	case OP_MOV:	TRB(MOV);
 		RD_B; CLV;
 		b = SR; NZ;
 		if(dm==0) cpu->r[df] = SR;
 		else writedest(cpu, SR, by);
 		SVC;
-	case 0120000: case 0020000:	TRB(CMP);
+	case OP_MOV_RR:	TRB(MOV);
+		RD_RR; CLV;
+		b = SR; NZ;
+		cpu->r[df] = SR;
+		SVC;
+	case OP_CMP:	TRB(CMP);
 		RD_B; CLCV;
 		b = SR + W(~DR) + 1; NC; BXT;
 		if(sgn((SR ^ DR) & ~(DR ^ b))) SEV;
 		NZ; SVC;
-	case 0130000: case 0030000:	TRB(BIT);
+	case OP_CMP_RR:	TRB(CMP);
+		RD_RR; CLCV;
+		b = SR + W(~DR) + 1; NC; BXT;
+		if(sgn((SR ^ DR) & ~(DR ^ b))) SEV;
+		NZ; SVC;
+	case OP_BIT:	TRB(BIT);
 		RD_B; CLV;
 		b = DR & SR;
 		NZ; SVC;
-	case 0140000: case 0040000:	TRB(BIC);
+	case OP_BIT_RR:	TRB(BIT);
+		RD_RR; CLV;
+		b = DR & SR;
+		NZ; SVC;
+	case OP_BIC:	TRB(BIC);
 		RD_B; CLV;
 		b = DR & ~SR;
 		NZ; WR; SVC;
-	case 0150000: case 0050000:	TRB(BIS);
+	case OP_BIC_RR:	TRB(BIC);
+		RD_RR; CLV;
+		b = DR & ~SR;
+		NZ; WR_R; SVC;
+	case OP_BIS:	TRB(BIS);
 		RD_B; CLV;
 		b = DR | SR;
 		NZ; WR; SVC;
-	case 0060000:			TR(ADD);
+	case OP_BIS_RR:	TRB(BIS);
+		RD_RR; CLV;
+		b = DR | SR;
+		NZ; WR_R; SVC;
+	case OP_ADD:	TR(ADD);
 		by = 0; RD_B; CLCV;
 		b = SR + DR; C;
 		if(sgn(~(SR ^ DR) & (DR ^ b))) SEV;
 		NZ; WR; SVC;
-	case 0160000:			TR(SUB);
+	case OP_ADD_RR:	TR(ADD);
+		by = 0; RD_RR; CLCV;
+		b = SR + DR; C;
+		if(sgn(~(SR ^ DR) & (DR ^ b))) SEV;
+		NZ; WR_R; SVC;
+	case OP_SUB:	TR(SUB);
 		by = 0; RD_B; CLCV;
 		b = DR + W(~SR) + 1; NC;
 		if(sgn((SR ^ DR) & (DR ^ b))) SEV;
 		NZ; WR; SVC;
-
-	/* Reserved instructions */
-	case 0170000: case 0070000: goto ri;
-	}
+	case OP_SUB_RR:	TR(SUB);
+		by = 0; RD_RR; CLCV;
+		b = DR + W(~SR) + 1; NC;
+		if(sgn((SR ^ DR) & (DR ^ b))) SEV;
+		NZ; WR_R; SVC;
 
 	/* Unary */
-	switch(cpu->ir & 0007700){
-	case 0005000:	TRB(CLR);
+	case OP_CLR:	TRB(CLR);
 		RD_U; CLCV;
 		b = 0;
 		NZ; WR; SVC;
-	case 0005100:	TRB(COM);
+	case OP_COM:	TRB(COM);
 		RD_U; CLV; SEC;
 		b = W(~SR);
 		NZ; WR; SVC;
-	case 0005200:	TRB(INC);
+	case OP_INC:	TRB(INC);
 		RD_U; CLV;
 		b = W(SR+1); BXT;
 		if(sgn(~SR&b)) SEV;
 		NZ; WR; SVC;
-	case 0005300:	TRB(DEC);
+	case OP_DEC:	TRB(DEC);
 		RD_U; CLV;
 		b = W(SR+~0); BXT;
 		if(sgn(SR&~b)) SEV;
 		NZ; WR; SVC;
-	case 0005400:	TRB(NEG);
+	case OP_NEG:	TRB(NEG);
 		RD_U; CLCV;
 		b = W(~SR+1); BXT; if(b) SEC;
 		if(sgn(b&SR)) SEV;
 		NZ; WR; SVC;
-	case 0005500:	TRB(ADC);
+	case OP_ADC:	TRB(ADC);
 		RD_U; c = ISSET(PSW_C); CLCV;
 		b = SR + c; C; BXT;
 		if(sgn(~SR&b)) SEV;
 		NZ; WR; SVC;
-	case 0005600:	TRB(SBC);
+	case OP_SBC:	TRB(SBC);
 		RD_U; c = !ISSET(PSW_C)-1; CLCV;
 		b = W(SR+c); if(c && SR == 0) SEC; BXT;
 		if(sgn(SR&~b)) SEV;
 		NZ; WR; SVC;
-	case 0005700:	TRB(TST);
+	case OP_TST:	TRB(TST);
 		RD_U; CLCV;
 		b = SR;
 		NZ; SVC;
 
-	case 0006000:	TRB(ROR);
+	case OP_ROR:	TRB(ROR);
 		RD_U; c = ISSET(PSW_C); CLCV;
 		b = (SR&mask) >> 1; if(c) b |= sign; if(SR & 1) SEC; BXT;
 		NZ; if((PSW>>3^PSW)&1) SEV;
 		WR; SVC;
-	case 0006100:	TRB(ROL);
+	case OP_ROL:	TRB(ROL);
 		RD_U; c = ISSET(PSW_C); CLCV;
 		b = (SR<<1) & mask; if(c) b |= 1; if(SR & B15) SEC; BXT;
 		NZ; if((PSW>>3^PSW)&1) SEV;
 		WR; SVC;
-	case 0006200:	TRB(ASR);
+	case OP_ASR:	TRB(ASR);
 		RD_U; c = ISSET(PSW_C); CLCV;
 		b = W(SR>>1) | SR&B15; if(SR & 1) SEC; BXT;
 		NZ; if((PSW>>3^PSW)&1) SEV;
 		WR; SVC;
-	case 0006300:	TRB(ASL);
+	case OP_ASL:	TRB(ASL);
 		RD_U; CLCV;
 		b = W(SR<<1); if(SR & B15) SEC; BXT;
 		NZ; if((PSW>>3^PSW)&1) SEV;
 		WR; SVC;
 
-	case 0006400:
-	case 0006500:
-	case 0006600:
-	case 0006700:
-		goto ri;
-
-	}
-
-	switch(cpu->ir & 0107400){
-	case 0004000:
-	case 0004400:	TR(JSR);
+	case OP_JSR:	TR(JSR);
 		if(dm == 0) goto ill;
 		if(addrop(cpu, dst, 0)) goto be;
 		DR = cpu->b;
 		PUSH; OUT(SP, cpu->r[sf]);
 		cpu->r[sf] = PC; PC = DR;
 		SVC;
-	case 0104000:	TR(EMT); TRAP(030);
-	case 0104400:	TR(TRAP); TRAP(034);
-	}
+	case OP_EMT:	TR(EMT); TRAP(030);
+	case OP_TRAP:	TR(TRAP); TRAP(034);
 
 	/* Branches */
-    // ! 000 0!! !xx xxx xxx    (! = at least one is non-zero)
-    if((cpu->ir & 074000) == 0 && (cpu->ir & 0103400) != 0) {
-        switch(cpu->ir & 0103400){
-        case 0000400:	TR(BR); BR; SVC;
-        case 0001000:	TR(BNE); CBR(0x0F0F); SVC;
-        case 0001400:	TR(BEQ); CBR(0xF0F0); SVC;
-        case 0002000:	TR(BGE); CBR(0xCC33); SVC;
-        case 0002400:	TR(BLT); CBR(0x33CC); SVC;
-        case 0003000:	TR(BGT); CBR(0x0C03); SVC;
-        case 0003400:	TR(BLE); CBR(0xF3FC); SVC;
-        case 0100000:	TR(BPL); CBR(0x00FF); SVC;
-        case 0100400:	TR(BMI); CBR(0xFF00); SVC;
-        case 0101000:	TR(BHI); CBR(0x0505); SVC;
-        case 0101400:	TR(BLOS); CBR(0xFAFA); SVC;
-        case 0102000:	TR(BVC); CBR(0x3333); SVC;
-        case 0102400:	TR(BVS); CBR(0xCCCC); SVC;
-        case 0103000:	TR(BCC); CBR(0x5555); SVC;
-        case 0103400:	TR(BCS); CBR(0xAAAA); SVC;
-        }
-    }
+	case OP_BR:	TR(BR); BR; SVC;
+	case OP_BNE:	TR(BNE); CBR(0x0F0F); SVC;
+	case OP_BEQ:	TR(BEQ); CBR(0xF0F0); SVC;
+	case OP_BGE:	TR(BGE); CBR(0xCC33); SVC;
+	case OP_BLT:	TR(BLT); CBR(0x33CC); SVC;
+	case OP_BGT:	TR(BGT); CBR(0x0C03); SVC;
+	case OP_BLE:	TR(BLE); CBR(0xF3FC); SVC;
+	case OP_BPL:	TR(BPL); CBR(0x00FF); SVC;
+	case OP_BMI:	TR(BMI); CBR(0xFF00); SVC;
+	case OP_BHI:	TR(BHI); CBR(0x0505); SVC;
+	case OP_BLOS:	TR(BLOS); CBR(0xFAFA); SVC;
+	case OP_BVC:	TR(BVC); CBR(0x3333); SVC;
+	case OP_BVS:	TR(BVS); CBR(0xCCCC); SVC;
+	case OP_BCC:	TR(BCC); CBR(0x5555); SVC;
+	case OP_BCS:	TR(BCS); CBR(0xAAAA); SVC;
 
 	/* Misc */
-	switch(cpu->ir & 0777300){
-	case 0100:	TR(JMP);
+	case OP_JMP:	TR(JMP);
 		if(dm == 0) goto ill;
 		if(addrop(cpu, dst, 0)) goto be;
 		PC = cpu->b;
 		SVC;
-	case 0200:
-        switch(cpu->ir&070){
-        case 000:	TR(RTS);
-            BA = SP; POP;
-            PC = cpu->r[df];
-            IN(cpu->r[df]);
-            SVC;
-        case 010: case 020: case 030:
-            goto ri;
-        case 040: case 050:	TR(CCC); PSW &= ~(cpu->ir&017); SVC;
-        case 060: case 070:	TR(SEC); PSW |= cpu->ir&017; SVC;
-        }
-	case 0300:	TR(SWAB);
+	case OP_RTS:	TR(RTS);
+		BA = SP; POP;
+		PC = cpu->r[df];
+		IN(cpu->r[df]);
+		SVC;
+	case OP_CCC:	TR(CCC); PSW &= ~(cpu->ir&017); SVC;
+	case OP_SEC:	TR(SEC); PSW |= cpu->ir&017; SVC;
+	case OP_SWAB:	TR(SWAB);
 		RD_U;
 		if(cpu->swab_vbit) {
 		    CLCV;   // v-bit cleared, ZQKC compatible
@@ -577,20 +755,20 @@ step(KA11 *cpu)
 		b = WD(DR & 0377, (DR>>8) & 0377);
 		CLNZ; if(b & B7) SEN; if((b & M8) == 0) SEZ;
 		WR; SVC;
-	}
 
 	/* Operate */
-	switch(cpu->ir){
-	case 0:	TR(HALT); cpu->state = KA11_STATE_HALTED; return;
-	case 1:	TR(WAIT); cpu->state = KA11_STATE_WAITING; return ; // no traps
-	case 2:	TR(RTI);
-		BA = SP; POP; IN(PC);
-		BA = SP; POP; IN(PSW);
+	case OP_HALT:	TR(HALT); cpu->state = KA11_STATE_HALTED; return;
+	case OP_WAIT:	TR(WAIT); cpu->state = KA11_STATE_WAITING; return ; // no traps
+	case OP_RTI:	TR(RTI);
+		if(pop_burst(cpu)){
+			BA = SP; POP; IN(PC);
+			BA = SP; POP; IN(PSW);
+		}
 		levelchange(cpu->psw) ;
 		SVC;
-	case 3:	TR(BPT); TRAP(014);
-	case 4:	TR(IOT); TRAP(020);
-	case 5:	TR(RESET); ka11_reset(cpu); unibone_bus_init() ; SVC;
+	case OP_BPT:	TR(BPT); TRAP(014);
+	case OP_IOT:	TR(IOT); TRAP(020);
+	case OP_RESET:	TR(RESET); ka11_reset(cpu); unibone_bus_init() ; SVC;
 	}
 
 	// All other instructions should be reserved now
@@ -611,8 +789,10 @@ trap:
 	trace("TRAP %o\n", TV);
 	PUSH; OUT(SP, PSW);
 	PUSH; OUT(SP, PC);
-	INA(TV, PC);
-	INA(TV+2, PSW);
+	if(vector_burst(cpu, TV)){
+		INA(TV, PC);
+		INA(TV+2, PSW);
+	}
 	levelchange(PSW);
 	/* no trace trap after a trap */
 	oldpsw = PSW;
@@ -636,15 +816,19 @@ service:
 		TRAP(024);
 	}else if(c < 7 && cpu->traps & TRAP_BR7){
 		cpu->traps &= ~TRAP_BR7;
+		cpu->bus->svc_request = 1;
 		TRAP(cpu->br[3].bg(cpu->br[3].dev));
 	}else if(c < 6 && cpu->traps & TRAP_BR6){
 		cpu->traps &= ~TRAP_BR6;
+		cpu->bus->svc_request = 1;
 		TRAP(cpu->br[2].bg(cpu->br[2].dev));
 	}else if(c < 5 && cpu->traps & TRAP_BR5){
 		cpu->traps &= ~TRAP_BR5;
+		cpu->bus->svc_request = 1;
 		TRAP(cpu->br[1].bg(cpu->br[1].dev));
 	}else if(c < 4 && cpu->traps & TRAP_BR4){
 		cpu->traps &= ~TRAP_BR4;
+		cpu->bus->svc_request = 1;
 		TRAP(cpu->br[0].bg(cpu->br[0].dev));
 	}else
 	// TODO? console stop
@@ -657,13 +841,10 @@ service:
 void
 ka11_setintr(KA11 *cpu, unsigned vec)
 {
-	pthread_mutex_lock(&cpu->mutex) ;
-	cpu->external_intr = true;
-	cpu->external_intrvec = vec;
 	trace("INTR vec=%03o\n", vec) ;
+	__atomic_store_n(&cpu->external_intr, KA11_EXTERNAL_INTR | (vec & 0xffff), __ATOMIC_RELEASE);
 //	if (cpu->state == KA11_STATE_WAITING) // atomically
 //		cpu->state = KA11_STATE_RUNNING ;
-	pthread_mutex_unlock(&cpu->mutex) ;
 }
 
 // only to be called from ka11_condstep() thread
@@ -681,8 +862,10 @@ ka11_pwrup_vector_fetch(KA11 *cpu)
 {
 	// caller must have issued reset()
 	// cpu->traps &= ~TRAP_PWR; // no, would be a fix
-	INA(024, PC);
-	INA(024+2, PSW);
+	if(vector_burst(cpu, 024)){
+		INA(024, PC);
+		INA(024+2, PSW);
+	}
 	return ;
 be:
 	trace("BE\n");
@@ -702,9 +885,78 @@ ka11_condstep(KA11 *cpu)
 		cpu->state = KA11_STATE_RUNNING;
 		// external_intr WAIT handled atomically in ka11_setintr() !
 
+		// poll devices only if one changed its BR state
+		if(cpu->bus->svc_request){
+			cpu->bus->svc_request = 0;
+			svc(cpu, cpu->bus);
+		}
+		step(cpu);
+	}
+}
+
+/* extra instruction stream words of an operand: index, immediate, absolute */
+static int
+opwords(int m)
+{
+	return (m&060) == 060 || (m&067) == 027;
+}
+
+// words of opcode and its operands, for predecoding blocks of straight line code.
+// 0: opcode may change PC, PSW priority or CPU state, and ends a block.
+int
+ka11_oplength(word ir)
+{
+	switch(optab[ir]){
+	case OP_MOV: case OP_MOV_RR: case OP_CMP: case OP_CMP_RR:
+	case OP_BIT: case OP_BIT_RR: case OP_BIC: case OP_BIC_RR:
+	case OP_BIS: case OP_BIS_RR: case OP_ADD: case OP_ADD_RR:
+	case OP_SUB: case OP_SUB_RR:
+		if((ir & 077) == 7)
+			return 0;	// PC destination
+		return 1 + opwords(ir>>6 & 077) + opwords(ir & 077);
+	case OP_CLR: case OP_COM: case OP_INC: case OP_DEC:
+	case OP_NEG: case OP_ADC: case OP_SBC: case OP_TST:
+	case OP_ROR: case OP_ROL: case OP_ASR: case OP_ASL:
+	case OP_SWAB:
+		if((ir & 077) == 7)
+			return 0;
+		return 1 + opwords(ir & 077);
+	case OP_CCC: case OP_SEC:
+		return 1;
+	}
+	return 0;
+}
+
+// Execute a block of straight line opcodes, predecoded at addresses pc[].
+// Interrupts are granted once per block, as if the block were one opcode.
+// Ends early on control transfer (trap, interrupt), CPU state change,
+// block_abort or device DMA into memory.
+// Result: opcodes executed
+unsigned
+ka11_blockstep(KA11 *cpu, const word *ir, const word *pc, unsigned count)
+{
+	unsigned i;
+
+	unibone_grant_interrupts() ;
+	if(cpu->bus->svc_request){
+		cpu->bus->svc_request = 0;
 		svc(cpu, cpu->bus);
+	}
+	cpu->block_abort = 0;
+	for(i = 0; i < count; i++){
+		if(cpu->r[7] != pc[i] || cpu->block_abort)
+			break;
+		if(!unibone_istream_cached())
+			break;	// opcode fetched again from memory
+		cpu->block_ir = &ir[i];
 		step(cpu);
+		cpu->block_ir = nil;
+		if(cpu->state != KA11_STATE_RUNNING){
+			i++;
+			break;
+		}
 	}
+	return i;
 }
 
 void
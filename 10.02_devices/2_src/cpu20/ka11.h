@@ -1,5 +1,7 @@
 // Interface of 11/20 CPU emulator to UniBone
 
+#define KA11_EXTERNAL_INTR	0x10000	// flag above 16 bit vector
+
 enum {
 	KA11_STATE_HALTED = 0,
 	KA11_STATE_RUNNING = 1,
@@ -26,9 +28,13 @@ struct KA11
 	} br[4];
 
 	// UniBone 	
-	pthread_mutex_t mutex ;
-	volatile bool external_intr ; // INTR by parallel thread pending
-	volatile word external_intrvec;	// associated vector
+	// INTR by parallel thread pending: KA11_EXTERNAL_INTR | vector, else 0.
+	// Written and consumed with atomic operations, no lock.
+	volatile uint32 external_intr ;
+
+	// opcode predecoded by block cache, instead of fetch. See ka11_blockstep()
+	const word *block_ir ;
+	volatile int block_abort ;	// end current block: code or PSW written
 
 	word sw;
 	int swab_vbit;
@@ -37,9 +43,12 @@ struct KA11
 
 void ka11_tracestate(KA11 *cpu);
 void ka11_printstate(KA11 *cpu);
+void ka11_init(KA11 *cpu);
 void ka11_reset(KA11 *cpu);
 void ka11_setintr(KA11 *cpu, unsigned vec);
 void ka11_pwrfail_trap(KA11 *cpu);
 void ka11_pwrup_vector_fetch(KA11 *cpu);
 void ka11_condstep(KA11 *cpu);
+int ka11_oplength(word ir);
+unsigned ka11_blockstep(KA11 *cpu, const word *ir, const word *pc, unsigned count);
 
@@ -0,0 +1,193 @@
+/* cpu_cycletrace.cpp: trace of CPU bus cycles, binary records
+
+ Copyright (c) 2026, QUniBone contributors
+ https://github.com/j-hoppe/QUniBone
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ THE CONTRIBUTORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+ 16-oct-2026  QC      created
+ */
+#include <string.h>
+#include <iostream>
+
+#include "cpu_cycletrace.hpp"
+
+#define CYCLETRACE_STREAM_POLL_NS	10000000	// 10ms: ring fills in > 16ms
+
+#if defined(__arm__)
+bool cycletrace_pmccntr = false ;
+uint32_t cycletrace_pmccntr_last = 0 ;
+uint64_t cycletrace_pmccntr_high = 0 ;
+#endif
+
+// ARMv7: use the PMU cycle counter, if the kernel allows user access.
+// PMUSERENR is always readable in user mode. With EN set, the
+// counter may be enabled here, it is not reset.
+void cycletrace_ticks_init(void)
+{
+#if defined(__arm__)
+    uint32_t userenr, pmcr ;
+    asm volatile("mrc p15, 0, %0, c9, c14, 0" : "=r" (userenr)) ; // PMUSERENR
+    if (!(userenr & 1))
+        return ; // clock_gettime()
+    asm volatile("mrc p15, 0, %0, c9, c12, 0" : "=r" (pmcr)) ; // PMCR
+    asm volatile("mcr p15, 0, %0, c9, c12, 0" : : "r" (pmcr | 1)) ; // E: enable counters
+    asm volatile("mcr p15, 0, %0, c9, c12, 1" : : "r" (1U << 31)) ; // PMCNTENSET: cycle counter
+    cycletrace_pmccntr = true ;
+#endif
+}
+
+static void *cycletrace_stream_worker_pthread_wrapper(void *context)
+{
+    cycletrace_buffer_c *buffer = (cycletrace_buffer_c *) context ;
+    buffer->stream_worker() ;
+    return NULL ;
+}
+
+cycletrace_buffer_c::cycletrace_buffer_c()
+{
+    head = tail = 0 ;
+    stream_file = NULL ;
+    stream_terminate = false ;
+    ticks_per_second = 0 ;
+    dropped_count = 0 ;
+    cycletrace_ticks_init() ;
+}
+
+cycletrace_buffer_c::~cycletrace_buffer_c()
+{
+    stream_close() ;
+}
+
+// file header. Tick rate measured against CLOCK_MONOTONIC on first use.
+bool cycletrace_buffer_c::write_header(FILE *f, uint64_t first_id)
+{
+    if (ticks_per_second == 0) {
+        struct timespec ts0, ts1, delay = { 0, 10000000 } ;
+        clock_gettime(CLOCK_MONOTONIC, &ts0) ;
+        uint64_t ticks0 = cycletrace_ticks() ;
+        nanosleep(&delay, NULL) ;
+        clock_gettime(CLOCK_MONOTONIC, &ts1) ;
+        uint64_t ticks1 = cycletrace_ticks() ;
+        uint64_t ns = (ts1.tv_sec - ts0.tv_sec) * 1000000000ULL + ts1.tv_nsec - ts0.tv_nsec ;
+        ticks_per_second = (ticks1 - ticks0) * 1000000000ULL / ns ;
+    }
+    cycletrace_file_header_t header ;
+    memset(&header, 0, sizeof(header)) ;
+    memcpy(header.magic, CYCLETRACE_MAGIC, sizeof(header.magic)) ;
+    header.record_size = sizeof(cycletrace_record_t) ;
+    header.ticks_per_second = ticks_per_second ;
+    header.first_id = first_id ;
+    return fwrite(&header, sizeof(header), 1, f) == 1 ;
+}
+
+// stream mode: write all records between tail and head.
+// Result: records written
+uint64_t cycletrace_buffer_c::spill(void)
+{
+    uint64_t h = __atomic_load_n(&head, __ATOMIC_ACQUIRE) ;
+    uint64_t t = tail ;
+    uint64_t count = h - t ;
+    while (t < h) {
+        // up to end of ring, then wrap
+        uint64_t chunk = h - t ;
+        if (chunk > CYCLETRACE_RING_SIZE - (t & CYCLETRACE_RING_MASK))
+            chunk = CYCLETRACE_RING_SIZE - (t & CYCLETRACE_RING_MASK) ;
+        fwrite(&ring[t & CYCLETRACE_RING_MASK], sizeof(cycletrace_record_t), chunk, stream_file) ;
+        t += chunk ;
+        __atomic_store_n(&tail, t, __ATOMIC_RELEASE) ; // CPU may reuse
+    }
+    return count ;
+}
+
+void cycletrace_buffer_c::stream_worker(void)
+{
+    while (!stream_terminate) {
+        if (spill() == 0) {
+            struct timespec delay = { 0, CYCLETRACE_STREAM_POLL_NS } ;
+            nanosleep(&delay, NULL) ;
+        }
+    }
+    spill() ; // rest
+}
+
+// start spilling all following records into file
+bool cycletrace_buffer_c::stream_open(std::string filepath)
+{
+    stream_close() ;
+    FILE *f = fopen(filepath.c_str(), "wb") ;
+    if (f == NULL) {
+        std::cout << "Can not open cycle trace file \"" << filepath << "\"!\n" ;
+        return false ;
+    }
+    tail = head ;
+    if (!write_header(f, tail)) {
+        fclose(f) ;
+        return false ;
+    }
+    dropped_count = 0 ;
+    stream_terminate = false ;
+    stream_file = f ;
+    int status = pthread_create(&stream_thread, NULL, &cycletrace_stream_worker_pthread_wrapper, this) ;
+    if (status != 0) {
+        stream_file = NULL ;
+        fclose(f) ;
+        std::cout << "Failed to create cycle trace stream thread, status = " << status << "\n" ;
+        return false ;
+    }
+    return true ;
+}
+
+void cycletrace_buffer_c::stream_close(void)
+{
+    if (stream_file == NULL)
+        return ;
+    stream_terminate = true ;
+    pthread_join(stream_thread, NULL) ;
+    uint64_t written = (uint64_t)(ftell(stream_file) - sizeof(cycletrace_file_header_t)) / sizeof(cycletrace_record_t) ;
+    fclose(stream_file) ;
+    stream_file = NULL ;
+    std::cout << "Streamed " << written << " bus cycles to trace file" ;
+    if (dropped_count)
+        std::cout << ", " << dropped_count << " dropped" ;
+    std::cout << ".\n" ;
+}
+
+// ring mode: save the last records, oldest first
+void cycletrace_buffer_c::dump(std::string filepath)
+{
+    FILE *f = fopen(filepath.c_str(), "wb") ;
+    if (f == NULL) {
+        std::cout << "Can not open cycle trace file \"" << filepath << "\"!\n" ;
+        return ;
+    }
+    uint64_t count = head < CYCLETRACE_RING_SIZE ? head : CYCLETRACE_RING_SIZE ;
+    uint64_t first = head - count ;
+    write_header(f, first) ;
+    uint64_t t = first ;
+    while (t < head) {
+        uint64_t chunk = head - t ;
+        if (chunk > CYCLETRACE_RING_SIZE - (t & CYCLETRACE_RING_MASK))
+            chunk = CYCLETRACE_RING_SIZE - (t & CYCLETRACE_RING_MASK) ;
+        fwrite(&ring[t & CYCLETRACE_RING_MASK], sizeof(cycletrace_record_t), chunk, f) ;
+        t += chunk ;
+    }
+    fclose(f) ;
+    std::cout << "Dumped " << count << " bus cycles to file \"" << filepath << "\".\n" ;
+}
@@ -0,0 +1,170 @@
+/* cpu_cycletrace.hpp: trace of CPU bus cycles, binary records
+
+ Copyright (c) 2026, QUniBone contributors
+ https://github.com/j-hoppe/QUniBone
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ THE CONTRIBUTORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+ 16-oct-2026  QC      created, from qunibus_cycle_trace_buffer_c in cpu.hpp
+
+ Each CPU bus cycle is one 16 byte record in a ring of power-of-two size.
+ Only the CPU thread adds, so no lock: the record is written, then "head"
+ is advanced.
+ Timestamps are raw ticks of the cheapest counter of the platform,
+ the file header holds ticks per second.
+ ARMv7 (BeagleBone): the PMU cycle counter PMCCNTR can only be read if the
+ kernel has enabled user access (PMUSERENR.EN, by a small kernel module).
+ Else clock_gettime() is used, which is a system call on the AM335x
+ (no vDSO clock source) and costs about 1 us per traced bus cycle.
+
+ Modes
+ - ring: oldest records are overwritten, ring is saved to file on HALT.
+ - stream: a thread spills the ring into the file continuously.
+   If the file can not keep up, newest records are dropped and counted,
+   the CPU is never blocked.
+
+ File: header, then records. Little endian, as written by ARM and x86.
+ Convert with tools/cycletrace_decode to CSV or VCD.
+ */
+#ifndef _CPU_CYCLETRACE_HPP_
+#define _CPU_CYCLETRACE_HPP_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#include <string>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define CYCLETRACE_MAGIC	"QUBCTR01"
+
+#define CYCLETRACE_FLAG_IOPAGE	0x01
+#define CYCLETRACE_FLAG_NXM	0x02	// timeout, not existing memory
+
+typedef struct {
+    uint64_t timestamp ; // ticks, see file header
+    uint32_t address ;
+    uint16_t data ;
+    uint8_t cycle ; // QUNIBUS_CYCLE_*
+    uint8_t flags ; // CYCLETRACE_FLAG_*
+} cycletrace_record_t ;
+
+typedef struct {
+    char magic[8] ;
+    uint32_t record_size ;
+    uint32_t _reserved ;
+    uint64_t ticks_per_second ;
+    uint64_t first_id ; // id of first record in file
+} cycletrace_file_header_t ;
+
+static_assert(sizeof(cycletrace_record_t) == 16, "cycletrace record not packed") ;
+static_assert(sizeof(cycletrace_file_header_t) == 32, "cycletrace header not packed") ;
+
+#if defined(__arm__)
+// ARMv7 PMCCNTR, set by cycletrace_ticks_init()
+extern bool cycletrace_pmccntr ;
+extern uint32_t cycletrace_pmccntr_last ;
+extern uint64_t cycletrace_pmccntr_high ;
+#endif
+
+void cycletrace_ticks_init(void) ;
+
+// cheap timestamp: cycle counter, if readable from user space.
+// Only called by the CPU thread, or while the CPU is not running.
+static inline uint64_t cycletrace_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc() ;
+#elif defined(__aarch64__)
+    uint64_t ticks ;
+    asm volatile("mrs %0, cntvct_el0" : "=r" (ticks)) ;
+    return ticks ;
+#else
+#if defined(__arm__)
+    if (cycletrace_pmccntr) {
+        // 32 bit, extended by counting wraps.
+        // Wraps while the CPU is halted for long are lost.
+        uint32_t ticks ;
+        asm volatile("mrc p15, 0, %0, c9, c13, 0" : "=r" (ticks)) ;
+        if (ticks < cycletrace_pmccntr_last)
+            cycletrace_pmccntr_high += 1ULL << 32 ;
+        cycletrace_pmccntr_last = ticks ;
+        return cycletrace_pmccntr_high | ticks ;
+    }
+#endif
+    // cycle counter not enabled for user space
+    struct timespec ts ;
+    clock_gettime(CLOCK_MONOTONIC, &ts) ;
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec ;
+#endif
+}
+
+#define CYCLETRACE_RING_SIZE	16384	// records, power of 2
+#define CYCLETRACE_RING_MASK	(CYCLETRACE_RING_SIZE - 1)
+
+class cycletrace_buffer_c {
+private:
+    cycletrace_record_t ring[CYCLETRACE_RING_SIZE] ;
+    volatile uint64_t head ; // id of next record = records ever added
+    volatile uint64_t tail ; // stream: records before are in file
+
+    // stream mode
+    FILE *stream_file ;
+    pthread_t stream_thread ;
+    volatile bool stream_terminate ;
+    uint64_t ticks_per_second ;
+
+    bool write_header(FILE *f, uint64_t first_id) ;
+    uint64_t spill(void) ;
+
+public:
+    bool active = false ;
+    uint64_t dropped_count ; // stream could not keep up
+
+    cycletrace_buffer_c() ;
+    ~cycletrace_buffer_c() ;
+
+    void add(bool iopage, uint32_t address, uint8_t cycle, uint16_t data, bool nxm) {
+        uint64_t h = head ;
+        if (stream_file && h - __atomic_load_n(&tail, __ATOMIC_ACQUIRE) >= CYCLETRACE_RING_SIZE) {
+            dropped_count++ ;
+            return ;
+        }
+        cycletrace_record_t *r = &ring[h & CYCLETRACE_RING_MASK] ;
+        r->timestamp = cycletrace_ticks() ;
+        r->address = address ;
+        r->data = data ;
+        r->cycle = cycle ;
+        r->flags = (iopage ? CYCLETRACE_FLAG_IOPAGE : 0) | (nxm ? CYCLETRACE_FLAG_NXM : 0) ;
+        __atomic_store_n(&head, h + 1, __ATOMIC_RELEASE) ;
+    }
+
+    bool stream_open(std::string filepath) ;
+    void stream_close(void) ;
+    bool is_streaming(void) {
+        return stream_file != NULL ;
+    }
+    void stream_worker(void) ;
+
+    void dump(std::string filepath) ;
+} ;
+
+#endif
@@ -20,6 +20,7 @@
  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
+ 16-oct-2026  QC      XBUF DATO clears XCSR READY by PRU micro-action
  12-nov-2018  JH      entered beta phase
  20/12/2018 djrm copied to make slu device
  14/01/2019 djrm adapted to use UART2 serial port
@@ -101,6 +102,9 @@ slu_c::slu_c() : qunibusdevice_c()
 	reg_xbuf->active_on_dato = true;
 	reg_xbuf->reset_value = 0;
 	reg_xbuf->writable_bits = 0xff;
+	// PRU clears XCSR READY on write to XBUF, bus cycle needs not to wait for ARM
+	reg_xbuf->action_dato_target = reg_xcsr;
+	reg_xbuf->action_dato_clear_bits = XCSR_XMIT_RDY;
 
 	// initialize serial format
 	serialport.value = "ttyS2"; // labeled "UART2" on PCB
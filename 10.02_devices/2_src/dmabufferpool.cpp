@@ -0,0 +1,133 @@
+/* dmabufferpool.cpp: recycled DMA transfer buffers in size classes
+
+ Copyright (c) 2026, QUniBone contributors
+ https://github.com/j-hoppe/QUniBone
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ THE CONTRIBUTORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+ 16-oct-2026  QC      created
+ */
+
+#include "dmabufferpool.hpp"
+
+//
+// Buffers carry their size class in front of the data.
+// The header keeps the DDR alignment of the data.
+//
+struct BufferHeader
+{
+    uint32_t SizeClass;     // BUFFER_POOL_CLASSES: not pooled
+    uint8_t Fill[60];
+};
+
+DMABufferPool::DMABufferPool()
+{
+    _freeBytes = 0;
+    for (unsigned i = 0; i < BUFFER_POOL_CLASSES; i++)
+    {
+        _freeBuffers[i].reserve(BUFFER_POOL_KEEP);
+    }
+}
+
+//
+// Alloc():
+//  Buffers are taken from the pool of the size class, if one is free.
+//
+uint8_t*
+DMABufferPool::Alloc(
+    size_t lengthInBytes)
+{
+    uint32_t sizeClass = 0;
+    while (sizeClass < BUFFER_POOL_CLASSES
+        && (size_t(1) << (sizeClass + BUFFER_POOL_MIN_SHIFT)) < lengthInBytes)
+    {
+        sizeClass++;
+    }
+
+    BufferHeader* header = nullptr;
+    if (sizeClass < BUFFER_POOL_CLASSES)
+    {
+        lengthInBytes = size_t(1) << (sizeClass + BUFFER_POOL_MIN_SHIFT);
+        const std::lock_guard<std::mutex> lock(_mutex);
+        if (!_freeBuffers[sizeClass].empty())
+        {
+            header = reinterpret_cast<BufferHeader*>(_freeBuffers[sizeClass].back());
+            _freeBuffers[sizeClass].pop_back();
+            _freeBytes -= lengthInBytes;
+        }
+    }
+
+    if (!header)
+    {
+        header = reinterpret_cast<BufferHeader*>(
+            AllocMemory(sizeof(BufferHeader) + lengthInBytes));
+        header->SizeClass = sizeClass;
+    }
+
+    return reinterpret_cast<uint8_t*>(header + 1);
+}
+
+//
+// Free():
+//  Return a buffer to the pool of its size class.
+//  If the pool is full, its memory is freed.
+//
+void
+DMABufferPool::Free(
+    uint8_t* buffer)
+{
+    BufferHeader* header = reinterpret_cast<BufferHeader*>(buffer) - 1;
+
+    if (header->SizeClass < BUFFER_POOL_CLASSES)
+    {
+        size_t lengthInBytes = size_t(1) << (header->SizeClass + BUFFER_POOL_MIN_SHIFT);
+        const std::lock_guard<std::mutex> lock(_mutex);
+        if (_freeBuffers[header->SizeClass].size() < BUFFER_POOL_KEEP
+            && _freeBytes + lengthInBytes <= BUFFER_POOL_MAX_BYTES)
+        {
+            _freeBuffers[header->SizeClass].push_back(reinterpret_cast<uint8_t*>(header));
+            _freeBytes += lengthInBytes;
+            return;
+        }
+    }
+
+    FreeMemory(reinterpret_cast<uint8_t*>(header));
+}
+
+void
+DMABufferPool::FreeAll(void)
+{
+    const std::lock_guard<std::mutex> lock(_mutex);
+    for (unsigned i = 0; i < BUFFER_POOL_CLASSES; i++)
+    {
+        for (uint8_t* buffer : _freeBuffers[i])
+        {
+            FreeMemory(buffer);
+        }
+        _freeBuffers[i].clear();
+    }
+    _freeBytes = 0;
+}
+
+size_t
+DMABufferPool::GetFreeBytes(void)
+{
+    const std::lock_guard<std::mutex> lock(_mutex);
+    return _freeBytes;
+}
@@ -0,0 +1,73 @@
+/* dmabufferpool.hpp: recycled DMA transfer buffers in size classes
+
+ Copyright (c) 2026, QUniBone contributors
+ https://github.com/j-hoppe/QUniBone
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ THE CONTRIBUTORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+ 16-oct-2026  QC      created
+
+ Transfer buffers are recycled in power-of-2 size classes from 512 bytes
+ to 1MB, so in steady state no buffer is allocated per transfer.
+ Larger buffers are allocated for each transfer.
+ Free buffers are limited per class and in total: they tie up the
+ DDR DMA pool, which other controllers need too.
+
+ Where buffers come from is defined by a subclass, for the
+ MSCP port the DDR DMA pool.
+ */
+#ifndef _DMABUFFERPOOL_HPP_
+#define _DMABUFFERPOOL_HPP_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+#include <vector>
+
+#define BUFFER_POOL_MIN_SHIFT 9
+#define BUFFER_POOL_MAX_SHIFT 20
+#define BUFFER_POOL_CLASSES (BUFFER_POOL_MAX_SHIFT - BUFFER_POOL_MIN_SHIFT + 1)
+#define BUFFER_POOL_KEEP 8      // free buffers kept per size class
+#define BUFFER_POOL_MAX_BYTES (256 * 1024)  // free buffers kept in total
+
+class DMABufferPool
+{
+public:
+    DMABufferPool();
+    virtual ~DMABufferPool() {}
+
+    uint8_t* Alloc(size_t lengthInBytes);
+    void Free(uint8_t* buffer);
+    // return all free buffers. Subclass destructor must call it.
+    void FreeAll(void);
+
+    size_t GetFreeBytes(void);
+
+protected:
+    // allocate and free the memory of a buffer
+    virtual uint8_t* AllocMemory(size_t lengthInBytes) = 0;
+    virtual void FreeMemory(uint8_t* memory) = 0;
+
+private:
+    std::mutex _mutex;
+    std::vector<uint8_t*> _freeBuffers[BUFFER_POOL_CLASSES];
+    size_t _freeBytes;
+};
+
+#endif
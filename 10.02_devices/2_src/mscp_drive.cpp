@@ -62,7 +62,7 @@ bool mscp_drive_c::on_param_changed(parameter_c *param)
         UpdateCapacity();
         return true;
     }
-    return device_c::on_param_changed(param); // more actions (for enable)false;
+    return storagedrive_c::on_param_changed(param); // more actions (for enable, overlay)
 }
 
 //
@@ -245,19 +245,49 @@ void mscp_drive_c::Write(uint32_t blockNumber, size_t lengthInBytes, uint8_t* bu
 }
 
 //
-// Reads the specifed number of bytes starting at the specified logical
-// block.  Returns a pointer to a buffer containing the data read.
-// Caller is responsible for freeing this buffer.
+// Writes zeros to the specified number of bytes, rounded up to whole
+// blocks, starting at the specified logical block.
+// Zeroed blocks of a sparse image file become holes.
 //
-uint8_t* mscp_drive_c::Read(uint32_t blockNumber, size_t lengthInBytes) 
+void mscp_drive_c::Erase(uint32_t blockNumber, size_t lengthInBytes)
 {
-    uint8_t* buffer = new uint8_t[lengthInBytes];
-
-    assert(nullptr != buffer);
+    size_t blockSize = GetBlockSize();
+    size_t len = (lengthInBytes + blockSize - 1) / blockSize * blockSize;
+    if (len > 0)
+    {
+        image_set_zero(static_cast<uint64_t>(blockNumber) * blockSize, len);
+    }
+}
 
+//
+// Reads the specifed number of bytes starting at the specified logical
+// block into the provided buffer.
+//
+void mscp_drive_c::Read(uint32_t blockNumber, size_t lengthInBytes, uint8_t* buffer)
+{
     image_read(buffer, blockNumber * GetBlockSize(), lengthInBytes);
+}
+
+//
+// Starts reading the specified number of bytes at the specified logical
+// block into the provided buffer.  Completion is awaited with
+// storagedrive_aio->wait(request).
+//
+void mscp_drive_c::ReadAsync(storagedrive_aio_request_c* request, uint32_t blockNumber, size_t lengthInBytes, uint8_t* buffer)
+{
+    image_read_async(request, buffer, blockNumber * GetBlockSize(), lengthInBytes, nullptr, nullptr);
+}
 
-    return buffer;
+//
+// Starts writing the specified number of bytes from the provided buffer,
+// starting at the specified logical block.  lengthInBytes must be a multiple
+// of the block size, the remainder of a partial block is not cleared.
+// Buffer must stay unchanged until the request is complete.
+//
+void mscp_drive_c::WriteAsync(storagedrive_aio_request_c* request, uint32_t blockNumber, size_t lengthInBytes, uint8_t* buffer)
+{
+    assert((lengthInBytes % GetBlockSize()) == 0);
+    image_write_async(request, buffer, blockNumber * GetBlockSize(), lengthInBytes, nullptr, nullptr);
 }
 
 //
@@ -275,21 +305,16 @@ void mscp_drive_c::WriteRCTBlock(uint32_t rctBlockNumber, uint8_t* buffer)
 
 //
 // Reads a single block's worth of data from the RCT area (at the specified
-// block offset).  Returns a pointer to a buffer containing the data read.
-// Caller is responsible for freeing this buffer.
+// block offset) into the provided buffer.  Buffer must be at least as large
+// as the disk's block size.
 //
-uint8_t* mscp_drive_c::ReadRCTBlock(uint32_t rctBlockNumber) 
+void mscp_drive_c::ReadRCTBlock(uint32_t rctBlockNumber, uint8_t* buffer) 
 {
     assert(rctBlockNumber < GetRCTBlockCount());
 
-    uint8_t* buffer = new uint8_t[GetBlockSize()];
-    assert(nullptr != buffer);
-
     memcpy(reinterpret_cast<void *>(buffer),
            reinterpret_cast<void *>(_rctData.get() + rctBlockNumber * GetBlockSize()),
            GetBlockSize());
-
-    return buffer;
 }
 
 //
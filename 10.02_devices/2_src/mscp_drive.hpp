@@ -43,11 +43,17 @@ public:
 
     void Write(uint32_t blockNumber, size_t lengthInBytes, uint8_t* buffer);
 
-    uint8_t* Read(uint32_t blockNumber, size_t lengthInBytes);
+    void Erase(uint32_t blockNumber, size_t lengthInBytes);
+
+    void Read(uint32_t blockNumber, size_t lengthInBytes, uint8_t* buffer);
+
+    void ReadAsync(storagedrive_aio_request_c* request, uint32_t blockNumber, size_t lengthInBytes, uint8_t* buffer);
+
+    void WriteAsync(storagedrive_aio_request_c* request, uint32_t blockNumber, size_t lengthInBytes, uint8_t* buffer);
 
     void WriteRCTBlock(uint32_t rctBlockNumber, uint8_t* buffer);
 
-    uint8_t* ReadRCTBlock(uint32_t rctBlockNumber);
+    void ReadRCTBlock(uint32_t rctBlockNumber, uint8_t* buffer);
 
 public:
     void on_power_changed(signal_edge_enum aclo_edge, signal_edge_enum dclo_edge) override;
@@ -9,20 +9,19 @@
     the side of implementation simplicity.
 
     In particular:
-         All commands are executed sequentially, as they appear in the
+         Commands for a unit are executed sequentially, as they appear in the
          command ring.  This includes any commands in the "Immediate"
          category.  Technically this is incorrect:  Immediate commands
          should execute as soon as possible, before any other commands.
          In practice I have yet to find code that cares.
 
-         This simplifies the implementation significantly, and apart
-         from maintaining fealty to the MSCP spec for Immediate commands,
-         there's no good reason to make it more complex:  real MSCP
-         controllers (like the original UDA50) would resequence commands
-         to allow optimal throughput across multiple units, etc.  On the
-         Unibone, the underlying storage and the execution speed of the
-         processor is orders of magnitude faster, so even a brute-force
-         braindead implementation like this can saturate the Unibus.
+         Commands for different units are executed in parallel by a pool
+         of unit workers, like real MSCP controllers overlap transfers
+         across units: a slow image file of one unit does not delay the
+         others.  Each unit has its own queue, so the MSCP ordering rules
+         within a unit hold.  Controller commands (SET CONTROLLER
+         CHARACTERISTICS, ABORT, GET COMMAND STATUS, invalid unit numbers)
+         wait until all units are idle and then execute on the polling thread.
 
     TODO:
     - Some commands aren't checked as thoroughly for errors as they could be.
@@ -67,6 +66,10 @@ mscp_server::mscp_server(
         _pollState(PollingState::Wait),
         polling_cond(PTHREAD_COND_INITIALIZER),
         polling_mutex(PTHREAD_MUTEX_INITIALIZER),
+        unit_cond(PTHREAD_COND_INITIALIZER),
+        unit_idle_cond(PTHREAD_COND_INITIALIZER),
+        unit_mutex(PTHREAD_MUTEX_INITIALIZER),
+        response_mutex(PTHREAD_MUTEX_INITIALIZER),
         _credits(INIT_CREDITS) 
 {
     set_workers_count(0) ; // no std worker()
@@ -79,6 +82,7 @@ mscp_server::mscp_server(
     enabled.set(true) ; 
     enabled.readonly = true ; // always active
 
+    StartUnitWorkers();
     StartPollingThread();
 }
 
@@ -86,6 +90,7 @@ mscp_server::mscp_server(
 mscp_server::~mscp_server()
 {
     AbortPollingThread();
+    AbortUnitWorkers();
 }
 
 
@@ -158,6 +163,202 @@ mscp_server::AbortPollingThread(void)
     DEBUG_FAST("Polling thread aborted.");  
 }
 
+//
+// unit_worker():
+//  Runs one of the unit worker threads.
+//
+void* unit_worker(
+    void *context)
+{
+    mscp_server* server = reinterpret_cast<mscp_server*>(context);
+    server->UnitWorker();
+    return nullptr;
+}
+
+//
+// StartUnitWorkers():
+//  Creates the queues for all units and starts the worker pool.
+//
+void
+mscp_server::StartUnitWorkers(void)
+{
+    _abort_units = false;
+    _unitCommandsPending = 0;
+    _unitQueues.resize(DRIVE_COUNT);
+    for (unsigned i = 0; i < _unitQueues.size(); i++)
+    {
+        _unitQueues[i].messages.reserve(MAX_CREDITS);
+    }
+    _readyUnits.reserve(DRIVE_COUNT);
+    _pollMessages.reserve(MAX_CREDITS);
+    _unitWorkers.resize(UNIT_WORKER_COUNT);
+
+    for (unsigned i = 0; i < _unitWorkers.size(); i++)
+    {
+        int status = pthread_create(
+            &_unitWorkers[i],
+            NULL,
+            &unit_worker,
+            reinterpret_cast<void*>(this));
+
+        if (status != 0)
+        {
+            FATAL("Failed to start mscp unit worker thread.  Status 0x%x", status);
+        }
+    }
+}
+
+//
+// AbortUnitWorkers():
+//  Stops the unit worker threads, queued commands are dropped.
+//
+void
+mscp_server::AbortUnitWorkers(void)
+{
+    pthread_mutex_lock(&unit_mutex);
+    _abort_units = true;
+    pthread_cond_broadcast(&unit_cond);
+    pthread_mutex_unlock(&unit_mutex);
+
+    for (unsigned i = 0; i < _unitWorkers.size(); i++)
+    {
+        pthread_join(_unitWorkers[i], NULL);
+    }
+}
+
+//
+// DispatchCommand():
+//  Called by the polling thread for each command read from the ring.
+//  Unit commands are queued for their unit, controller commands
+//  wait until all units are idle, then execute here.
+//
+void
+mscp_server::DispatchCommand(
+    Message* message)
+{
+    ControlMessageHeader* header =
+        reinterpret_cast<ControlMessageHeader*>(message->Message);
+    uint16_t unitNumber = header->UnitNumber;
+
+    bool unitCommand = false;
+    switch (header->Word3.Command.Opcode)
+    {
+        case Opcodes::ACCESS:
+        case Opcodes::AVAILABLE:
+        case Opcodes::COMPARE_HOST_DATA:
+        case Opcodes::DETERMINE_ACCESS_PATHS:
+        case Opcodes::ERASE:
+        case Opcodes::GET_UNIT_STATUS:
+        case Opcodes::ONLINE:
+        case Opcodes::READ:
+        case Opcodes::REPLACE:
+        case Opcodes::SET_UNIT_CHARACTERISTICS:
+        case Opcodes::WRITE:
+            unitCommand = unitNumber < _unitQueues.size();
+            break;
+        default:
+            break;
+    }
+
+    if (!unitCommand)
+    {
+        WaitUnitsIdle();
+        ExecuteCommand(message);
+        return;
+    }
+
+    pthread_mutex_lock(&unit_mutex);
+    UnitQueue* queue = &_unitQueues[unitNumber];
+    bool wasEmpty = queue->empty();
+    queue->push(message);
+    _unitCommandsPending++;
+    if (!queue->busy && wasEmpty)
+    {
+        // unit was idle
+        _readyUnits.push_back(unitNumber);
+        pthread_cond_signal(&unit_cond);
+    }
+    pthread_mutex_unlock(&unit_mutex);
+}
+
+//
+// UnitWorker():
+//  Takes a unit with queued commands and executes its oldest command.
+//  The unit is "busy" meanwhile, so no other worker takes it:
+//  commands for one unit never overlap.
+//
+void
+mscp_server::UnitWorker(void)
+{
+    worker_init_realtime_priority(rt_device);
+
+    pthread_mutex_lock(&unit_mutex);
+    while (!_abort_units)
+    {
+        if (_readyUnits.empty())
+        {
+            pthread_cond_wait(&unit_cond, &unit_mutex);
+            continue;
+        }
+        uint16_t unitNumber = _readyUnits.front();
+        _readyUnits.erase(_readyUnits.begin());
+        UnitQueue* queue = &_unitQueues[unitNumber];
+        Message* message = queue->pop();
+        queue->busy = true;
+        pthread_mutex_unlock(&unit_mutex);
+
+        ExecuteCommand(message);
+
+        pthread_mutex_lock(&unit_mutex);
+        queue->busy = false;
+        _unitCommandsPending--;
+        if (!queue->empty())
+        {
+            _readyUnits.push_back(unitNumber);
+            pthread_cond_signal(&unit_cond);
+        }
+        pthread_cond_broadcast(&unit_idle_cond);
+    }
+    pthread_mutex_unlock(&unit_mutex);
+}
+
+//
+// WaitUnitsIdle():
+//  Blocks until all queued unit commands are executed.
+//
+void
+mscp_server::WaitUnitsIdle(void)
+{
+    pthread_mutex_lock(&unit_mutex);
+    while (_unitCommandsPending > 0)
+    {
+        pthread_cond_wait(&unit_idle_cond, &unit_mutex);
+    }
+    pthread_mutex_unlock(&unit_mutex);
+}
+
+//
+// DiscardUnitCommands():
+//  On reset: drops all commands not yet started, like the polling
+//  thread drops the rest of its queue.
+//
+void
+mscp_server::DiscardUnitCommands(void)
+{
+    pthread_mutex_lock(&unit_mutex);
+    for (unsigned i = 0; i < _unitQueues.size(); i++)
+    {
+        while (!_unitQueues[i].empty())
+        {
+            _port->ReleaseMessage(_unitQueues[i].pop());
+            _unitCommandsPending--;
+        }
+    }
+    _readyUnits.clear();
+    pthread_cond_broadcast(&unit_idle_cond);
+    pthread_mutex_unlock(&unit_mutex);
+}
+
 //
 // Poll():
 //  The MSCP polling thread.  
@@ -200,19 +401,22 @@ mscp_server::Poll(void)
         //
         // Read all commands from the ring into a queue; then execute them.
         //
-        std::queue<std::shared_ptr<Message>> messages;
+        std::vector<Message*>& messages = _pollMessages;
+        messages.clear();
 
         int msgCount = 0;
         while (!_abort_polling && _pollState != PollingState::InitRestart)
         {
             bool error = false;
-            std::shared_ptr<Message> message(_port->GetNextCommand(&error));
+            Message* message(_port->GetNextCommand(&error));
             if (error)
             {
                 DEBUG_FAST("Error while reading messages, returning to idle state.");
-                // The lords of STL decreed that queue should have no "clear" method
-                // so we do this garbage instead:
-                messages = std::queue<std::shared_ptr<Message>>(); 
+                for (Message* dropped : messages)
+                {
+                    _port->ReleaseMessage(dropped);
+                }
+                messages.clear();
                 break; 
             }
             if (nullptr == message)
@@ -222,161 +426,23 @@ mscp_server::Poll(void)
             }
 
             msgCount++;
-            messages.push(message);
+            messages.push_back(message);
         } 
 
         //
         // Pull commands from the queue until it is empty or we're told to quit.
+        // Commands for a unit go to the unit's queue, executed by the unit workers.
         //
-        while(!messages.empty() && !_abort_polling && _pollState != PollingState::InitRestart)
+        size_t msgIndex = 0;
+        while(msgIndex < messages.size() && !_abort_polling && _pollState != PollingState::InitRestart)
         {
-            std::shared_ptr<Message> message(messages.front());  
-            messages.pop();
-
-            //
-            // Handle the message.  We dispatch on opcodes to the
-            // appropriate methods.  These methods modify the message
-            // object in place; this message object is then posted back
-            // to the response ring.
-            //
-            ControlMessageHeader* header = 
-                reinterpret_cast<ControlMessageHeader*>(message->Message);
-
-            DEBUG_FAST("Message size 0x%x opcode 0x%x rsvd 0x%x mod 0x%x unit %d, ursvd 0x%x, ref 0x%x", 
-                message->MessageLength,
-                header->Word3.Command.Opcode,
-                header->Word3.Command.Reserved,
-                header->Word3.Command.Modifiers,
-                header->UnitNumber,
-                header->Reserved,
-                header->ReferenceNumber);
-
-            bool protocolError = false;
-            uint32_t cmdStatus = 0;
-            uint16_t modifiers = header->Word3.Command.Modifiers;
-
-            switch (header->Word3.Command.Opcode)
-            {
-                case Opcodes::ABORT:
-                    cmdStatus = Abort();
-                    break;
-
-                case Opcodes::ACCESS:
-                    cmdStatus = Access(message, header->UnitNumber);
-                    break;
-
-                case Opcodes::AVAILABLE:
-                    cmdStatus = Available(header->UnitNumber, modifiers);
-                    break;
-
-                case Opcodes::COMPARE_HOST_DATA:
-                    cmdStatus = CompareHostData(message, header->UnitNumber);
-                    break;
-
-                case Opcodes::DETERMINE_ACCESS_PATHS:
-                    cmdStatus = DetermineAccessPaths(header->UnitNumber);
-                    break;
-
-                case Opcodes::ERASE:
-                    cmdStatus = Erase(message, header->UnitNumber, modifiers);
-                    break;
-
-                case Opcodes::GET_COMMAND_STATUS:
-                    cmdStatus = GetCommandStatus(message);
-                    break;
-
-                case Opcodes::GET_UNIT_STATUS:
-                    cmdStatus = GetUnitStatus(message, header->UnitNumber, modifiers);
-                    break;
-
-                case Opcodes::ONLINE:
-                    cmdStatus = Online(message, header->UnitNumber, modifiers);
-                    break;
-
-                case Opcodes::READ:
-                    cmdStatus = Read(message, header->UnitNumber, modifiers);
-                    break;
-
-                case Opcodes::REPLACE:
-                    cmdStatus = Replace(message, header->UnitNumber);
-                    break;
-
-                case Opcodes::SET_CONTROLLER_CHARACTERISTICS:
-                    cmdStatus = SetControllerCharacteristics(message);     
-                    break;
-
-                case Opcodes::SET_UNIT_CHARACTERISTICS:
-                    cmdStatus = SetUnitCharacteristics(message, header->UnitNumber, modifiers);
-                    break;
-
-                case Opcodes::WRITE:
-                    cmdStatus = Write(message, header->UnitNumber, modifiers);
-                    break;
-
-                default:
-                    DEBUG_FAST("Unimplemented MSCP command 0x%x", header->Word3.Command.Opcode);
-                    protocolError = true;
-                    break;
-            }
-
-            if (protocolError)
-            {
-                uint16_t subCode = offsetof(ControlMessageHeader, Word3) + HEADER_OFFSET;
-                cmdStatus = STATUS(Status::INVALID_COMMAND, subCode, 0);
-            }
-
-            DEBUG_FAST("cmd 0x%x st 0x%x fl 0x%x", cmdStatus, GET_STATUS(cmdStatus), GET_FLAGS(cmdStatus));
-
-            //
-            // Set the endcode and status bits
-            //
-            header->Word3.End.Status = GET_STATUS(cmdStatus);
-            header->Word3.End.Flags = GET_FLAGS(cmdStatus);
-
-            // Set the End code properly -- for a protocol error, 
-            // this is just the End code, for all others it's the End code
-            // or'd with the original opcode.
-            if (protocolError)
-            {
-                 // Just the END code, no opcode
-                 header->Word3.End.Endcode = Endcodes::END;
-            }
-            else
-            {
-                 header->Word3.End.Endcode |= Endcodes::END;
-            }
-
-            if (message->Word1.Info.MessageType == MessageTypes::Sequential &&
-                header->Word3.End.Endcode & Endcodes::END)
-            {
-                //
-                // We steal the credits hack from simh:
-                // The controller gives all of its credits to the host,
-                // thereafter it supplies one credit for every response
-                // packet sent.
-                // 
-                uint8_t grantedCredits = std::min(_credits, static_cast<uint8_t>(MAX_CREDITS));
-                _credits -= grantedCredits;
-                message->Word1.Info.Credits = grantedCredits + 1;
-                DEBUG_FAST("granted credits %d", grantedCredits + 1);
-            }
-            else
-            {
-                message->Word1.Info.Credits = 0;
-            }
-
-            //
-            // Post the response to the port's response ring.
-            // If everything is working properly, there should always be room.
-            //
-            if(!_port->PostResponse(message.get()))
-            {
-                FATAL("Unexpected: no room in response ring.");
-            }
+            DispatchCommand(messages[msgIndex++]);
+        }
 
-            //
-            // Go around and pick up the next one.
-            //
+        // Commands not dispatched are dropped.
+        while (msgIndex < messages.size())
+        {
+            _port->ReleaseMessage(messages[msgIndex++]);
         }
 
         //
@@ -407,6 +473,173 @@ mscp_server::Poll(void)
     DEBUG_FAST("MSCP Polling thread exiting."); 
 }
 
+//
+// ExecuteCommand():
+//  Executes one command message and posts the response.
+//  Called by the polling thread for controller commands,
+//  and by the unit workers for unit commands.
+//
+void
+mscp_server::ExecuteCommand(
+    Message* message)
+{
+    //
+    // Handle the message.  We dispatch on opcodes to the
+    // appropriate methods.  These methods modify the message
+    // object in place; this message object is then posted back
+    // to the response ring.
+    //
+    ControlMessageHeader* header = 
+        reinterpret_cast<ControlMessageHeader*>(message->Message);
+
+    DEBUG_FAST("Message size 0x%x opcode 0x%x rsvd 0x%x mod 0x%x unit %d, ursvd 0x%x, ref 0x%x", 
+        message->MessageLength,
+        header->Word3.Command.Opcode,
+        header->Word3.Command.Reserved,
+        header->Word3.Command.Modifiers,
+        header->UnitNumber,
+        header->Reserved,
+        header->ReferenceNumber);
+
+    bool protocolError = false;
+    uint32_t cmdStatus = 0;
+    uint16_t modifiers = header->Word3.Command.Modifiers;
+
+    switch (header->Word3.Command.Opcode)
+    {
+        case Opcodes::ABORT:
+            cmdStatus = Abort();
+            break;
+
+        case Opcodes::ACCESS:
+            cmdStatus = Access(message, header->UnitNumber);
+            break;
+
+        case Opcodes::AVAILABLE:
+            cmdStatus = Available(header->UnitNumber, modifiers);
+            break;
+
+        case Opcodes::COMPARE_HOST_DATA:
+            cmdStatus = CompareHostData(message, header->UnitNumber);
+            break;
+
+        case Opcodes::DETERMINE_ACCESS_PATHS:
+            cmdStatus = DetermineAccessPaths(header->UnitNumber);
+            break;
+
+        case Opcodes::ERASE:
+            cmdStatus = Erase(message, header->UnitNumber, modifiers);
+            break;
+
+        case Opcodes::GET_COMMAND_STATUS:
+            cmdStatus = GetCommandStatus(message);
+            break;
+
+        case Opcodes::GET_UNIT_STATUS:
+            cmdStatus = GetUnitStatus(message, header->UnitNumber, modifiers);
+            break;
+
+        case Opcodes::ONLINE:
+            cmdStatus = Online(message, header->UnitNumber, modifiers);
+            break;
+
+        case Opcodes::READ:
+            cmdStatus = Read(message, header->UnitNumber, modifiers);
+            break;
+
+        case Opcodes::REPLACE:
+            cmdStatus = Replace(message, header->UnitNumber);
+            break;
+
+        case Opcodes::SET_CONTROLLER_CHARACTERISTICS:
+            cmdStatus = SetControllerCharacteristics(message);     
+            break;
+
+        case Opcodes::SET_UNIT_CHARACTERISTICS:
+            cmdStatus = SetUnitCharacteristics(message, header->UnitNumber, modifiers);
+            break;
+
+        case Opcodes::WRITE:
+            cmdStatus = Write(message, header->UnitNumber, modifiers);
+            break;
+
+        default:
+            DEBUG_FAST("Unimplemented MSCP command 0x%x", header->Word3.Command.Opcode);
+            protocolError = true;
+            break;
+    }
+
+    if (protocolError)
+    {
+        uint16_t subCode = offsetof(ControlMessageHeader, Word3) + HEADER_OFFSET;
+        cmdStatus = STATUS(Status::INVALID_COMMAND, subCode, 0);
+    }
+
+    DEBUG_FAST("cmd 0x%x st 0x%x fl 0x%x", cmdStatus, GET_STATUS(cmdStatus), GET_FLAGS(cmdStatus));
+
+    //
+    // Set the endcode and status bits
+    //
+    header->Word3.End.Status = GET_STATUS(cmdStatus);
+    header->Word3.End.Flags = GET_FLAGS(cmdStatus);
+
+    // Set the End code properly -- for a protocol error, 
+    // this is just the End code, for all others it's the End code
+    // or'd with the original opcode.
+    if (protocolError)
+    {
+         // Just the END code, no opcode
+         header->Word3.End.Endcode = Endcodes::END;
+    }
+    else
+    {
+         header->Word3.End.Endcode |= Endcodes::END;
+    }
+
+    // Credits and response ring are shared by all unit workers.
+    pthread_mutex_lock(&response_mutex);
+    if (message->Word1.Info.MessageType == MessageTypes::Sequential &&
+        header->Word3.End.Endcode & Endcodes::END)
+    {
+        //
+        // We steal the credits hack from simh:
+        // The controller gives all of its credits to the host,
+        // thereafter it supplies one credit for every response
+        // packet sent.
+        // 
+        uint8_t grantedCredits = std::min(_credits, static_cast<uint8_t>(MAX_CREDITS));
+        _credits -= grantedCredits;
+        message->Word1.Info.Credits = grantedCredits + 1;
+        DEBUG_FAST("granted credits %d", grantedCredits + 1);
+    }
+    else
+    {
+        message->Word1.Info.Credits = 0;
+    }
+
+    //
+    // Post the response to the port's response ring.
+    // If everything is working properly, there should always be room.
+    // On a bus error the port has been reset and the response is lost,
+    // like the commands still queued.
+    //
+    bool error = false;
+    if(!_port->PostResponse(message, &error))
+    {
+        if (error)
+        {
+            DEBUG_FAST("Error while posting response, response dropped.");
+        }
+        else
+        {
+            FATAL("Unexpected: no room in response ring.");
+        }
+    }
+    pthread_mutex_unlock(&response_mutex);
+
+    _port->ReleaseMessage(message);
+}
+
 //
 // The following are all implementations of the MSCP commands we support.
 //
@@ -417,10 +650,11 @@ mscp_server::Abort()
     INFO("MSCP ABORT");
 
     //
-    // Since we do not reorder messages and in fact pick up and execute
-    // them one at a time, sequentially as they appear in the ring buffer,
-    // by the time we've gotten this command, the command it's referring
-    // to is long gone.
+    // Unit commands run concurrently on the unit workers, but ABORT is a
+    // controller command: DispatchCommand() executes it only after
+    // WaitUnitsIdle() has drained all unit queues.  Every command
+    // preceding it in the ring, including the one it refers to, is
+    // complete by the time we get here.
     // This is semi-legal behavior and it's legal for us to ignore ABORT in this
     // case.
     //
@@ -455,7 +689,7 @@ mscp_server::Available(
 
 uint32_t
 mscp_server::Access(
-    std::shared_ptr<Message> message,
+    Message* message,
     uint16_t unitNumber)
 {
     INFO("MSCP ACCESS");
@@ -469,7 +703,7 @@ mscp_server::Access(
 
 uint32_t
 mscp_server::CompareHostData(
-    std::shared_ptr<Message> message,
+    Message* message,
     uint16_t unitNumber)
 {
     INFO("MSCP COMPARE HOST DATA");
@@ -504,7 +738,7 @@ mscp_server::DetermineAccessPaths(
 
 uint32_t
 mscp_server::Erase(
-    std::shared_ptr<Message> message,
+    Message* message,
     uint16_t unitNumber,
     uint16_t modifiers)
 {
@@ -517,7 +751,7 @@ mscp_server::Erase(
 
 uint32_t
 mscp_server::GetCommandStatus(
-    std::shared_ptr<Message> message)
+    Message* message)
 {
     INFO("MSCP GET COMMAND STATUS");
 
@@ -547,7 +781,7 @@ mscp_server::GetCommandStatus(
 
 uint32_t
 mscp_server::GetUnitStatus(
-    std::shared_ptr<Message> message,
+    Message* message,
     uint16_t unitNumber,
     uint16_t modifiers)
 {
@@ -651,7 +885,7 @@ mscp_server::GetUnitStatus(
 
 uint32_t
 mscp_server::Online(
-    std::shared_ptr<Message> message,
+    Message* message,
     uint16_t unitNumber,
     uint16_t modifiers)
 {
@@ -683,7 +917,7 @@ mscp_server::Online(
 
 uint32_t
 mscp_server::Replace(
-    std::shared_ptr<Message> message,
+    Message* message,
     uint16_t unitNumber)
 {
     INFO("MSCP REPLACE");
@@ -708,7 +942,7 @@ mscp_server::Replace(
 
 uint32_t
 mscp_server::SetControllerCharacteristics(
-    std::shared_ptr<Message> message)
+    Message* message)
 {
     #pragma pack(push,1)
     struct SetControllerCharacteristicsParameters
@@ -771,7 +1005,7 @@ mscp_server::SetControllerCharacteristics(
 
 uint32_t
 mscp_server::SetUnitCharacteristics(
-    std::shared_ptr<Message> message,
+    Message* message,
     uint16_t unitNumber,
     uint16_t modifiers)
 {
@@ -798,7 +1032,7 @@ mscp_server::SetUnitCharacteristics(
 
 uint32_t
 mscp_server::Read(
-    std::shared_ptr<Message> message,
+    Message* message,
     uint16_t unitNumber,
     uint16_t modifiers)
 {
@@ -811,7 +1045,7 @@ mscp_server::Read(
 
 uint32_t
 mscp_server::Write(
-    std::shared_ptr<Message> message,
+    Message* message,
     uint16_t unitNumber,
     uint16_t modifiers)
 {
@@ -828,7 +1062,7 @@ mscp_server::Write(
 //
 uint32_t
 mscp_server::SetUnitCharacteristicsInternal(
-    std::shared_ptr<Message> message,
+    Message* message,
     uint16_t unitNumber,
     uint16_t modifiers,
     bool bringOnline)
@@ -899,7 +1133,7 @@ mscp_server::SetUnitCharacteristicsInternal(
 uint32_t
 mscp_server::DoDiskTransfer(
     uint16_t operation,
-    std::shared_ptr<Message> message,
+    Message* message,
     uint16_t unitNumber,
     uint16_t modifiers)
 {
@@ -983,23 +1217,25 @@ mscp_server::DoDiskTransfer(
         case Opcodes::COMPARE_HOST_DATA:
         {
             // Read the data in from disk, read the data in from memory, and compare.
-            std::unique_ptr<uint8_t> diskBuffer;
+            std::unique_ptr<uint8_t, DMABufferDeleter> diskBuffer(
+                _port->DMABufferAlloc(params->ByteCount), DMABufferDeleter(_port));
 
             if (rctAccess)
             {
-                diskBuffer.reset(drive->ReadRCTBlock(rctBlockNumber));
+                drive->ReadRCTBlock(rctBlockNumber, diskBuffer.get());
             }
             else
             {
-                diskBuffer.reset(drive->Read(params->LBN, params->ByteCount));
+                drive->Read(params->LBN, params->ByteCount, diskBuffer.get());
             }
 
-            std::unique_ptr<uint8_t> memBuffer(_port->DMARead(
+            std::unique_ptr<uint8_t, DMABufferDeleter> memBuffer(
+                _port->DMABufferAlloc(params->ByteCount), DMABufferDeleter(_port));
+ 
+            if (!_port->DMARead(
                 params->BufferPhysicalAddress & 0x00ffffff,
                 params->ByteCount,
-                params->ByteCount));
- 
-            if (!memBuffer)
+                memBuffer.get()))
             {
                 return STATUS(Status::HOST_BUFFER_ACCESS_ERROR, HostBufferAccessSubcodes::NXM, 0);
             }
@@ -1012,34 +1248,51 @@ mscp_server::DoDiskTransfer(
  
         case Opcodes::ERASE:
         {
-            std::unique_ptr<uint8_t> memBuffer(new uint8_t[params->ByteCount]);
-            memset(reinterpret_cast<void*>(memBuffer.get()), 0, params->ByteCount);
-
             if (rctAccess)
             {
+                std::unique_ptr<uint8_t, DMABufferDeleter> memBuffer(
+                    _port->DMABufferAlloc(params->ByteCount), DMABufferDeleter(_port));
+                memset(reinterpret_cast<void*>(memBuffer.get()), 0, params->ByteCount);
+
                 drive->WriteRCTBlock(rctBlockNumber,
                     memBuffer.get());
             }
             else
             {
-                drive->Write(params->LBN,
-                    params->ByteCount,
-                    memBuffer.get());
+                // No zero buffer: sparse images punch holes
+                drive->Erase(params->LBN,
+                    params->ByteCount);
             }
         } 
         break;
 
         case Opcodes::READ:
         {
-            std::unique_ptr<uint8_t> diskBuffer;
+            if (!rctAccess
+                && params->ByteCount > TRANSFER_CHUNK_BLOCKS * drive->GetBlockSize())
+            {
+                // Large transfer: disk and DMA overlap.
+                uint32_t transferred = 0;
+                if (!StreamRead(drive, params->LBN, params->ByteCount,
+                    params->BufferPhysicalAddress & 0x00ffffff, transferred))
+                {
+                    params->ByteCount = transferred;
+                    return STATUS(Status::HOST_BUFFER_ACCESS_ERROR, HostBufferAccessSubcodes::NXM, 0);
+                }
+                break;
+            }
+
+            // Read disk data into a DDR buffer, PRU DMAs it without copy.
+            std::unique_ptr<uint8_t, DMABufferDeleter> diskBuffer(
+                _port->DMABufferAlloc(params->ByteCount), DMABufferDeleter(_port));
         
             if (rctAccess)
             {
-                diskBuffer.reset(drive->ReadRCTBlock(rctBlockNumber));
+                drive->ReadRCTBlock(rctBlockNumber, diskBuffer.get());
             }
             else
             { 
-                diskBuffer.reset(drive->Read(params->LBN, params->ByteCount));
+                drive->Read(params->LBN, params->ByteCount, diskBuffer.get());
             }
 
             if (!_port->DMAWrite(
@@ -1055,12 +1308,27 @@ mscp_server::DoDiskTransfer(
 
         case Opcodes::WRITE:
         {
-            std::unique_ptr<uint8_t> memBuffer(_port->DMARead(
+            if (!rctAccess
+                && params->ByteCount > TRANSFER_CHUNK_BLOCKS * drive->GetBlockSize())
+            {
+                // Large transfer: disk and DMA overlap.
+                uint32_t transferred = 0;
+                if (!StreamWrite(drive, params->LBN, params->ByteCount,
+                    params->BufferPhysicalAddress & 0x00ffffff, transferred))
+                {
+                    params->ByteCount = transferred;
+                    return STATUS(Status::HOST_BUFFER_ACCESS_ERROR, HostBufferAccessSubcodes::NXM, 0);
+                }
+                break;
+            }
+
+            std::unique_ptr<uint8_t, DMABufferDeleter> memBuffer(
+                _port->DMABufferAlloc(params->ByteCount), DMABufferDeleter(_port));
+
+            if (!_port->DMARead(
                 params->BufferPhysicalAddress & 0x00ffffff,
                 params->ByteCount,
-                params->ByteCount));
-
-            if (!memBuffer)
+                memBuffer.get()))
             {
                 return STATUS(Status::HOST_BUFFER_ACCESS_ERROR, HostBufferAccessSubcodes::NXM, 0);
             }
@@ -1094,13 +1362,142 @@ mscp_server::DoDiskTransfer(
     return STATUS(Status::SUCCESS, 0, 0);
 }
 
+//
+// StreamRead():
+//  Transfers a large READ chunk by chunk: while a chunk is DMA'd to the
+//  host, the following chunks are read from disk by the storagedrive
+//  thread pool.  Returns false on NXM, 'transferred' is then the count
+//  of bytes written to host memory before the failing chunk.
+//
+bool
+mscp_server::StreamRead(
+    mscp_drive_c* drive,
+    uint32_t blockNumber,
+    uint32_t byteCount,
+    uint32_t address,
+    uint32_t& transferred)
+{
+    uint32_t chunkSize = TRANSFER_CHUNK_BLOCKS * drive->GetBlockSize();
+    uint32_t chunkCount = (byteCount + chunkSize - 1) / chunkSize;
+    std::unique_ptr<uint8_t, DMABufferDeleter> buffer(
+        _port->DMABufferAlloc(TRANSFER_PIPELINE_DEPTH * chunkSize), DMABufferDeleter(_port));
+    storagedrive_aio_request_c requests[TRANSFER_PIPELINE_DEPTH];
+
+    uint32_t submitted = 0;
+    bool success = true;
+    transferred = 0;
+    for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+    {
+        // keep the pipeline full
+        while (submitted < chunkCount && submitted < chunk + TRANSFER_PIPELINE_DEPTH)
+        {
+            unsigned slot = submitted % TRANSFER_PIPELINE_DEPTH;
+            drive->ReadAsync(&requests[slot],
+                blockNumber + submitted * TRANSFER_CHUNK_BLOCKS,
+                std::min(chunkSize, byteCount - submitted * chunkSize),
+                buffer.get() + slot * chunkSize);
+            submitted++;
+        }
+
+        unsigned slot = chunk % TRANSFER_PIPELINE_DEPTH;
+        storagedrive_aio->wait(&requests[slot]);
+        if (!_port->DMAWrite(
+            address + chunk * chunkSize,
+            requests[slot].len,
+            buffer.get() + slot * chunkSize))
+        {
+            success = false;
+            break;
+        }
+        transferred += requests[slot].len;
+    }
+
+    // Buffer must not be released while chunks are still read into it.
+    for (unsigned slot = 0; slot < TRANSFER_PIPELINE_DEPTH; slot++)
+    {
+        storagedrive_aio->wait(&requests[slot]);
+    }
+
+    return success;
+}
+
+//
+// StreamWrite():
+//  Transfers a large WRITE chunk by chunk: while a chunk is DMA'd from
+//  the host, the previous chunks are written to disk by the storagedrive
+//  thread pool.  Returns false on NXM, 'transferred' is then the count
+//  of bytes written to disk before the failing chunk.
+//
+bool
+mscp_server::StreamWrite(
+    mscp_drive_c* drive,
+    uint32_t blockNumber,
+    uint32_t byteCount,
+    uint32_t address,
+    uint32_t& transferred)
+{
+    uint32_t chunkSize = TRANSFER_CHUNK_BLOCKS * drive->GetBlockSize();
+    uint32_t chunkCount = (byteCount + chunkSize - 1) / chunkSize;
+    std::unique_ptr<uint8_t, DMABufferDeleter> buffer(
+        _port->DMABufferAlloc(TRANSFER_PIPELINE_DEPTH * chunkSize), DMABufferDeleter(_port));
+    storagedrive_aio_request_c requests[TRANSFER_PIPELINE_DEPTH];
+
+    bool success = true;
+    transferred = 0;
+    for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+    {
+        unsigned slot = chunk % TRANSFER_PIPELINE_DEPTH;
+        uint8_t* chunkBuffer = buffer.get() + slot * chunkSize;
+        uint32_t length = std::min(chunkSize, byteCount - chunk * chunkSize);
+
+        // wait until the chunk buffer is written to disk
+        storagedrive_aio->wait(&requests[slot]);
+        if (!_port->DMARead(
+            address + chunk * chunkSize,
+            length,
+            chunkBuffer))
+        {
+            success = false;
+            break;
+        }
+
+        if (chunk + 1 < chunkCount)
+        {
+            drive->WriteAsync(&requests[slot],
+                blockNumber + chunk * TRANSFER_CHUNK_BLOCKS,
+                length,
+                chunkBuffer);
+        }
+        else
+        {
+            // Last chunk: Write() also clears the rest of a partial block,
+            // after all previous chunks.
+            for (unsigned i = 0; i < TRANSFER_PIPELINE_DEPTH; i++)
+            {
+                storagedrive_aio->wait(&requests[i]);
+            }
+            drive->Write(blockNumber + chunk * TRANSFER_CHUNK_BLOCKS,
+                length,
+                chunkBuffer);
+        }
+        transferred += length;
+    }
+
+    for (unsigned slot = 0; slot < TRANSFER_PIPELINE_DEPTH; slot++)
+    {
+        storagedrive_aio->wait(&requests[slot]);
+    }
+
+    return success;
+}
+
 //
 // GetParameterPointer():
 //  Returns a pointer to the Parameter text in the given Message.
 //
 uint8_t*
 mscp_server::GetParameterPointer(
-    std::shared_ptr<Message> message)
+    Message* message)
 {
     // We silence a strict aliasing warning here; this is safe (if perhaps not recommended
     // the general case.)
@@ -1153,6 +1550,10 @@ mscp_server::Reset(void)
     }  
     pthread_mutex_unlock(&polling_mutex);
 
+    // Commands already running on units complete, queued ones are dropped.
+    DiscardUnitCommands();
+    WaitUnitsIdle();
+
     _credits = INIT_CREDITS;
 
     // Release all drives
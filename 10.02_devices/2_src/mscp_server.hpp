@@ -9,6 +9,7 @@
 
 #include <stdint.h>
 #include <memory>
+#include <vector>
 
 class uda_c;
 class Message;
@@ -31,6 +32,14 @@ class mscp_drive_c;
 
 #define HEADER_OFFSET 4
 
+// Threads executing commands, for different units in parallel
+#define UNIT_WORKER_COUNT 4
+
+// Large READ and WRITE transfers are streamed in chunks: disk I/O of
+// one chunk overlaps the DMA of the previous one.
+#define TRANSFER_CHUNK_BLOCKS 16
+#define TRANSFER_PIPELINE_DEPTH 4     // chunk buffers in flight
+
 //
 // ControlMessageHeader encapsulates the standard MSCP control
 // message header: a 12-byte header followed by up to 36 bytes of
@@ -173,6 +182,7 @@ public:
     void Reset(void);
     void InitPolling(void);
     void Poll(void);
+    void UnitWorker(void);
 
 public:
     void on_power_changed(signal_edge_enum aclo_edge, signal_edge_enum dclo_edge) override {
@@ -183,32 +193,42 @@ public:
 
 private:
     uint32_t Abort(void);
-    uint32_t Access(std::shared_ptr<Message> message, uint16_t unitNumber);
+    uint32_t Access(Message* message, uint16_t unitNumber);
     uint32_t Available(uint16_t unitNumber, uint16_t modifiers);
-    uint32_t CompareHostData(std::shared_ptr<Message> message, uint16_t unitNumber);
+    uint32_t CompareHostData(Message* message, uint16_t unitNumber);
     uint32_t DetermineAccessPaths(uint16_t unitNumber);
-    uint32_t Erase(std::shared_ptr<Message> message, uint16_t unitNumber, uint16_t modifiers);
-    uint32_t GetCommandStatus(std::shared_ptr<Message> message);
-    uint32_t GetUnitStatus(std::shared_ptr<Message> message, uint16_t unitNumber, uint16_t modifiers);
-    uint32_t Online(std::shared_ptr<Message> message, uint16_t unitNumber, uint16_t modifiers);
-    uint32_t SetControllerCharacteristics(std::shared_ptr<Message> message);
-    uint32_t SetUnitCharacteristics(std::shared_ptr<Message> message, uint16_t unitNumber, uint16_t modifiers);
-    uint32_t Read(std::shared_ptr<Message> message, uint16_t unitNumber, uint16_t modifiers);
-    uint32_t Replace(std::shared_ptr<Message> message, uint16_t unitNumber);
-    uint32_t Write(std::shared_ptr<Message> message, uint16_t unitNumber, uint16_t modifiers);
+    uint32_t Erase(Message* message, uint16_t unitNumber, uint16_t modifiers);
+    uint32_t GetCommandStatus(Message* message);
+    uint32_t GetUnitStatus(Message* message, uint16_t unitNumber, uint16_t modifiers);
+    uint32_t Online(Message* message, uint16_t unitNumber, uint16_t modifiers);
+    uint32_t SetControllerCharacteristics(Message* message);
+    uint32_t SetUnitCharacteristics(Message* message, uint16_t unitNumber, uint16_t modifiers);
+    uint32_t Read(Message* message, uint16_t unitNumber, uint16_t modifiers);
+    uint32_t Replace(Message* message, uint16_t unitNumber);
+    uint32_t Write(Message* message, uint16_t unitNumber, uint16_t modifiers);
 
     uint32_t SetUnitCharacteristicsInternal(
-        std::shared_ptr<Message> message,
+        Message* message,
         uint16_t unitNumber,
         uint16_t modifiers,
         bool bringOnline);
-    uint32_t DoDiskTransfer(uint16_t operation, std::shared_ptr<Message> message, uint16_t unitNumber, uint16_t modifiers);
-    uint8_t* GetParameterPointer(std::shared_ptr<Message> message);
+    uint32_t DoDiskTransfer(uint16_t operation, Message* message, uint16_t unitNumber, uint16_t modifiers);
+    bool StreamRead(mscp_drive_c* drive, uint32_t blockNumber, uint32_t byteCount,
+        uint32_t address, uint32_t& transferred);
+    bool StreamWrite(mscp_drive_c* drive, uint32_t blockNumber, uint32_t byteCount,
+        uint32_t address, uint32_t& transferred);
+    uint8_t* GetParameterPointer(Message* message);
+    void DispatchCommand(Message* message);
+    void ExecuteCommand(Message* message);
     mscp_drive_c* GetDrive(uint32_t unitNumber);
 
 private:
     void StartPollingThread(void);
     void AbortPollingThread(void);
+    void StartUnitWorkers(void);
+    void AbortUnitWorkers(void);
+    void WaitUnitsIdle(void);
+    void DiscardUnitCommands(void);
 
 private:
     uint32_t _hostTimeout;
@@ -232,6 +252,51 @@ private:
     pthread_cond_t polling_cond;
     pthread_mutex_t polling_mutex;
 
+    // Per unit command queue, commands for one unit execute in order.
+    // Entries before 'head' are taken. The vector keeps its capacity,
+    // so in steady state queueing does not allocate.
+    struct UnitQueue
+    {
+        std::vector<Message*> messages;
+        size_t head = 0;
+        bool busy = false;  // a unit worker executes a command for this unit
+
+        bool empty(void) { return head == messages.size(); }
+
+        void push(Message* message)
+        {
+            if (head > 0 && head * 2 >= messages.size())
+            {
+                messages.erase(messages.begin(), messages.begin() + head);
+                head = 0;
+            }
+            messages.push_back(message);
+        }
+
+        Message* pop(void)
+        {
+            Message* message = messages[head++];
+            if (empty())
+            {
+                messages.clear();
+                head = 0;
+            }
+            return message;
+        }
+    };
+    std::vector<UnitQueue> _unitQueues;     // indexed by unit number
+    std::vector<uint16_t> _readyUnits;      // have commands, not busy
+    std::vector<Message*> _pollMessages;    // read from the command ring
+    uint32_t _unitCommandsPending;          // queued + executing
+    bool _abort_units;
+    std::vector<pthread_t> _unitWorkers;
+    pthread_cond_t unit_cond;               // command queued
+    pthread_cond_t unit_idle_cond;          // command completed
+    pthread_mutex_t unit_mutex;
+
+    // Credits and response ring, shared by unit workers
+    pthread_mutex_t response_mutex;
+
     // Credits available
     uint8_t _credits;
 };
@@ -14,6 +14,7 @@
 #include "qunibus.h"
 #include "qunibusadapter.hpp"
 #include "qunibusdevice.hpp"
+#include "ddrmem.h"
 #include "storagecontroller.hpp"
 #include "rk11.hpp"   
 #include "rk05.hpp"
@@ -106,6 +107,9 @@ rk11_c::rk11_c() :     storagecontroller_c(),  _new_command_ready(false)
         drive->parent = this;
         storagedrives.push_back(drive);
     }
+
+    _sectorBuffer = ddrmem->dma_buffer_alloc(256);
+    _checkBuffer = ddrmem->dma_buffer_alloc(256);
 }
   
 rk11_c::~rk11_c()
@@ -114,6 +118,8 @@ rk11_c::~rk11_c()
     {
         delete storagedrives[i];
     }
+    ddrmem->dma_buffer_free(_sectorBuffer);
+    ddrmem->dma_buffer_free(_checkBuffer);
 }
 
 // RLV11 is only 18 bit capable, and has an (unimplementedd) maintenance mode.
@@ -289,8 +295,8 @@ void rk11_c::worker(unsigned instance)
                             // and submit DMA requests one at a time, waiting for
                             // their completion. 
                           
-                            uint16_t sectorBuffer[256];
-                            uint16_t checkBuffer[256];
+                            uint16_t *sectorBuffer = _sectorBuffer;
+                            uint16_t *checkBuffer = _checkBuffer;
  
                             uint32_t current_address = command.address;
                             int16_t current_count = -(int16_t)(get_register_dato_value(RKWC_reg));
@@ -325,7 +331,7 @@ void rk11_c::worker(unsigned instance)
                                 // Clear the buffer.  This is only necessary because short writes
                                 // and reads expect the rest of the sector to be filled with zeroes.
                                 //
-                                memset(sectorBuffer, 0, sizeof(sectorBuffer));
+                                memset(sectorBuffer, 0, 256 * sizeof(uint16_t));
                                 
                                 if (read)
                                 {
@@ -102,6 +102,10 @@ private:
         bool timeout;
     };
 
+    // Sector buffers in DDR: PRU DMAs directly from/to them, no copy via mailbox
+    uint16_t *_sectorBuffer;
+    uint16_t *_checkBuffer;
+
     volatile bool _new_command_ready;   // Used in sync. between C/S register updates and worker thread.
                                    // If set, causes worker to abandon any current command and
                                    // pick up a new one.
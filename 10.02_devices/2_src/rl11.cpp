@@ -21,6 +21,7 @@
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
+ 16-oct-2026  QC      silo in DDR for zero-copy DMA
  12-nov-2018  JH      entered beta phase
 
 
@@ -96,6 +97,7 @@
 #include "utils.hpp"
 #include "qunibus.h"
 #include "qunibusadapter.hpp"
+#include "ddrmem.h"
 #include "panel.hpp"
 #include "rl11.hpp"
 #include "rl0102.hpp"
@@ -188,6 +190,9 @@ RL11_c::RL11_c(void) :    storagecontroller_c()
 
     busreg_BAE = NULL ;
 
+    // PRU transfers sectors directly from/to DDR, no copy via mailbox
+    silo = ddrmem->dma_buffer_alloc(RL11_SILO_WORDCOUNT);
+    silo_compare = ddrmem->dma_buffer_alloc(RL11_SILO_WORDCOUNT);
 }
 
 RL11_c::~RL11_c() 
@@ -195,6 +200,8 @@ RL11_c::~RL11_c()
     unsigned i;
     for (i = 0; i < drivecount; i++)
         delete storagedrives[i];
+    ddrmem->dma_buffer_free(silo);
+    ddrmem->dma_buffer_free(silo_compare);
 }
 
 // RLV11 is only 18 bit capable, and has an (unimplementedd) maintenance mode.
@@ -765,7 +772,7 @@ void RL11_c::state_readwrite()
     unsigned cmd_wordcount = get_MP_wordcount(); // wordcount in hidden MP register
     unsigned dma_wordcount; // len of current DMA transaction
 
-    assert(sizeof(silo) / 2 >= sector_wordcount);
+    assert(RL11_SILO_WORDCOUNT >= sector_wordcount);
     assert(
         function_code == RL11_CMD_READ_DATA_WITHOUT_HEADER_CHECK || function_code == RL11_CMD_READ_DATA || function_code == RL11_CMD_WRITE_DATA || function_code == RL11_CMD_WRITE_CHECK);
 
@@ -817,8 +824,8 @@ void RL11_c::state_readwrite()
         else
             dma_wordcount = cmd_wordcount; // transfer all remaining words
 
-        memset((uint8_t *) silo, 0, sizeof(silo));
-        memset((uint8_t *) silo_compare, 0, sizeof(silo_compare));
+        memset((uint8_t *) silo, 0, 2 * RL11_SILO_WORDCOUNT);
+        memset((uint8_t *) silo_compare, 0, 2 * RL11_SILO_WORDCOUNT);
 
         if (function_code == RL11_CMD_READ_DATA
                 || function_code == RL11_CMD_READ_DATA_WITHOUT_HEADER_CHECK) {
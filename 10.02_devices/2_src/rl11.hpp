@@ -21,6 +21,7 @@
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
+ 16-oct-2026  QC      silo in DDR for zero-copy DMA
  12-nov-2018  JH      entered beta phase
  */
 #ifndef _RL11_HPP_
@@ -29,6 +30,8 @@
 #include "qunibusadapter.hpp"
 #include "storagecontroller.hpp"
 
+#define RL11_SILO_WORDCOUNT	128 // one sector
+
 class RL0102_c;
 class RL11_c: public storagecontroller_c {
 private:
@@ -56,9 +59,9 @@ private:
     volatile uint16_t mpr_silo[3];  // max 3 word deep buffer
     volatile unsigned mpr_silo_idx;  // read index in MP register SILO
 
-    // data buffer to/from drive
-    uint16_t silo[128]; // buffer from/to drive
-    uint16_t silo_compare[128]; // memory data to be compared with silo
+    // data buffer to/from drive, in DDR for zero-copy DMA
+    uint16_t *silo; // buffer from/to drive, RL11_SILO_WORDCOUNT
+    uint16_t *silo_compare; // memory data to be compared with silo
 
     // RL11 has one INTR and DMA
     dma_request_c dma_request = dma_request_c(this); // operated by qunibusadapter
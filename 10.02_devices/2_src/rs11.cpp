@@ -110,7 +110,7 @@ size_t rs11_c::clip_into_range(uint32_t wordAddress, size_t count)
     if (diff > 0)
     {
         // Adjust count so it fits within the available address space
-        count = max(static_cast<uint32_t>(0), count - diff);
+        count = max(static_cast<size_t>(0), count - diff);
     }
 
     return count;
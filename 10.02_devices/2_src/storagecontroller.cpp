@@ -21,6 +21,7 @@
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
+ 16-oct-2026  QC      flush write-back cache on power fail
  12-nov-2018  JH      entered beta phase
 
  A qunibus device with several "storagedrives"
@@ -71,6 +72,9 @@ void storagecontroller_c::on_power_changed(signal_edge_enum aclo_edge, signal_ed
 {
 	std::vector<storagedrive_c*>::iterator it;
 	for (it = storagedrives.begin(); it != storagedrives.end(); it++) {
+		// power fail: data in write-back cache to image
+		if (aclo_edge == SIGNAL_EDGE_RAISING || dclo_edge == SIGNAL_EDGE_RAISING)
+			(*it)->image_flush();
 		// drives should evaluate only DCLO for power to simulate wall power.
 		(*it)->on_power_changed(aclo_edge, dclo_edge);
 	}
@@ -21,6 +21,14 @@
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
+ 16-oct-2026  QC      image_mutex: sync and async image accesses serialized
+ 16-oct-2026  QC      image_set_zero()
+ 16-oct-2026  QC      asynchronous image_read/write
+ 16-oct-2026  QC      compressed images
+ 16-oct-2026  QC      copy-on-write overlay
+ 16-oct-2026  QC      read-ahead
+ 16-oct-2026  QC      write-back cache
+ 16-oct-2026  QC      image_mmap, image_sync
  may-2019		JD		file_size()
  12-nov-2018  JH      entered beta phase
 
@@ -58,6 +66,10 @@ storagedrive_c::storagedrive_c(storagecontroller_c *_controller) :
      */
 
     image = nullptr ; // create on parameter setting
+    cache = nullptr ; // create on image open
+    cache_blocks.value = 256 ; // 128KB
+    cache_flush_ms.value = 1000 ;
+    readahead_blocks.value = 32 ; // > 1 RL/RK track
     // or pure "shared" directory, or syncronizing share<->binary image
 
     // default: shared filesystem not (yet) implementable for this disk type (MSCP)
@@ -75,18 +87,54 @@ void storagedrive_c::image_params_readonly(bool readonly)
     image_filepath.readonly = readonly ;
     image_filesystem.readonly = readonly ;
     image_shareddir.readonly = readonly ;
+    image_mmap.readonly = readonly ;
+    image_sync.readonly = readonly ;
+    image_overlay.readonly = readonly ;
+    overlay_discard.readonly = readonly ;
 }
 
 bool storagedrive_c::image_is_param(parameter_c *param) 
 {
     return (param == &image_filepath)
            || (param == &image_filesystem)
-           || (param == &image_shareddir) ;
+           || (param == &image_shareddir)
+           || (param == &image_mmap)
+           || (param == &image_sync)
+           || (param == &image_overlay)
+           || (param == &overlay_discard) ;
 }
 
 // implements params, so must handle "change"
 bool storagedrive_c::on_param_changed(parameter_c *param) 
 {
+    if (param == &overlay_snapshot) {
+        if (overlay_snapshot.new_value.empty())
+            return true ;
+        storageimage_overlay_c *overlay = dynamic_cast<storageimage_overlay_c *>(image) ;
+        if (overlay == nullptr || !overlay->is_open()) {
+            ERROR("Snapshot needs an open overlay image") ;
+            return false ;
+        }
+        image_flush() ; // cached data into snapshot
+        image_lock() ;
+        bool result = overlay->snapshot(overlay_snapshot.new_value) ;
+        image_unlock() ;
+        return result ;
+    } else if (param == &overlay_commit) {
+        if (!overlay_commit.new_value)
+            return true ;
+        overlay_commit.new_value = false ; // action, no state
+        storageimage_overlay_c *overlay = dynamic_cast<storageimage_overlay_c *>(image) ;
+        if (overlay == nullptr || !overlay->is_open()) {
+            ERROR("Commit needs an open overlay image") ;
+            return false ;
+        }
+        image_flush() ;
+        image_lock() ;
+        bool result = overlay->commit() ;
+        image_unlock() ;
+        return result ;
+    }
     // no own "enable" logic
     return device_c::on_param_changed(param);
 }
@@ -96,6 +144,8 @@ void storagedrive_c::image_delete()
 {
     if (image == nullptr)
         return ;
+    image_wait_async() ;
+    cache_delete() ;
     storageimage_base_c *tmpimage = image ;
     image = nullptr ; // semi-atomic
     delete tmpimage ;
@@ -120,7 +170,8 @@ bool storagedrive_c::image_recreate_on_param_change(parameter_c *param)
         image_delete() ;
 		accepted = image_recreate_shared_on_param_change(image_filepath.new_value, image_filesystem.value, image_shareddir.value) ;
 	    if (image == nullptr)  // not enough params for shared dir: try regular image
-	        image = new storageimage_binfile_c(image_filepath.new_value) ; // dyn size
+	        image = image_create_binary(image_filepath.new_value, image_mmap.value, image_sync.value,
+	                                    image_overlay.value, overlay_discard.value) ; // dyn size
         accepted = (image != nullptr) ;
     } else if (param == &image_filesystem) {
         // shared image file system change?
@@ -131,10 +182,75 @@ bool storagedrive_c::image_recreate_on_param_change(parameter_c *param)
     } else if (param == &image_shareddir) {
         // shared image host root dir change?
         accepted = image_recreate_shared_on_param_change(image_filepath.value, image_filesystem.value, image_shareddir.new_value) ;
+    } else if (param == &image_mmap || param == &image_sync
+               || param == &image_overlay || param == &overlay_discard) {
+        // access method of binary image changed
+        std::string sync_paramval = (param == &image_sync) ? image_sync.new_value : image_sync.value ;
+        bool use_mmap = (param == &image_mmap) ? image_mmap.new_value : image_mmap.value ;
+        std::string overlay_path = (param == &image_overlay) ? image_overlay.new_value : image_overlay.value ;
+        bool discard_overlay = (param == &overlay_discard) ? overlay_discard.new_value : overlay_discard.value ;
+        enum storageimage_mmap_c::sync_policy_e sync_policy ;
+        if (!sync_paramval.empty() && !storageimage_mmap_c::sync_policy_from_text(sync_paramval, &sync_policy)) {
+            ERROR("image_sync must be kernel, async or sync") ;
+            return false ;
+        }
+        accepted = true ;
+        // reinstantiate a binary image, but not a shared one
+        if (!image_filepath.value.empty()
+                && (image_filesystem.value.empty() || image_shareddir.value.empty())) {
+            image_delete() ;
+            image = image_create_binary(image_filepath.value, use_mmap, sync_paramval, overlay_path, discard_overlay) ;
+        }
     }
     return accepted ;
 }
 
+// binary image file, via file stream or mapped into memory.
+// Or copy-on-write overlay over it, then image file is only read.
+// A delta file as image is opened with its parent chain.
+// A compressed image is only read, changes go to an overlay, default "<image>.cow".
+// Only "<image>.gz" existing: converted to compressed "<image>.qcz" once,
+// and again when the .gz is replaced,
+// instead of expanding it to "<image>".
+// sync_paramval already checked
+storageimage_base_c *storagedrive_c::image_create_binary(std::string image_path, bool use_mmap, std::string sync_paramval,
+        std::string overlay_path, bool discard_overlay)
+{
+    std::string compressed_path ;
+    std::string gz_path = image_path + ".gz" ;
+    if (storageimage_compressed_c::is_compressed_file(image_path))
+        compressed_path = image_path ;
+    else if (!file_exists(&image_path) && file_exists(&gz_path)) {
+        compressed_path = image_path + ".qcz" ;
+        // converted once, again if the .gz was replaced
+        if (!storageimage_compressed_c::is_converted_from(compressed_path, gz_path)) {
+            std::string cow_path = overlay_path.empty() ? image_path + ".cow" : overlay_path ;
+            if (file_exists(&compressed_path) && file_exists(&cow_path))
+                WARNING("%s changed, overlay %s was made for the previous content", gz_path.c_str(),
+                        cow_path.c_str()) ;
+            if (!storageimage_compressed_c::create_from_file(gz_path, compressed_path)) {
+                ERROR("Can not convert %s", gz_path.c_str()) ;
+                return nullptr ;
+            }
+        }
+    }
+    if (!compressed_path.empty()) {
+        if (overlay_path.empty())
+            overlay_path = image_path + ".cow" ;
+        return new storageimage_overlay_c(overlay_path, compressed_path, discard_overlay) ;
+    }
+    if (!overlay_path.empty())
+        return new storageimage_overlay_c(overlay_path, image_path, discard_overlay) ;
+    if (storageimage_overlay_c::is_overlay_file(image_path))
+        return new storageimage_overlay_c(image_path, "", false) ;
+    if (!use_mmap)
+        return new storageimage_binfile_c(image_path) ;
+    enum storageimage_mmap_c::sync_policy_e sync_policy = storageimage_mmap_c::sync_kernel ;
+    if (!sync_paramval.empty())
+        storageimage_mmap_c::sync_policy_from_text(sync_paramval, &sync_policy) ;
+    return new storageimage_mmap_c(image_path, sync_policy) ;
+}
+
 // eval parameter set for shared image
 // result: parameter accepted, image recreated
 bool storagedrive_c::image_recreate_shared_on_param_change(std::string image_path, std::string filesystem_paramval, std::string shareddir_paramval) 
@@ -169,17 +285,93 @@ bool storagedrive_c::image_open(bool create)
     if (image == nullptr)
         return false ;
 
+    cache_delete() ; // open() may close and reopen
     // virtual method of implementation
-    return image->open(this, create) ;
+    bool result = image->open(this, create) ;
+    // shared image is changed by its syncer thread, no cache
+    if (result && image->is_open() && cache_blocks.value > 0
+            && dynamic_cast<sharedfilesystem::storageimage_shared_c *>(image) == nullptr) {
+        cache = new storagedrive_cache_c(image, cache_blocks.value, cache_flush_ms.value, readahead_blocks.value) ;
+        cache->log_level_ptr = log_level_ptr ; // same log level as drive
+    }
+    cache_update_stats() ;
+    return result ;
 }
 
 void storagedrive_c::image_close(void) 
 {
     if (image == nullptr)
         return ;
+    image_wait_async() ;
+    cache_delete() ;
     image->close() ;
 }
 
+// exclusive access to image, against PDP accesses via cache or storagedrive_aio
+void storagedrive_c::image_lock(void)
+{
+    pthread_mutex_lock(&image_mutex);
+    if (cache != nullptr)
+        cache->image_lock() ;
+}
+
+void storagedrive_c::image_unlock(void)
+{
+    if (cache != nullptr)
+        cache->image_unlock() ;
+    pthread_mutex_unlock(&image_mutex);
+}
+
+// write all dirty blocks to image, stops flusher thread
+void storagedrive_c::cache_delete(void)
+{
+    if (cache == nullptr)
+        return ;
+    storagedrive_cache_c *tmpcache = cache ;
+    cache = nullptr ;
+    delete tmpcache ;
+    // statistics of the deleted cache are not valid for the next one
+    cache_hits.value = 0 ;
+    cache_misses.value = 0 ;
+    cache_dirty.value = 0 ;
+    readahead_loaded.value = 0 ;
+    readahead_hits.value = 0 ;
+    readahead_hit_rate.value = 0 ;
+}
+
+// copy cache counters to "readonly" parameters
+void storagedrive_c::cache_update_stats(void)
+{
+    if (cache == nullptr)
+        return ;
+    cache_hits.value = cache->hits ;
+    cache_misses.value = cache->misses ;
+    cache_dirty.value = cache->dirty_count ;
+    readahead_loaded.value = cache->readahead_loaded ;
+    readahead_hits.value = cache->readahead_hits ;
+    if (readahead_loaded.value > 0)
+        readahead_hit_rate.value = (100 * readahead_hits.value) / readahead_loaded.value ;
+    else
+        readahead_hit_rate.value = 0 ;
+}
+
+// flusher thread and read-ahead change counters in background
+void storagedrive_c::on_params_render(void)
+{
+    cache_update_stats() ;
+}
+
+// write pending data to image, synchronously
+// also waits for pending asynchronous writes
+void storagedrive_c::image_flush(void)
+{
+    image_wait_async() ;
+    if (cache == nullptr)
+        return ;
+    cache->flush() ;
+    cache_update_stats() ;
+}
+
 bool storagedrive_c::image_is_open(void) 
 {
     if (image == nullptr)
@@ -197,14 +389,24 @@ bool storagedrive_c::image_is_readonly()
 bool storagedrive_c::image_truncate(void) {
     if (image == nullptr)
         return false ; // is_open
-    return image->truncate() ;
+    if (cache != nullptr)
+        return cache->truncate() ;
+    pthread_mutex_lock(&image_mutex);
+    bool result = image->truncate() ;
+    pthread_mutex_unlock(&image_mutex);
+    return result ;
 }
 
 uint64_t storagedrive_c::image_size(void) 
 {
     if (image == nullptr)
         return 0 ;
-    return image->size() ;
+    if (cache != nullptr)
+        return cache->size() ;
+    pthread_mutex_lock(&image_mutex);
+    uint64_t result = image->size() ;
+    pthread_mutex_unlock(&image_mutex);
+    return result ;
 }
 
 void storagedrive_c::image_read(uint8_t *buffer, uint64_t position, unsigned len) 
@@ -212,7 +414,14 @@ void storagedrive_c::image_read(uint8_t *buffer, uint64_t position, unsigned len
     if (image == nullptr)
         return ;
     set_activity_led(true) ; // indicate only read/write access
-    image->read(buffer, position, len) ;
+    if (cache != nullptr) {
+        cache->read(buffer, position, len) ;
+        cache_update_stats() ;
+    } else {
+        pthread_mutex_lock(&image_mutex);
+        image->read(buffer, position, len) ;
+        pthread_mutex_unlock(&image_mutex);
+    }
     set_activity_led(false) ;
 }
 
@@ -221,9 +430,73 @@ void storagedrive_c::image_write(uint8_t *buffer, uint64_t position, unsigned le
     if (image == nullptr)
         return ;
     set_activity_led(true) ;
-    image->write(buffer, position, len) ;
+    if (cache != nullptr) {
+        cache->write(buffer, position, len) ;
+        cache_update_stats() ;
+    } else {
+        pthread_mutex_lock(&image_mutex);
+        image->write(buffer, position, len) ;
+        pthread_mutex_unlock(&image_mutex);
+    }
     set_activity_led(false) ;
 }
+
+// write 00s. Sparse image files get holes, nothing written if already zero.
+void storagedrive_c::image_set_zero(uint64_t position, unsigned len)
+{
+    if (image == nullptr)
+        return ;
+    set_activity_led(true) ;
+    if (cache != nullptr) {
+        cache->set_zero(position, len) ;
+        cache_update_stats() ;
+    } else {
+        pthread_mutex_lock(&image_mutex);
+        if (position + len > image->size() || !image->is_zero(position, len))
+            image->set_zero(position, len) ;
+        pthread_mutex_unlock(&image_mutex);
+    }
+    set_activity_led(false) ;
+}
+
+// Request is executed by storagedrive_aio thread pool, in order of submission.
+// Blocking image_read() and image_write() may be mixed with these: all image
+// accesses are serialized by the cache or "image_mutex". But the order of a blocking
+// and a pending async access to the same blocks is undefined, wait for completion.
+void storagedrive_c::image_read_async(storagedrive_aio_request_c *request, uint8_t *buffer, uint64_t position,
+                                      unsigned len, storagedrive_aio_callback_t callback, void *context)
+{
+    request->drive = this ;
+    request->is_write = false ;
+    request->buffer = buffer ;
+    request->position = position ;
+    request->len = len ;
+    request->callback = callback ;
+    request->context = context ;
+    storagedrive_aio->submit(&aio_queue, request) ;
+}
+
+// "buffer" must stay unchanged until request complete
+void storagedrive_c::image_write_async(storagedrive_aio_request_c *request, uint8_t *buffer, uint64_t position,
+                                       unsigned len, storagedrive_aio_callback_t callback, void *context)
+{
+    request->drive = this ;
+    request->is_write = true ;
+    request->buffer = buffer ;
+    request->position = position ;
+    request->len = len ;
+    request->callback = callback ;
+    request->context = context ;
+    storagedrive_aio->submit(&aio_queue, request) ;
+}
+
+// until all asynchronous requests completed. Not from a callback!
+void storagedrive_c::image_wait_async(void)
+{
+    if (storagedrive_aio != nullptr)
+        storagedrive_aio->drain(&aio_queue) ;
+}
+
 // Service function for disk drive who need to clear unwritten bytes in last block of transaction
 // Sometimes when writing incomplete disk blocks, the remaining bytes must be filled with 00s
 // Some disk are guaranteed to write only whole blocks, then always unused_byte_count=0
@@ -255,26 +528,26 @@ void storagedrive_c::set_activity_led(bool onoff)
 
 
 // fill buffer with test data to be placed at "file_offset"
-void storagedrive_selftest_c::block_buffer_fill(unsigned block_number) 
+void storagedrive_selftest_c::block_buffer_fill(uint8_t *buffer, unsigned block_number) 
 {
     assert((block_size % 4) == 0); // whole uint32_t
     for (unsigned i = 0; i < block_size / 4; i++) {
         // i counts dwords in buffer
         // pattern: global incrementing uint32_t
         uint32_t pattern = i + (block_number * block_size / 4);
-        ((uint32_t*) block_buffer)[i] = pattern;
+        ((uint32_t*) buffer)[i] = pattern;
     }
 }
 
 // verify pattern generated by fillbuff
-void storagedrive_selftest_c::block_buffer_check(unsigned block_number) 
+void storagedrive_selftest_c::block_buffer_check(uint8_t *buffer, unsigned block_number) 
 {
     assert((block_size % 4) == 0);	// whole uint32_t
     for (unsigned i = 0; i < block_size / 4; i++) {
         // i counts dwords in buffer
         // pattern: global incrementing uint32_t
         uint32_t pattern_expected = i + (block_number * block_size / 4);
-        uint32_t pattern_found = ((uint32_t*) block_buffer)[i];
+        uint32_t pattern_found = ((uint32_t*) buffer)[i];
         if (pattern_expected != pattern_found) {
             printf(
                 "ERROR storage_drive selftest: Block %d, dword %d: expected 0x%x, found 0x%x\n",
@@ -301,7 +574,7 @@ void storagedrive_selftest_c::test()
     blocks_to_touch = block_count;
     while (blocks_to_touch > 0) {
         unsigned block_number = random() % block_count;
-        block_buffer_fill(block_number);
+        block_buffer_fill(block_buffer, block_number);
         image_write(block_buffer, /*position*/block_size * block_number, block_size);
         if (!block_touched[block_number]) { // mark
             block_touched[block_number] = true;
@@ -320,7 +593,7 @@ void storagedrive_selftest_c::test()
     while (blocks_to_touch > 0) {
         unsigned block_number = random() % block_count;
         image_read(block_buffer, /*position*/block_size * block_number, block_size);
-        block_buffer_check(block_number);
+        block_buffer_check(block_buffer, block_number);
         if (!block_touched[block_number]) { // mark
             block_touched[block_number] = true;
             blocks_to_touch--;
@@ -330,5 +603,53 @@ void storagedrive_selftest_c::test()
     image_close();
 
     free(block_touched);
+
+    /*** blocking and asynchronous accesses mixed, without and with cache ***/
+    test_async(0) ;
+    test_async(16) ;
+}
+
+// Even blocks are accessed asynchronously by the storagedrive_aio pool,
+// odd blocks meanwhile by blocking calls: both access the image in parallel.
+void storagedrive_selftest_c::test_async(unsigned cache_block_count)
+{
+    storagedrive_aio_request_c *requests = new storagedrive_aio_request_c[block_count] ;
+    uint8_t *async_buffers = (uint8_t *) malloc(block_count * block_size) ;
+
+    cache_blocks.value = cache_block_count ;
+    image_open(true);
+    image_truncate() ; // blocks not written read as 00s
+
+    for (unsigned block_number = 0; block_number < block_count; block_number += 2) {
+        uint8_t *buffer = async_buffers + block_number * block_size ;
+        block_buffer_fill(buffer, block_number);
+        image_write_async(&requests[block_number], buffer, block_size * block_number, block_size, nullptr, nullptr) ;
+        if (block_number + 1 < block_count) {
+            block_buffer_fill(block_buffer, block_number + 1);
+            image_write(block_buffer, block_size * (block_number + 1), block_size);
+        }
+        if (block_number > 0) {
+            image_read(block_buffer, block_size * (block_number - 1), block_size);
+            block_buffer_check(block_buffer, block_number - 1);
+        }
+    }
+    image_wait_async() ;
+
+    memset(async_buffers, 0, block_count * block_size) ;
+    for (unsigned block_number = 0; block_number < block_count; block_number += 2) {
+        image_read_async(&requests[block_number], async_buffers + block_number * block_size,
+                         block_size * block_number, block_size, nullptr, nullptr) ;
+        if (block_number + 1 < block_count) {
+            image_read(block_buffer, block_size * (block_number + 1), block_size);
+            block_buffer_check(block_buffer, block_number + 1);
+        }
+    }
+    image_wait_async() ;
+    for (unsigned block_number = 0; block_number < block_count; block_number += 2)
+        block_buffer_check(async_buffers + block_number * block_size, block_number);
+
+    image_close();
+    free(async_buffers) ;
+    delete[] requests ;
 }
 
@@ -20,6 +20,14 @@
  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
+ 16-oct-2026  QC      image_mutex: sync and async image accesses serialized
+ 16-oct-2026  QC      image_set_zero()
+ 16-oct-2026  QC      asynchronous image_read/write
+ 16-oct-2026  QC      compressed images
+ 16-oct-2026  QC      copy-on-write overlay
+ 16-oct-2026  QC      read-ahead
+ 16-oct-2026  QC      write-back cache
+ 16-oct-2026  QC      image_mmap, image_sync
  may-2019		JD		file_size()
  12-nov-2018  JH      entered beta phase
 
@@ -28,12 +36,17 @@
 #define _STORAGEDRIVE_HPP_
 
 #include <stdint.h>
+#include <pthread.h>
 #include <string>
 #include <fstream>
 #include <assert.h>
 
 #include "utils.hpp"
 #include "storageimage.hpp"
+#include "storageimage_compressed.hpp"
+#include "storageimage_overlay.hpp"
+#include "storagedrive_cache.hpp"
+#include "storagedrive_aio.hpp"
 #include "device.hpp"
 #include "parameter.hpp"
 
@@ -83,6 +96,20 @@ private:
     // hide from devices
     storageimage_base_c	*image = nullptr ;
 
+    // write-back cache in front of image, exists while image is open
+    storagedrive_cache_c *cache = nullptr ;
+    // Image accesses without cache, by the drive's threads and the storagedrive_aio pool.
+    // With cache, the cache serializes its image accesses itself.
+    pthread_mutex_t image_mutex = PTHREAD_MUTEX_INITIALIZER ;
+    void image_lock(void) ;
+    void image_unlock(void) ;
+    void cache_delete(void) ;
+    void cache_update_stats(void) ;
+
+    // submission queue for image_read_async()/image_write_async()
+    storagedrive_aio_queue_c aio_queue ;
+    void image_wait_async(void) ;
+
 public:
     storagecontroller_c *controller; // link to parent
 
@@ -101,18 +128,54 @@ public:
 
     // if binary image
     parameter_string_c image_filepath = parameter_string_c(this, "image", "img", /*readonly*/
-                                        false, "Path to binary image file. Empty to detach. \".gz\" archive also searched.");
+                                        false, "Path to binary image file. Empty to detach. \".gz\" archive also searched, used compressed.");
     // if shared host dir
 //		image_shareddir - path to directory root of shared host file tree
     parameter_string_c image_shareddir = parameter_string_c(this, "shared_dir", "shd", /*readonly*/
                                          false, "Path to directory with shared files. Created on demand, empty to disable sharing.");
     parameter_string_c image_filesystem = parameter_string_c(this, "shared_filesystem", "shfs", /*readonly*/
                                           false, "Encode shared dir in this file system (empty, RT11, XXDP).");
+    // access of binary image
+    parameter_bool_c image_mmap = parameter_bool_c(this, "image_mmap", "mmap", /*readonly*/
+                                  false, "Map binary image file into memory, instead of file stream I/O.");
+    parameter_string_c image_sync = parameter_string_c(this, "image_sync", "isync", /*readonly*/
+                                    false, "Write back of mapped image: kernel (default), async (MS_ASYNC) or sync (MS_SYNC) after each write.");
+    // copy-on-write: "image" is not written, changes go to overlay file
+    parameter_string_c image_overlay = parameter_string_c(this, "overlay", "ovl", /*readonly*/
+                                       false, "Path to copy-on-write delta file for image. Empty: write image directly.");
+    parameter_bool_c overlay_discard = parameter_bool_c(this, "overlay_discard", "ovd", /*readonly*/
+                                       false, "Delete overlay on close, image starts unchanged again.");
+    parameter_string_c overlay_snapshot = parameter_string_c(this, "overlay_snapshot", "ovsnap", /*readonly*/
+                                          false, "Set to file name: freeze overlay as snapshot, continue on new overlay.");
+    parameter_bool_c overlay_commit = parameter_bool_c(this, "overlay_commit", "ovcommit", /*readonly*/
+                                      false, "Set to 1: write overlay changes into image, clear overlay.");
+
+    // write-back cache, changes effective on next image open
+    parameter_unsigned_c cache_blocks = parameter_unsigned_c(this, "cache_blocks", "cb", /*readonly*/
+                                        false, "", "%d", "Blocks of 512 bytes in write-back cache, 0 = no cache", 16, 10);
+    parameter_unsigned_c cache_flush_ms = parameter_unsigned_c(this, "cache_flush_ms", "cfl", /*readonly*/
+                                          false, "ms", "%d", "Interval of dirty block write-back, 0 = only when needed", 16, 10);
+    parameter_unsigned64_c cache_hits = parameter_unsigned64_c(this, "cache_hits", "chit", /*readonly*/
+                                        true, "", "%u", "Blocks found in cache", 64, 10);
+    parameter_unsigned64_c cache_misses = parameter_unsigned64_c(this, "cache_misses", "cmiss", /*readonly*/
+                                          true, "", "%u", "Blocks read from or written to image directly", 64, 10);
+    parameter_unsigned_c cache_dirty = parameter_unsigned_c(this, "cache_dirty", "cdirty", /*readonly*/
+                                       true, "", "%d", "Blocks not yet written to image", 16, 10);
+    // sequential read-ahead into cache
+    parameter_unsigned_c readahead_blocks = parameter_unsigned_c(this, "readahead_blocks", "rab", /*readonly*/
+                                            false, "", "%d", "Blocks to prefetch on sequential read, 0 = off. Max cache_blocks/4", 16, 10);
+    parameter_unsigned64_c readahead_loaded = parameter_unsigned64_c(this, "readahead_loaded", "raload", /*readonly*/
+            true, "", "%u", "Blocks loaded by read-ahead", 64, 10);
+    parameter_unsigned64_c readahead_hits = parameter_unsigned64_c(this, "readahead_hits", "rahit", /*readonly*/
+                                            true, "", "%u", "Blocks loaded by read-ahead and read by PDP", 64, 10);
+    parameter_unsigned_c readahead_hit_rate = parameter_unsigned_c(this, "readahead_hit_rate", "rarate", /*readonly*/
+            true, "%", "%d", "readahead_hits / readahead_loaded", 8, 10);
 
     parameter_unsigned_c activity_led = parameter_unsigned_c(this, "activityled", "al", /*readonly*/
                                         false, "", "%d", "Number of LED to used for activity display.", 8, 10);
 
     virtual bool on_param_changed(parameter_c *param) override;
+    void on_params_render(void) override;
 
 //	parameter_bool_c writeprotect = parameter_bool_c(this, "writeprotect", "wp", /*readonly*/false, "Medium is write protected, different reasons") ;
 
@@ -129,6 +192,8 @@ public:
     void image_delete() ;
 private:
     bool image_recreate_shared_on_param_change(std::string image_path, std::string filesystem_paramval, std::string shareddir_paramval);
+    storageimage_base_c *image_create_binary(std::string image_path, bool use_mmap, std::string sync_paramval,
+            std::string overlay_path, bool discard_overlay) ;
 
 public:
     bool image_open(bool create) ;
@@ -139,6 +204,13 @@ public:
     uint64_t image_size(void) ;
     void image_read(uint8_t *buffer, uint64_t position, unsigned len) ;
     void image_write(uint8_t *buffer, uint64_t position, unsigned len) ;
+    void image_set_zero(uint64_t position, unsigned len) ;
+    void image_flush(void) ;
+    // non-blocking, "callback" from I/O thread when done
+    void image_read_async(storagedrive_aio_request_c *request, uint8_t *buffer, uint64_t position, unsigned len,
+                          storagedrive_aio_callback_t callback, void *context) ;
+    void image_write_async(storagedrive_aio_request_c *request, uint8_t *buffer, uint64_t position, unsigned len,
+                           storagedrive_aio_callback_t callback, void *context) ;
     void image_clear_remaining_block_bytes(unsigned block_size_bytes, uint64_t position, unsigned len) ;
 
     void set_activity_led(bool onoff) ;
@@ -151,13 +223,14 @@ private:
     unsigned block_count;
     uint8_t *block_buffer;
 
-    void block_buffer_fill(unsigned block_number);
-    void block_buffer_check(unsigned block_number);
+    void block_buffer_fill(uint8_t *buffer, unsigned block_number);
+    void block_buffer_check(uint8_t *buffer, unsigned block_number);
+    void test_async(unsigned cache_block_count);
 
 public:
     storagedrive_selftest_c(const char *_imagefname, unsigned _block_size, unsigned _block_count) :
         storagedrive_c(NULL) {
-        assert((block_size % 4) == 0); // whole uint32s
+        assert((_block_size % 4) == 0); // whole uint32s
         // this->image_filepath.set(string(imagefname)) ;
 
         imagefname = _imagefname;
@@ -169,7 +242,7 @@ public:
     }
     ~storagedrive_selftest_c() {
         free(block_buffer);
-        delete image ;
+        image_delete() ; // not twice by ~storagedrive_c
     }
 
     // fill abstracts
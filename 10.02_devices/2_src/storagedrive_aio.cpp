@@ -0,0 +1,145 @@
+/* storagedrive_aio.cpp: asynchronous image I/O for storage drives
+
+ Copyright (c) 2026, QUniBone contributors
+ https://github.com/j-hoppe/QUniBone
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ THE CONTRIBUTORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+ 16-oct-2026  QC      created
+ */
+#include <assert.h>
+
+#include "logger.hpp"
+#include "storagedrive.hpp"
+#include "storagedrive_aio.hpp"
+
+storagedrive_aio_c *storagedrive_aio; // singleton
+
+static void *storagedrive_aio_worker_pthread_wrapper(void *context)
+{
+    storagedrive_aio_c *aio = (storagedrive_aio_c *) context ;
+    aio->worker() ;
+    return NULL ;
+}
+
+storagedrive_aio_c::storagedrive_aio_c(unsigned thread_count)
+{
+    log_label = "aio" ;
+    terminate = false ;
+    submitted_count = 0 ;
+    max_pending = 0 ;
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&work_cond, NULL);
+    pthread_cond_init(&complete_cond, NULL);
+    threads.resize(thread_count) ;
+    for (unsigned i = 0; i < thread_count; i++) {
+        int status = pthread_create(&threads[i], NULL, &storagedrive_aio_worker_pthread_wrapper, this) ;
+        if (status != 0)
+            FATAL("Failed to create storagedrive_aio_c.worker pthread with status = %d", status);
+    }
+}
+
+storagedrive_aio_c::~storagedrive_aio_c()
+{
+    pthread_mutex_lock(&mutex);
+    terminate = true ;
+    pthread_cond_broadcast(&work_cond);
+    pthread_mutex_unlock(&mutex);
+    for (unsigned i = 0; i < threads.size(); i++)
+        pthread_join(threads[i], NULL) ;
+    pthread_cond_destroy(&complete_cond);
+    pthread_cond_destroy(&work_cond);
+    pthread_mutex_destroy(&mutex);
+}
+
+// put request into queue of its drive, return immediately
+void storagedrive_aio_c::submit(storagedrive_aio_queue_c *queue, storagedrive_aio_request_c *request)
+{
+    assert(request->drive) ;
+    assert(request->complete) ; // not submitted twice
+    request->complete = false ;
+    pthread_mutex_lock(&mutex);
+    queue->submitted.push_back(request) ;
+    queue->pending++ ;
+    if (queue->pending > max_pending)
+        max_pending = queue->pending ;
+    submitted_count++ ;
+    if (!queue->busy && queue->submitted.size() == 1) {
+        ready.push_back(queue) ; // was idle
+        pthread_cond_signal(&work_cond);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+// block until request is complete.
+// Not from the request's own callback!
+void storagedrive_aio_c::wait(storagedrive_aio_request_c *request)
+{
+    pthread_mutex_lock(&mutex);
+    while (!request->complete)
+        pthread_cond_wait(&complete_cond, &mutex);
+    pthread_mutex_unlock(&mutex);
+}
+
+// block until all requests of a drive are complete.
+// before image is closed or changed.
+void storagedrive_aio_c::drain(storagedrive_aio_queue_c *queue)
+{
+    pthread_mutex_lock(&mutex);
+    while (queue->pending > 0)
+        pthread_cond_wait(&complete_cond, &mutex);
+    pthread_mutex_unlock(&mutex);
+}
+
+// pool thread: take a ready queue, execute its oldest request.
+// The queue is "busy" meanwhile, so no other thread takes it.
+void storagedrive_aio_c::worker(void)
+{
+    pthread_mutex_lock(&mutex);
+    while (!terminate) {
+        if (ready.empty()) {
+            pthread_cond_wait(&work_cond, &mutex);
+            continue ;
+        }
+        storagedrive_aio_queue_c *queue = ready.front() ;
+        ready.pop_front() ;
+        storagedrive_aio_request_c *request = queue->submitted.front() ;
+        queue->submitted.pop_front() ;
+        queue->busy = true ;
+        pthread_mutex_unlock(&mutex);
+
+        if (request->is_write)
+            request->drive->image_write(request->buffer, request->position, request->len) ;
+        else
+            request->drive->image_read(request->buffer, request->position, request->len) ;
+        if (request->callback)
+            request->callback(request) ; // may submit next request
+
+        pthread_mutex_lock(&mutex);
+        request->complete = true ; // caller may delete it now
+        queue->pending-- ;
+        queue->busy = false ;
+        if (!queue->submitted.empty()) {
+            ready.push_back(queue) ;
+            pthread_cond_signal(&work_cond);
+        }
+        pthread_cond_broadcast(&complete_cond);
+    }
+    pthread_mutex_unlock(&mutex);
+}
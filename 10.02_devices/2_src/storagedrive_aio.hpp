@@ -0,0 +1,121 @@
+/* storagedrive_aio.hpp: asynchronous image I/O for storage drives
+
+ Copyright (c) 2026, QUniBone contributors
+ https://github.com/j-hoppe/QUniBone
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ THE CONTRIBUTORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+ 16-oct-2026  QC      created
+
+ Drive workers call image_read()/image_write() blocking, so a slow SD card
+ stalls the controller. With image_read_async()/image_write_async()
+ the request is put into the submission queue of the drive and executed
+ by a shared pool of threads. On completion the request's callback is
+ called from the pool thread.
+
+ Requests of one drive are executed in submission order, one at a time:
+ image access is not thread safe, and a read after a write must see the data.
+ Blocking accesses of the drive's own threads are serialized with them
+ by the drive's cache or image mutex.
+ Requests of different drives run in parallel.
+
+ No io_uring: images are accessed via file streams, mapped memory or
+ overlay chains, not via a single file descriptor.
+ */
+#ifndef _STORAGEDRIVE_AIO_HPP_
+#define _STORAGEDRIVE_AIO_HPP_
+
+#include <stdint.h>
+#include <pthread.h>
+#include <deque>
+#include <vector>
+
+#include "logsource.hpp"
+
+class storagedrive_c ;
+class storagedrive_aio_request_c ;
+
+// called by pool thread when request is complete
+typedef void (*storagedrive_aio_callback_t)(storagedrive_aio_request_c *request) ;
+
+// owned by the caller, must stay valid until complete
+class storagedrive_aio_request_c {
+public:
+    storagedrive_c *drive ;
+    bool is_write ;
+    uint8_t *buffer ;
+    uint64_t position ;
+    unsigned len ;
+    storagedrive_aio_callback_t callback ; // may be NULL
+    void *context ; // for callback
+    volatile bool complete ; // set after callback returned
+
+    storagedrive_aio_request_c() {
+        drive = nullptr ;
+        is_write = false ;
+        buffer = nullptr ;
+        position = 0 ;
+        len = 0 ;
+        callback = nullptr ;
+        context = nullptr ;
+        complete = true ;
+    }
+} ;
+
+// submission queue of one drive
+class storagedrive_aio_queue_c {
+    friend class storagedrive_aio_c ;
+private:
+    std::deque<storagedrive_aio_request_c *> submitted ;
+    bool busy ; // a pool thread executes a request of this queue
+    unsigned pending ; // submitted + executing
+public:
+    storagedrive_aio_queue_c() {
+        busy = false ;
+        pending = 0 ;
+    }
+} ;
+
+class storagedrive_aio_c: public logsource_c {
+private:
+    pthread_mutex_t mutex ;
+    pthread_cond_t work_cond ; // queue became ready
+    pthread_cond_t complete_cond ; // a request completed
+    std::vector<pthread_t> threads ;
+    std::deque<storagedrive_aio_queue_c *> ready ; // have requests, not busy
+    volatile bool terminate ;
+
+public:
+    // statistics
+    volatile uint64_t submitted_count ;
+    volatile unsigned max_pending ; // most requests waiting in one queue
+
+    storagedrive_aio_c(unsigned thread_count) ;
+    ~storagedrive_aio_c() ;
+
+    void submit(storagedrive_aio_queue_c *queue, storagedrive_aio_request_c *request) ;
+    void wait(storagedrive_aio_request_c *request) ;
+    void drain(storagedrive_aio_queue_c *queue) ;
+
+    void worker(void) ;
+} ;
+
+extern storagedrive_aio_c *storagedrive_aio ; // singleton
+
+#endif
@@ -0,0 +1,579 @@
+/* storagedrive_cache.cpp: write-back block cache between drive and image
+
+ Copyright (c) 2026, QUniBone contributors
+ https://github.com/j-hoppe/QUniBone
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ THE CONTRIBUTORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+ 16-oct-2026  QC      prefetch hold for tests
+ 16-oct-2026  QC      set_zero(): whole blocks dropped, zeroed in image
+ 16-oct-2026  QC      prefetch: in-flight range separate from requested range
+ 16-oct-2026  QC      sequential read-ahead
+ 16-oct-2026  QC      created
+ */
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+
+#include "logger.hpp"
+#include "storagedrive_cache.hpp"
+
+// transfers larger than this part of the cache bypass it,
+// so big sequential transfers do not flush all cached blocks
+#define STORAGEDRIVE_CACHE_BYPASS_FRACTION	4
+#define STORAGEDRIVE_CACHE_MIN_BLOCKS	16
+
+static void *storagedrive_cache_flusher_pthread_wrapper(void *context)
+{
+    storagedrive_cache_c *cache = (storagedrive_cache_c *) context;
+    cache->flusher() ;
+    return NULL;
+}
+
+storagedrive_cache_c::storagedrive_cache_c(storageimage_base_c *_image, unsigned _block_count, unsigned _flush_interval_ms,
+        unsigned _readahead_blocks)
+{
+    log_label = "dcache" ;
+    image = _image ;
+    block_count = std::max(_block_count, (unsigned)STORAGEDRIVE_CACHE_MIN_BLOCKS) ;
+    flush_interval_ms = _flush_interval_ms ;
+    hits = misses = 0 ;
+    dirty_count = 0 ;
+    write_end = 0 ;
+    flush_requested = false ;
+
+    // read-ahead must not evict the blocks of the current transfer
+    readahead_blocks = std::min(_readahead_blocks, block_count / STORAGEDRIVE_CACHE_BYPASS_FRACTION) ;
+    read_end = 0 ;
+    readahead_next_block_nr = 0 ;
+    prefetch_requested = false ;
+    prefetch_first_block_nr = 0 ;
+    prefetch_count = 0 ;
+    prefetch_inflight_first_block_nr = 0 ;
+    prefetch_inflight_count = 0 ;
+    prefetch_invalid = false ;
+    prefetch_hold = prefetch_held = false ;
+    readahead_loaded = readahead_hits = 0 ;
+
+    pool = (uint8_t *)malloc((size_t)block_count * STORAGEDRIVE_CACHE_BLOCK_SIZE) ;
+    assert(pool) ;
+    for (unsigned i = 0; i < block_count; i++)
+        free_slots.push_back(i) ;
+    index.reserve(block_count) ;
+
+    pthread_mutex_init(&mutex, NULL);
+    pthread_mutex_init(&image_mutex, NULL);
+    pthread_cond_init(&flusher_cond, NULL);
+    pthread_cond_init(&prefetch_hold_cond, NULL);
+    flusher_terminate = false ;
+    int status = pthread_create(&flusher_pthread, NULL, &storagedrive_cache_flusher_pthread_wrapper, this) ;
+    if (status != 0)
+        FATAL("Failed to create storagedrive_cache_c.flusher_pthread with status = %d", status);
+}
+
+// stops flusher, writes all dirty blocks
+storagedrive_cache_c::~storagedrive_cache_c()
+{
+    pthread_mutex_lock(&mutex);
+    flusher_terminate = true ;
+    pthread_cond_signal(&flusher_cond);
+    pthread_mutex_unlock(&mutex);
+    int status = pthread_join(flusher_pthread, NULL) ;
+    if (status != 0)
+        FATAL("Failed to join with storagedrive_cache_c.flusher_pthread with status = %d", status);
+
+    flush() ;
+
+    pthread_cond_destroy(&prefetch_hold_cond);
+    pthread_cond_destroy(&flusher_cond);
+    pthread_mutex_destroy(&image_mutex);
+    pthread_mutex_destroy(&mutex);
+    free(pool) ;
+}
+
+// find block, and make it most recently used
+// mutex must be locked
+storagedrive_cache_c::block_t *storagedrive_cache_c::lookup(uint64_t block_nr)
+{
+    auto it = index.find(block_nr) ;
+    if (it == index.end())
+        return nullptr ;
+    lru.splice(lru.begin(), lru, it->second) ;
+    return &*it->second ;
+}
+
+// write dirty bytes of a single block to image, synchronously
+// mutex must be locked
+void storagedrive_cache_c::write_back(block_t *block)
+{
+    if (block->dirty_begin == block->dirty_end)
+        return ;
+    pthread_mutex_lock(&image_mutex);
+    image->write(block_data(block) + block->dirty_begin,
+                 block->block_nr * STORAGEDRIVE_CACHE_BLOCK_SIZE + block->dirty_begin,
+                 block->dirty_end - block->dirty_begin) ;
+    pthread_mutex_unlock(&image_mutex);
+    block->dirty_begin = block->dirty_end = 0 ;
+    dirty_count-- ;
+}
+
+// get a new block as most recently used, content undefined.
+// Evicts the least recently used clean block of the older half,
+// or writes back the least recently used dirty one.
+// The newer half is never evicted: it holds the blocks of the current transfer.
+// mutex must be locked
+storagedrive_cache_c::block_t *storagedrive_cache_c::allocate(uint64_t block_nr)
+{
+    assert(index.find(block_nr) == index.end()) ;
+    if (free_slots.empty()) {
+        auto victim = std::prev(lru.end()) ;
+        unsigned n = 0 ;
+        for (auto it = lru.rbegin(); it != lru.rend() && n < block_count / 2; ++it, ++n)
+            if (it->dirty_begin == it->dirty_end) {
+                victim = std::prev(it.base()) ;
+                break ;
+            }
+        write_back(&*victim) ; // if all dirty: flusher too slow
+        free_slots.push_back(victim->slot) ;
+        index.erase(victim->block_nr) ;
+        lru.erase(victim) ;
+    }
+    block_t block ;
+    block.block_nr = block_nr ;
+    block.slot = free_slots.back() ;
+    free_slots.pop_back() ;
+    block.dirty_begin = block.dirty_end = 0 ;
+    block.prefetched = false ;
+    lru.push_front(block) ;
+    index[block_nr] = lru.begin() ;
+    return &lru.front() ;
+}
+
+// read "count" blocks not in cache from image with one access, and cache them
+// mutex must be locked
+void storagedrive_cache_c::fill(uint64_t first_block_nr, unsigned count)
+{
+    unsigned len = count * STORAGEDRIVE_CACHE_BLOCK_SIZE ;
+    uint8_t *buffer = (uint8_t *)malloc(len) ;
+    // image_mutex: waits until flusher has written evicted blocks
+    pthread_mutex_lock(&image_mutex);
+    image->read(buffer, first_block_nr * STORAGEDRIVE_CACHE_BLOCK_SIZE, len) ; // 00s behind end of file
+    pthread_mutex_unlock(&image_mutex);
+    for (unsigned i = 0; i < count; i++) {
+        block_t *block = allocate(first_block_nr + i) ;
+        memcpy(block_data(block), buffer + i * STORAGEDRIVE_CACHE_BLOCK_SIZE, STORAGEDRIVE_CACHE_BLOCK_SIZE) ;
+    }
+    misses += count ;
+    free(buffer) ;
+}
+
+// bytes in between are valid cache data, so one range per block is sufficient
+void storagedrive_cache_c::mark_dirty(block_t *block, unsigned begin, unsigned end)
+{
+    if (block->dirty_begin == block->dirty_end) {
+        block->dirty_begin = begin ;
+        block->dirty_end = end ;
+        dirty_count++ ;
+    } else {
+        block->dirty_begin = std::min(block->dirty_begin, begin) ;
+        block->dirty_end = std::max(block->dirty_end, end) ;
+    }
+}
+
+/* read "len" bytes at "position" into buffer.
+ * Missing blocks are read from image, consecutive ones with a single access.
+ */
+void storagedrive_cache_c::read(uint8_t *buffer, uint64_t position, unsigned len)
+{
+    assert(len) ;
+    uint64_t first_block_nr = position / STORAGEDRIVE_CACHE_BLOCK_SIZE ;
+    uint64_t last_block_nr = (position + len - 1) / STORAGEDRIVE_CACHE_BLOCK_SIZE ;
+    uint64_t block_nr ;
+
+    pthread_mutex_lock(&mutex);
+    if (len > block_count * STORAGEDRIVE_CACHE_BLOCK_SIZE / STORAGEDRIVE_CACHE_BYPASS_FRACTION) {
+        // bypass: read image, then overlay unwritten data
+        pthread_mutex_lock(&image_mutex);
+        image->read(buffer, position, len) ;
+        pthread_mutex_unlock(&image_mutex);
+        for (block_nr = first_block_nr; block_nr <= last_block_nr; block_nr++) {
+            auto it = index.find(block_nr) ;
+            if (it == index.end() || it->second->dirty_begin == it->second->dirty_end)
+                continue ;
+            block_t *block = &*it->second ;
+            uint64_t block_pos = block_nr * STORAGEDRIVE_CACHE_BLOCK_SIZE ;
+            uint64_t begin = std::max(block_pos + block->dirty_begin, position) ;
+            uint64_t end = std::min(block_pos + block->dirty_end, position + len) ;
+            if (begin < end)
+                memcpy(buffer + (begin - position), block_data(block) + (begin - block_pos), end - begin) ;
+        }
+        misses += last_block_nr - first_block_nr + 1 ;
+        read_end = position + len ;
+        pthread_mutex_unlock(&mutex);
+        return ;
+    }
+
+    // 1. load missing blocks. Touch cached ones, so fill() does not evict them
+    for (block_nr = first_block_nr; block_nr <= last_block_nr; ) {
+        block_t *block = lookup(block_nr) ;
+        if (block != nullptr) {
+            hits++ ;
+            if (block->prefetched) {
+                readahead_hits++ ;
+                block->prefetched = false ;
+            }
+            block_nr++ ;
+            continue ;
+        }
+        uint64_t run_start = block_nr ;
+        while (block_nr <= last_block_nr && index.find(block_nr) == index.end())
+            block_nr++ ;
+        fill(run_start, block_nr - run_start) ;
+    }
+    // 2. copy to caller
+    for (block_nr = first_block_nr; block_nr <= last_block_nr; block_nr++) {
+        block_t *block = lookup(block_nr) ;
+        assert(block) ;
+        uint64_t block_pos = block_nr * STORAGEDRIVE_CACHE_BLOCK_SIZE ;
+        uint64_t begin = std::max(block_pos, position) ;
+        uint64_t end = std::min(block_pos + STORAGEDRIVE_CACHE_BLOCK_SIZE, position + len) ;
+        memcpy(buffer + (begin - position), block_data(block) + (begin - block_pos), end - begin) ;
+    }
+
+    // 3. sequential? then request next blocks, when half of the read-ahead window is consumed
+    bool sequential = (position == read_end) ;
+    read_end = position + len ;
+    if (readahead_blocks > 0 && sequential && !prefetch_requested) {
+        uint64_t next_block_nr = last_block_nr + 1 ;
+        if (readahead_next_block_nr < next_block_nr)
+            readahead_next_block_nr = next_block_nr ;
+        if (readahead_next_block_nr <= last_block_nr + readahead_blocks / 2) {
+            prefetch_first_block_nr = readahead_next_block_nr ;
+            prefetch_count = next_block_nr + readahead_blocks - readahead_next_block_nr ;
+            readahead_next_block_nr = next_block_nr + readahead_blocks ;
+            prefetch_requested = true ;
+            pthread_cond_signal(&flusher_cond);
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+/* write "len" bytes at "position" into cache, flusher writes them to image.
+ * Partially written blocks are read from image first.
+ */
+void storagedrive_cache_c::write(uint8_t *buffer, uint64_t position, unsigned len)
+{
+    assert(len) ;
+    uint64_t first_block_nr = position / STORAGEDRIVE_CACHE_BLOCK_SIZE ;
+    uint64_t last_block_nr = (position + len - 1) / STORAGEDRIVE_CACHE_BLOCK_SIZE ;
+    uint64_t block_nr ;
+
+    pthread_mutex_lock(&mutex);
+    write_end = std::max(write_end, position + len) ;
+    // data read by prefetch() may be outdated now
+    if (first_block_nr < prefetch_inflight_first_block_nr + prefetch_inflight_count
+            && last_block_nr >= prefetch_inflight_first_block_nr)
+        prefetch_invalid = true ;
+    if (len > block_count * STORAGEDRIVE_CACHE_BLOCK_SIZE / STORAGEDRIVE_CACHE_BYPASS_FRACTION) {
+        // bypass: write image, update cached copies
+        pthread_mutex_lock(&image_mutex);
+        image->write(buffer, position, len) ;
+        pthread_mutex_unlock(&image_mutex);
+        for (block_nr = first_block_nr; block_nr <= last_block_nr; block_nr++) {
+            auto it = index.find(block_nr) ;
+            if (it == index.end())
+                continue ;
+            block_t *block = &*it->second ;
+            uint64_t block_pos = block_nr * STORAGEDRIVE_CACHE_BLOCK_SIZE ;
+            uint64_t begin = std::max(block_pos, position) ;
+            uint64_t end = std::min(block_pos + STORAGEDRIVE_CACHE_BLOCK_SIZE, position + len) ;
+            memcpy(block_data(block) + (begin - block_pos), buffer + (begin - position), end - begin) ;
+        }
+        misses += last_block_nr - first_block_nr + 1 ;
+        pthread_mutex_unlock(&mutex);
+        return ;
+    }
+
+    for (block_nr = first_block_nr; block_nr <= last_block_nr; block_nr++) {
+        uint64_t block_pos = block_nr * STORAGEDRIVE_CACHE_BLOCK_SIZE ;
+        uint64_t begin = std::max(block_pos, position) ;
+        uint64_t end = std::min(block_pos + STORAGEDRIVE_CACHE_BLOCK_SIZE, position + len) ;
+        block_t *block = lookup(block_nr) ;
+        if (block != nullptr)
+            hits++ ;
+        else if (end - begin == STORAGEDRIVE_CACHE_BLOCK_SIZE) {
+            block = allocate(block_nr) ; // completely overwritten
+            misses++ ;
+        } else {
+            fill(block_nr, 1) ; // read-modify-write
+            block = lookup(block_nr) ;
+        }
+        memcpy(block_data(block) + (begin - block_pos), buffer + (begin - position), end - begin) ;
+        mark_dirty(block, begin - block_pos, end - block_pos) ;
+    }
+    if (dirty_count > block_count / 2) {
+        flush_requested = true ;
+        pthread_cond_signal(&flusher_cond);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+/* write 00s to "len" bytes at "position".
+ * Whole blocks are dropped from the cache and zeroed in the image directly,
+ * sparse images punch holes then. Partial blocks at the ends via write().
+ */
+void storagedrive_cache_c::set_zero(uint64_t position, unsigned len)
+{
+    static uint8_t zeros[STORAGEDRIVE_CACHE_BLOCK_SIZE] ; // all 0
+    assert(len) ;
+    uint64_t end = position + len ;
+    uint64_t first_block_nr = (position + STORAGEDRIVE_CACHE_BLOCK_SIZE - 1) / STORAGEDRIVE_CACHE_BLOCK_SIZE ;
+    uint64_t end_block_nr = end / STORAGEDRIVE_CACHE_BLOCK_SIZE ; // behind last whole block
+    if (first_block_nr >= end_block_nr) {
+        // inside one block
+        write(zeros, position, len) ;
+        return ;
+    }
+    uint64_t zero_begin = first_block_nr * STORAGEDRIVE_CACHE_BLOCK_SIZE ;
+    uint64_t zero_end = end_block_nr * STORAGEDRIVE_CACHE_BLOCK_SIZE ;
+    if (position < zero_begin)
+        write(zeros, position, zero_begin - position) ;
+    if (zero_end < end)
+        write(zeros, zero_end, end - zero_end) ;
+
+    pthread_mutex_lock(&mutex);
+    write_end = std::max(write_end, zero_end) ;
+    // data read by prefetch() may be outdated now
+    if (first_block_nr < prefetch_inflight_first_block_nr + prefetch_inflight_count
+            && end_block_nr > prefetch_inflight_first_block_nr)
+        prefetch_invalid = true ;
+    for (uint64_t block_nr = first_block_nr; block_nr < end_block_nr; block_nr++) {
+        auto it = index.find(block_nr) ;
+        if (it == index.end())
+            continue ;
+        if (it->second->dirty_begin != it->second->dirty_end)
+            dirty_count-- ; // never written back
+        free_slots.push_back(it->second->slot) ;
+        lru.erase(it->second) ;
+        index.erase(it) ;
+    }
+    // waits for a running flush(), so older data of dropped blocks is overwritten
+    pthread_mutex_lock(&image_mutex);
+    // already zero inside image: nothing to punch. Behind end: extend.
+    if (zero_end > image->size() || !image->is_zero(zero_begin, zero_end - zero_begin))
+        image->set_zero(zero_begin, zero_end - zero_begin) ;
+    pthread_mutex_unlock(&image_mutex);
+    pthread_mutex_unlock(&mutex);
+}
+
+// image size including blocks not yet written back
+uint64_t storagedrive_cache_c::size(void)
+{
+    pthread_mutex_lock(&mutex);
+    pthread_mutex_lock(&image_mutex);
+    uint64_t result = std::max(image->size(), write_end) ;
+    pthread_mutex_unlock(&image_mutex);
+    pthread_mutex_unlock(&mutex);
+    return result ;
+}
+
+// discard all blocks, then set image size to 0
+bool storagedrive_cache_c::truncate(void)
+{
+    pthread_mutex_lock(&mutex);
+    pthread_mutex_lock(&image_mutex);
+    lru.clear() ;
+    index.clear() ;
+    free_slots.clear() ;
+    for (unsigned i = 0; i < block_count; i++)
+        free_slots.push_back(i) ;
+    dirty_count = 0 ;
+    write_end = 0 ;
+    read_end = 0 ;
+    readahead_next_block_nr = 0 ;
+    prefetch_invalid = true ;
+    bool result = image->truncate() ;
+    pthread_mutex_unlock(&image_mutex);
+    pthread_mutex_unlock(&mutex);
+    return result ;
+}
+
+// write all dirty blocks to image.
+// On return all data written before is in the image, even if the
+// flusher was writing in parallel.
+void storagedrive_cache_c::flush(void)
+{
+    // copy of dirty ranges, adjacent ones merged.
+    // Own buffer per call, flusher and drive may flush in parallel.
+    std::vector<uint8_t> staging ;
+    struct run_t {
+        uint64_t position ;
+        unsigned offset ; // in staging[]
+        unsigned len ;
+    } ;
+    std::vector<run_t> runs ;
+    std::vector<block_t *> dirty_blocks ;
+
+    pthread_mutex_lock(&mutex);
+    for (auto it = lru.begin(); it != lru.end(); ++it)
+        if (it->dirty_begin != it->dirty_end)
+            dirty_blocks.push_back(&*it) ;
+    std::sort(dirty_blocks.begin(), dirty_blocks.end(),
+    [](const block_t *a, const block_t *b) {
+        return a->block_nr < b->block_nr ;
+    }) ;
+    staging.resize(dirty_blocks.size() * STORAGEDRIVE_CACHE_BLOCK_SIZE) ;
+    unsigned offset = 0 ;
+    for (unsigned i = 0; i < dirty_blocks.size(); i++) {
+        block_t *block = dirty_blocks[i] ;
+        uint64_t position = block->block_nr * STORAGEDRIVE_CACHE_BLOCK_SIZE + block->dirty_begin ;
+        unsigned len = block->dirty_end - block->dirty_begin ;
+        memcpy(staging.data() + offset, block_data(block) + block->dirty_begin, len) ;
+        if (!runs.empty() && runs.back().position + runs.back().len == position)
+            runs.back().len += len ;
+        else
+            runs.push_back({position, offset, len}) ;
+        offset += len ;
+        block->dirty_begin = block->dirty_end = 0 ;
+    }
+    dirty_count = 0 ;
+    // PDP may access the cache while staging[] is written
+    pthread_mutex_lock(&image_mutex);
+    pthread_mutex_unlock(&mutex);
+    for (unsigned i = 0; i < runs.size(); i++)
+        image->write(staging.data() + runs[i].offset, runs[i].position, runs[i].len) ;
+    pthread_mutex_unlock(&image_mutex);
+}
+
+// load the range requested by read() into the cache.
+// Image is read without holding "mutex", so PDP accesses continue.
+// Blocks cached before may be dirty: image data is older, never insert these.
+void storagedrive_cache_c::prefetch(void)
+{
+    pthread_mutex_lock(&mutex);
+    uint64_t first_block_nr = prefetch_first_block_nr ;
+    unsigned count = prefetch_count ;
+    prefetch_requested = false ;
+    // write() checks this range until the blocks are inserted
+    prefetch_inflight_first_block_nr = first_block_nr ;
+    prefetch_inflight_count = count ;
+    prefetch_invalid = false ;
+    std::vector<bool> cached(count) ;
+    unsigned missing = 0 ;
+    for (unsigned i = 0; i < count; i++) {
+        cached[i] = (index.find(first_block_nr + i) != index.end()) ;
+        if (!cached[i])
+            missing++ ;
+    }
+    if (missing == 0) {
+        prefetch_inflight_count = 0 ;
+        pthread_mutex_unlock(&mutex);
+        return ;
+    }
+    pthread_mutex_unlock(&mutex);
+
+    unsigned len = count * STORAGEDRIVE_CACHE_BLOCK_SIZE ;
+    uint8_t *buffer = (uint8_t *)malloc(len) ;
+    pthread_mutex_lock(&image_mutex);
+    image->read(buffer, first_block_nr * STORAGEDRIVE_CACHE_BLOCK_SIZE, len) ;
+    pthread_mutex_unlock(&image_mutex);
+
+    pthread_mutex_lock(&mutex);
+    if (prefetch_hold) {
+        prefetch_held = true ;
+        pthread_cond_broadcast(&prefetch_hold_cond);
+        while (prefetch_hold)
+            pthread_cond_wait(&prefetch_hold_cond, &mutex);
+    }
+    if (!prefetch_invalid)
+        for (unsigned i = 0; i < count; i++) {
+            uint64_t block_nr = first_block_nr + i ;
+            if (cached[i] || index.find(block_nr) != index.end())
+                continue ; // cache has same or newer data
+            block_t *block = allocate(block_nr) ;
+            memcpy(block_data(block), buffer + i * STORAGEDRIVE_CACHE_BLOCK_SIZE, STORAGEDRIVE_CACHE_BLOCK_SIZE) ;
+            block->prefetched = true ;
+            readahead_loaded++ ;
+        }
+    // else: a write() overlapped the image read, drop the buffer
+    prefetch_inflight_count = 0 ;
+    prefetch_held = false ;
+    pthread_cond_broadcast(&prefetch_hold_cond);
+    pthread_mutex_unlock(&mutex);
+    free(buffer) ;
+}
+
+// for tests: stop prefetch() after the image read, before blocks are inserted.
+// Meanwhile read() and write() can run, as they do while the image is read.
+void storagedrive_cache_c::prefetch_hold_set(bool hold)
+{
+    pthread_mutex_lock(&mutex);
+    prefetch_hold = hold ;
+    pthread_cond_broadcast(&prefetch_hold_cond);
+    pthread_mutex_unlock(&mutex);
+}
+
+// for tests: wait until prefetch() stopped at the hold (true),
+// or finished inserting (false)
+void storagedrive_cache_c::prefetch_hold_wait(bool held)
+{
+    pthread_mutex_lock(&mutex);
+    while (prefetch_held != held)
+        pthread_cond_wait(&prefetch_hold_cond, &mutex);
+    pthread_mutex_unlock(&mutex);
+}
+
+// background thread: write back dirty blocks periodically,
+// or if signaled by write(). Executes read-ahead requested by read().
+// flush_interval_ms = 0: no periodic write-back, only when signaled.
+void storagedrive_cache_c::flusher(void)
+{
+    struct timespec next_flush ;
+    clock_gettime(CLOCK_REALTIME, &next_flush) ;
+    pthread_mutex_lock(&mutex);
+    while (!flusher_terminate) {
+        if (!prefetch_requested && !flush_requested) {
+            if (flush_interval_ms == 0)
+                pthread_cond_wait(&flusher_cond, &mutex);
+            else if (pthread_cond_timedwait(&flusher_cond, &mutex, &next_flush) == ETIMEDOUT)
+                flush_requested = true ;
+            continue ;
+        }
+        if (prefetch_requested) {
+            pthread_mutex_unlock(&mutex);
+            prefetch() ;
+            pthread_mutex_lock(&mutex);
+        }
+        if (flush_requested) {
+            flush_requested = false ;
+            clock_gettime(CLOCK_REALTIME, &next_flush) ;
+            uint64_t ns = next_flush.tv_nsec + (uint64_t)flush_interval_ms * 1000000 ;
+            next_flush.tv_sec += ns / 1000000000 ;
+            next_flush.tv_nsec = ns % 1000000000 ;
+            if (dirty_count > 0) {
+                pthread_mutex_unlock(&mutex);
+                flush() ;
+                pthread_mutex_lock(&mutex);
+            }
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+}
@@ -0,0 +1,148 @@
+/* storagedrive_cache.hpp: write-back block cache between drive and image
+
+ Copyright (c) 2026, QUniBone contributors
+ https://github.com/j-hoppe/QUniBone
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ THE CONTRIBUTORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+ 16-oct-2026  QC      prefetch hold for tests
+ 16-oct-2026  QC      set_zero()
+ 16-oct-2026  QC      writes checked against in-flight read-ahead range
+ 16-oct-2026  QC      sequential read-ahead
+ 16-oct-2026  QC      created
+
+ Controller worker() threads read and write the image via the cache,
+ so writes are not blocked by the SD card.
+ Dirty blocks are written back by a flusher thread
+ - every "flush_interval_ms", if not 0
+ - if half of the cache is dirty
+ - synchronously by flush(), on close(), and when dirty blocks must be evicted.
+ Only the dirty byte range of a block is written back, so the image file
+ grows exactly like without cache.
+
+ Read-ahead: a read() starting where the previous one ended is sequential.
+ Then the flusher thread also loads the next "readahead_blocks" into the cache,
+ so the following sector reads of a track or MSCP transfer hit the cache.
+
+ Locking: "mutex" protects the cache tables, "image_mutex" all image accesses.
+ Always take "mutex" first. The flusher copies dirty blocks, takes "image_mutex",
+ then releases "mutex": PDP accesses to cached blocks run while data is written.
+ */
+#ifndef _STORAGEDRIVE_CACHE_HPP_
+#define _STORAGEDRIVE_CACHE_HPP_
+
+#include <stdint.h>
+#include <pthread.h>
+#include <list>
+#include <vector>
+#include <unordered_map>
+
+#include "logsource.hpp"
+#include "storageimage.hpp"
+
+#define STORAGEDRIVE_CACHE_BLOCK_SIZE	512
+
+class storagedrive_cache_c: public logsource_c {
+private:
+    typedef struct {
+        uint64_t block_nr ; // image position / block size
+        unsigned slot ; // index of data in pool
+        // dirty bytes are [dirty_begin, dirty_end), clean if equal
+        unsigned dirty_begin ;
+        unsigned dirty_end ;
+        bool prefetched ; // loaded by read-ahead, not yet read
+    } block_t ;
+
+    storageimage_base_c *image ;
+    unsigned block_count ; // capacity
+
+    pthread_mutex_t mutex ;
+    pthread_mutex_t image_mutex ;
+    pthread_cond_t flusher_cond ;
+    pthread_t flusher_pthread ;
+    volatile bool flusher_terminate ;
+    bool flush_requested ; // by write(), if cache gets full of dirty blocks
+    unsigned flush_interval_ms ;
+
+    // read-ahead
+    unsigned readahead_blocks ; // 0 = disabled
+    uint64_t read_end ; // position after last read()
+    uint64_t readahead_next_block_nr ; // first block not yet requested
+    bool prefetch_requested ;
+    uint64_t prefetch_first_block_nr ; // requested range
+    unsigned prefetch_count ;
+    // range prefetch() is reading from image, read() may request the next meanwhile
+    uint64_t prefetch_inflight_first_block_nr ;
+    unsigned prefetch_inflight_count ; // 0 = none
+    bool prefetch_invalid ; // in-flight range written while image was read
+    bool prefetch_hold ; // stop prefetch() before insert, for tests
+    bool prefetch_held ; // prefetch() is stopped or inserting after stop
+    pthread_cond_t prefetch_hold_cond ;
+    void prefetch(void) ;
+
+    uint8_t *pool ; // block_count * STORAGEDRIVE_CACHE_BLOCK_SIZE
+    std::vector<unsigned> free_slots ;
+    std::list<block_t> lru ; // front = most recently used
+    std::unordered_map<uint64_t, std::list<block_t>::iterator> index ;
+
+    // highest position written via cache, image->size() may be smaller
+    uint64_t write_end ;
+
+    uint8_t *block_data(block_t *block) {
+        return pool + (uint64_t)block->slot * STORAGEDRIVE_CACHE_BLOCK_SIZE ;
+    }
+    block_t *lookup(uint64_t block_nr) ;
+    block_t *allocate(uint64_t block_nr) ;
+    void fill(uint64_t first_block_nr, unsigned count) ;
+    void mark_dirty(block_t *block, unsigned begin, unsigned end) ;
+    void write_back(block_t *block) ;
+
+public:
+    // statistics
+    volatile uint64_t hits ; // blocks found in cache
+    volatile uint64_t misses ; // blocks read from image
+    volatile unsigned dirty_count ; // blocks not yet written back
+    volatile uint64_t readahead_loaded ; // blocks loaded by read-ahead
+    volatile uint64_t readahead_hits ; // of these, later read
+
+    storagedrive_cache_c(storageimage_base_c *image, unsigned block_count, unsigned flush_interval_ms,
+                         unsigned readahead_blocks) ;
+    ~storagedrive_cache_c() ;
+
+    void read(uint8_t *buffer, uint64_t position, unsigned len) ;
+    void write(uint8_t *buffer, uint64_t position, unsigned len) ;
+    void set_zero(uint64_t position, unsigned len) ;
+    uint64_t size(void) ;
+    bool truncate(void) ;
+    void flush(void) ;
+    // for direct image operations of the drive, no cache access meanwhile
+    void image_lock(void) {
+        pthread_mutex_lock(&image_mutex);
+    }
+    void image_unlock(void) {
+        pthread_mutex_unlock(&image_mutex);
+    }
+
+    void prefetch_hold_set(bool hold) ;
+    void prefetch_hold_wait(bool held) ;
+
+    void flusher(void) ;
+} ;
+
+#endif
@@ -21,6 +21,9 @@
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
+ 16-oct-2026	QC      sparse files: set_zero(), is_zero() on holes
+ 16-oct-2026	QC      mmap: size check, map before file grows
+ 16-oct-2026	QC      storageimage_mmap_c
  07-mar-2021	JH      start
 
  A storagedrive is a disk or tape drive, with an image file as storage medium.
@@ -28,13 +31,16 @@
  supports the "attach" command
  */
 #include <assert.h>
+#include <errno.h>
 #include <inttypes.h>
 #include <string.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <fstream>
 #include <ios>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 
 #ifndef O_BINARY
@@ -46,25 +52,103 @@
 #include "storageimage.hpp"
 
 
-// BIG use of memory
+#define STORAGEIMAGE_ZERO_CHUNK	0x1000
+
+// generic: write 00s chunk-wise
 void storageimage_base_c::set_zero(uint64_t position, unsigned len)
 {
-    uint8_t *zeros = (uint8_t*) malloc(len) ;
-    memset(zeros, 0, len) ;
-    write(zeros, position, len);
-    free(zeros) ;
+    static uint8_t zeros[STORAGEIMAGE_ZERO_CHUNK] ; // all 0
+    while (len > 0) {
+        unsigned chunk = std::min(len, (unsigned)sizeof(zeros)) ;
+        write(zeros, position, chunk);
+        position += chunk ;
+        len -= chunk ;
+    }
 }
 
+// generic: read and check chunk-wise
 bool storageimage_base_c::is_zero(uint64_t position, unsigned len)
 {
-    bool result = true ;
-    uint8_t *buffer= (uint8_t*) malloc(len) ;
-    read(buffer, position, len);
-    for (unsigned i=0 ; i < len ; i++)
-        if (buffer[i] != 0)
-            result = false ;
-    free(buffer) ;
-    return result ;
+    uint8_t buffer[STORAGEIMAGE_ZERO_CHUNK] ;
+    while (len > 0) {
+        unsigned chunk = std::min(len, (unsigned)sizeof(buffer)) ;
+        read(buffer, position, chunk);
+        for (unsigned i=0 ; i < chunk ; i++)
+            if (buffer[i] != 0)
+                return false ;
+        position += chunk ;
+        len -= chunk ;
+    }
+    return true ;
+}
+
+// sparse file: range inside file is punched to a hole,
+// range behind end of file extends the file by a hole.
+// No data written, disk space is released.
+// result: false if file system can not punch holes, then caller must write 00s
+bool storageimage_base_c::file_set_zero(int fd, uint64_t file_size, uint64_t position, unsigned len)
+{
+    uint64_t end = position + len ;
+    if (position < file_size
+            && fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, position,
+                         std::min(end, file_size) - position) != 0)
+        return false ; // EOPNOTSUPP on FAT
+    if (end > file_size && ftruncate(fd, end) != 0) {
+        ERROR("Can not extend image: %s", strerror(errno)) ;
+        return false ;
+    }
+    return true ;
+}
+
+// sparse file: holes are zero without reading them.
+// Only data extents listed by the file system are read and checked.
+// Behind end of file is zero, as read() returns 00s there.
+bool storageimage_base_c::file_is_zero(int fd, uint64_t position, unsigned len)
+{
+    uint8_t buffer[STORAGEIMAGE_ZERO_CHUNK] ;
+    uint64_t end = position + len ;
+    uint64_t pos = position ;
+    while (pos < end) {
+        off_t data_pos = lseek(fd, pos, SEEK_DATA) ;
+        if (data_pos < 0)
+            return errno == ENXIO ; // ENXIO: no more data, else error: assume data
+        if ((uint64_t)data_pos >= end)
+            return true ;
+        off_t hole_pos = lseek(fd, data_pos, SEEK_HOLE) ; // EOF is a hole too
+        uint64_t data_end = (hole_pos < 0) ? end : std::min((uint64_t)hole_pos, end) ;
+        for (pos = data_pos ; pos < data_end ; ) {
+            unsigned chunk = std::min(data_end - pos, (uint64_t)sizeof(buffer)) ;
+            ssize_t n = ::pread(fd, buffer, chunk, pos) ;
+            if (n <= 0)
+                return n == 0 ; // 0 = EOF
+            for (ssize_t i=0 ; i < n ; i++)
+                if (buffer[i] != 0)
+                    return false ;
+            pos += n ;
+        }
+    }
+    return true ;
+}
+
+// image file could not be opened, neither rw nor read only
+// try to unzip from <image_fname>.gz
+// result: true = uncompressed, retry opening
+bool storageimage_base_c::uncompress_file(std::string image_fname)
+{
+    std::string compressed_image_fname = image_fname + ".gz" ;
+    if (FILE *fz = fopen(compressed_image_fname.c_str(), "r")) {
+        fclose(fz);
+        std::string uncompress_cmd = "zcat " + compressed_image_fname + " >" + image_fname ;
+        printf("Only compressed image file %s found, expanding \"%s\" ...\n", image_fname.c_str(), uncompress_cmd.c_str()) ;
+        int ret = system(uncompress_cmd.c_str()) ;
+        if (ret != 0) {
+            printf(" FAILED!\n") ;
+            return false ;
+        }
+        printf("... complete.\n") ;
+        return true ;
+    }
+    return false ;
 }
 
 
@@ -99,24 +183,10 @@ bool storageimage_binfile_c::open(storagedrive_c *_drive, bool create)
         }
 
         retries-- ;
-        if (retries > 0) {
-            // file could not be opened, neither rw nor read only
-            // try to unzip, then retry opening
-            std::string compressed_image_fname = image_fname + ".gz" ;
-            if (FILE *fz = fopen(compressed_image_fname.c_str(), "r")) {
-                fclose(fz);
-                std::string uncompress_cmd = "zcat " + compressed_image_fname + " >" + image_fname ;
-                printf("Only compressed image file %s found, expanding \"%s\" ...\n", image_fname.c_str(), uncompress_cmd.c_str()) ;
-                int ret = system(uncompress_cmd.c_str()) ;
-                if (ret != 0) {
-                    printf(" FAILED!\n") ;
-                    retries = 0 ; // not again
-                } else
-                    printf("... complete.\n") ;
-
-            } else
-                retries = 0 ; // not again
-        }
+        // file could not be opened, neither rw nor read only
+        // try to unzip, then retry opening
+        if (retries > 0 && !uncompress_file(image_fname))
+            retries = 0 ; // not again
     }
 
     // definitely no image file neither plain nor zipped
@@ -169,6 +239,7 @@ void storageimage_binfile_c::read(uint8_t *buffer, uint64_t position, unsigned l
     memset(buffer, 0, len);
 
     // 2. move read pointer
+    f.clear(); // clear eof and fail bit of previous read behind end of file
     f.seekg(position);
     // may be at eof now, doesn't matter
 
@@ -182,36 +253,27 @@ void storageimage_binfile_c::read(uint8_t *buffer, uint64_t position, unsigned l
 void storageimage_binfile_c::write(uint8_t *buffer, uint64_t position, unsigned len) 
 {
     int64_t write_pos = (int64_t) position;  // unsigned-> int
-    const int max_chunk_size = 0x40000; //256KB: trade-off between performance and mem usage
-    uint8_t *fillbuff = NULL;
     int64_t file_size, p;
 
     assert(buffer);
     assert(is_open());
     assert(!readonly); // caller must take care
 
-    // enlarge file in chunks until filled up to "position"
+    // enlarge file up to "position"
     f.clear(); // clear fail bit
     f.seekp(0, std::ios::end); // move to current EOF
     file_size = f.tellp(); // current file len
     if (file_size < 0)
         file_size = 0; // -1 on emtpy files
-    while (file_size < write_pos) {
-        // fill in '00' 'chunks up to desired end, but limit to max_chunk_size
-        int chunk_size = std::min(max_chunk_size, (int) (write_pos - file_size));
-        if (!fillbuff) {
-            // allocate 00-buffer only once
-            fillbuff = (uint8_t *) malloc(max_chunk_size);
-            assert(fillbuff);
-            memset(fillbuff, 0, max_chunk_size);
+    if (file_size < write_pos) {
+        // gap is a hole of a sparse file, no 00s written
+        f.flush() ;
+        if (::truncate(image_fname.c_str(), write_pos) != 0) {
+            ERROR("storageimage_binfile_c.write() can not extend %s: %s", image_fname.c_str(), strerror(errno));
+            return ;
         }
-        f.clear(); // clear fail bit
-        f.seekp(file_size, std::ios::beg); // move to end
-        f.write((const char *) fillbuff, chunk_size);
-        file_size += chunk_size;
+        file_size = write_pos ;
     }
-    if (fillbuff)
-        free(fillbuff); // has been used, discard
 
     if (file_size == 0)
         // p = -1 error after seekp(0) on empty files?
@@ -231,8 +293,36 @@ void storageimage_binfile_c::write(uint8_t *buffer, uint64_t position, unsigned
     f.flush();
 }
 
+// punch a hole, written 00s only if file system has no sparse files
+void storageimage_binfile_c::set_zero(uint64_t position, unsigned len)
+{
+    assert(is_open());
+    assert(!readonly); // caller must take care
+    f.flush() ;
+    int fd = ::open(image_fname.c_str(), O_BINARY | O_WRONLY) ;
+    bool ok = (fd >= 0) && file_set_zero(fd, size(), position, len) ;
+    if (fd >= 0)
+        ::close(fd) ;
+    if (!ok)
+        storageimage_base_c::set_zero(position, len) ;
+    // stream reads after next seekg(), old buffer content is discarded
+}
+
+bool storageimage_binfile_c::is_zero(uint64_t position, unsigned len)
+{
+    assert(is_open());
+    f.flush() ;
+    int fd = ::open(image_fname.c_str(), O_BINARY | O_RDONLY) ;
+    if (fd < 0)
+        return storageimage_base_c::is_zero(position, len) ;
+    bool result = file_is_zero(fd, position, len) ;
+    ::close(fd) ;
+    return result ;
+}
+
 uint64_t storageimage_binfile_c::size(void) 
 {
+    f.clear(); // clear fail bit of read behind end of file
     f.seekp(0, std::ios::end);
     return f.tellp();
 }
@@ -286,6 +376,273 @@ void storageimage_binfile_c::save_to_file(std::string _host_filename)
 
 
 
+// mapping grows in steps of this, to avoid mremap() on each appended sector
+#define STORAGEIMAGE_MMAP_CHUNK	0x100000 // 1MB
+
+// "kernel", "async", "sync"
+// result: false, if text invalid
+bool storageimage_mmap_c::sync_policy_from_text(std::string text, enum sync_policy_e *sync_policy)
+{
+    if (text == "kernel")
+        *sync_policy = sync_kernel ;
+    else if (text == "async")
+        *sync_policy = sync_async ;
+    else if (text == "sync")
+        *sync_policy = sync_sync ;
+    else
+        return false ;
+    return true ;
+}
+
+// map file with at least "min_size", existing mapping is enlarged.
+// fd and data_size must be valid.
+// result: OK= true, else false
+bool storageimage_mmap_c::map(uint64_t min_size)
+{
+    // round up to chunk, never map empty range
+    uint64_t new_map_size = (min_size + STORAGEIMAGE_MMAP_CHUNK - 1) & ~(uint64_t)(STORAGEIMAGE_MMAP_CHUNK - 1) ;
+    if (new_map_size == 0)
+        new_map_size = STORAGEIMAGE_MMAP_CHUNK ;
+    if (new_map_size <= map_size)
+        return true ; // already large enough
+    if ((size_t)new_map_size != new_map_size) {
+        // 32 bit ARM: address space is 4GB
+        ERROR("storageimage_mmap_c: %s with %" PRIu64 " bytes too large to map", image_fname.c_str(),
+              new_map_size) ;
+        return false ;
+    }
+    void *new_data ;
+    if (data == nullptr) {
+        int prot = readonly ? PROT_READ : (PROT_READ | PROT_WRITE) ;
+        new_data = mmap(nullptr, new_map_size, prot, MAP_SHARED, fd, 0) ;
+    } else
+        new_data = mremap(data, map_size, new_map_size, MREMAP_MAYMOVE) ;
+    if (new_data == MAP_FAILED) {
+        ERROR("storageimage_mmap_c: mapping %" PRIu64 " bytes of %s failed: %s", new_map_size,
+              image_fname.c_str(), strerror(errno)) ;
+        return false ;
+    }
+    data = (uint8_t *)new_data ;
+    map_size = new_map_size ;
+    return true ;
+}
+
+void storageimage_mmap_c::unmap(void)
+{
+    if (data != nullptr)
+        munmap(data, map_size) ;
+    data = nullptr ;
+    map_size = 0 ;
+}
+
+// write back the pages covering [position, position+len)
+void storageimage_mmap_c::sync(uint64_t position, uint64_t len, bool wait)
+{
+    if (data == nullptr || len == 0)
+        return ;
+    uint64_t pagesize = sysconf(_SC_PAGESIZE) ;
+    uint64_t start = position & ~(pagesize - 1) ;
+    if (msync(data + start, position + len - start, wait ? MS_SYNC : MS_ASYNC) != 0)
+        ERROR("storageimage_mmap_c: msync() on %s failed: %s", image_fname.c_str(), strerror(errno)) ;
+}
+
+// open a file, if possible, and map it.
+// set the file_readonly flag
+// creates file, if not existing
+// result: OK= true, else false
+bool storageimage_mmap_c::open(storagedrive_c *_drive, bool create)
+{
+    drive = _drive ;
+    if (is_open())
+        close(); // after RL11 INIT
+    readonly = false ;
+    if (image_fname.empty())
+        return true ; // ! is_open
+
+    fd = ::open(image_fname.c_str(), O_BINARY | O_RDWR) ;
+    if (fd < 0) {
+        fd = ::open(image_fname.c_str(), O_BINARY | O_RDONLY) ;
+        readonly = (fd >= 0) ;
+    }
+    if (fd < 0 && uncompress_file(image_fname)) {
+        // retry on expanded file
+        fd = ::open(image_fname.c_str(), O_BINARY | O_RDWR) ;
+        if (fd < 0) {
+            fd = ::open(image_fname.c_str(), O_BINARY | O_RDONLY) ;
+            readonly = (fd >= 0) ;
+        }
+    }
+    if (fd < 0) {
+        // definitely no image file neither plain nor zipped
+        // create one?
+        if (!create)
+            return false;
+        fd = ::open(image_fname.c_str(), O_BINARY | O_RDWR | O_CREAT, 0666) ;
+        if (fd < 0) {
+            INFO("Creating empty image file %s FAILED.", image_fname.c_str()) ;
+            return false;
+        }
+        INFO("Created empty image file %s.", image_fname.c_str()) ;
+    }
+
+    struct stat file_status ;
+    if (fstat(fd, &file_status) != 0) {
+        ERROR("storageimage_mmap_c: fstat() on %s failed: %s", image_fname.c_str(), strerror(errno)) ;
+        close() ;
+        return false ;
+    }
+    data_size = file_status.st_size ;
+    if (!map(data_size)) {
+        close() ;
+        return false ;
+    }
+    return true ;
+}
+
+bool storageimage_mmap_c::is_open(void)
+{
+    return fd >= 0 ;
+}
+
+// set file size to 0
+bool storageimage_mmap_c::truncate(void)
+{
+    assert(is_open());
+    assert(!readonly); // caller must take care
+    // mapping remains, but all pages are behind data_size now
+    if (ftruncate(fd, 0) != 0) {
+        ERROR("storageimage_mmap_c: ftruncate() on %s failed: %s", image_fname.c_str(), strerror(errno)) ;
+        return false ;
+    }
+    data_size = 0 ;
+    return true ;
+}
+
+/* read "len" bytes from file into buffer
+ * if file is too short, 00s are read
+ */
+void storageimage_mmap_c::read(uint8_t *buffer, uint64_t position, unsigned len)
+{
+    assert(is_open());
+    assert(buffer != nullptr) ;
+    assert(len) ;
+    unsigned bytes_copied = 0 ;
+    if (position < data_size) {
+        if (position + len <= data_size)
+            bytes_copied = len ;
+        else
+            bytes_copied = data_size - position ;
+        memcpy(buffer, &data[position], bytes_copied) ;
+    }
+    // fill up 00s
+    if (bytes_copied != len)
+        memset(buffer + bytes_copied, 0, len - bytes_copied) ;
+}
+
+/* write "len" bytes from buffer into file at position "offset"
+ * if file too short, it is extended. ftruncate() fills with 00s.
+ */
+void storageimage_mmap_c::write(uint8_t *buffer, uint64_t position, unsigned len)
+{
+    assert(buffer);
+    assert(is_open());
+    assert(!readonly); // caller must take care
+
+    uint64_t end_pos = position + len ;
+    if (end_pos > data_size) {
+        // map before growing: file remains unchanged if mapping fails
+        if (!map(end_pos))
+            return ;
+        if (ftruncate(fd, end_pos) != 0) {
+            ERROR("storageimage_mmap_c.write() failure on %s: %s", image_fname.c_str(), strerror(errno));
+            return ;
+        }
+        data_size = end_pos ;
+    }
+    memcpy(&data[position], buffer, len) ;
+    if (sync_policy != sync_kernel)
+        sync(position, len, sync_policy == sync_sync) ;
+}
+
+// punch a hole, mapped pages read as 00 then
+void storageimage_mmap_c::set_zero(uint64_t position, unsigned len)
+{
+    assert(is_open());
+    assert(!readonly); // caller must take care
+    uint64_t end_pos = position + len ;
+    if (end_pos > data_size && !map(end_pos))
+        return ; // file may grow: map first, like write()
+    if (!file_set_zero(fd, data_size, position, len)) {
+        storageimage_base_c::set_zero(position, len) ; // via write()
+        return ;
+    }
+    if (end_pos > data_size)
+        data_size = end_pos ;
+}
+
+bool storageimage_mmap_c::is_zero(uint64_t position, unsigned len)
+{
+    assert(is_open());
+    return file_is_zero(fd, position, len) ; // shared mapping = page cache
+}
+
+uint64_t storageimage_mmap_c::size(void)
+{
+    return data_size ;
+}
+
+void storageimage_mmap_c::close(void)
+{
+    if (!is_open())
+        return ;
+    if (!readonly)
+        sync(0, data_size, true) ;
+    unmap() ;
+    ::close(fd) ;
+    fd = -1 ;
+    data_size = 0 ;
+    readonly = false;
+}
+
+// read data from image into memory buffer (cache)
+void storageimage_mmap_c::get_bytes(byte_buffer_c* byte_buffer, uint64_t byte_offset, uint32_t len)
+{
+    byte_buffer->set_size(len) ;
+    read(byte_buffer->data_ptr(), byte_offset, len) ;
+}
+
+// write cache buffer to image
+void storageimage_mmap_c::set_bytes(byte_buffer_c *byte_buffer, uint64_t byte_offset)
+{
+    write(byte_buffer->data_ptr(), byte_offset, byte_buffer->size()) ;
+}
+
+// make a snapshot
+// must be locked against parallel read()/write()/close()
+void storageimage_mmap_c::save_to_file(std::string _host_filename)
+{
+    std::string host_filename = absolute_path(&_host_filename) ;
+    assert(is_open()) ;
+
+    try {
+        int32_t file_descriptor;
+        file_descriptor = ::open(host_filename.c_str(), O_BINARY | O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (file_descriptor < 0)
+            throw printf_exception("storageimage_mmap_c::save_to_file() cannot open \"%s\"",
+                                   host_filename.c_str());
+        if (data_size > 0 && ::write(file_descriptor, data, data_size) != (ssize_t)data_size) {
+            ::close(file_descriptor);
+            throw printf_exception("storageimage_mmap_c::save_to_file() cannot write \"%s\"",
+                                   host_filename.c_str());
+        }
+        ::close(file_descriptor);
+    }
+    catch(std::exception& e) {
+        ERROR(e.what()) ;
+    }
+}
+
+
 // result: OK= true, else false
 bool storageimage_memory_c::open(storagedrive_c *_drive, bool create)
 {
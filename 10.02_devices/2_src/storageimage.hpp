@@ -20,12 +20,15 @@
  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
+ 16-oct-2026	QC      sparse files: set_zero(), is_zero() on holes
+ 16-oct-2026	QC      storageimage_mmap_c
  07-mar-2021	JH      start
 
  A disk/tape emulation (storage drive) saves data onto some magnetic surface,
  organized as filesystem.
  On Linux side this is saves a
  - plain binary file (SimH compatible block stream)
+   accessed via file stream, or mapped into memory
  - an unpacked shared directory with file tree
 
 
@@ -65,6 +68,11 @@ public:
     //	bool image_load_from_disk(string host_filename, 		bool allowcreate, bool *filecreated) ;
     virtual void save_to_file(std::string host_filename) = 0 ; // make a snapshot
 
+protected:
+    bool uncompress_file(std::string image_fname) ;
+    // sparse file: zeros are holes
+    bool file_set_zero(int fd, uint64_t file_size, uint64_t position, unsigned len) ;
+    bool file_is_zero(int fd, uint64_t position, unsigned len) ;
 } ;
 
 
@@ -95,6 +103,8 @@ public:
     virtual bool truncate(void) override;
     virtual void read(uint8_t *buffer, uint64_t position, unsigned len) override;
     virtual void write(uint8_t *buffer, uint64_t position, unsigned len) override;
+    virtual void set_zero(uint64_t position, unsigned len) override ;
+    virtual bool is_zero(uint64_t position, unsigned len) override ;
     virtual uint64_t size(void) override;
     virtual void close(void) override;
     virtual void get_bytes(byte_buffer_c *byte_buffer, uint64_t byte_offset, uint32_t data_size) override;
@@ -104,6 +114,64 @@ public:
 
 } ;
 
+// binary disk file mapped into memory, SimH compatible.
+// read()/write() are memcpy(), no syscall per sector.
+// File is grown with ftruncate(), mapping is grown in chunks with mremap().
+// Must be locked against parallel read()/write()/close(), like binfile.
+class storageimage_mmap_c: public storageimage_base_c {
+public:
+    // when written data is forced to the image file
+    enum sync_policy_e {
+        sync_kernel, // Linux writes back dirty pages, like flush() of binfile
+        sync_async, // msync(MS_ASYNC) after each write(): schedule write back
+        sync_sync // msync(MS_SYNC) after each write(): wait for write back
+    } ;
+    static bool sync_policy_from_text(std::string text, enum sync_policy_e *sync_policy) ;
+
+private:
+    bool readonly ;
+    int fd ; // image file, -1 if closed
+    std::string image_fname ;
+    enum sync_policy_e sync_policy ;
+    uint8_t *data ; // mapped file content
+    uint64_t data_size ; // current file size
+    uint64_t map_size ; // size of mapping, >= data_size. Never access behind data_size!
+
+    bool map(uint64_t min_size) ;
+    void unmap(void) ;
+    void sync(uint64_t position, uint64_t len, bool wait) ;
+
+public:
+    storageimage_mmap_c(std::string _image_fname, enum sync_policy_e _sync_policy) {
+        image_fname = _image_fname ;
+        sync_policy = _sync_policy ;
+        readonly = false ;
+        fd = -1 ;
+        data = nullptr ;
+        data_size = map_size = 0 ;
+    }
+
+    virtual ~storageimage_mmap_c() override {
+        close() ;
+    }
+
+    virtual bool is_readonly() override {
+        return readonly ;
+    }
+    virtual bool open(storagedrive_c *drive, bool create) override;
+    virtual bool is_open(	void) override;
+    virtual bool truncate(void) override;
+    virtual void read(uint8_t *buffer, uint64_t position, unsigned len) override;
+    virtual void write(uint8_t *buffer, uint64_t position, unsigned len) override;
+    virtual void set_zero(uint64_t position, unsigned len) override ;
+    virtual bool is_zero(uint64_t position, unsigned len) override ;
+    virtual uint64_t size(void) override;
+    virtual void close(void) override;
+    virtual void get_bytes(byte_buffer_c *byte_buffer, uint64_t byte_offset, uint32_t data_size) override;
+    virtual void set_bytes(byte_buffer_c *byte_buffer, uint64_t byte_offset) override ;
+    virtual void save_to_file(std::string host_filename) override ;
+} ;
+
 // in-memory version of disk image file
 class storageimage_memory_c: public storageimage_base_c {
 private:
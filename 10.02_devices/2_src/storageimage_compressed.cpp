@@ -0,0 +1,349 @@
+/* storageimage_compressed.cpp: read-only image of compressed block groups
+
+ Copyright (c) 2026, QUniBone contributors
+ https://github.com/j-hoppe/QUniBone
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ THE CONTRIBUTORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+ 16-oct-2026  QC      source size/mtime in header, index validated on open()
+ 16-oct-2026  QC      created
+ */
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <zlib.h>
+
+#include "logger.hpp"
+#include "utils.hpp"
+#include "storageimage_compressed.hpp"
+
+static_assert(sizeof(storageimage_compressed_header_t) == STORAGEIMAGE_COMPRESSED_HEADER_SIZE,
+              "header must be one block") ;
+
+storageimage_compressed_c::storageimage_compressed_c(std::string _image_fname)
+{
+    image_fname = _image_fname ;
+    fd = -1 ;
+    memset(&header, 0, sizeof(header)) ;
+    group_cache_next = 0 ;
+    pthread_mutex_init(&mutex, NULL);
+}
+
+storageimage_compressed_c::~storageimage_compressed_c()
+{
+    close() ;
+    pthread_mutex_destroy(&mutex);
+}
+
+// does file start with compressed image header?
+bool storageimage_compressed_c::is_compressed_file(std::string fname)
+{
+    char magic[8] ;
+    int fd = ::open(fname.c_str(), O_RDONLY) ;
+    if (fd < 0)
+        return false ;
+    bool result = (::read(fd, magic, sizeof(magic)) == sizeof(magic))
+                  && !memcmp(magic, STORAGEIMAGE_COMPRESSED_MAGIC, sizeof(magic)) ;
+    ::close(fd) ;
+    return result ;
+}
+
+// convert a .gz (or plain) image into compressed groups with index.
+// Source is read as stream, nothing is expanded onto the SD card.
+// Written to a temp file first, so a crash leaves no half image.
+// result: OK= true, else false
+bool storageimage_compressed_c::create_from_file(std::string src_fname, std::string dest_fname)
+{
+    printf("Indexing compressed image %s into %s ...\n", src_fname.c_str(), dest_fname.c_str()) ;
+    struct stat src_status ;
+    gzFile src = NULL ;
+    if (stat(src_fname.c_str(), &src_status) == 0)
+        src = gzopen(src_fname.c_str(), "rb") ; // plain files are read transparently
+    if (src == NULL) {
+        printf(" Can not open %s!\n", src_fname.c_str()) ;
+        return false ;
+    }
+    std::string tmp_fname = dest_fname + ".tmp" ;
+    int dest = ::open(tmp_fname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666) ;
+    if (dest < 0) {
+        printf(" Can not create %s: %s!\n", tmp_fname.c_str(), strerror(errno)) ;
+        gzclose(src) ;
+        return false ;
+    }
+
+    storageimage_compressed_header_t header ;
+    memset(&header, 0, sizeof(header)) ;
+    memcpy(header.magic, STORAGEIMAGE_COMPRESSED_MAGIC, sizeof(header.magic)) ;
+    header.group_size = STORAGEIMAGE_COMPRESSED_GROUP_SIZE ;
+    header.method = STORAGEIMAGE_COMPRESSED_METHOD_DEFLATE ;
+    header.source_size = src_status.st_size ;
+    header.source_mtime = src_status.st_mtime ;
+
+    std::vector<storageimage_compressed_index_entry_t> index ;
+    std::vector<uint8_t> group(header.group_size) ;
+    std::vector<uint8_t> compressed(compressBound(header.group_size)) ;
+    uint64_t offset = STORAGEIMAGE_COMPRESSED_HEADER_SIZE ;
+    bool ok = true ;
+    bool eof = false ;
+    while (ok && !eof) {
+        int n = gzread(src, group.data(), header.group_size) ;
+        if (n < 0) {
+            int errnum ;
+            printf(" Read error on %s: %s!\n", src_fname.c_str(), gzerror(src, &errnum)) ;
+            ok = false ;
+            break ;
+        }
+        if (n == 0)
+            break ;
+        eof = ((unsigned)n < header.group_size) ;
+        std::fill(group.begin() + n, group.end(), 0) ; // last group padded
+        header.size += n ;
+
+        storageimage_compressed_index_entry_t entry ;
+        memset(&entry, 0, sizeof(entry)) ;
+        bool all_zero = std::all_of(group.begin(), group.end(), [](uint8_t b) {
+            return b == 0 ;
+        }) ;
+        if (!all_zero) {
+            uLongf compressed_len = compressed.size() ;
+            const uint8_t *data = compressed.data() ;
+            if (compress2(compressed.data(), &compressed_len, group.data(), header.group_size,
+                          Z_DEFAULT_COMPRESSION) != Z_OK || compressed_len >= header.group_size) {
+                // incompressible: store plain
+                data = group.data() ;
+                compressed_len = header.group_size ;
+            }
+            entry.offset = offset ;
+            entry.length = compressed_len ;
+            ok = ::pwrite(dest, data, compressed_len, offset) == (ssize_t)compressed_len ;
+            offset += compressed_len ;
+        }
+        index.push_back(entry) ;
+    }
+    gzclose(src) ;
+
+    header.group_count = index.size() ;
+    header.index_offset = offset ;
+    unsigned index_size = index.size() * sizeof(storageimage_compressed_index_entry_t) ;
+    ok = ok && ::pwrite(dest, index.data(), index_size, offset) == (ssize_t)index_size
+         && ::pwrite(dest, &header, sizeof(header), 0) == sizeof(header)
+         && fsync(dest) == 0 ;
+    ::close(dest) ;
+    if (ok && rename(tmp_fname.c_str(), dest_fname.c_str()) != 0)
+        ok = false ;
+    if (!ok) {
+        printf(" FAILED: %s\n", strerror(errno)) ;
+        remove(tmp_fname.c_str()) ;
+        return false ;
+    }
+    printf("... complete, %llu bytes stored in %llu.\n", (unsigned long long)header.size,
+           (unsigned long long)(offset + index_size)) ;
+    return true ;
+}
+
+// was "fname" created from the current content of "src_fname"?
+// false also if "fname" is no compressed image
+bool storageimage_compressed_c::is_converted_from(std::string fname, std::string src_fname)
+{
+    storageimage_compressed_header_t header ;
+    struct stat src_status ;
+    if (stat(src_fname.c_str(), &src_status) != 0)
+        return false ;
+    int fd = ::open(fname.c_str(), O_RDONLY) ;
+    if (fd < 0)
+        return false ;
+    bool result = ::pread(fd, &header, sizeof(header), 0) == sizeof(header)
+                  && !memcmp(header.magic, STORAGEIMAGE_COMPRESSED_MAGIC, sizeof(header.magic))
+                  && header.source_size == (uint64_t)src_status.st_size
+                  && header.source_mtime == (int64_t)src_status.st_mtime ;
+    ::close(fd) ;
+    return result ;
+}
+
+// only the header and index are read.
+// The index is checked against the file, so group_get() never reads
+// more than compressed_buffer or behind end of file.
+// result: OK= true, else false
+bool storageimage_compressed_c::open(storagedrive_c *_drive, bool create)
+{
+    UNUSED(create) ; // read only, nothing to create
+    drive = _drive ;
+    if (is_open())
+        close(); // after RL11 INIT
+
+    fd = ::open(image_fname.c_str(), O_RDONLY) ;
+    if (fd < 0)
+        return false ;
+    struct stat file_status ;
+    bool ok = fstat(fd, &file_status) == 0
+              && ::pread(fd, &header, sizeof(header), 0) == sizeof(header)
+              && !memcmp(header.magic, STORAGEIMAGE_COMPRESSED_MAGIC, sizeof(header.magic))
+              && header.method == STORAGEIMAGE_COMPRESSED_METHOD_DEFLATE
+              && header.group_size == STORAGEIMAGE_COMPRESSED_GROUP_SIZE
+              && header.group_count == (header.size + header.group_size - 1) / header.group_size ;
+    uint64_t file_size = ok ? file_status.st_size : 0 ;
+    // index must lie in file, before the groups can be checked
+    ok = ok && header.index_offset <= file_size
+         && header.group_count <= (file_size - header.index_offset) / sizeof(storageimage_compressed_index_entry_t) ;
+    if (ok) {
+        index.resize(header.group_count) ;
+        ssize_t index_size = index.size() * sizeof(storageimage_compressed_index_entry_t) ;
+        ok = ::pread(fd, index.data(), index_size, header.index_offset) == index_size ;
+    }
+    uint64_t max_length = compressBound(header.group_size) ;
+    for (uint64_t i = 0; ok && i < index.size(); i++)
+        ok = index[i].length <= max_length && index[i].offset <= file_size
+             && index[i].length <= file_size - index[i].offset ;
+    if (!ok) {
+        ERROR("%s is no valid compressed image", image_fname.c_str()) ;
+        close() ;
+        return false ;
+    }
+    for (unsigned i = 0; i < STORAGEIMAGE_COMPRESSED_GROUP_CACHE; i++) {
+        group_cache[i].group_nr = UINT64_MAX ;
+        group_cache[i].data.resize(header.group_size) ;
+    }
+    group_cache_next = 0 ;
+    compressed_buffer.resize(compressBound(header.group_size)) ; // max valid entry length
+    return true ;
+}
+
+bool storageimage_compressed_c::is_open()
+{
+    return fd >= 0 ;
+}
+
+bool storageimage_compressed_c::truncate()
+{
+    ERROR("Compressed image %s is read only", image_fname.c_str()) ;
+    return false ;
+}
+
+// decompressed data of a group, from cache or file.
+// mutex must be locked.
+uint8_t *storageimage_compressed_c::group_get(uint64_t group_nr)
+{
+    for (unsigned i = 0; i < STORAGEIMAGE_COMPRESSED_GROUP_CACHE; i++)
+        if (group_cache[i].group_nr == group_nr)
+            return group_cache[i].data.data() ;
+
+    group_buffer_t *group = &group_cache[group_cache_next] ;
+    group_cache_next = (group_cache_next + 1) % STORAGEIMAGE_COMPRESSED_GROUP_CACHE ;
+    group->group_nr = group_nr ;
+    uint8_t *data = group->data.data() ;
+    storageimage_compressed_index_entry_t *entry = &index[group_nr] ;
+    if (entry->length == 0)
+        memset(data, 0, header.group_size) ;
+    else if (entry->length == header.group_size) {
+        if (::pread(fd, data, header.group_size, entry->offset) != header.group_size) {
+            ERROR("Can not read %s: %s", image_fname.c_str(), strerror(errno)) ;
+            memset(data, 0, header.group_size) ;
+        }
+    } else {
+        uLongf len = header.group_size ;
+        if (::pread(fd, compressed_buffer.data(), entry->length, entry->offset) != entry->length
+                || uncompress(data, &len, compressed_buffer.data(), entry->length) != Z_OK
+                || len != header.group_size) {
+            ERROR("Can not decompress group %llu of %s", (unsigned long long)group_nr, image_fname.c_str()) ;
+            memset(data, 0, header.group_size) ;
+        }
+    }
+    return data ;
+}
+
+/* read "len" bytes from image into buffer
+ * if image is too short, 00s are read
+ */
+void storageimage_compressed_c::read(uint8_t *buffer, uint64_t position, unsigned len)
+{
+    assert(is_open()) ;
+    assert(buffer != nullptr) ;
+    assert(len) ;
+    memset(buffer, 0, len) ;
+    uint64_t end = std::min(position + len, header.size) ;
+    pthread_mutex_lock(&mutex);
+    for (uint64_t pos = position; pos < end; ) {
+        uint64_t group_nr = pos / header.group_size ;
+        unsigned group_offset = pos % header.group_size ;
+        unsigned n = std::min(end - pos, (uint64_t)(header.group_size - group_offset)) ;
+        memcpy(buffer + (pos - position), group_get(group_nr) + group_offset, n) ;
+        pos += n ;
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+void storageimage_compressed_c::write(uint8_t *buffer, uint64_t position, unsigned len)
+{
+    UNUSED(buffer) ;
+    UNUSED(position) ;
+    UNUSED(len) ;
+    ERROR("Compressed image %s is read only", image_fname.c_str()) ;
+}
+
+uint64_t storageimage_compressed_c::size(void)
+{
+    return header.size ;
+}
+
+void storageimage_compressed_c::close(void)
+{
+    if (!is_open())
+        return ;
+    ::close(fd) ;
+    fd = -1 ;
+    index.clear() ;
+}
+
+void storageimage_compressed_c::get_bytes(byte_buffer_c* byte_buffer, uint64_t byte_offset, uint32_t len)
+{
+    byte_buffer->set_size(len) ;
+    read(byte_buffer->data_ptr(), byte_offset, len) ;
+}
+
+void storageimage_compressed_c::set_bytes(byte_buffer_c *byte_buffer, uint64_t byte_offset)
+{
+    write(byte_buffer->data_ptr(), byte_offset, byte_buffer->size()) ;
+}
+
+// expanded copy of the image
+void storageimage_compressed_c::save_to_file(std::string host_filename)
+{
+    assert(is_open()) ;
+    int dest = ::open(host_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666) ;
+    if (dest < 0) {
+        ERROR("Can not create %s: %s", host_filename.c_str(), strerror(errno)) ;
+        return ;
+    }
+    bool ok = true ;
+    pthread_mutex_lock(&mutex);
+    for (uint64_t group_nr = 0; ok && group_nr < header.group_count; group_nr++) {
+        uint64_t pos = group_nr * header.group_size ;
+        unsigned n = std::min(header.size - pos, (uint64_t)header.group_size) ;
+        ok = ::pwrite(dest, group_get(group_nr), n, pos) == (ssize_t)n ;
+    }
+    pthread_mutex_unlock(&mutex);
+    if (!ok)
+        ERROR("Can not write %s: %s", host_filename.c_str(), strerror(errno)) ;
+    ::close(dest) ;
+}
@@ -0,0 +1,124 @@
+/* storageimage_compressed.hpp: read-only image of compressed block groups
+
+ Copyright (c) 2026, QUniBone contributors
+ https://github.com/j-hoppe/QUniBone
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ THE CONTRIBUTORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+ 16-oct-2026  QC      source size/mtime in header, index validated on open()
+ 16-oct-2026  QC      created
+
+ A ".gz" image can not be accessed randomly, it had to be expanded
+ completely onto the SD card. Here the image is split into "groups" of
+ fixed size, each compressed independently. An index gives the file position
+ of each group, so read() decompresses only the groups it needs.
+
+ File layout:
+ - header block
+ - compressed groups. All-zero groups are not stored.
+ - index: offset and length of each group.
+   length 0 = all zero, length == group_size: stored uncompressed.
+
+ The header records size and mtime of the converted file: if the .gz
+ is replaced, the compressed image is created again.
+
+ The image is read only. For write access it is used as parent
+ of a copy-on-write overlay (storageimage_overlay_c).
+ */
+#ifndef _STORAGEIMAGE_COMPRESSED_HPP_
+#define _STORAGEIMAGE_COMPRESSED_HPP_
+
+#include <stdint.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+#include "storageimage.hpp"
+
+#define STORAGEIMAGE_COMPRESSED_MAGIC	"QUBCZ001"
+#define STORAGEIMAGE_COMPRESSED_HEADER_SIZE	512
+#define STORAGEIMAGE_COMPRESSED_GROUP_SIZE	0x10000 // 64K: 128 blocks
+#define STORAGEIMAGE_COMPRESSED_GROUP_CACHE	8 // decompressed groups kept
+
+// compression of groups
+#define STORAGEIMAGE_COMPRESSED_METHOD_DEFLATE	1 // zlib
+
+// first block of file, little endian
+typedef struct {
+    char magic[8] ;
+    uint32_t group_size ;
+    uint32_t method ;
+    uint64_t size ; // uncompressed image size
+    uint64_t group_count ;
+    uint64_t index_offset ;
+    // file converted from, to detect a changed .gz
+    uint64_t source_size ;
+    int64_t source_mtime ; // seconds
+    uint8_t _fill[STORAGEIMAGE_COMPRESSED_HEADER_SIZE - 56] ;
+} storageimage_compressed_header_t ;
+
+typedef struct {
+    uint64_t offset ;
+    uint32_t length ;
+    uint32_t _reserved ;
+} storageimage_compressed_index_entry_t ;
+
+class storageimage_compressed_c: public storageimage_base_c {
+private:
+    std::string image_fname ;
+    int fd ; // -1 if closed
+    storageimage_compressed_header_t header ;
+    std::vector<storageimage_compressed_index_entry_t> index ;
+
+    pthread_mutex_t mutex ; // group cache
+    // small round robin cache of decompressed groups
+    typedef struct {
+        uint64_t group_nr ; // invalid if >= group_count
+        std::vector<uint8_t> data ;
+    } group_buffer_t ;
+    group_buffer_t group_cache[STORAGEIMAGE_COMPRESSED_GROUP_CACHE] ;
+    unsigned group_cache_next ; // slot to replace
+    std::vector<uint8_t> compressed_buffer ;
+
+    uint8_t *group_get(uint64_t group_nr) ;
+
+public:
+    storageimage_compressed_c(std::string _image_fname) ;
+    virtual ~storageimage_compressed_c() override ;
+
+    static bool is_compressed_file(std::string fname) ;
+    static bool create_from_file(std::string src_fname, std::string dest_fname) ;
+    static bool is_converted_from(std::string fname, std::string src_fname) ;
+
+    virtual bool is_readonly() override {
+        return true ;
+    }
+    virtual bool open(storagedrive_c *drive, bool create) override;
+    virtual bool is_open(	void) override;
+    virtual bool truncate(void) override;
+    virtual void read(uint8_t *buffer, uint64_t position, unsigned len) override;
+    virtual void write(uint8_t *buffer, uint64_t position, unsigned len) override;
+    virtual uint64_t size(void) override;
+    virtual void close(void) override;
+    virtual void get_bytes(byte_buffer_c *byte_buffer, uint64_t byte_offset, uint32_t data_size) override;
+    virtual void set_bytes(byte_buffer_c *byte_buffer, uint64_t byte_offset) override ;
+    virtual void save_to_file(std::string host_filename) override ;
+} ;
+
+#endif
@@ -0,0 +1,511 @@
+/* storageimage_overlay.cpp: copy-on-write overlay over a read-only image
+
+ Copyright (c) 2026, QUniBone contributors
+ https://github.com/j-hoppe/QUniBone
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ THE CONTRIBUTORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+ 16-oct-2026  QC      compressed parent
+ 16-oct-2026  QC      commit() only into base image, header written as byte block
+ 16-oct-2026  QC      created
+ */
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <algorithm>
+
+#include "logger.hpp"
+#include "utils.hpp"
+#include "storageimage_compressed.hpp"
+#include "storageimage_overlay.hpp"
+
+static_assert(sizeof(storageimage_overlay_header_t) == STORAGEIMAGE_OVERLAY_BLOCK_SIZE,
+              "delta header must be one block") ;
+
+// bitmap covers at least this, or twice the parent
+#define STORAGEIMAGE_OVERLAY_MIN_BLOCKS	(0x40000000 / STORAGEIMAGE_OVERLAY_BLOCK_SIZE) // 1GB
+
+storageimage_overlay_c::storageimage_overlay_c(std::string _delta_fname, std::string _parent_fname,
+        bool _discard_on_close)
+{
+    delta_fname = absolute_path(&_delta_fname) ;
+    if (!_parent_fname.empty())
+        parent_fname = absolute_path(&_parent_fname) ;
+    discard_on_close = _discard_on_close ;
+    delta_fd = -1 ;
+    parent = nullptr ;
+    memset(&header, 0, sizeof(header)) ;
+    pthread_mutex_init(&mutex, NULL);
+}
+
+storageimage_overlay_c::~storageimage_overlay_c()
+{
+    close() ;
+    pthread_mutex_destroy(&mutex);
+}
+
+// does file start with delta header?
+bool storageimage_overlay_c::is_overlay_file(std::string fname)
+{
+    char magic[8] ;
+    int fd = ::open(fname.c_str(), O_RDONLY) ;
+    if (fd < 0)
+        return false ;
+    bool result = (::read(fd, magic, sizeof(magic)) == sizeof(magic))
+                  && !memcmp(magic, STORAGEIMAGE_OVERLAY_MAGIC, sizeof(magic)) ;
+    ::close(fd) ;
+    return result ;
+}
+
+// is "fname" parent, or parent of parent ...?
+// After snapshot() the original image is no longer the direct parent.
+bool storageimage_overlay_c::has_ancestor(std::string fname)
+{
+    if (fname == header.parent_fname)
+        return true ;
+    storageimage_overlay_c *parent_overlay = dynamic_cast<storageimage_overlay_c *>(parent) ;
+    return parent_overlay != nullptr && parent_overlay->has_ancestor(fname) ;
+}
+
+// open parent named in header, as binary or compressed image or as next delta of chain.
+// Only read, except by commit()
+bool storageimage_overlay_c::parent_open(void)
+{
+    std::string fname = header.parent_fname ;
+    if (is_overlay_file(fname))
+        parent = new storageimage_overlay_c(fname, "", /*discard_on_close*/false) ;
+    else if (storageimage_compressed_c::is_compressed_file(fname))
+        parent = new storageimage_compressed_c(fname) ;
+    else
+        parent = new storageimage_binfile_c(fname) ;
+    parent->log_level_ptr = log_level_ptr ;
+    if (!parent->open(drive, /*create*/false)) {
+        ERROR("Can not open parent image %s of %s", fname.c_str(), delta_fname.c_str()) ;
+        delete parent ;
+        parent = nullptr ;
+        return false ;
+    }
+    return true ;
+}
+
+void storageimage_overlay_c::parent_close(void)
+{
+    if (parent == nullptr)
+        return ;
+    delete parent ; // closes
+    parent = nullptr ;
+}
+
+// header as byte block, as written to file.
+// pwrite(&header) lets gcc -O3 assume only "magic" is read (-Wstringop-overread)
+static void header_to_block(storageimage_overlay_header_t *header, uint8_t *block)
+{
+    memcpy(block, header, sizeof(*header)) ;
+}
+
+bool storageimage_overlay_c::header_save(void)
+{
+    uint8_t block[sizeof(header)] ;
+    header_to_block(&header, block) ;
+    if (::pwrite(delta_fd, block, sizeof(block), 0) != sizeof(block)) {
+        ERROR("Can not write header of %s: %s", delta_fname.c_str(), strerror(errno)) ;
+        return false ;
+    }
+    return true ;
+}
+
+// create empty delta for opened parent.
+// header.parent_fname already set
+bool storageimage_overlay_c::delta_create(void)
+{
+    delta_fd = ::open(delta_fname.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666) ;
+    if (delta_fd < 0) {
+        ERROR("Can not create %s: %s", delta_fname.c_str(), strerror(errno)) ;
+        return false ;
+    }
+    uint64_t parent_size = parent->size() ;
+    uint64_t parent_blocks = (parent_size + STORAGEIMAGE_OVERLAY_BLOCK_SIZE - 1) / STORAGEIMAGE_OVERLAY_BLOCK_SIZE ;
+    uint64_t max_block_count = std::max(2 * parent_blocks, (uint64_t)STORAGEIMAGE_OVERLAY_MIN_BLOCKS) ;
+    max_block_count = (max_block_count + 0x7fff) & ~(uint64_t)0x7fff ; // bitmap in whole 4K pages
+
+    memcpy(header.magic, STORAGEIMAGE_OVERLAY_MAGIC, sizeof(header.magic)) ;
+    header.block_size = STORAGEIMAGE_OVERLAY_BLOCK_SIZE ;
+    header.size = parent_size ;
+    header.parent_size = parent_size ;
+    header.max_block_count = max_block_count ;
+    header.bitmap_offset = STORAGEIMAGE_OVERLAY_BLOCK_SIZE ;
+    header.data_offset = header.bitmap_offset + max_block_count / 8 ;
+    bitmap.assign(max_block_count / 8, 0) ;
+    // bitmap and data are holes
+    if (ftruncate(delta_fd, header.data_offset) != 0 || !header_save()) {
+        ERROR("Can not initialize %s: %s", delta_fname.c_str(), strerror(errno)) ;
+        ::close(delta_fd) ;
+        delta_fd = -1 ;
+        return false ;
+    }
+    return true ;
+}
+
+bool storageimage_overlay_c::delta_load(void)
+{
+    if (::pread(delta_fd, &header, sizeof(header), 0) != sizeof(header)
+            || memcmp(header.magic, STORAGEIMAGE_OVERLAY_MAGIC, sizeof(header.magic))
+            || header.block_size != STORAGEIMAGE_OVERLAY_BLOCK_SIZE) {
+        ERROR("%s is no valid overlay delta file", delta_fname.c_str()) ;
+        return false ;
+    }
+    header.parent_fname[sizeof(header.parent_fname) - 1] = 0 ;
+    bitmap.resize(header.max_block_count / 8) ;
+    if (::pread(delta_fd, bitmap.data(), bitmap.size(), header.bitmap_offset) != (ssize_t)bitmap.size()) {
+        ERROR("Can not read bitmap of %s", delta_fname.c_str()) ;
+        return false ;
+    }
+    return true ;
+}
+
+// remove all blocks: punch bitmap and data to holes
+void storageimage_overlay_c::delta_clear(void)
+{
+    std::fill(bitmap.begin(), bitmap.end(), 0) ;
+    if (ftruncate(delta_fd, header.bitmap_offset) != 0 || ftruncate(delta_fd, header.data_offset) != 0)
+        ERROR("Can not clear %s: %s", delta_fname.c_str(), strerror(errno)) ;
+}
+
+// mark block as in delta. Called after data written, so a crash
+// loses the block, but never exposes garbage.
+void storageimage_overlay_c::bitmap_set(uint64_t block_nr)
+{
+    uint64_t idx = block_nr / 8 ;
+    bitmap[idx] |= 1 << (block_nr % 8) ;
+    if (::pwrite(delta_fd, &bitmap[idx], 1, header.bitmap_offset + idx) != 1)
+        ERROR("Can not write bitmap of %s: %s", delta_fname.c_str(), strerror(errno)) ;
+}
+
+// open existing delta, or create empty one for parent.
+// With discard_on_close, always start with empty delta.
+// result: OK= true, else false
+bool storageimage_overlay_c::open(storagedrive_c *_drive, bool create)
+{
+    drive = _drive ;
+    if (is_open())
+        close(); // after RL11 INIT
+
+    if (discard_on_close && !parent_fname.empty())
+        remove(delta_fname.c_str()) ; // left over from crashed session
+
+    if (file_exists(&delta_fname)) {
+        delta_fd = ::open(delta_fname.c_str(), O_RDWR) ;
+        if (delta_fd < 0) {
+            ERROR("Can not open %s: %s", delta_fname.c_str(), strerror(errno)) ;
+            return false ;
+        }
+        if (!delta_load()) {
+            close() ;
+            return false ;
+        }
+        if (!parent_open()) {
+            close() ;
+            return false ;
+        }
+        if (!parent_fname.empty() && !has_ancestor(parent_fname)) {
+            ERROR("Delta %s belongs to image %s, not %s", delta_fname.c_str(), header.parent_fname,
+                  parent_fname.c_str()) ;
+            close() ;
+            return false ;
+        }
+        return true ;
+    }
+
+    if (parent_fname.empty() || !create)
+        return false ;
+    if (parent_fname.size() >= sizeof(header.parent_fname)) {
+        ERROR("Path of parent image too long: %s", parent_fname.c_str()) ;
+        return false ;
+    }
+    memset(&header, 0, sizeof(header)) ;
+    strcpy(header.parent_fname, parent_fname.c_str()) ;
+    if (!parent_open())
+        return false ;
+    if (!delta_create()) {
+        parent_close() ;
+        return false ;
+    }
+    INFO("Created overlay %s for image %s.", delta_fname.c_str(), parent_fname.c_str()) ;
+    return true ;
+}
+
+bool storageimage_overlay_c::is_open(void)
+{
+    return delta_fd >= 0 ;
+}
+
+// image appears empty, parent is hidden
+bool storageimage_overlay_c::truncate(void)
+{
+    assert(is_open()) ;
+    pthread_mutex_lock(&mutex);
+    delta_clear() ;
+    header.size = 0 ;
+    header.parent_size = 0 ;
+    bool result = header_save() ;
+    pthread_mutex_unlock(&mutex);
+    return result ;
+}
+
+/* read "len" bytes into buffer
+ * consecutive blocks from delta or parent are read with one access.
+ * behind end of image, 00s are read
+ */
+void storageimage_overlay_c::read(uint8_t *buffer, uint64_t position, unsigned len)
+{
+    assert(is_open()) ;
+    assert(buffer != nullptr) ;
+    assert(len) ;
+    memset(buffer, 0, len) ;
+    pthread_mutex_lock(&mutex);
+    uint64_t end = std::min(position + len, header.size) ;
+    uint64_t pos = position ;
+    while (pos < end) {
+        uint64_t block_nr = pos / STORAGEIMAGE_OVERLAY_BLOCK_SIZE ;
+        bool in_delta = block_in_delta(block_nr) ;
+        // find run of blocks from same source
+        do
+            block_nr++ ;
+        while (block_nr * STORAGEIMAGE_OVERLAY_BLOCK_SIZE < end && block_in_delta(block_nr) == in_delta) ;
+        uint64_t run_end = std::min(block_nr * STORAGEIMAGE_OVERLAY_BLOCK_SIZE, end) ;
+        uint8_t *dest = buffer + (pos - position) ;
+        if (in_delta) {
+            if (::pread(delta_fd, dest, run_end - pos, header.data_offset + pos) < 0)
+                ERROR("Can not read %s: %s", delta_fname.c_str(), strerror(errno)) ;
+        } else if (pos < header.parent_size)
+            parent->read(dest, pos, std::min(run_end, header.parent_size) - pos) ;
+        pos = run_end ;
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+/* write "len" bytes from buffer to delta.
+ * Partially written blocks are copied from parent first.
+ */
+void storageimage_overlay_c::write(uint8_t *buffer, uint64_t position, unsigned len)
+{
+    assert(is_open()) ;
+    assert(buffer) ;
+    uint64_t first_block_nr = position / STORAGEIMAGE_OVERLAY_BLOCK_SIZE ;
+    uint64_t last_block_nr = (position + len - 1) / STORAGEIMAGE_OVERLAY_BLOCK_SIZE ;
+    if (last_block_nr >= header.max_block_count) {
+        ERROR("Write behind max size of overlay %s", delta_fname.c_str()) ;
+        return ;
+    }
+    pthread_mutex_lock(&mutex);
+    bool ok = true ;
+    for (uint64_t block_nr = first_block_nr; block_nr <= last_block_nr; block_nr++) {
+        uint64_t block_pos = block_nr * STORAGEIMAGE_OVERLAY_BLOCK_SIZE ;
+        uint64_t begin = std::max(block_pos, position) ;
+        uint64_t end = std::min(block_pos + STORAGEIMAGE_OVERLAY_BLOCK_SIZE, position + len) ;
+        ssize_t res ;
+        if (block_in_delta(block_nr) || end - begin == STORAGEIMAGE_OVERLAY_BLOCK_SIZE)
+            res = ::pwrite(delta_fd, buffer + (begin - position), end - begin, header.data_offset + begin) ;
+        else {
+            // copy up: block from parent, modified
+            uint8_t block[STORAGEIMAGE_OVERLAY_BLOCK_SIZE] ;
+            memset(block, 0, sizeof(block)) ;
+            if (block_pos < header.parent_size)
+                parent->read(block, block_pos, std::min((uint64_t)STORAGEIMAGE_OVERLAY_BLOCK_SIZE, header.parent_size - block_pos)) ;
+            memcpy(block + (begin - block_pos), buffer + (begin - position), end - begin) ;
+            res = ::pwrite(delta_fd, block, sizeof(block), header.data_offset + block_pos) ;
+        }
+        if (res < 0) {
+            ERROR("Can not write %s: %s", delta_fname.c_str(), strerror(errno)) ;
+            ok = false ;
+            break ;
+        }
+        if (!block_in_delta(block_nr))
+            bitmap_set(block_nr) ;
+    }
+    // image grows only by data actually written
+    if (ok && position + len > header.size) {
+        header.size = position + len ;
+        header_save() ;
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+uint64_t storageimage_overlay_c::size(void)
+{
+    return header.size ;
+}
+
+void storageimage_overlay_c::close(void)
+{
+    if (!is_open())
+        return ;
+    pthread_mutex_lock(&mutex);
+    ::close(delta_fd) ;
+    delta_fd = -1 ;
+    if (discard_on_close)
+        remove(delta_fname.c_str()) ;
+    parent_close() ;
+    pthread_mutex_unlock(&mutex);
+}
+
+void storageimage_overlay_c::get_bytes(byte_buffer_c* byte_buffer, uint64_t byte_offset, uint32_t len)
+{
+    byte_buffer->set_size(len) ;
+    read(byte_buffer->data_ptr(), byte_offset, len) ;
+}
+
+void storageimage_overlay_c::set_bytes(byte_buffer_c *byte_buffer, uint64_t byte_offset)
+{
+    write(byte_buffer->data_ptr(), byte_offset, byte_buffer->size()) ;
+}
+
+// copy of the delta, with the same parent.
+// Only changed blocks are copied, not the image.
+void storageimage_overlay_c::save_to_file(std::string _host_filename)
+{
+    std::string host_filename = absolute_path(&_host_filename) ;
+    assert(is_open()) ;
+    pthread_mutex_lock(&mutex);
+    int fd = ::open(host_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666) ;
+    if (fd < 0) {
+        ERROR("Can not create %s: %s", host_filename.c_str(), strerror(errno)) ;
+        pthread_mutex_unlock(&mutex);
+        return ;
+    }
+    uint8_t header_block[sizeof(header)] ;
+    header_to_block(&header, header_block) ;
+    bool ok = ftruncate(fd, header.data_offset) == 0
+              && ::pwrite(fd, header_block, sizeof(header_block), 0) == sizeof(header_block)
+              && ::pwrite(fd, bitmap.data(), bitmap.size(), header.bitmap_offset) == (ssize_t)bitmap.size() ;
+    uint8_t block[STORAGEIMAGE_OVERLAY_BLOCK_SIZE] ;
+    for (uint64_t block_nr = 0; ok && block_nr < header.max_block_count; block_nr++) {
+        if (!block_in_delta(block_nr))
+            continue ;
+        uint64_t offset = header.data_offset + block_nr * STORAGEIMAGE_OVERLAY_BLOCK_SIZE ;
+        ok = ::pread(delta_fd, block, sizeof(block), offset) >= 0
+             && ::pwrite(fd, block, sizeof(block), offset) == sizeof(block) ;
+    }
+    if (!ok)
+        ERROR("Can not write %s: %s", host_filename.c_str(), strerror(errno)) ;
+    ::close(fd) ;
+    pthread_mutex_unlock(&mutex);
+}
+
+// freeze current state under "snapshot_fname":
+// delta is renamed and becomes the parent of a new empty delta.
+// If the new delta can not be created, the snapshot is renamed back
+// and stays the active delta.
+// result: OK= true, else false
+bool storageimage_overlay_c::snapshot(std::string _snapshot_fname)
+{
+    std::string snapshot_fname = absolute_path(&_snapshot_fname) ;
+    assert(is_open()) ;
+    if (snapshot_fname.size() >= sizeof(header.parent_fname)) {
+        ERROR("Path of snapshot too long: %s", snapshot_fname.c_str()) ;
+        return false ;
+    }
+    if (file_exists(&snapshot_fname)) {
+        ERROR("Snapshot %s already exists", snapshot_fname.c_str()) ;
+        return false ;
+    }
+    pthread_mutex_lock(&mutex);
+    fsync(delta_fd) ;
+    if (rename(delta_fname.c_str(), snapshot_fname.c_str()) != 0) {
+        ERROR("Can not rename %s to %s: %s", delta_fname.c_str(), snapshot_fname.c_str(), strerror(errno)) ;
+        pthread_mutex_unlock(&mutex);
+        return false ;
+    }
+    // keep old delta open until the new one exists
+    int old_delta_fd = delta_fd ;
+    storageimage_overlay_header_t old_header = header ;
+    std::vector<uint8_t> old_bitmap = bitmap ;
+    storageimage_base_c *old_parent = parent ;
+    parent = nullptr ;
+    strcpy(header.parent_fname, snapshot_fname.c_str()) ;
+    if (!parent_open() || !delta_create()) {
+        parent_close() ;
+        remove(delta_fname.c_str()) ; // partially created
+        if (rename(snapshot_fname.c_str(), delta_fname.c_str()) != 0) {
+            // old file descriptor is still valid, continue on the snapshot
+            ERROR("Can not rename %s back to %s: %s, continuing on %s", snapshot_fname.c_str(),
+                  delta_fname.c_str(), strerror(errno), snapshot_fname.c_str()) ;
+            delta_fname = snapshot_fname ;
+        }
+        delta_fd = old_delta_fd ;
+        header = old_header ;
+        bitmap = old_bitmap ;
+        parent = old_parent ;
+        pthread_mutex_unlock(&mutex);
+        ERROR("Snapshot %s not created", snapshot_fname.c_str()) ;
+        return false ;
+    }
+    ::close(old_delta_fd) ;
+    delete old_parent ; // closes
+    pthread_mutex_unlock(&mutex);
+    INFO("Snapshot %s created, %s continues on it.", snapshot_fname.c_str(), delta_fname.c_str()) ;
+    return true ;
+}
+
+// write all changed blocks into parent, then clear delta.
+// Only into the base image: a snapshot parent is frozen, other deltas
+// may be built on it.
+// result: OK= true, else false
+bool storageimage_overlay_c::commit(void)
+{
+    assert(is_open()) ;
+    pthread_mutex_lock(&mutex);
+    if (dynamic_cast<storageimage_overlay_c *>(parent) != nullptr) {
+        ERROR("Can not commit %s, parent %s is a frozen snapshot", delta_fname.c_str(), header.parent_fname) ;
+        pthread_mutex_unlock(&mutex);
+        return false ;
+    }
+    if (parent->is_readonly()) {
+        ERROR("Can not commit %s, parent image %s is read only", delta_fname.c_str(), header.parent_fname) ;
+        pthread_mutex_unlock(&mutex);
+        return false ;
+    }
+    if (header.parent_size == 0 && parent->size() > 0)
+        parent->truncate() ; // truncate() was not yet applied to parent
+    uint8_t block[STORAGEIMAGE_OVERLAY_BLOCK_SIZE] ;
+    unsigned block_count = 0 ;
+    for (uint64_t block_nr = 0; block_nr < header.max_block_count; block_nr++) {
+        if (!block_in_delta(block_nr))
+            continue ;
+        uint64_t block_pos = block_nr * STORAGEIMAGE_OVERLAY_BLOCK_SIZE ;
+        if (block_pos >= header.size)
+            break ;
+        unsigned len = std::min((uint64_t)STORAGEIMAGE_OVERLAY_BLOCK_SIZE, header.size - block_pos) ;
+        if (::pread(delta_fd, block, len, header.data_offset + block_pos) < 0) {
+            ERROR("Can not read %s: %s", delta_fname.c_str(), strerror(errno)) ;
+            pthread_mutex_unlock(&mutex);
+            return false ;
+        }
+        parent->write(block, block_pos, len) ;
+        block_count++ ;
+    }
+    delta_clear() ;
+    header.parent_size = parent->size() ;
+    bool result = header_save() ;
+    pthread_mutex_unlock(&mutex);
+    INFO("%u blocks of %s committed to %s.", block_count, delta_fname.c_str(), header.parent_fname) ;
+    return result ;
+}
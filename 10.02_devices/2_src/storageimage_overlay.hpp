@@ -0,0 +1,121 @@
+/* storageimage_overlay.hpp: copy-on-write overlay over a read-only image
+
+ Copyright (c) 2026, QUniBone contributors
+ https://github.com/j-hoppe/QUniBone
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ THE CONTRIBUTORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+ 16-oct-2026  QC      commit() only into base image
+ 16-oct-2026  QC      created
+
+ The PDP sees a "parent" image, but all writes go into a "delta" file.
+ Parent is a binary or compressed image, or another delta file (chain).
+ Parent is never written, except by commit().
+
+ Delta file layout:
+ - header block, with path of parent
+ - bitmap: 1 bit per 512 byte block, set if block is in delta
+ - data: block n at data_offset + n*512. Unwritten blocks are holes
+   of a sparse file, so delta size is only the changed blocks.
+
+ Operations
+ - snapshot(): the delta file is renamed to the snapshot name and frozen,
+   it becomes the parent of a new empty delta. O(1), no data copied.
+ - discard_on_close: delta is deleted on close, next open() starts with
+   the unchanged parent again ("scratch" session).
+ - commit(): all delta blocks are written into the parent, delta is cleared.
+   Refused after snapshot(): the parent is then a frozen snapshot.
+ */
+#ifndef _STORAGEIMAGE_OVERLAY_HPP_
+#define _STORAGEIMAGE_OVERLAY_HPP_
+
+#include <stdint.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+#include "storageimage.hpp"
+
+#define STORAGEIMAGE_OVERLAY_MAGIC	"QUBCOW01"
+#define STORAGEIMAGE_OVERLAY_BLOCK_SIZE	512
+#define STORAGEIMAGE_OVERLAY_MAX_PATH	256
+
+// first block of delta file, little endian
+typedef struct {
+    char magic[8] ;
+    uint32_t block_size ;
+    uint32_t _reserved ;
+    uint64_t size ; // image size seen by PDP
+    uint64_t parent_size ; // parent visible up to here, 0 after truncate()
+    uint64_t max_block_count ; // bits in bitmap
+    uint64_t bitmap_offset ;
+    uint64_t data_offset ;
+    char parent_fname[STORAGEIMAGE_OVERLAY_MAX_PATH] ; // absolute
+    uint8_t _fill[STORAGEIMAGE_OVERLAY_BLOCK_SIZE - 56 - STORAGEIMAGE_OVERLAY_MAX_PATH] ;
+} storageimage_overlay_header_t ;
+
+class storageimage_overlay_c: public storageimage_base_c {
+private:
+    std::string delta_fname ;
+    std::string parent_fname ; // empty: take from delta header
+    bool discard_on_close ;
+
+    pthread_mutex_t mutex ; // read/write against snapshot()/commit()
+    int delta_fd ; // -1 if closed
+    storageimage_overlay_header_t header ;
+    std::vector<uint8_t> bitmap ;
+    storageimage_base_c *parent ; // open while delta is open
+
+    bool block_in_delta(uint64_t block_nr) {
+        return bitmap[block_nr / 8] & (1 << (block_nr % 8)) ;
+    }
+    bool delta_create(void) ;
+    void delta_clear(void) ;
+    void bitmap_set(uint64_t block_nr) ;
+    bool delta_load(void) ;
+    bool header_save(void) ;
+    bool parent_open(void) ;
+    void parent_close(void) ;
+
+public:
+    storageimage_overlay_c(std::string _delta_fname, std::string _parent_fname, bool _discard_on_close) ;
+    virtual ~storageimage_overlay_c() override ;
+
+    static bool is_overlay_file(std::string fname) ;
+    bool has_ancestor(std::string fname) ;
+
+    virtual bool is_readonly() override {
+        return false ;
+    }
+    virtual bool open(storagedrive_c *drive, bool create) override;
+    virtual bool is_open(	void) override;
+    virtual bool truncate(void) override;
+    virtual void read(uint8_t *buffer, uint64_t position, unsigned len) override;
+    virtual void write(uint8_t *buffer, uint64_t position, unsigned len) override;
+    virtual uint64_t size(void) override;
+    virtual void close(void) override;
+    virtual void get_bytes(byte_buffer_c *byte_buffer, uint64_t byte_offset, uint32_t data_size) override;
+    virtual void set_bytes(byte_buffer_c *byte_buffer, uint64_t byte_offset) override ;
+    virtual void save_to_file(std::string host_filename) override ;
+
+    bool snapshot(std::string snapshot_fname) ;
+    bool commit(void) ;
+} ;
+
+#endif
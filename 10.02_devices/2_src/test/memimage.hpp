@@ -0,0 +1,79 @@
+/* memimage.hpp: storage image in memory, for host tests
+
+
+ Copyright (c) 2026, QUniBone contributors
+ https://github.com/j-hoppe/QUniBone
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ THE CONTRIBUTORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+ 16-oct-2026  QC      created
+ */
+#ifndef _MEMIMAGE_HPP_
+#define _MEMIMAGE_HPP_
+
+#include <string.h>
+#include <vector>
+#include "storageimage.hpp"
+
+class memimage_c: public storageimage_base_c {
+public:
+    std::vector<uint8_t> data ;
+
+    bool is_readonly() override {
+        return false ;
+    }
+    bool open(storagedrive_c *_drive, bool create) override {
+        (void)create ;
+        drive = _drive ;
+        return true ;
+    }
+    bool is_open(void) override {
+        return true ;
+    }
+    bool truncate(void) override {
+        data.clear() ;
+        return true ;
+    }
+    void read(uint8_t *buffer, uint64_t position, unsigned len) override {
+        for (unsigned i = 0; i < len; i++)
+            buffer[i] = position + i < data.size() ? data[position + i] : 0 ;
+    }
+    void write(uint8_t *buffer, uint64_t position, unsigned len) override {
+        if (position + len > data.size())
+            data.resize(position + len, 0) ;
+        memcpy(&data[position], buffer, len) ;
+    }
+    uint64_t size(void) override {
+        return data.size() ;
+    }
+    void close(void) override {
+    }
+    void get_bytes(byte_buffer_c *byte_buffer, uint64_t byte_offset, uint32_t data_size) override {
+        byte_buffer->set_size(data_size) ;
+        read(byte_buffer->data_ptr(), byte_offset, data_size) ;
+    }
+    void set_bytes(byte_buffer_c *byte_buffer, uint64_t byte_offset) override {
+        write(byte_buffer->data_ptr(), byte_offset, byte_buffer->size()) ;
+    }
+    void save_to_file(std::string host_filename) override {
+        (void)host_filename ;
+    }
+} ;
+
+#endif
@@ -0,0 +1,57 @@
+/* test.hpp: minimal check macros for host tests
+
+
+ Copyright (c) 2026, QUniBone contributors
+ https://github.com/j-hoppe/QUniBone
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ THE CONTRIBUTORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+ 16-oct-2026  QC      created
+
+ Each test program checks one module, prints failed checks and
+ returns the failure count as exit code.
+ */
+#ifndef _TEST_HPP_
+#define _TEST_HPP_
+
+#include <stdio.h>
+#include "logger.hpp"
+
+static unsigned test_failures = 0 ;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("%s:%d: FAILED: %s\n", __FILE__, __LINE__, #cond) ; \
+            test_failures++ ; \
+        } \
+    } while (0)
+
+// logsource_c needs the global logger
+static inline void test_init(void)
+{
+    logger = new logger_c() ;
+}
+
+static inline int test_result(const char *name)
+{
+    printf("%s: %s\n", name, test_failures ? "FAILED" : "OK") ;
+    return test_failures ;
+}
+
+#endif
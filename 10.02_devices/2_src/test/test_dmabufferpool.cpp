@@ -0,0 +1,114 @@
+/* test_dmabufferpool.cpp: host test of the MSCP transfer buffer pool
+
+
+ Copyright (c) 2026, QUniBone contributors
+ https://github.com/j-hoppe/QUniBone
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ THE CONTRIBUTORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+ 16-oct-2026  QC      created
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <set>
+#include <vector>
+
+#include "test.hpp"
+#include "dmabufferpool.hpp"
+
+// heap memory, counts buffers not returned
+class heappool_c: public DMABufferPool {
+public:
+    std::set<uint8_t *> live ;
+    unsigned alloc_count = 0 ;
+
+    ~heappool_c() {
+        FreeAll() ;
+    }
+protected:
+    uint8_t *AllocMemory(size_t len) override {
+        uint8_t *memory = (uint8_t *) malloc(len) ;
+        live.insert(memory) ;
+        alloc_count++ ;
+        return memory ;
+    }
+    void FreeMemory(uint8_t *memory) override {
+        CHECK(live.erase(memory) == 1) ;
+        free(memory) ;
+    }
+} ;
+
+// buffer of same size class reused, no new memory
+static void test_reuse(void)
+{
+    heappool_c pool ;
+    uint8_t *buffer = pool.Alloc(1000) ;
+    buffer[1023] = 0 ; // rounded up to class size
+    pool.Free(buffer) ;
+    CHECK(pool.GetFreeBytes() == 1024) ;
+    CHECK(pool.Alloc(600) == buffer) ;
+    CHECK(pool.alloc_count == 1) ;
+    CHECK(pool.GetFreeBytes() == 0) ;
+    pool.Free(buffer) ;
+    CHECK(pool.Alloc(512) != buffer) ; // other class
+    CHECK(pool.alloc_count == 2) ;
+}
+
+// kept buffers limited per class and in total, larger than max class not kept
+static void test_limits(void)
+{
+    heappool_c pool ;
+    std::vector<uint8_t *> buffers ;
+    for (unsigned i = 0; i < BUFFER_POOL_KEEP + 2; i++)
+        buffers.push_back(pool.Alloc(512)) ;
+    for (uint8_t *buffer : buffers)
+        pool.Free(buffer) ;
+    CHECK(pool.live.size() == BUFFER_POOL_KEEP) ;
+    CHECK(pool.GetFreeBytes() == BUFFER_POOL_KEEP * 512) ;
+    pool.FreeAll() ;
+    CHECK(pool.live.empty() && pool.GetFreeBytes() == 0) ;
+
+    buffers.clear() ;
+    for (unsigned i = 0; i < BUFFER_POOL_KEEP; i++)
+        buffers.push_back(pool.Alloc(64 * 1024)) ;
+    for (uint8_t *buffer : buffers)
+        pool.Free(buffer) ;
+    CHECK(pool.GetFreeBytes() == BUFFER_POOL_MAX_BYTES) ;
+    CHECK(pool.live.size() == BUFFER_POOL_MAX_BYTES / (64 * 1024)) ;
+
+    // pool is full: not kept, not even small ones
+    uint8_t *buffer = pool.Alloc(512) ;
+    pool.Free(buffer) ;
+    CHECK(pool.live.size() == BUFFER_POOL_MAX_BYTES / (64 * 1024)) ;
+    pool.FreeAll() ;
+
+    buffer = pool.Alloc(1 << BUFFER_POOL_MAX_SHIFT) ;
+    pool.Free(buffer) ;
+    buffer = pool.Alloc((1 << BUFFER_POOL_MAX_SHIFT) + 1) ;
+    pool.Free(buffer) ;
+    CHECK(pool.live.empty() && pool.GetFreeBytes() == 0) ;
+}
+
+int main()
+{
+    test_init() ;
+    test_reuse() ;
+    test_limits() ;
+    return test_result("dmabufferpool") ;
+}
@@ -0,0 +1,285 @@
+/* test_storagedrive_cache.cpp: coherence of the drive block cache
+
+
+ Copyright (c) 2026, QUniBone contributors
+ https://github.com/j-hoppe/QUniBone
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ THE CONTRIBUTORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+ 16-oct-2026  QC      created
+ */
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <vector>
+
+#include "test.hpp"
+#include "memimage.hpp"
+#include "storagedrive_cache.hpp"
+
+#define BS	STORAGEDRIVE_CACHE_BLOCK_SIZE
+
+// image with every byte of block n = n
+static void image_fill(memimage_c *image, unsigned blocks)
+{
+    image->data.resize(blocks * BS) ;
+    for (unsigned i = 0; i < blocks * BS; i++)
+        image->data[i] = i / BS ;
+}
+
+static bool block_is(uint8_t *buffer, uint8_t val)
+{
+    for (unsigned i = 0; i < BS; i++)
+        if (buffer[i] != val)
+            return false ;
+    return true ;
+}
+
+static void read_block(storagedrive_cache_c *cache, unsigned block_nr, uint8_t *buffer)
+{
+    cache->read(buffer, (uint64_t)block_nr * BS, BS) ;
+}
+
+// read, partial write, flush, bypass in one thread
+static void test_basic(void)
+{
+    memimage_c image ;
+    image_fill(&image, 64) ;
+    storagedrive_cache_c *cache = new storagedrive_cache_c(&image, 16, 10000, 0) ;
+    uint8_t buffer[8 * BS] ;
+
+    read_block(cache, 3, buffer) ;
+    CHECK(block_is(buffer, 3)) ;
+    memset(buffer, 0xaa, 10) ;
+    cache->write(buffer, 3 * BS + 100, 10) ; // read-modify-write
+    CHECK(image.data[3 * BS + 100] == 3) ; // not yet written back
+    read_block(cache, 3, buffer) ;
+    CHECK(buffer[99] == 3 && buffer[100] == 0xaa && buffer[109] == 0xaa && buffer[110] == 3) ;
+    cache->flush() ;
+    CHECK(image.data[3 * BS + 100] == 0xaa && image.data[3 * BS + 110] == 3) ;
+
+    // bypass read overlays dirty data
+    memset(buffer, 0x55, BS) ;
+    cache->write(buffer, 5 * BS, BS) ;
+    cache->read(buffer, 0, 8 * BS) ;
+    CHECK(block_is(buffer + 5 * BS, 0x55) && block_is(buffer + 6 * BS, 6)) ;
+
+    // bypass write updates cached copy
+    memset(buffer, 0x77, 8 * BS) ;
+    cache->write(buffer, 0, 8 * BS) ;
+    read_block(cache, 5, buffer) ;
+    CHECK(block_is(buffer, 0x77)) ;
+
+    // write behind end of image grows it on flush
+    memset(buffer, 0x11, BS) ;
+    cache->write(buffer, 100 * BS, BS) ;
+    CHECK(cache->size() == 101 * BS) ;
+    delete cache ; // flushes
+    CHECK(image.data.size() == 101 * BS && image.data[100 * BS] == 0x11) ;
+}
+
+// whole blocks dropped from cache and zeroed in image, partial ends via cache
+static void test_set_zero(void)
+{
+    memimage_c image ;
+    image_fill(&image, 64) ;
+    storagedrive_cache_c *cache = new storagedrive_cache_c(&image, 16, 10000, 0) ;
+    uint8_t buffer[8 * BS] ;
+
+    memset(buffer, 0x55, 2 * BS) ;
+    cache->write(buffer, 4 * BS, 2 * BS) ; // dirty blocks 4,5
+    read_block(cache, 7, buffer) ; // clean block 7
+    cache->set_zero(3 * BS + 100, 5 * BS) ; // 3 partial, 4..7 whole, 8 partial
+    CHECK(image.data[4 * BS] == 0 && image.data[7 * BS + BS - 1] == 0) ;
+    cache->read(buffer, 3 * BS, 6 * BS) ;
+    CHECK(buffer[99] == 3 && buffer[100] == 0) ;
+    CHECK(block_is(buffer + BS, 0) && block_is(buffer + 4 * BS, 0)) ;
+    CHECK(buffer[5 * BS + 99] == 0 && buffer[5 * BS + 100] == 8) ;
+    cache->flush() ; // dropped dirty blocks not written back
+    CHECK(image.data[4 * BS] == 0 && image.data[5 * BS] == 0) ;
+    CHECK(image.data[3 * BS + 99] == 3 && image.data[3 * BS + 100] == 0) ;
+    CHECK(image.data[8 * BS + 99] == 0 && image.data[8 * BS + 100] == 8) ;
+
+    // inside one block, and behind end of image
+    cache->set_zero(10 * BS + 1, 2) ;
+    read_block(cache, 10, buffer) ;
+    CHECK(buffer[0] == 10 && buffer[1] == 0 && buffer[2] == 0 && buffer[3] == 10) ;
+    cache->set_zero(70 * BS, 2 * BS) ;
+    CHECK(cache->size() == 72 * BS) ;
+    delete cache ;
+    CHECK(image.data.size() == 72 * BS && image.data[71 * BS] == 0) ;
+}
+
+// sequential reads request read-ahead, the next blocks then hit the cache
+static void test_readahead(void)
+{
+    memimage_c image ;
+    image_fill(&image, 64) ;
+    storagedrive_cache_c *cache = new storagedrive_cache_c(&image, 32, 10000, 8) ;
+    uint8_t buffer[BS] ;
+
+    read_block(cache, 5, buffer) ; // not sequential
+    cache->prefetch_hold_set(true) ;
+    read_block(cache, 6, buffer) ; // sequential: blocks 7..14 requested
+    cache->prefetch_hold_wait(true) ; // flusher thread has read them
+    cache->prefetch_hold_set(false) ;
+    cache->prefetch_hold_wait(false) ;
+    CHECK(cache->readahead_loaded == 8) ;
+    uint64_t misses = cache->misses ;
+    for (unsigned i = 7; i < 11; i++) {
+        read_block(cache, i, buffer) ;
+        CHECK(block_is(buffer, i)) ;
+    }
+    CHECK(cache->misses == misses && cache->readahead_hits == 4) ;
+    delete cache ;
+}
+
+// A bypass write into the range prefetch() is reading from image
+// must not be overwritten by the old image data, even if read() has
+// already requested the next read-ahead range.
+static void test_prefetch_write_race(void)
+{
+    memimage_c image ;
+    image_fill(&image, 64) ;
+    // 16 blocks: read-ahead 4, writes > 4 blocks bypass the cache
+    storagedrive_cache_c *cache = new storagedrive_cache_c(&image, 16, 10000, 4) ;
+    uint8_t buffer[BS] ;
+
+    // blocks 2..4 cached by non-sequential reads
+    read_block(cache, 4, buffer) ;
+    read_block(cache, 3, buffer) ;
+    read_block(cache, 2, buffer) ;
+    read_block(cache, 0, buffer) ;
+    // hold the read-ahead after it has read the image
+    cache->prefetch_hold_set(true) ;
+    // sequential: request read-ahead of 2..5, only block 5 read from image
+    read_block(cache, 1, buffer) ;
+    cache->prefetch_hold_wait(true) ;
+
+    // sequential cache hits request the next range 6..8
+    read_block(cache, 2, buffer) ;
+    read_block(cache, 3, buffer) ;
+    read_block(cache, 4, buffer) ;
+
+    // bypass write 1..5 after block 5 was read from image
+    std::vector<uint8_t> data(5 * BS, 0xaa) ;
+    cache->write(data.data(), 1 * BS, 5 * BS) ;
+    // read-ahead inserts, or drops, block 5
+    cache->prefetch_hold_set(false) ;
+    cache->prefetch_hold_wait(false) ;
+
+    read_block(cache, 5, buffer) ;
+    CHECK(block_is(buffer, 0xaa)) ;
+    CHECK(image.data[5 * BS] == 0xaa) ;
+    read_block(cache, 6, buffer) ;
+    CHECK(block_is(buffer, 6)) ;
+    delete cache ;
+}
+
+// two threads on disjoint block ranges, each checks its own data
+struct stress_arg {
+    storagedrive_cache_c *cache ;
+    unsigned first_block_nr ;
+    unsigned errors ;
+} ;
+
+static void *stress(void *context)
+{
+    stress_arg *arg = (stress_arg *)context ;
+    uint8_t buffer[4 * BS] ;
+    unsigned seed = arg->first_block_nr ;
+    for (unsigned i = 0; i < 2000; i++) {
+        unsigned block_nr = arg->first_block_nr + rand_r(&seed) % 32 ;
+        unsigned count = 1 + rand_r(&seed) % 4 ;
+        uint8_t val = (uint8_t)(i + 1) ;
+        memset(buffer, val, count * BS) ;
+        arg->cache->write(buffer, (uint64_t)block_nr * BS, count * BS) ;
+        arg->cache->read(buffer, (uint64_t)block_nr * BS, count * BS) ;
+        for (unsigned j = 0; j < count * BS; j++)
+            if (buffer[j] != val) {
+                arg->errors++ ;
+                break ;
+            }
+        // sequential reads keep the read-ahead busy
+        arg->cache->read(buffer, (uint64_t)(block_nr + count) * BS, BS) ;
+    }
+    return NULL ;
+}
+
+static void test_concurrent(void)
+{
+    memimage_c image ;
+    image_fill(&image, 256) ;
+    storagedrive_cache_c *cache = new storagedrive_cache_c(&image, 32, 1, 8) ;
+    stress_arg arg[2] = { { cache, 0, 0 }, { cache, 100, 0 } } ;
+    pthread_t threads[2] ;
+    for (unsigned i = 0; i < 2; i++)
+        pthread_create(&threads[i], NULL, stress, &arg[i]) ;
+    for (unsigned i = 0; i < 2; i++)
+        pthread_join(threads[i], NULL) ;
+    CHECK(arg[0].errors == 0) ;
+    CHECK(arg[1].errors == 0) ;
+    // everything written back matches what the cache delivers
+    std::vector<uint8_t> cached(256 * BS) ;
+    cache->read(cached.data(), 0, 256 * BS) ;
+    delete cache ;
+    CHECK(memcmp(cached.data(), image.data.data(), 256 * BS) == 0) ;
+}
+
+// flush interval 0: no periodic write-back, flusher idle until signaled
+static void test_no_periodic_flush(void)
+{
+    memimage_c image ;
+    image_fill(&image, 64) ;
+    storagedrive_cache_c *cache = new storagedrive_cache_c(&image, 16, 0, 0) ;
+    uint8_t buffer[BS] ;
+
+    memset(buffer, 0xaa, BS) ;
+    cache->write(buffer, 2 * BS, BS) ;
+    struct timespec cpu_start, cpu_end ;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_start) ;
+    usleep(200000) ;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_end) ;
+    uint64_t cpu_ns = (uint64_t)(cpu_end.tv_sec - cpu_start.tv_sec) * 1000000000
+                      + cpu_end.tv_nsec - cpu_start.tv_nsec ;
+    CHECK(cpu_ns < 5000000) ; // flusher not spinning
+    CHECK(cache->dirty_count == 1 && image.data[2 * BS] == 2) ;
+
+    // more than half of cache dirty: flusher signaled
+    for (unsigned i = 3; i < 11; i++)
+        cache->write(buffer, i * BS, BS) ;
+    for (unsigned i = 0; i < 100 && cache->dirty_count > 0; i++)
+        usleep(10000) ;
+    CHECK(cache->dirty_count == 0 && image.data[2 * BS] == 0xaa) ;
+    delete cache ;
+}
+
+int main()
+{
+    test_init() ;
+    test_basic() ;
+    test_readahead() ;
+    test_set_zero() ;
+    test_no_periodic_flush() ;
+    test_prefetch_write_race() ;
+    test_concurrent() ;
+    return test_result("storagedrive_cache") ;
+}
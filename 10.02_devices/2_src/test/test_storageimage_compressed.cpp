@@ -0,0 +1,180 @@
+/* test_storageimage_compressed.cpp: .gz to .qcz conversion and random reads
+
+
+ Copyright (c) 2026, QUniBone contributors
+ https://github.com/j-hoppe/QUniBone
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ THE CONTRIBUTORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+ 16-oct-2026  QC      created
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/time.h>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#include "test.hpp"
+#include "storageimage_compressed.hpp"
+
+#define GS	STORAGEIMAGE_COMPRESSED_GROUP_SIZE
+
+static std::string dir ;
+
+// groups: compressible, all zero, random (stored plain), partial last group
+static std::vector<uint8_t> image_data(unsigned seed)
+{
+    std::vector<uint8_t> data(3 * GS + 1000, 0) ;
+    for (unsigned i = 0; i < GS; i++)
+        data[i] = (i / 512) ^ seed ;
+    for (unsigned i = 2 * GS; i < data.size(); i++)
+        data[i] = rand_r(&seed) ;
+    return data ;
+}
+
+static void gz_write(std::string fname, std::vector<uint8_t> &data)
+{
+    gzFile f = gzopen(fname.c_str(), "wb") ;
+    gzwrite(f, data.data(), data.size()) ;
+    gzclose(f) ;
+}
+
+static std::vector<uint8_t> file_read(std::string fname)
+{
+    std::vector<uint8_t> data ;
+    FILE *f = fopen(fname.c_str(), "rb") ;
+    if (f == NULL)
+        return data ;
+    int c ;
+    while ((c = fgetc(f)) != EOF)
+        data.push_back(c) ;
+    fclose(f) ;
+    return data ;
+}
+
+static void file_patch(std::string fname, uint64_t offset, const void *data, unsigned len)
+{
+    int fd = open(fname.c_str(), O_WRONLY) ;
+    CHECK(pwrite(fd, data, len, offset) == (ssize_t)len) ;
+    close(fd) ;
+}
+
+static bool image_opens(std::string fname)
+{
+    storageimage_compressed_c image(fname) ;
+    return image.open(nullptr, false) ;
+}
+
+static void test_roundtrip(void)
+{
+    std::string gz = dir + "/disk.img.gz", qcz = dir + "/disk.img.qcz", plain = dir + "/disk.img" ;
+    std::vector<uint8_t> data = image_data(1) ;
+    gz_write(gz, data) ;
+    CHECK(storageimage_compressed_c::create_from_file(gz, qcz)) ;
+    CHECK(storageimage_compressed_c::is_compressed_file(qcz)) ;
+    CHECK(storageimage_compressed_c::is_converted_from(qcz, gz)) ;
+
+    storageimage_compressed_c *image = new storageimage_compressed_c(qcz) ;
+    CHECK(image->open(nullptr, false)) ;
+    CHECK(image->size() == data.size()) ;
+    // reads across group boundaries and behind end
+    std::vector<uint8_t> buffer(GS + 4000) ;
+    uint64_t positions[] = { 0, GS - 100, 2 * GS - 7, 3 * GS - 2000, 3 * GS + 500 } ;
+    for (uint64_t pos : positions) {
+        image->read(buffer.data(), pos, buffer.size()) ;
+        bool same = true ;
+        for (unsigned i = 0; i < buffer.size(); i++)
+            if (buffer[i] != (pos + i < data.size() ? data[pos + i] : 0))
+                same = false ;
+        CHECK(same) ;
+    }
+    image->save_to_file(plain) ;
+    CHECK(file_read(plain) == data) ;
+    delete image ;
+    unlink(plain.c_str()) ;
+
+    // .gz replaced: .qcz is stale
+    std::vector<uint8_t> data2 = image_data(2) ;
+    gz_write(gz, data2) ;
+    struct timeval times[2] = { { 1000000000, 0 }, { 1000000000, 0 } } ;
+    utimes(gz.c_str(), times) ;
+    CHECK(!storageimage_compressed_c::is_converted_from(qcz, gz)) ;
+    CHECK(storageimage_compressed_c::create_from_file(gz, qcz)) ;
+    CHECK(storageimage_compressed_c::is_converted_from(qcz, gz)) ;
+    image = new storageimage_compressed_c(qcz) ;
+    CHECK(image->open(nullptr, false)) ;
+    image->read(buffer.data(), 0, 512) ;
+    CHECK(memcmp(buffer.data(), data2.data(), 512) == 0) ;
+    delete image ;
+    unlink(gz.c_str()) ;
+    unlink(qcz.c_str()) ;
+}
+
+// corrupt header and index entries: open() must refuse
+static void test_invalid_index(void)
+{
+    std::string gz = dir + "/bad.img.gz", qcz = dir + "/bad.img.qcz" ;
+    std::vector<uint8_t> data = image_data(3) ;
+    gz_write(gz, data) ;
+    CHECK(storageimage_compressed_c::create_from_file(gz, qcz)) ;
+    std::vector<uint8_t> good = file_read(qcz) ;
+    storageimage_compressed_header_t header ;
+    memcpy(&header, good.data(), sizeof(header)) ;
+    uint64_t entry0 = header.index_offset ; // group 0 is compressed
+    CHECK(image_opens(qcz)) ;
+
+    uint32_t length = 0x7fffffff ;
+    file_patch(qcz, entry0 + offsetof(storageimage_compressed_index_entry_t, length), &length, sizeof(length)) ;
+    CHECK(!image_opens(qcz)) ;
+
+    gz_write(gz, data) ; // restore
+    CHECK(storageimage_compressed_c::create_from_file(gz, qcz)) ;
+    uint64_t offset = good.size() - 10 ; // data behind end of file
+    file_patch(qcz, entry0 + offsetof(storageimage_compressed_index_entry_t, offset), &offset, sizeof(offset)) ;
+    CHECK(!image_opens(qcz)) ;
+
+    CHECK(storageimage_compressed_c::create_from_file(gz, qcz)) ;
+    uint32_t group_size = 2 * GS ;
+    file_patch(qcz, offsetof(storageimage_compressed_header_t, group_size), &group_size, sizeof(group_size)) ;
+    CHECK(!image_opens(qcz)) ;
+
+    CHECK(storageimage_compressed_c::create_from_file(gz, qcz)) ;
+    uint64_t index_offset = good.size() ; // index behind end of file
+    file_patch(qcz, offsetof(storageimage_compressed_header_t, index_offset), &index_offset, sizeof(index_offset)) ;
+    CHECK(!image_opens(qcz)) ;
+
+    unlink(gz.c_str()) ;
+    unlink(qcz.c_str()) ;
+}
+
+int main()
+{
+    char tmpl[] = "/tmp/test_compressed_XXXXXX" ;
+    test_init() ;
+    dir = mkdtemp(tmpl) ;
+    test_roundtrip() ;
+    test_invalid_index() ;
+    rmdir(dir.c_str()) ;
+    return test_result("storageimage_compressed") ;
+}
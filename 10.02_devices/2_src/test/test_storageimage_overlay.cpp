@@ -0,0 +1,236 @@
+/* test_storageimage_overlay.cpp: copy-on-write delta, snapshot, commit
+
+
+ Copyright (c) 2026, QUniBone contributors
+ https://github.com/j-hoppe/QUniBone
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ THE CONTRIBUTORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+ 16-oct-2026  QC      created
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <string>
+#include <vector>
+
+#include "test.hpp"
+#include "storageimage_overlay.hpp"
+
+#define BS	STORAGEIMAGE_OVERLAY_BLOCK_SIZE
+
+static std::string dir ;
+
+static std::vector<uint8_t> file_read(std::string fname)
+{
+    std::vector<uint8_t> data ;
+    FILE *f = fopen(fname.c_str(), "rb") ;
+    if (f == NULL)
+        return data ;
+    int c ;
+    while ((c = fgetc(f)) != EOF)
+        data.push_back(c) ;
+    fclose(f) ;
+    return data ;
+}
+
+// base image with every byte of block n = n
+static void base_create(std::string fname, unsigned blocks)
+{
+    FILE *f = fopen(fname.c_str(), "wb") ;
+    for (unsigned i = 0; i < blocks * BS; i++)
+        fputc(i / BS, f) ;
+    fclose(f) ;
+}
+
+static bool image_is(storageimage_base_c *image, uint64_t position, unsigned len, uint8_t val)
+{
+    std::vector<uint8_t> buffer(len) ;
+    image->read(buffer.data(), position, len) ;
+    for (unsigned i = 0; i < len; i++)
+        if (buffer[i] != val)
+            return false ;
+    return true ;
+}
+
+static void test_write_reopen_commit(void)
+{
+    std::string base = dir + "/base.img", delta = dir + "/base.cow" ;
+    base_create(base, 16) ;
+    std::vector<uint8_t> base_data = file_read(base) ;
+    uint8_t buffer[BS] ;
+
+    storageimage_overlay_c *overlay = new storageimage_overlay_c(delta, base, false) ;
+    CHECK(overlay->open(nullptr, true)) ;
+    CHECK(overlay->size() == 16 * BS) ;
+    CHECK(image_is(overlay, 3 * BS, BS, 3)) ;
+    // partial block: copy up from parent
+    memset(buffer, 0xaa, 10) ;
+    overlay->write(buffer, 3 * BS + 100, 10) ;
+    CHECK(image_is(overlay, 3 * BS + 100, 10, 0xaa)) ;
+    CHECK(image_is(overlay, 3 * BS, 100, 3) && image_is(overlay, 3 * BS + 110, BS - 110, 3)) ;
+    // grow behind parent
+    memset(buffer, 0x55, BS) ;
+    overlay->write(buffer, 20 * BS, BS) ;
+    CHECK(overlay->size() == 21 * BS) ;
+    CHECK(image_is(overlay, 17 * BS, BS, 0)) ;
+    CHECK(file_read(base) == base_data) ; // parent never written
+    delete overlay ;
+
+    // reopen from delta alone
+    overlay = new storageimage_overlay_c(delta, "", false) ;
+    CHECK(overlay->open(nullptr, false)) ;
+    CHECK(image_is(overlay, 3 * BS + 100, 10, 0xaa)) ;
+    CHECK(image_is(overlay, 20 * BS, BS, 0x55)) ;
+
+    // commit into base image
+    CHECK(overlay->commit()) ;
+    std::vector<uint8_t> data = file_read(base) ;
+    CHECK(data.size() == 21 * BS) ;
+    CHECK(data.size() > 3 * BS + 100 && data[3 * BS + 100] == 0xaa && data[3 * BS + 99] == 3) ;
+    CHECK(data.size() > 20 * BS && data[20 * BS] == 0x55) ;
+    CHECK(image_is(overlay, 3 * BS + 100, 10, 0xaa)) ;
+    delete overlay ;
+    unlink(delta.c_str()) ;
+    unlink(base.c_str()) ;
+}
+
+// after snapshot() the parent is frozen: commit() must refuse
+static void test_snapshot_commit(void)
+{
+    std::string base = dir + "/snapbase.img", delta = dir + "/snapbase.cow", snap = dir + "/snap1.cow" ;
+    base_create(base, 16) ;
+    std::vector<uint8_t> base_data = file_read(base) ;
+    uint8_t buffer[BS] ;
+
+    storageimage_overlay_c *overlay = new storageimage_overlay_c(delta, base, false) ;
+    CHECK(overlay->open(nullptr, true)) ;
+    memset(buffer, 0x11, BS) ;
+    overlay->write(buffer, 2 * BS, BS) ;
+    CHECK(overlay->snapshot(snap)) ;
+    CHECK(overlay->has_ancestor(base)) ;
+    std::vector<uint8_t> snap_data = file_read(snap) ;
+    memset(buffer, 0x22, BS) ;
+    overlay->write(buffer, 5 * BS, BS) ;
+    CHECK(image_is(overlay, 2 * BS, BS, 0x11)) ;
+    CHECK(image_is(overlay, 5 * BS, BS, 0x22)) ;
+
+    CHECK(!overlay->commit()) ;
+    CHECK(file_read(snap) == snap_data) ;
+    CHECK(file_read(base) == base_data) ;
+    CHECK(image_is(overlay, 5 * BS, BS, 0x22)) ;
+    delete overlay ;
+
+    // snapshot still shows its frozen state
+    overlay = new storageimage_overlay_c(snap, "", false) ;
+    CHECK(overlay->open(nullptr, false)) ;
+    CHECK(image_is(overlay, 2 * BS, BS, 0x11)) ;
+    CHECK(image_is(overlay, 5 * BS, BS, 5)) ;
+    delete overlay ;
+    unlink(delta.c_str()) ;
+    unlink(snap.c_str()) ;
+    unlink(base.c_str()) ;
+}
+
+// file size limit lets writes behind the header fail
+static void file_size_limit(rlim_t limit)
+{
+    struct rlimit rl ;
+    getrlimit(RLIMIT_FSIZE, &rl) ;
+    rl.rlim_cur = limit ;
+    setrlimit(RLIMIT_FSIZE, &rl) ;
+}
+
+// failed write does not grow image, failed snapshot keeps delta active
+static void test_write_errors(void)
+{
+    std::string base = dir + "/errbase.img", delta = dir + "/errbase.cow", snap = dir + "/errsnap.cow" ;
+    base_create(base, 16) ;
+    uint8_t buffer[BS] ;
+    struct rlimit rl ;
+    getrlimit(RLIMIT_FSIZE, &rl) ;
+    signal(SIGXFSZ, SIG_IGN) ;
+
+    storageimage_overlay_c *overlay = new storageimage_overlay_c(delta, base, false) ;
+    CHECK(overlay->open(nullptr, true)) ;
+    memset(buffer, 0x11, BS) ;
+    overlay->write(buffer, 2 * BS, BS) ;
+
+    file_size_limit(BS) ; // header only
+    memset(buffer, 0x22, BS) ;
+    overlay->write(buffer, 20 * BS, BS) ;
+    CHECK(overlay->size() == 16 * BS) ;
+    // new delta can not be initialized
+    CHECK(!overlay->snapshot(snap)) ;
+    file_size_limit(rl.rlim_cur) ;
+    CHECK(access(snap.c_str(), F_OK) != 0) ;
+    CHECK(overlay->has_ancestor(base)) ;
+    CHECK(image_is(overlay, 2 * BS, BS, 0x11)) ;
+    overlay->write(buffer, 5 * BS, BS) ;
+    CHECK(image_is(overlay, 5 * BS, BS, 0x22)) ;
+    delete overlay ;
+
+    overlay = new storageimage_overlay_c(delta, "", false) ;
+    CHECK(overlay->open(nullptr, false)) ;
+    CHECK(image_is(overlay, 2 * BS, BS, 0x11)) ;
+    CHECK(image_is(overlay, 5 * BS, BS, 0x22)) ;
+    delete overlay ;
+    signal(SIGXFSZ, SIG_DFL) ;
+    unlink(delta.c_str()) ;
+    unlink(base.c_str()) ;
+}
+
+static void test_discard_truncate(void)
+{
+    std::string base = dir + "/scratch.img", delta = dir + "/scratch.cow" ;
+    base_create(base, 8) ;
+    uint8_t buffer[BS] ;
+    memset(buffer, 0x33, BS) ;
+
+    storageimage_overlay_c *overlay = new storageimage_overlay_c(delta, base, true) ;
+    CHECK(overlay->open(nullptr, true)) ;
+    overlay->write(buffer, 0, BS) ;
+    overlay->close() ;
+    CHECK(access(delta.c_str(), F_OK) != 0) ;
+    CHECK(overlay->open(nullptr, true)) ;
+    CHECK(image_is(overlay, 0, BS, 0)) ; // block 0 of base is 00s
+    CHECK(image_is(overlay, BS, BS, 1)) ;
+    CHECK(overlay->truncate()) ;
+    CHECK(overlay->size() == 0) ;
+    overlay->write(buffer, BS, BS) ;
+    CHECK(image_is(overlay, 0, BS, 0) && image_is(overlay, BS, BS, 0x33)) ;
+    delete overlay ;
+    unlink(base.c_str()) ;
+}
+
+int main()
+{
+    char tmpl[] = "/tmp/test_overlay_XXXXXX" ;
+    test_init() ;
+    dir = mkdtemp(tmpl) ;
+    test_write_reopen_commit() ;
+    test_snapshot_commit() ;
+    test_write_errors() ;
+    test_discard_truncate() ;
+    rmdir(dir.c_str()) ;
+    return test_result("storageimage_overlay") ;
+}
@@ -0,0 +1,146 @@
+/* cycletrace_decode.cpp: convert binary CPU cycle trace to CSV or VCD
+
+ Copyright (c) 2026, QUniBone contributors
+ https://github.com/j-hoppe/QUniBone
+
+ Permission is hereby granted, free of charge, to any person obtaining a
+ copy of this software and associated documentation files (the "Software"),
+ to deal in the Software without restriction, including without limitation
+ the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ and/or sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ THE CONTRIBUTORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+ 16-oct-2026  QC      created
+
+ Host tool for files written by CPU20 with "cycle_tracefilepath".
+ Usage: cycletrace_decode [-csv | -vcd] <tracefile> [<outfile>]
+ Default is CSV to stdout, columns as the former text dump.
+ VCD shows address, data, cycle, iopage and nxm as signals over time,
+ for GTKWave and other waveform viewers.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu_cycletrace.hpp"
+
+// QUNIBUS_CYCLE_* in qunibus.h
+static const char *cycle_text[4] = { "DATI", "DATIP", "DATO", "DATOB" } ;
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: cycletrace_decode [-csv | -vcd] <tracefile> [<outfile>]\n") ;
+    exit(1) ;
+}
+
+// VCD wants a string of binary digits
+static const char *binary(uint32_t value, unsigned bits)
+{
+    static char buffer[40] ;
+    for (unsigned i = 0; i < bits; i++)
+        buffer[i] = (value & (1 << (bits - 1 - i))) ? '1' : '0' ;
+    buffer[bits] = 0 ;
+    return buffer ;
+}
+
+static void vcd_header(FILE *out)
+{
+    fprintf(out, "$timescale 1ns $end\n") ;
+    fprintf(out, "$scope module cpu $end\n") ;
+    fprintf(out, "$var wire 22 a address $end\n") ;
+    fprintf(out, "$var wire 16 d data $end\n") ;
+    fprintf(out, "$var wire 2 c cycle $end\n") ;
+    fprintf(out, "$var wire 1 i iopage $end\n") ;
+    fprintf(out, "$var wire 1 n nxm $end\n") ;
+    fprintf(out, "$upscope $end\n") ;
+    fprintf(out, "$enddefinitions $end\n") ;
+}
+
+int main(int argc, char *argv[])
+{
+    bool vcd = false ;
+    int argi = 1 ;
+    if (argi < argc && !strcmp(argv[argi], "-vcd")) {
+        vcd = true ;
+        argi++ ;
+    } else if (argi < argc && !strcmp(argv[argi], "-csv"))
+        argi++ ;
+    if (argi >= argc)
+        usage() ;
+
+    FILE *in = fopen(argv[argi], "rb") ;
+    if (in == NULL) {
+        perror(argv[argi]) ;
+        return 1 ;
+    }
+    FILE *out = stdout ;
+    if (argi + 1 < argc) {
+        out = fopen(argv[argi + 1], "w") ;
+        if (out == NULL) {
+            perror(argv[argi + 1]) ;
+            return 1 ;
+        }
+    }
+
+    cycletrace_file_header_t header ;
+    if (fread(&header, sizeof(header), 1, in) != 1
+            || memcmp(header.magic, CYCLETRACE_MAGIC, sizeof(header.magic))
+            || header.record_size != sizeof(cycletrace_record_t)
+            || header.ticks_per_second == 0) {
+        fprintf(stderr, "%s: not a cycle trace file\n", argv[argi]) ;
+        return 1 ;
+    }
+
+    if (vcd)
+        vcd_header(out) ;
+    else {
+        fprintf(out, "// Sampled QUNIBUS cycles, %llu ticks per second\n",
+                (unsigned long long)header.ticks_per_second) ;
+        fprintf(out, "id, timestamp, iopage, address, cycle, data, nxm\n") ;
+    }
+
+    cycletrace_record_t r ;
+    uint64_t id = header.first_id ;
+    uint64_t start_ticks = 0 ;
+    uint64_t last_ns = 0 ;
+    while (fread(&r, sizeof(r), 1, in) == 1) {
+        if (id == header.first_id)
+            start_ticks = r.timestamp ;
+        // ns since first record. ticks * 1e9 would overflow
+        uint64_t ticks = r.timestamp - start_ticks ;
+        uint64_t ns = ticks / header.ticks_per_second * 1000000000ULL
+                      + ticks % header.ticks_per_second * 1000000000ULL / header.ticks_per_second ;
+        bool iopage = r.flags & CYCLETRACE_FLAG_IOPAGE ;
+        bool nxm = r.flags & CYCLETRACE_FLAG_NXM ;
+        if (vcd) {
+            if (id != header.first_id && ns <= last_ns)
+                ns = last_ns + 1 ; // VCD time must increase
+            fprintf(out, "#%llu\n", (unsigned long long)ns) ;
+            fprintf(out, "b%s a\n", binary(r.address, 22)) ;
+            fprintf(out, "b%s d\n", binary(r.data, 16)) ;
+            fprintf(out, "b%s c\n", binary(r.cycle, 2)) ;
+            fprintf(out, "%di\n", iopage) ;
+            fprintf(out, "%dn\n", nxm) ;
+        } else
+            fprintf(out, "%llu, %llu, %d, %06o, %s, %06o, %d\n",
+                    (unsigned long long)id, (unsigned long long)ns, iopage, r.address,
+                    cycle_text[r.cycle & 3], r.data, nxm) ;
+        last_ns = ns ;
+        id++ ;
+    }
+    fclose(in) ;
+    if (out != stdout)
+        fclose(out) ;
+    return 0 ;
+}
@@ -26,6 +26,7 @@
 #include "qunibus.h"
 #include "qunibusadapter.hpp"
 #include "qunibusdevice.hpp"
+#include "ddrmem.h"
 #include "storagecontroller.hpp"
 #include "mscp_drive.hpp"
 #include "uda.hpp"
@@ -74,6 +75,8 @@ uda_c::uda_c() :
     SA_reg->reset_value = 0;
     SA_reg->writable_bits = 0xffff;
 
+    _freeMessages.reserve(MAX_CREDITS * 2);
+
     _server.reset(new mscp_server(this));
 
     //
@@ -100,6 +103,10 @@ uda_c::~uda_c()
     }
 
     storagedrives.clear();
+
+    // stop the server threads before their buffers go away
+    _server.reset();
+    FreePools();
 }
 
 bool uda_c::on_param_changed(parameter_c *param) 
@@ -535,6 +542,7 @@ uda_c::update_SA(uint16_t value)
 Message*
 uda_c::GetNextCommand(bool* error) 
 {
+    const std::lock_guard<std::mutex> lock(_ringMutex);
     timeout_c timer;
     *error = false;
  
@@ -546,16 +554,15 @@ uda_c::GetNextCommand(bool* error)
         _commandRingPointer, 
         descriptorAddress);
 
-    std::unique_ptr<Descriptor> cmdDescriptor(
-        reinterpret_cast<Descriptor*>(
-            DMARead(
-                descriptorAddress,
-                sizeof(Descriptor),
-                sizeof(Descriptor))));
+    Descriptor descriptor;
+    Descriptor* cmdDescriptor = &descriptor;
 
-    // A null command descriptor indicates an NXM condition; we set SA to the appropriate
+    // A failed descriptor read indicates an NXM condition; we set SA to the appropriate
     // error code and reset the port.
-    if (!cmdDescriptor)
+    if (!DMARead(
+            descriptorAddress,
+            sizeof(Descriptor),
+            reinterpret_cast<uint8_t*>(cmdDescriptor)))
     {
         PortError(PORT_ERROR_PACKET_READ);
         *error = true;
@@ -591,15 +598,15 @@ uda_c::GetNextCommand(bool* error)
             return nullptr;
         }     
    
-        std::unique_ptr<Message> cmdMessage(
-            reinterpret_cast<Message*>(
-                DMARead(
-                    messageAddress - 4,
-                    messageLength + 4, 
-                    sizeof(Message)))); 
-
-        if (!cmdMessage)
+        Message* cmdMessage = AllocMessage();
+        memset(reinterpret_cast<uint8_t*>(cmdMessage), 0xc3, MESSAGE_FILL_LENGTH);
+
+        if (!DMARead(
+                messageAddress - 4,
+                messageLength + 4,
+                reinterpret_cast<uint8_t*>(cmdMessage)))
         {
+            ReleaseMessage(cmdMessage);
             PortError(PORT_ERROR_RING_READ);
             *error = true;
             return nullptr;
@@ -629,21 +636,20 @@ uda_c::GetNextCommand(bool* error)
                     GetCommandDescriptorAddress(
                         (_commandRingPointer - 1) % _commandRingLength);
 
-                std::unique_ptr<Descriptor> previousDescriptor(
-                    reinterpret_cast<Descriptor*>(
-                        DMARead(
-                            previousDescriptorAddress,
-                            sizeof(Descriptor),
-                            sizeof(Descriptor))));
+                Descriptor previousDescriptor;
 
-                if (!previousDescriptor)
+                if (!DMARead(
+                        previousDescriptorAddress,
+                        sizeof(Descriptor),
+                        reinterpret_cast<uint8_t*>(&previousDescriptor)))
                 {
+                    ReleaseMessage(cmdMessage);
                     PortError(PORT_ERROR_RING_READ);
                     *error = true;
                     return nullptr;
                 }
 
-                if (previousDescriptor->Word1.Fields.Ownership)
+                if (previousDescriptor.Word1.Fields.Ownership)
                 {
                     // We own the previous descriptor, so the ring was previously
                     // full.
@@ -657,13 +663,20 @@ uda_c::GetNextCommand(bool* error)
         // set the Flag bit (to indicate that we've processed it)
         // and return a pointer to the message.
         //
+        // If an interrupt is due, set ring base - 4 to non-zero to indicate
+        // a transition, in the same DMA chain.
+        //
         cmdDescriptor->Word1.Fields.Ownership = 0;
         cmdDescriptor->Word1.Fields.Flag = 1;
-        if (!DMAWrite(
-            descriptorAddress,
-            sizeof(Descriptor),
-            reinterpret_cast<uint8_t*>(cmdDescriptor.get())))
+        uint16_t transition = 0x1;
+        dma_segment_t segments[] = {
+            { QUNIBUS_CYCLE_DATO, descriptorAddress, 
+                reinterpret_cast<uint16_t*>(cmdDescriptor), sizeof(Descriptor) >> 1 },
+            { QUNIBUS_CYCLE_DATO, _ringBase - 4, &transition, 1 }
+        };
+        if (!DMAChain(segments, doInterrupt ? 2 : 1))
         {
+            ReleaseMessage(cmdMessage);
             PortError(PORT_ERROR_RING_WRITE);
             *error = true;
             return nullptr;
@@ -676,14 +689,10 @@ uda_c::GetNextCommand(bool* error)
         // Post an interrupt as necessary.
         if (doInterrupt)
         {
-            //
-            // Set ring base - 4 to non-zero to indicate a transition.
-            //
-            DMAWriteWord(_ringBase - 4, 0x1);
             Interrupt();
         }
 
-        return cmdMessage.release();
+        return cmdMessage;
     }
    
     DEBUG_FAST("No descriptor found.  0x%x 0x%x", cmdDescriptor->Word0.Word0, cmdDescriptor->Word1.Word1);  
@@ -695,26 +704,35 @@ uda_c::GetNextCommand(bool* error)
 //
 // PostResponse():
 //  Posts the provided Message to the response ring.
-//  Returns true on success, false otherwise.
-//  TODO: Need to handle NXM, as above.
+//  Returns true on success, false if the ring is full.
+//  On NXM the port is reset and error is set, as above.
 //
 bool
 uda_c::PostResponse(
-    Message* response
+    Message* response,
+    bool* error
 )
 {
+    const std::lock_guard<std::mutex> lock(_ringMutex);
     bool res = false;
+    *error = false;
 
     // Grab the next descriptor.
     uint32_t descriptorAddress = GetResponseDescriptorAddress(_responseRingPointer);
-    std::unique_ptr<Descriptor> cmdDescriptor(
-        reinterpret_cast<Descriptor*>(
-            DMARead(
-                descriptorAddress,
-                sizeof(Descriptor),
-                sizeof(Descriptor))));
+    Descriptor descriptor;
+    Descriptor* cmdDescriptor = &descriptor;
 
-    // TODO: if NULL is returned assume a bus error and handle it appropriately.
+    // A failed descriptor read indicates an NXM condition; we set SA to the appropriate
+    // error code and reset the port.
+    if (!DMARead(
+            descriptorAddress,
+            sizeof(Descriptor),
+            reinterpret_cast<uint8_t*>(cmdDescriptor)))
+    {
+        PortError(PORT_ERROR_PACKET_READ);
+        *error = true;
+        return false;
+    }
 
     //
     // Check owner bit: if set, ownership has been passed to us, in which case
@@ -778,12 +796,6 @@ uda_c::PostResponse(
         // This will fit; simply copy the response message over the top
         // of the buffer allocated on the host -- this updates the header fields
         // as necessary and provides the actual response data to the host.
-        //
-        DMAWrite(
-            messageAddress - 4,
-            response->MessageLength + 4,
-            reinterpret_cast<uint8_t*>(response));
-
         //
         // Check if a transition from empty to non-empty occurred, interrupt if requested.
         //
@@ -791,6 +803,26 @@ uda_c::PostResponse(
         // that the ring was previously empty (i.e. the descriptor we're now returning
         // is the first entry returned to the ring by the Port.)
         //
+        // If the host requests a transition interrupt, the previous entry is read 
+        // in the same DMA chain, after the response has been written.
+        //
+        bool checkPrevious = cmdDescriptor->Word1.Fields.Flag && _responseRingLength > 1;
+        uint32_t previousDescriptorAddress = checkPrevious ?
+            GetResponseDescriptorAddress((_responseRingPointer - 1) % _responseRingLength) : 0;
+        Descriptor previousDescriptor;
+        dma_segment_t segments[] = {
+            { QUNIBUS_CYCLE_DATO, messageAddress - 4, 
+                reinterpret_cast<uint16_t*>(response), (response->MessageLength + 4u) >> 1 },
+            { QUNIBUS_CYCLE_DATI, previousDescriptorAddress,
+                reinterpret_cast<uint16_t*>(&previousDescriptor), sizeof(Descriptor) >> 1 }
+        };
+        if (!DMAChain(segments, checkPrevious ? 2 : 1))
+        {
+            PortError(PORT_ERROR_PACKET_WRITE);
+            *error = true;
+            return false;
+        }
+
         if (cmdDescriptor->Word1.Fields.Flag)
         {
             //
@@ -802,47 +834,36 @@ uda_c::PostResponse(
                 // Degenerate case:  If the ring is of size 1 we always interrupt.
                 doInterrupt = true;
             }
-            else
+            else if (previousDescriptor.Word1.Fields.Ownership)
             {
-                uint32_t previousDescriptorAddress =
-                    GetResponseDescriptorAddress(
-                    (_responseRingPointer - 1) % _responseRingLength);
-
-                std::unique_ptr<Descriptor> previousDescriptor(
-                    reinterpret_cast<Descriptor*>(
-                        DMARead(
-                            previousDescriptorAddress,
-                            sizeof(Descriptor),
-                            sizeof(Descriptor))));
-
-                if (previousDescriptor->Word1.Fields.Ownership)
-                {
-                    // We own the previous descriptor, so the ring was previously
-                    // full.
-                    doInterrupt = true;
-                }
+                // We own the previous descriptor, so the ring was previously
+                // full.
+                doInterrupt = true;
             }
         }
 
         //
         // Message posted; reset the Owner bit of the response descriptor,
         // and set the Flag bit (to indicate that we've processed it).
+        // On interrupt, set ring base - 2 to non-zero to indicate a transition.
         //
         cmdDescriptor->Word1.Fields.Ownership = 0;
         cmdDescriptor->Word1.Fields.Flag = 1;
-        DMAWrite(
-            descriptorAddress,
-            sizeof(Descriptor),
-            reinterpret_cast<uint8_t*>(cmdDescriptor.get()));
+        uint16_t transition = 0x1;
+        segments[0] = { QUNIBUS_CYCLE_DATO, descriptorAddress, 
+                reinterpret_cast<uint16_t*>(cmdDescriptor), sizeof(Descriptor) >> 1 };
+        segments[1] = { QUNIBUS_CYCLE_DATO, _ringBase - 2, &transition, 1 };
+        if (!DMAChain(segments, doInterrupt ? 2 : 1))
+        {
+            PortError(PORT_ERROR_RING_WRITE);
+            *error = true;
+            return false;
+        }
 
         // Post an interrupt as necessary.
         if (doInterrupt)
         {
             DEBUG_FAST("Response ring no longer empty, interrupting.");
-            //
-            // Set ring base - 2 to non-zero to indicate a transition.
-            //
-            DMAWriteWord(_ringBase - 2, 0x1);
             Interrupt();
         }
 
@@ -1016,23 +1037,14 @@ uda_c::DMAReadWord(
     uint32_t address,
     bool& success)
 {
-    uint8_t* buffer = DMARead(
+    uint16_t word = 0;
+
+    success = DMARead(
         address,
         sizeof(uint16_t),
-        sizeof(uint16_t));
+        reinterpret_cast<uint8_t*>(&word));
 
-    if (buffer)
-    {
-        success = true;
-        uint16_t retval = *reinterpret_cast<uint16_t *>(buffer);
-        delete[] buffer;
-        return retval;
-    }
-    else
-    {
-        success = false;
-        return 0;
-    }
+    return word;
 }
 
 
@@ -1052,6 +1064,7 @@ uda_c::DMAWrite(
     assert ((lengthInBytes % 2) == 0);
     assert (address < 2* qunibus->addr_space_word_count); // exceeds address space? test for IOpage too?
 
+    const std::lock_guard<std::mutex> lock(_dmaMutex);
     qunibusadapter->DMA(dma_request, true,
             QUNIBUS_CYCLE_DATO,
             address,
@@ -1062,43 +1075,132 @@ uda_c::DMAWrite(
 
 //
 // DMARead():
-// Read data from Qbus/Unibus memory into the returned buffer.
-// Buffer returned is nullptr if memory could not be read.
-// Caller is responsible for freeing the buffer when done.
-// The address specified in 'address' must be word-aligned
-// and the length must be even.
+//  Read data from Qbus/Unibus memory into the provided buffer.  Returns
+//  true on success; if false is returned this is due to an NXM condition.
+//  If the buffer is from DMABufferAlloc() the PRU writes into it directly.
 //
-uint8_t*
+bool
 uda_c::DMARead(
     uint32_t address,
     size_t lengthInBytes,
-    size_t bufferSize)
+    uint8_t* buffer)
 {
-    assert (bufferSize >= lengthInBytes);
-    assert((lengthInBytes % 2) == 0);
+    assert ((lengthInBytes % 2) == 0);
     assert (address < 2* qunibus->addr_space_word_count); // exceeds address space? test for IOpage too?
 
-    uint16_t* buffer = new uint16_t[bufferSize >> 1];
+    const std::lock_guard<std::mutex> lock(_dmaMutex);
+    qunibusadapter->DMA(dma_request, true,
+            QUNIBUS_CYCLE_DATI,
+            address,
+            reinterpret_cast<uint16_t*>(buffer),
+            lengthInBytes >> 1);
+    return dma_request.success;
+}
+
+//
+// DMABufferAlloc():
+//  Allocate a transfer buffer in DDR memory, so the PRU DMAs directly
+//  from/to it without copying chunks through the mailbox.
+//  Falls back to heap memory if no DDR is available.
+//  Buffers are recycled by the pool of their size class.
+//  Free with DMABufferFree(), or hold in a std::unique_ptr with DMABufferDeleter.
+//
+uint8_t*
+uda_c::DMABufferAlloc(
+    size_t lengthInBytes)
+{
+    return _bufferPool.Alloc(lengthInBytes);
+}
+
+//
+// DMABufferFree():
+//  Return a transfer buffer to the pool of its size class.
+//
+void
+uda_c::DMABufferFree(
+    uint8_t* buffer)
+{
+    _bufferPool.Free(buffer);
+}
 
-    assert(buffer);
+uint8_t*
+DDRBufferPool::AllocMemory(
+    size_t lengthInBytes)
+{
+    return reinterpret_cast<uint8_t*>(
+        ddrmem->dma_buffer_alloc((lengthInBytes + 1) >> 1));
+}
 
-    memset(reinterpret_cast<uint8_t*>(buffer), 0xc3, bufferSize);
+void
+DDRBufferPool::FreeMemory(
+    uint8_t* memory)
+{
+    ddrmem->dma_buffer_free(reinterpret_cast<uint16_t*>(memory));
+}
 
-    qunibusadapter->DMA(dma_request, true,
-                QUNIBUS_CYCLE_DATI,
-                address,
-                buffer,
-                lengthInBytes >> 1);
-
-    if (dma_request.success)
-    { 
-	return reinterpret_cast<uint8_t*>(buffer);
+//
+// AllocMessage():
+//  Returns a buffer for a command message, from the pool if one is free.
+//
+Message*
+uda_c::AllocMessage(void)
+{
+    {
+        const std::lock_guard<std::mutex> lock(_poolMutex);
+        if (!_freeMessages.empty())
+        {
+            Message* message = _freeMessages.back();
+            _freeMessages.pop_back();
+            return message;
+        }
     }
-    else
+
+    return new Message;
+}
+
+//
+// ReleaseMessage():
+//  Returns a command message to the pool.
+//
+void
+uda_c::ReleaseMessage(
+    Message* message)
+{
+    const std::lock_guard<std::mutex> lock(_poolMutex);
+    _freeMessages.push_back(message);
+}
+
+//
+// FreePools():
+//  Frees all pooled messages and transfer buffers.
+//  DDR buffers must be returned before the PRU is stopped.
+//
+void
+uda_c::FreePools(void)
+{
+    const std::lock_guard<std::mutex> lock(_poolMutex);
+    for (Message* message : _freeMessages)
     {
-//    ARM_DEBUG_PIN0(1) ;
-//printf("UDA.DMARead NXM: address=%07o,len=%d words, failing addr=%07o",
-//		address, lengthInBytes >> 1, dma_request.qunibus_end_addr ) ;
-        return nullptr;     
+        delete message;
     }
-} 
+    _freeMessages.clear();
+
+    _bufferPool.FreeAll();
+}
+
+//
+// DMAChain():
+//  Transfer a list of segments in order as one scatter/gather DMA request,
+//  each segment with its own direction, address and buffer.
+//  Returns true on success; if false is returned a segment hit an NXM 
+//  condition and the following segments were not transferred.
+//
+bool
+uda_c::DMAChain(
+    const dma_segment_t* segments,
+    unsigned segmentCount)
+{
+    const std::lock_guard<std::mutex> lock(_dmaMutex);
+    qunibusadapter->DMA(dma_request, true, segments, segmentCount);
+    return dma_request.success;
+}
@@ -8,12 +8,15 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
+#include <vector>
 #include "utils.hpp"
 #include "qunibusadapter.hpp"
 #include "qunibusdevice.hpp"
 #include "storagecontroller.hpp"
 #include "mscp_server.hpp"
 #include "mscp_drive.hpp"
+#include "dmabufferpool.hpp"
 
 // The number of drives supported by the controller.
 // This is arbitrarily fixed at 8 but could be set to any
@@ -28,6 +31,10 @@
 // to prevent parsing clearly invalid commands.
 #define MAX_MESSAGE_LENGTH 0x1000
 
+// Command messages are recycled; before a command is read the first bytes
+// are filled with a pattern.  This covers all responses (max 60 bytes.)
+#define MESSAGE_FILL_LENGTH 128
+
 #define STEP1    0x0800
 #define STEP2    0x1000
 #define STEP3    0x2000
@@ -62,6 +69,20 @@ struct Message
 };
 #pragma pack(pop)
 
+//
+// Transfer buffers in DDR memory, so the PRU DMAs directly
+// from/to them without copying chunks through the mailbox.
+//
+class DDRBufferPool : public DMABufferPool
+{
+public:
+    ~DDRBufferPool() { FreeAll(); }
+
+protected:
+    uint8_t* AllocMemory(size_t lengthInBytes) override;
+    void FreeMemory(uint8_t* memory) override;
+};
+
 /*
   This implements the Transport layer for a Qbus/Unibus MSCP controller.
 
@@ -105,11 +126,18 @@ public:
     //
     Message* GetNextCommand(bool* error);
 
+    //
+    // Returns a command message to the pool, after the response
+    // has been posted or the command was discarded.
+    //
+    void ReleaseMessage(Message* message);
+
     //
     // Posts a response message to the response ring and memory
     // if there is space.
-    // Returns FALSE if the ring is full.
-    bool PostResponse(Message* response);
+    // Returns FALSE if the ring is full.  error is set to true if
+    // a DMA failed, the port is reset then and the response is lost.
+    bool PostResponse(Message* response, bool* error);
 
     uint32_t GetControllerIdentifier(void);
     uint16_t GetControllerClassModel(void);
@@ -139,7 +167,10 @@ public:
     uint16_t DMAReadWord(uint32_t address, bool& success);
 
     bool DMAWrite(uint32_t address, size_t lengthInBytes, uint8_t* buffer);
-    uint8_t* DMARead(uint32_t address, size_t lengthInBytes, size_t bufferSize);
+    bool DMARead(uint32_t address, size_t lengthInBytes, uint8_t* buffer);
+    uint8_t* DMABufferAlloc(size_t lengthInBytes);
+    void DMABufferFree(uint8_t* buffer);
+    bool DMAChain(const dma_segment_t* segments, unsigned segmentCount);
 
 private:
     void update_SA(uint16_t value);
@@ -150,6 +181,20 @@ private:
 
     std::shared_ptr<mscp_server> _server;
 
+    // The server executes commands of different units in parallel:
+    // only one DMA at a time on dma_request, and the command and
+    // response ring are accessed by one thread at a time.
+    std::mutex _dmaMutex;
+    std::mutex _ringMutex;
+
+    // Recycled command messages and transfer buffers, so in steady state
+    // no heap allocation is done per command.
+    std::mutex _poolMutex;
+    std::vector<Message*> _freeMessages;
+    DDRBufferPool _bufferPool;
+    Message* AllocMessage(void);
+    void FreePools(void);
+
     uint32_t _ringBase;
 
     // Lengths are in terms of slots (32 bits each) in the
@@ -215,3 +260,17 @@ private:
     #pragma pack(pop) 
 };
 
+//
+// Releases transfer buffers from uda_c::DMABufferAlloc(), for std::unique_ptr.
+//
+struct DMABufferDeleter
+{
+    DMABufferDeleter(uda_c* port) : _port(port) {}
+
+    void operator()(uint8_t* buffer) const
+    {
+        _port->DMABufferFree(buffer);
+    }
+
+    uda_c* _port;
+};
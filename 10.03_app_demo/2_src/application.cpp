@@ -31,6 +31,8 @@
  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+ 16-oct-2026  QC      storagedrive_aio thread pool
+ 16-oct-2026  QC      latency recorder
  12-nov-2018  JH      entered beta phase
  14-May-2018 	JH      created
 
@@ -68,6 +70,8 @@
 #include "panel.hpp"
 #include "qunibus.h"
 #include "qunibusadapter.hpp"
+#include "latency.hpp"
+#include "storagedrive_aio.hpp"
 
 #include "logger.hpp"
 #include "application.hpp"   // own
@@ -310,10 +314,12 @@ int application_c::run(int argc, char *argv[])
     INFO("Printing verbose output.");
     DEBUG("Printing DEBUG output. Log file = \"%s\"", logger->default_filepath.c_str());
 
+#ifndef VIRTUAL_PRU
     /* prussdrv_init() will segfault if called with EUID != 0 */
     if (geteuid()) {
         FATAL("%s must be run as root to use prussdrv\n", argv[0]);
     }
+#endif
 
     inputline.init();
     if (!opt_cmdfilename.empty()) {
@@ -368,6 +374,11 @@ static void factory()
     // qunibusadapter.worker() needs initialized mailbox
     qunibusadapter = new qunibusadapter_c();
 
+    latency_recorder = new latency_recorder_c();
+
+    // image I/O of all storage drives
+    storagedrive_aio = new storagedrive_aio_c(4);
+
     app = new application_c();
 }
 
@@ -98,6 +98,7 @@ public:
 	void menu_interrupts(const char *menu_code);
 	void menu_devices(const char *menu_code, bool with_CPU);
 	void menu_device_exercisers(const char *menu_code);
+	void menu_latency(const char *menu_code);
 
 	void menu_main(void);
 
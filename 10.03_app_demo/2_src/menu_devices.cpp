@@ -23,6 +23,7 @@
  16-Nov-2018  JH      created
  16-Oct-2022  MR      Copied the "m lt file" option from other menu to here
  27-Feb-2023  JD/JH   RS11/RF11 new. KE11 EAE for UNIBUS.
+ 16-Oct-2026  QC      "st": storage drive self test, blocking and async accesses
  */
 
 #include <stdio.h>
@@ -131,8 +132,6 @@ static void print_device(device_c *device)
 void application_c::menu_devices(const char *menu_code, bool with_emulated_CPU)
 {
     /** list of usable devices ***/
-    bool with_storage_file_test = false;
-
     bool ready = false;
     bool show_help = true ;
     bool memory_emulated = false;
@@ -247,13 +246,6 @@ void application_c::menu_devices(const char *menu_code, bool with_emulated_CPU)
     }
 #endif
 
-    if (with_storage_file_test) {
-        const char *testfname = "/tmp/storagedrive_selftest.bin";
-        remove(testfname);
-        storagedrive_selftest_c dut(testfname, /* block_size*/1024, /* block_count */137);
-        dut.test();
-    }
-
     // now devices are "Plugged in". Reset PDP-11.
 //	qunibus->probe_grant_continuity(true);
 
@@ -322,6 +314,7 @@ void application_c::menu_devices(const char *menu_code, bool with_emulated_CPU)
             }
             printf("dbg c|s|f            Debug log: Clear, Show on console, dump to File.\n");
             printf("                       (file = %s)\n", logger->default_filepath.c_str());
+            printf("st                   Self test of storage drive image access\n");
             printf("init                 Pulse " QUNIBUS_NAME " INIT\n");
 #if defined(UNIBUS)
             printf("pwr                  Simulate UNIBUS power cycle (ACLO/DCLO)\n");
@@ -339,6 +332,13 @@ void application_c::menu_devices(const char *menu_code, bool with_emulated_CPU)
                               s_param[2]);
             if (!strcasecmp(s_opcode, "q")) {
                 ready = true;
+            } else if (!strcasecmp(s_opcode, "st") && n_fields == 1) {
+                const char *testfname = "/tmp/storagedrive_selftest.bin";
+                remove(testfname);
+                storagedrive_selftest_c dut(testfname, /* block_size*/1024, /* block_count */137);
+                dut.test(); // exit() on error
+                remove(testfname);
+                printf("Storage drive self test OK.\n");
             } else if (!strcasecmp(s_opcode, "init")) {
                 qunibus->init();
             } else if (!strcasecmp(s_opcode, "pwr")) {
@@ -20,6 +20,7 @@
  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
+ 16-oct-2026  QC      latency histograms
  12-nov-2018  JH      entered beta phase
  15-May-2016  JH      created
  */
@@ -35,6 +36,7 @@
 
 #include "qunibus.h"
 #include "ddrmem.h"
+#include "latency.hpp"
 
 #include "application.hpp" // own
 
@@ -216,6 +218,7 @@ void application_c::print_params(parameterized_c *parameterized, parameter_c *p)
     grid.set(4, 0, "Access");
     grid.set(5, 0, "Info");
 
+    parameterized->on_params_render() ;
     std::vector<parameter_c *>::iterator it;
     r = 1;
     for (it = parameterized->parameter.begin(); it != parameterized->parameter.end(); ++it)
@@ -231,6 +234,56 @@ void application_c::print_params(parameterized_c *parameterized, parameter_c *p)
     grid.print("  ", '-');
 }
 
+/**********************************************
+ * Latency histograms of PRU->ARM->PRU path
+ * Recorded while devices run in menu "d" or "dc".
+ * */
+void application_c::menu_latency(const char *menu_code)
+{
+    bool show_help = true; // show cmds on first screen, then only on error or request
+    bool ready = false;
+    char *s_choice;
+    char s_opcode[256], s_param[256];
+    int n_fields;
+    while (!ready) {
+        // no menu display when reading script
+        if (show_help && !script_active()) {
+            show_help = false; // only once
+            printf("\n");
+            printf("*** Latency of " QUNIBUS_NAME " device register events, DMA and INTR.\n");
+            printf("    Recording is %s.\n", latency_recorder->enabled ? "enabled" : "disabled");
+            printf("e <1|0>          Enable/disable recording\n");
+            printf("s                Show latencies of all devices\n");
+            printf("c                Clear histograms\n");
+            printf("f [<filename>]   Save histograms as CSV (default \"latency.csv\")\n");
+            printf("q                Quit\n");
+        }
+        s_choice = getchoice(menu_code);
+        printf("\n");
+        n_fields = sscanf(s_choice, "%s %s", s_opcode, s_param);
+        if (n_fields <= 0)
+            continue;
+        if (!strcasecmp(s_opcode, "q")) {
+            ready = true;
+        } else if (!strcasecmp(s_opcode, "e") && n_fields == 2) {
+            latency_recorder->enabled = !!strtol(s_param, NULL, 10);
+            printf("Latency recording %s.\n", latency_recorder->enabled ? "enabled" : "disabled");
+        } else if (!strcasecmp(s_opcode, "s")) {
+            latency_recorder->print();
+        } else if (!strcasecmp(s_opcode, "c")) {
+            latency_recorder->clear();
+            printf("Latency histograms cleared.\n");
+        } else if (!strcasecmp(s_opcode, "f")) {
+            const char *filename = (n_fields == 2) ? s_param : "latency.csv";
+            if (latency_recorder->save_csv(filename))
+                printf("Latency histograms saved to \"%s\".\n", filename);
+        } else {
+            printf("Unknown command \"%s\"!\n", s_choice);
+            show_help = true;
+        }
+    }
+}
+
 /**********************************************
  *	Main menu
  */
@@ -269,6 +322,7 @@ void application_c::menu_main(void)
             // printf("de          Device Exerciser: work with devices on the " QUNIBUS_NAME " without PDP-11 CPU arbitration\n");
             printf(
                 "m           Full memory slave emulation with DMA bus master functions by PDP-11 CPU.\n");
+            printf("lh          Latency histograms of device events, DMA and INTR\n");
             printf("i           Info, help\n");
             printf("q           Quit\n");
         }
@@ -305,6 +359,8 @@ void application_c::menu_main(void)
                 menu_device_exercisers("DE");
             } else if (!strcasecmp(opcode, "m")) {
                 menu_masterslave("M", /*with_CPU*/true);
+            } else if (!strcasecmp(opcode, "lh")) {
+                menu_latency("LH");
             } else if (!strcasecmp(opcode, "i")) {
                 menu_info("I");
             } else {